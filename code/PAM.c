@@ -0,0 +1,173 @@
+/* ------------------------------------------------------------------------- *
+ * Implementation of the PAM interface
+ * ------------------------------------------------------------------------- */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "PAM.h"
+#include "PNM.h"
+
+// Longest line of a PAM header read
+#define HEADER_LINE_SIZE 256
+
+// Methods
+
+PAMImage* createPAM(size_t width, size_t height, size_t depth) {
+    if (depth == 0) {
+        return NULL;
+    }
+
+    PAMImage* image = (PAMImage*) malloc(sizeof(PAMImage));
+    if (!image) {
+        return NULL;
+    }
+
+    image->width = width;
+    image->height = height;
+    image->depth = depth;
+
+    image->data = (unsigned char*) malloc(width * height * depth);
+    if (!image->data && width * height > 0) {
+        free(image);
+        return NULL;
+    }
+
+    return image;
+}
+
+void freePAM(PAMImage* image) {
+    if (image) {
+        free(image->data);
+        free(image);
+    }
+}
+
+/* ------------------------------------------------------------------------- *
+ * Read the header of a P7 file, after its magic number, up to its ENDHDR
+ * line, leaving the stream at the first pixel.
+ *
+ * PARAMETERS
+ * fp           Stream positioned after the magic number
+ * width        Where to store the width of the image (in pixels)
+ * height       Where to store the height of the image (in pixels)
+ * depth        Where to store the number of channels
+ *
+ * RETURN
+ * 0            In case of success
+ * -1           Otherwise
+ * ------------------------------------------------------------------------- */
+static int readPAMHeader(FILE* fp, size_t* width, size_t* height, size_t* depth) {
+    char line[HEADER_LINE_SIZE];
+    char token[16];
+    size_t value;
+    size_t maxValue = 0;
+
+    *width = 0;
+    *height = 0;
+    *depth = 0;
+
+    while (fgets(line, sizeof(line), fp)) {
+        if (line[0] == '#' || sscanf(line, "%15s", token) != 1) {
+            continue;
+        }
+
+        if (strcmp(token, "ENDHDR") == 0) {
+            return (*width > 0 && *height > 0 && *depth > 0 && maxValue == 255) ? 0 : -1;
+        }
+
+        if (strcmp(token, "TUPLTYPE") == 0) {
+            continue;
+        }
+
+        if (sscanf(line, "%15s %zu", token, &value) != 2) {
+            return -1;
+        }
+
+        if (strcmp(token, "WIDTH") == 0) {
+            *width = value;
+        } else if (strcmp(token, "HEIGHT") == 0) {
+            *height = value;
+        } else if (strcmp(token, "DEPTH") == 0) {
+            *depth = value;
+        } else if (strcmp(token, "MAXVAL") == 0) {
+            maxValue = value;
+        } else {
+            return -1;
+        }
+    }
+
+    return -1;
+}
+
+PAMImage* readPAM(const char* filename) {
+    // Open PAM file for reading
+    FILE* fp = fopen(filename, "rb");
+    if (!fp) {
+        return NULL;
+    }
+
+    // Read image format, then the header of the format
+    char magic[3] = {0};
+    size_t width;
+    size_t height;
+    size_t depth = 3;
+    int result = -1;
+
+    if (fread(magic, 1, 2, fp) == 2 && magic[0] == 'P') {
+        // The header of a PNM file is read as by readPNM(), from the start
+        if (magic[1] == '6') {
+            result = fseek(fp, 0, SEEK_SET) == 0 ? readPNMStreamHeader(fp, &width, &height) : -1;
+        } else if (magic[1] == '7' && fgetc(fp) == '\n') {
+            result = readPAMHeader(fp, &width, &height, &depth);
+        }
+    }
+
+    if (result != 0) {
+        fclose(fp);
+        return NULL;
+    }
+
+    // Allocate memory
+    PAMImage* image = createPAM(width, height, depth);
+    if (!image) {
+        fclose(fp);
+        return NULL;
+    }
+
+    // Read pixels
+    if (fread(image->data, width * depth, height, fp) != height) {
+        freePAM(image);
+        fclose(fp);
+        return NULL;
+    }
+
+    fclose(fp);
+    return image;
+}
+
+int writePAM(const char* filename, const PAMImage* image) {
+    FILE* fp = fopen(filename, "wb");
+    if (!fp) {
+        return -1;
+    }
+
+    const char* tupleType = image->depth == 3 ? "TUPLTYPE RGB\n" :
+                            image->depth == 1 ? "TUPLTYPE GRAYSCALE\n" : "";
+
+    int result = fprintf(fp, "P7\nWIDTH %zu\nHEIGHT %zu\nDEPTH %zu\nMAXVAL 255\n%sENDHDR\n",
+                         image->width, image->height, image->depth, tupleType) < 0 ? -1 : 0;
+
+    if (result == 0 && image->width > 0 &&
+        fwrite(image->data, image->width * image->depth, image->height, fp) != image->height) {
+        result = -1;
+    }
+
+    if (fclose(fp) != 0) {
+        result = -1;
+    }
+
+    return result;
+}
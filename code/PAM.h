@@ -0,0 +1,78 @@
+/* ------------------------------------------------------------------------- *
+ * PAM.
+ * Interface for loading and writing PAM images (the portable arbitrary map
+ * of Netpbm), whose pixels have any number of channels, such as
+ * multispectral captures.
+ * ------------------------------------------------------------------------- */
+
+#ifndef _PAM_H_
+#define _PAM_H_
+
+#include <stddef.h>
+
+
+// Types ----------------------------------------------------------------------
+
+typedef struct {
+    size_t width;
+    size_t height;
+    size_t depth;           // Number of channels of each pixel
+    unsigned char* data;    // Channel c of pixel (i, j) is at position
+                            // (i * width + j) * depth + c
+} PAMImage;
+
+
+// Methods --------------------------------------------------------------------
+
+/* ------------------------------------------------------------------------- *
+ * Create an empty PAM image.
+ * The PAM image must later be deleted by calling freePAM().
+ *
+ * PARAMETERS
+ * width        Width of the image (in pixels)
+ * height       Height of the image (in pixels)
+ * depth        Number of channels of each pixel (at least 1)
+ *
+ * RETURN
+ * image        Pointer to an empty PAM image
+ * NULL         if an error occured
+ * ------------------------------------------------------------------------- */
+PAMImage* createPAM(size_t width, size_t height, size_t depth);
+
+/* ------------------------------------------------------------------------- *
+ * Free a PAM image.
+ *
+ * PARAMETER
+ * image        Pointer to a PAM image
+ * ------------------------------------------------------------------------- */
+void freePAM(PAMImage* image);
+
+/* ------------------------------------------------------------------------- *
+ * Load a PAM image from a file (P7, with a MAXVAL of 255; the TUPLTYPE is
+ * ignored). A PNM file (P6) is loaded as an image of 3 channels.
+ * The PAM image must later be deleted by calling freePAM().
+ *
+ * PARAMETERS
+ * filename     Path to the PAM file
+ *
+ * RETURN
+ * image        Pointer to the loaded PAM image
+ * NULL         if an error occured
+ * ------------------------------------------------------------------------- */
+PAMImage* readPAM(const char* filename);
+
+/* ------------------------------------------------------------------------- *
+ * Write a PAM image into a file (P7). Its TUPLTYPE is RGB for 3 channels,
+ * GRAYSCALE for 1, and left out otherwise.
+ *
+ * PARAMETERS
+ * filename     Path to the PAM file
+ * image        Pointer to the PAM image to write
+ *
+ * RETURN
+ * 0            In case of success
+ * -1           Otherwise
+ * ------------------------------------------------------------------------- */
+int writePAM(const char* filename, const PAMImage* image);
+
+#endif // _PAM_H_
@@ -3,12 +3,57 @@
  *
  * Partly adapted from http://stackoverflow.com/a/2699908
  * ------------------------------------------------------------------------- */
+#define _GNU_SOURCE
+
 #include <stdlib.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
 
 #include "PNM.h"
+#include "timing.h"
+
+// Alignment of the buffers and writes, as required by O_DIRECT
+#define WRITE_ALIGNMENT 4096
+
+// Size of the row bands read by startPNMLoad() by default
+#define LOAD_CHUNK_SIZE (4 << 20)
+
+// Chunks of a raster read by one thread of readPNMWithOptions()
+typedef struct {
+    int fd;                 // The PNM file
+    unsigned char* buffer;  // The raster
+    size_t size;            // The size of the raster (in bytes)
+    off_t offset;           // Offset of the raster in the file
+    size_t chunkSize;       // Size of each read (in bytes)
+    size_t first;           // Index of the first chunk read by the thread
+    size_t step;            // Distance between two chunks read by the thread
+    bool failed;            // Whether a chunk could not be read
+} ReadChunks;
+
+// Loading of an image by a background thread
+struct PNMLoad_t {
+    PNMImage* image;        // The image, whose rows arrive in order
+    FILE* fp;               // The PNM file
+    off_t offset;           // Offset of the first pixel in the file
+    size_t chunkSize;       // Size of each read (in bytes)
+    pthread_t thread;       // The thread reading the rows
+    pthread_mutex_t lock;   // Protects the fields below
+    pthread_cond_t arrived; // Signaled when rows arrive or the loading ends
+    size_t nbRows;          // Number of rows loaded
+    bool over;              // Whether the loading is over (complete or not)
+};
+
+// Background synchronisations in progress, and whether one of them failed
+static pthread_mutex_t syncLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t syncDone = PTHREAD_COND_INITIALIZER;
+static size_t nbPendingSyncs = 0;
+static bool syncFailed = false;
 
 // Methods
 
@@ -37,56 +82,182 @@ void freePNM(PNMImage* image) {
     }
 }
 
-PNMImage* readPNM(const char* filename){
-    char buffer[16];
-    int c;
+PNMView getPNMView(PNMImage* image) {
+    PNMView view;
 
-    // Open PNM file for reading
-    FILE* fp = fopen(filename, "rb");
-    if (!fp) {
-        return NULL;
+    view.width = image->width;
+    view.height = image->height;
+    view.stride = image->width;
+    view.data = image->data;
+
+    return view;
+}
+
+int getPNMSubView(const PNMView* view, size_t top, size_t left, size_t width,
+                  size_t height, PNMView* subView) {
+    if (top > view->height || height > view->height - top ||
+        left > view->width || width > view->width - left) {
+        return -1;
     }
 
+    subView->width = width;
+    subView->height = height;
+    subView->stride = view->stride;
+    subView->data = view->data + top * view->stride + left;
+
+    return 0;
+}
+
+int readPNMStreamHeader(FILE* fp, size_t* width, size_t* height) {
+    char buffer[16];
+    int c;
+
     // Read image format
     if (!fgets(buffer, sizeof(buffer), fp)) {
-        return NULL;
+        return -1;
     }
 
     if (buffer[0] != 'P' || buffer[1] != '6') {
-        return NULL;
+        return -1;
     }
 
     // Check for comments
     c = getc(fp);
     while (c == '#') {
-        while (getc(fp) != '\n');
+        while ((c = getc(fp)) != '\n' && c != EOF);
         c = getc(fp);
     }
 
     ungetc(c, fp);
 
     // Read image size
+    if (fscanf(fp, "%zu %zu", width, height) != 2) {
+        return -1;
+    }
+
+    // Read RGB depth
+    if (fscanf(fp, "%d", &c) != 1) {
+        return -1;
+    }
+
+    if (c != 255) {
+        return -1;
+    }
+
+    while ((c = fgetc(fp)) != '\n' && c != EOF) ;
+
+    return 0;
+}
+
+int readPNMHeader(const char* filename, size_t* width, size_t* height) {
+    FILE* fp = fopen(filename, "rb");
+    if (!fp) {
+        return -1;
+    }
+
+    int result = readPNMStreamHeader(fp, width, height);
+
+    fclose(fp);
+    return result;
+}
+
+/* ------------------------------------------------------------------------- *
+ * Parse a decimal number in a buffer, skipping the whitespaces before it.
+ *
+ * PARAMETERS
+ * buffer       The buffer
+ * size         The size of the buffer (in bytes)
+ * position     Position of the parser, moved after the number
+ * value        Where to store the number
+ *
+ * RETURN
+ * 0            In case of success
+ * -1           Otherwise
+ * ------------------------------------------------------------------------- */
+static int parseNumber(const unsigned char* buffer, size_t size,
+                       size_t* position, size_t* value) {
+    while (*position < size && (buffer[*position] == ' ' ||
+           buffer[*position] == '\t' || buffer[*position] == '\r' ||
+           buffer[*position] == '\n')) {
+        (*position)++;
+    }
+
+    if (*position >= size || buffer[*position] < '0' || buffer[*position] > '9') {
+        return -1;
+    }
+
+    *value = 0;
+    while (*position < size && buffer[*position] >= '0' && buffer[*position] <= '9') {
+        *value = *value * 10 + (buffer[*position] - '0');
+        (*position)++;
+    }
+
+    return 0;
+}
+
+PNMImage* parsePNM(const unsigned char* buffer, size_t size) {
+    size_t position = 0;
+
+    // Read image format
+    if (size < 2 || buffer[0] != 'P' || buffer[1] != '6') {
+        return NULL;
+    }
+
+    while (position < size && buffer[position++] != '\n') ;
+
+    // Check for comments
+    while (position < size && buffer[position] == '#') {
+        while (position < size && buffer[position++] != '\n') ;
+    }
+
+    // Read image size and RGB depth
     size_t width;
     size_t height;
+    size_t depth;
 
-    if (fscanf(fp, "%zu %zu", &width, &height) != 2) {
+    if (parseNumber(buffer, size, &position, &width) != 0 ||
+        parseNumber(buffer, size, &position, &height) != 0 ||
+        parseNumber(buffer, size, &position, &depth) != 0 || depth != 255) {
         return NULL;
     }
 
-    // Read RGB depth
-    if (fscanf(fp, "%d", &c) != 1) {
+    while (position < size && buffer[position++] != '\n') ;
+
+    if (width == 0 || (size - position) / 3 / width < height) {
         return NULL;
     }
 
-    if (c != 255) {
+    // Allocate memory and copy pixels
+    PNMImage* image = createPNM(width, height);
+    if (!image) {
         return NULL;
     }
 
-    while (fgetc(fp) != '\n') ;
+    memcpy(image->data, buffer + position, 3 * width * height);
+
+    return image;
+}
+
+PNMImage* readPNM(const char* filename){
+    // Open PNM file for reading
+    FILE* fp = fopen(filename, "rb");
+    if (!fp) {
+        return NULL;
+    }
+
+    // Read image format, size and RGB depth
+    size_t width;
+    size_t height;
+
+    if (readPNMStreamHeader(fp, &width, &height) != 0) {
+        fclose(fp);
+        return NULL;
+    }
 
     // Allocate memory
     PNMImage* image = createPNM(width, height);
     if (!image) {
+        fclose(fp);
         return NULL;
     }
 
@@ -94,6 +265,7 @@ PNMImage* readPNM(const char* filename){
     if (fread(image->data, 3 * image->width,
               image->height, fp) != image->height) {
         freePNM(image);
+        fclose(fp);
         return NULL;
     }
 
@@ -101,22 +273,558 @@ PNMImage* readPNM(const char* filename){
     return image;
 }
 
-int writePNM(const char* filename, const PNMImage* image){
-    // Open file
-    FILE* fp;
+/* ------------------------------------------------------------------------- *
+ * Read a whole buffer at a given offset of a file.
+ *
+ * PARAMETERS
+ * fd           The file descriptor
+ * buffer       The buffer to fill
+ * size         The size of the buffer (in bytes)
+ * offset       The offset in the file
+ *
+ * RETURN
+ * 0            In case of success
+ * -1           Otherwise (including the end of the file)
+ * ------------------------------------------------------------------------- */
+static int readAll(int fd, unsigned char* buffer, size_t size, off_t offset) {
+    while (size > 0) {
+        ssize_t nbRead = pread(fd, buffer, size, offset);
+        if (nbRead < 0 && errno == EINTR) {
+            continue;
+        }
+        if (nbRead <= 0) {
+            return -1;
+        }
+
+        buffer += nbRead;
+        size -= (size_t)nbRead;
+        offset += nbRead;
+    }
+
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * Read the rows of an image, a band at a time, announcing each band.
+ *
+ * PARAMETERS
+ * argument     The PNMLoad
+ *
+ * RETURN
+ * NULL
+ * ------------------------------------------------------------------------- */
+static void* loadRoutine(void* argument) {
+    PNMLoad* load = argument;
+    PNMImage* image = load->image;
+    size_t rowSize = 3 * image->width;
+    size_t bandHeight = load->chunkSize / rowSize > 0 ? load->chunkSize / rowSize : 1;
+
+    for (size_t row = 0; row < image->height; row += bandHeight) {
+        size_t nbRows = image->height - row < bandHeight ? image->height - row : bandHeight;
+
+        if (readAll(fileno(load->fp), (unsigned char*)image->data + row * rowSize,
+                    nbRows * rowSize, load->offset + (off_t)(row * rowSize)) != 0) {
+            break;
+        }
 
-    fp = fopen(filename, "wb");
+        pthread_mutex_lock(&load->lock);
+        load->nbRows = row + nbRows;
+        pthread_cond_broadcast(&load->arrived);
+        pthread_mutex_unlock(&load->lock);
+    }
+
+    pthread_mutex_lock(&load->lock);
+    load->over = true;
+    pthread_cond_broadcast(&load->arrived);
+    pthread_mutex_unlock(&load->lock);
+
+    return NULL;
+}
+
+/* ------------------------------------------------------------------------- *
+ * Read every step-th chunk of a raster, from the first-th one.
+ *
+ * PARAMETERS
+ * argument     The ReadChunks
+ *
+ * RETURN
+ * NULL
+ * ------------------------------------------------------------------------- */
+static void* readRoutine(void* argument) {
+    ReadChunks* chunks = argument;
+
+    for (size_t start = chunks->first * chunks->chunkSize; start < chunks->size;
+         start += chunks->step * chunks->chunkSize) {
+        size_t size = chunks->size - start < chunks->chunkSize ?
+                      chunks->size - start : chunks->chunkSize;
+
+        if (readAll(chunks->fd, chunks->buffer + start, size,
+                    chunks->offset + (off_t)start) != 0) {
+            chunks->failed = true;
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+void initPNMReadOptions(PNMReadOptions* options) {
+    options->chunkSize = 8 << 20;
+    options->nbThreads = 4;
+}
+
+PNMImage* readPNMWithOptions(const char* filename, const PNMReadOptions* options,
+                             PNMReadStats* stats) {
+    PNMReadOptions defaultOptions;
+    if (!options) {
+        initPNMReadOptions(&defaultOptions);
+        options = &defaultOptions;
+    }
+
+    double startTime = getTimeSeconds();
+
+    FILE* fp = fopen(filename, "rb");
     if (!fp) {
-        return -1;
+        return NULL;
     }
 
-    // Write content
-    fprintf(fp, "P6\n");
-    fprintf(fp, "%zu %zu\n",image->width, image->height);
-    fprintf(fp, "255\n");
-    fwrite(image->data, 3 * image->width, image->height, fp);
+    size_t width;
+    size_t height;
+    long offset;
+
+    if (readPNMStreamHeader(fp, &width, &height) != 0 || (offset = ftell(fp)) < 0) {
+        fclose(fp);
+        return NULL;
+    }
 
+    PNMImage* image = createPNM(width, height);
+    if (!image) {
+        fclose(fp);
+        return NULL;
+    }
+
+    // Each thread reads every nbThreads-th chunk straight into the raster,
+    // so that its pages are also first touched in parallel
+    size_t size = 3 * width * height;
+    size_t chunkSize = options->chunkSize > 0 ? options->chunkSize : size;
+    if (chunkSize == 0) {
+        chunkSize = 1;
+    }
+    size_t nbChunks = size / chunkSize + (size % chunkSize != 0);
+    size_t nbThreads = options->nbThreads < nbChunks ? options->nbThreads : nbChunks;
+    if (nbThreads < 1) {
+        nbThreads = 1;
+    }
+
+    ReadChunks* chunks = malloc(sizeof(ReadChunks) * nbThreads);
+    pthread_t* threads = malloc(sizeof(pthread_t) * nbThreads);
+    if (!chunks || !threads) {
+        free(chunks);
+        free(threads);
+        freePNM(image);
+        fclose(fp);
+        return NULL;
+    }
+
+    for (size_t t = 0; t < nbThreads; t++) {
+        chunks[t].fd = fileno(fp);
+        chunks[t].buffer = (unsigned char*)image->data;
+        chunks[t].size = size;
+        chunks[t].offset = (off_t)offset;
+        chunks[t].chunkSize = chunkSize;
+        chunks[t].first = t;
+        chunks[t].step = nbThreads;
+        chunks[t].failed = false;
+    }
+
+    // The first chunks are read by the current thread
+    size_t nbStarted = 0;
+    for (size_t t = 1; t < nbThreads; t++) {
+        if (pthread_create(&threads[t], NULL, readRoutine, &chunks[t]) != 0) {
+            break;
+        }
+        nbStarted = t;
+    }
+
+    readRoutine(&chunks[0]);
+
+    for (size_t t = 1; t <= nbStarted; t++) {
+        pthread_join(threads[t], NULL);
+    }
+
+    // The chunks of the threads which could not be created are read now
+    for (size_t t = nbStarted + 1; t < nbThreads; t++) {
+        readRoutine(&chunks[t]);
+    }
+
+    bool failed = false;
+    for (size_t t = 0; t < nbThreads; t++) {
+        failed = failed || chunks[t].failed;
+    }
+
+    free(chunks);
+    free(threads);
     fclose(fp);
 
+    if (failed) {
+        freePNM(image);
+        return NULL;
+    }
+
+    if (stats) {
+        stats->nbBytes = size;
+        stats->seconds = getTimeSeconds() - startTime;
+    }
+
+    return image;
+}
+
+PNMLoad* startPNMLoad(const char* filename, size_t chunkSize) {
+    PNMLoad* load = malloc(sizeof(PNMLoad));
+    if (!load) {
+        return NULL;
+    }
+
+    load->fp = fopen(filename, "rb");
+    if (!load->fp) {
+        free(load);
+        return NULL;
+    }
+
+    size_t width;
+    size_t height;
+    long offset;
+
+    if (readPNMStreamHeader(load->fp, &width, &height) != 0 || width == 0 ||
+        (offset = ftell(load->fp)) < 0) {
+        fclose(load->fp);
+        free(load);
+        return NULL;
+    }
+
+    load->image = createPNM(width, height);
+    if (!load->image) {
+        fclose(load->fp);
+        free(load);
+        return NULL;
+    }
+
+    load->offset = (off_t)offset;
+    load->chunkSize = chunkSize > 0 ? chunkSize : LOAD_CHUNK_SIZE;
+    load->nbRows = 0;
+    load->over = false;
+    pthread_mutex_init(&load->lock, NULL);
+    pthread_cond_init(&load->arrived, NULL);
+
+    if (pthread_create(&load->thread, NULL, loadRoutine, load) != 0) {
+        pthread_mutex_destroy(&load->lock);
+        pthread_cond_destroy(&load->arrived);
+        freePNM(load->image);
+        fclose(load->fp);
+        free(load);
+        return NULL;
+    }
+
+    return load;
+}
+
+const PNMImage* getPNMLoadImage(const PNMLoad* load) {
+    return load->image;
+}
+
+size_t waitPNMRows(PNMLoad* load, size_t nbRows) {
+    pthread_mutex_lock(&load->lock);
+    while (load->nbRows < nbRows && !load->over) {
+        pthread_cond_wait(&load->arrived, &load->lock);
+    }
+    nbRows = load->nbRows;
+    pthread_mutex_unlock(&load->lock);
+
+    return nbRows;
+}
+
+PNMImage* finishPNMLoad(PNMLoad* load) {
+    pthread_join(load->thread, NULL);
+
+    PNMImage* image = load->image;
+    if (load->nbRows < image->height) {
+        freePNM(image);
+        image = NULL;
+    }
+
+    pthread_mutex_destroy(&load->lock);
+    pthread_cond_destroy(&load->arrived);
+    fclose(load->fp);
+    free(load);
+
+    return image;
+}
+
+/* ------------------------------------------------------------------------- *
+ * Write a whole buffer at a given offset of a file.
+ *
+ * PARAMETERS
+ * fd           The file descriptor
+ * buffer       The buffer to write
+ * size         The size of the buffer (in bytes)
+ * offset       The offset in the file
+ *
+ * RETURN
+ * 0            In case of success
+ * -1           Otherwise
+ * ------------------------------------------------------------------------- */
+static int writeAll(int fd, const unsigned char* buffer, size_t size,
+                    off_t offset) {
+    while (size > 0) {
+        ssize_t written = pwrite(fd, buffer, size, offset);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return -1;
+        }
+
+        buffer += written;
+        size -= (size_t)written;
+        offset += written;
+    }
+
     return 0;
 }
+
+/* ------------------------------------------------------------------------- *
+ * Synchronise and close a file in the background.
+ *
+ * PARAMETERS
+ * argument     The file descriptor, cast to a pointer
+ *
+ * RETURN
+ * NULL
+ * ------------------------------------------------------------------------- */
+static void* syncRoutine(void* argument) {
+    int fd = (int)(size_t)argument;
+    bool failed = fdatasync(fd) != 0;
+
+    if (close(fd) != 0) {
+        failed = true;
+    }
+
+    pthread_mutex_lock(&syncLock);
+    if (failed) {
+        syncFailed = true;
+    }
+    nbPendingSyncs--;
+    pthread_cond_broadcast(&syncDone);
+    pthread_mutex_unlock(&syncLock);
+
+    return NULL;
+}
+
+void initPNMWriteOptions(PNMWriteOptions* options) {
+    options->chunkSize = 8 << 20;
+    options->direct = false;
+    options->sync = PNM_SYNC_NONE;
+}
+
+int writePNM(const char* filename, const PNMImage* image){
+    return writePNMWithOptions(filename, image, NULL, NULL);
+}
+
+int writePNMView(const char* filename, const PNMView* view) {
+    PNMImage image;
+
+    image.width = view->width;
+    image.height = view->height;
+    image.data = view->data;
+
+    if (view->stride == view->width || view->height <= 1) {
+        return writePNM(filename, &image);
+    }
+
+    char header[64];
+    int headerLength = formatPNMHeader(header, sizeof(header), &image);
+    if (headerLength < 0) {
+        return -1;
+    }
+
+    FILE* fp = fopen(filename, "wb");
+    if (!fp) {
+        return -1;
+    }
+
+    int result = fwrite(header, (size_t)headerLength, 1, fp) == 1 ? 0 : -1;
+
+    for (size_t i = 0; i < view->height && result == 0 && view->width > 0; i++) {
+        if (fwrite(view->data + i * view->stride, 3 * view->width, 1, fp) != 1) {
+            result = -1;
+        }
+    }
+
+    if (fclose(fp) != 0) {
+        result = -1;
+    }
+
+    return result;
+}
+
+int writePNMWithOptions(const char* filename, const PNMImage* image,
+                        const PNMWriteOptions* options, PNMWriteStats* stats) {
+    PNMWriteOptions defaultOptions;
+    if (!options) {
+        initPNMWriteOptions(&defaultOptions);
+        options = &defaultOptions;
+    }
+
+    double startTime = getTimeSeconds();
+
+    char header[64];
+    int headerLength = formatPNMHeader(header, sizeof(header), image);
+    if (headerLength < 0) {
+        return -1;
+    }
+
+    const unsigned char* pixels = (const unsigned char*)image->data;
+    size_t dataSize = 3 * image->width * image->height;
+    size_t total = (size_t)headerLength + dataSize;
+
+    // Chunks are multiples of the alignment, and not larger than the file
+    size_t chunkSize = options->chunkSize < WRITE_ALIGNMENT ?
+                       WRITE_ALIGNMENT : options->chunkSize;
+    chunkSize -= chunkSize % WRITE_ALIGNMENT;
+
+    size_t roundedTotal = total + WRITE_ALIGNMENT - 1;
+    roundedTotal -= roundedTotal % WRITE_ALIGNMENT;
+    if (chunkSize > roundedTotal) {
+        chunkSize = roundedTotal;
+    }
+
+    // Open file, falling back to the page cache if O_DIRECT is refused
+    bool direct = options->direct;
+    int fd = -1;
+
+    if (direct) {
+        fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+    }
+    if (fd < 0) {
+        direct = false;
+        fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+    if (fd < 0) {
+        return -1;
+    }
+
+    // Preallocate, which also sets the final size (not supported everywhere)
+    fallocate(fd, 0, 0, (off_t)total);
+
+    unsigned char* buffer = NULL;
+    if (posix_memalign((void**)&buffer, WRITE_ALIGNMENT, chunkSize) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    // The first chunk holds the header followed by the first rows
+    int result = 0;
+    size_t offset = 0;
+    size_t copied = 0;
+    bool staged = true;
+
+    while (offset < total && result == 0) {
+        const unsigned char* chunk;
+        size_t length;
+
+        if (staged) {
+            size_t headerPart = offset == 0 ? (size_t)headerLength : 0;
+            size_t pixelPart = dataSize - copied;
+            if (pixelPart > chunkSize - headerPart) {
+                pixelPart = chunkSize - headerPart;
+            }
+
+            memcpy(buffer, header, headerPart);
+            memcpy(buffer + headerPart, pixels + copied, pixelPart);
+            copied += pixelPart;
+
+            chunk = buffer;
+            length = headerPart + pixelPart;
+
+            // Without O_DIRECT, the next chunks are written from the image
+            staged = direct;
+        } else {
+            chunk = pixels + (offset - (size_t)headerLength);
+            length = total - offset < chunkSize ? total - offset : chunkSize;
+        }
+
+        // O_DIRECT only accepts whole blocks, the tail goes through the cache
+        if (direct && length % WRITE_ALIGNMENT != 0) {
+            direct = false;
+            if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT) != 0) {
+                result = -1;
+                break;
+            }
+        }
+
+        result = writeAll(fd, chunk, length, (off_t)offset);
+        offset += length;
+    }
+
+    free(buffer);
+
+    // Durability policy
+    if (result == 0 && options->sync == PNM_SYNC_DATA && fdatasync(fd) != 0) {
+        result = -1;
+    }
+
+    if (result == 0 && options->sync == PNM_SYNC_ASYNC) {
+        pthread_t thread;
+        pthread_attr_t attributes;
+
+        pthread_mutex_lock(&syncLock);
+        nbPendingSyncs++;
+        pthread_mutex_unlock(&syncLock);
+
+        pthread_attr_init(&attributes);
+        pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+        int created = pthread_create(&thread, &attributes, syncRoutine,
+                                     (void*)(size_t)fd);
+        pthread_attr_destroy(&attributes);
+
+        // If no thread can be started, the file is synchronised now
+        if (created != 0) {
+            syncRoutine((void*)(size_t)fd);
+        }
+    } else if (close(fd) != 0) {
+        result = -1;
+    }
+
+    if (stats) {
+        stats->nbBytes = result == 0 ? total : offset;
+        stats->seconds = getTimeSeconds() - startTime;
+    }
+
+    return result;
+}
+
+int waitPNMSyncs(void) {
+    pthread_mutex_lock(&syncLock);
+
+    while (nbPendingSyncs > 0) {
+        pthread_cond_wait(&syncDone, &syncLock);
+    }
+
+    int result = syncFailed ? -1 : 0;
+    syncFailed = false;
+
+    pthread_mutex_unlock(&syncLock);
+
+    return result;
+}
+
+int formatPNMHeader(char* buffer, size_t size, const PNMImage* image) {
+    int length = snprintf(buffer, size, "P6\n%zu %zu\n255\n",
+                          image->width, image->height);
+
+    if (length < 0 || (size_t)length >= size) {
+        return -1;
+    }
+
+    return length;
+}
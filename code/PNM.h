@@ -9,6 +9,8 @@
 #define _PNM_H_
 
 #include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
 
 
 // Types ----------------------------------------------------------------------
@@ -23,6 +25,46 @@ typedef struct {
     PNMPixel* data;     // Pixel (i, j) is at position i * width + j
 } PNMImage;
 
+// A rectangle of pixels inside a larger buffer (an image, a frame, a mapped
+// file), whose lines are `stride` pixels apart
+typedef struct {
+    size_t width;
+    size_t height;
+    size_t stride;      // Pixel (i, j) is at position i * stride + j
+    PNMPixel* data;     // Pixel (0, 0), not owned by the view
+} PNMView;
+
+// When the written data must reach the storage device
+typedef enum {
+    PNM_SYNC_NONE,      // Left to the operating system
+    PNM_SYNC_DATA,      // fdatasync() before writePNMWithOptions() returns
+    PNM_SYNC_ASYNC      // fdatasync() by a background thread
+} PNMSyncPolicy;
+
+typedef struct {
+    size_t chunkSize;   // Size of each write (in bytes, rounded to 4 KiB)
+    bool direct;        // Bypass the page cache (O_DIRECT) when possible
+    PNMSyncPolicy sync; // Durability policy
+} PNMWriteOptions;
+
+typedef struct {
+    size_t chunkSize;   // Size of each read (in bytes, 0 for a single read)
+    size_t nbThreads;   // Number of threads reading chunks at the same time
+} PNMReadOptions;
+
+typedef struct {
+    size_t nbBytes;     // Number of bytes of pixels read
+    double seconds;     // Time spent loading (in seconds)
+} PNMReadStats;
+
+// Loading of a PNM image by a background thread, a band of rows at a time
+typedef struct PNMLoad_t PNMLoad;
+
+typedef struct {
+    size_t nbBytes;     // Number of bytes written
+    double seconds;     // Time spent writing (in seconds)
+} PNMWriteStats;
+
 
 // Methods --------------------------------------------------------------------
 
@@ -48,6 +90,35 @@ PNMImage* createPNM(size_t width, size_t height);
  * ------------------------------------------------------------------------- */
 void freePNM(PNMImage* image);
 
+/* ------------------------------------------------------------------------- *
+ * Give a view of a whole PNM image. The view is valid as long as the image.
+ *
+ * PARAMETERS
+ * image        Pointer to a PNM image
+ *
+ * RETURN
+ * view         The view of the image (its stride is the width of the image)
+ * ------------------------------------------------------------------------- */
+PNMView getPNMView(PNMImage* image);
+
+/* ------------------------------------------------------------------------- *
+ * Give a view of a rectangle of a view, sharing its pixels.
+ *
+ * PARAMETERS
+ * view         Pointer to the view
+ * top          Line of the view of the first line of the rectangle
+ * left         Column of the view of the first column of the rectangle
+ * width        Width of the rectangle (in pixels)
+ * height       Height of the rectangle (in pixels)
+ * subView      Where to store the view of the rectangle
+ *
+ * RETURN
+ * 0            In case of success
+ * -1           if the rectangle does not fit in the view
+ * ------------------------------------------------------------------------- */
+int getPNMSubView(const PNMView* view, size_t top, size_t left, size_t width,
+                  size_t height, PNMView* subView);
+
 /* ------------------------------------------------------------------------- *
  * Load a PNM image from a file.
  * The PNM image must later be deleted by calling freePNM().
@@ -61,6 +132,132 @@ void freePNM(PNMImage* image);
  * ------------------------------------------------------------------------- */
 PNMImage* readPNM(const char* filename);
 
+/* ------------------------------------------------------------------------- *
+ * Fill a PNMReadOptions with the default options (8 MiB chunks, 4 threads).
+ *
+ * PARAMETERS
+ * options      Pointer to the options to initialise
+ * ------------------------------------------------------------------------- */
+void initPNMReadOptions(PNMReadOptions* options);
+
+/* ------------------------------------------------------------------------- *
+ * Load a PNM image from a file.
+ * The header is parsed and the image allocated first; several threads then
+ * read chunks of the pixels concurrently (with pread), straight into the
+ * image. Images smaller than a chunk are read in one call.
+ * The PNM image must later be deleted by calling freePNM().
+ *
+ * PARAMETERS
+ * filename     Path to the PNM file
+ * options      Pointer to the options (NULL for the default ones)
+ * stats        Pointer to the measures to fill (or NULL)
+ *
+ * RETURN
+ * image        Pointer to the loaded PNM image
+ * NULL         if an error occured
+ * ------------------------------------------------------------------------- */
+PNMImage* readPNMWithOptions(const char* filename, const PNMReadOptions* options,
+                             PNMReadStats* stats);
+
+/* ------------------------------------------------------------------------- *
+ * Load a PNM image from a buffer holding the content of a PNM file.
+ * The PNM image must later be deleted by calling freePNM().
+ *
+ * PARAMETERS
+ * buffer       The content of the PNM file
+ * size         The size of the buffer (in bytes)
+ *
+ * RETURN
+ * image        Pointer to the loaded PNM image
+ * NULL         if an error occured
+ * ------------------------------------------------------------------------- */
+PNMImage* parsePNM(const unsigned char* buffer, size_t size);
+
+/* ------------------------------------------------------------------------- *
+ * Start loading a PNM image from a file in the background.
+ * The header is read at once, and the image is allocated with its final
+ * size; a thread then reads its rows in order, a band of about chunkSize
+ * bytes at a time. The rows can be used as soon as waitPNMRows() gives
+ * them, while the next ones are still being read.
+ * The loading must later be ended by calling finishPNMLoad().
+ *
+ * PARAMETERS
+ * filename     Path to the PNM file
+ * chunkSize    The size of each read (in bytes, 0 for 4 MiB)
+ *
+ * RETURN
+ * load         Pointer to the loading
+ * NULL         if an error occured
+ * ------------------------------------------------------------------------- */
+PNMLoad* startPNMLoad(const char* filename, size_t chunkSize);
+
+/* ------------------------------------------------------------------------- *
+ * Give the image being loaded. Only its rows given by waitPNMRows() may be
+ * read before finishPNMLoad().
+ *
+ * PARAMETERS
+ * load         Pointer to the loading
+ *
+ * RETURN
+ * image        Pointer to the image being loaded
+ * ------------------------------------------------------------------------- */
+const PNMImage* getPNMLoadImage(const PNMLoad* load);
+
+/* ------------------------------------------------------------------------- *
+ * Wait until the first nbRows rows of an image are loaded.
+ *
+ * PARAMETERS
+ * load         Pointer to the loading
+ * nbRows       The number of rows needed
+ *
+ * RETURN
+ * nbLoaded     The number of rows loaded, fewer than nbRows only if the
+ *              file could not be read
+ * ------------------------------------------------------------------------- */
+size_t waitPNMRows(PNMLoad* load, size_t nbRows);
+
+/* ------------------------------------------------------------------------- *
+ * Wait until a loading is over, and free it.
+ * The PNM image must later be deleted by calling freePNM().
+ *
+ * PARAMETERS
+ * load         Pointer to the loading
+ *
+ * RETURN
+ * image        Pointer to the loaded PNM image
+ * NULL         if the file could not be read entirely
+ * ------------------------------------------------------------------------- */
+PNMImage* finishPNMLoad(PNMLoad* load);
+
+/* ------------------------------------------------------------------------- *
+ * Read only the size of a PNM image stored in a file.
+ *
+ * PARAMETERS
+ * filename     Path to the PNM file
+ * width        Where to store the width of the image (in pixels)
+ * height       Where to store the height of the image (in pixels)
+ *
+ * RETURN
+ * 0            In case of success
+ * -1           Otherwise
+ * ------------------------------------------------------------------------- */
+int readPNMHeader(const char* filename, size_t* width, size_t* height);
+
+/* ------------------------------------------------------------------------- *
+ * Read the header of a PNM file from a stream, leaving the stream at the
+ * first pixel.
+ *
+ * PARAMETERS
+ * fp           Stream positioned at the beginning of the PNM file
+ * width        Where to store the width of the image (in pixels)
+ * height       Where to store the height of the image (in pixels)
+ *
+ * RETURN
+ * 0            In case of success
+ * -1           Otherwise
+ * ------------------------------------------------------------------------- */
+int readPNMStreamHeader(FILE* fp, size_t* width, size_t* height);
+
 /* ------------------------------------------------------------------------- *
  * Write a PNM image into a file.
  *
@@ -74,4 +271,70 @@ PNMImage* readPNM(const char* filename);
  * ------------------------------------------------------------------------- */
 int writePNM(const char* filename, const PNMImage* image);
 
+/* ------------------------------------------------------------------------- *
+ * Write the pixels of a view into a PNM file, as an image of the size of
+ * the view. A view whose lines are contiguous is written as writePNM()
+ * does; the lines of any other view are written one after the other.
+ *
+ * PARAMETERS
+ * filename     Path to the PNM file
+ * view         Pointer to the view to write
+ *
+ * RETURN
+ * 0            In case of success
+ * -1           Otherwise
+ * ------------------------------------------------------------------------- */
+int writePNMView(const char* filename, const PNMView* view);
+
+/* ------------------------------------------------------------------------- *
+ * Fill a PNMWriteOptions with the default options (8 MiB chunks, through
+ * the page cache, no synchronisation).
+ *
+ * PARAMETERS
+ * options      Pointer to the options to initialise
+ * ------------------------------------------------------------------------- */
+void initPNMWriteOptions(PNMWriteOptions* options);
+
+/* ------------------------------------------------------------------------- *
+ * Write a PNM image into a file.
+ * The file is preallocated, and the header is sent with the first rows in
+ * a single write. Images smaller than a chunk are written in one call.
+ *
+ * PARAMETERS
+ * filename     Path to the PNM file
+ * image        Pointer to the PNM image to write
+ * options      Pointer to the options (NULL for the default ones)
+ * stats        Pointer to the measures to fill (or NULL)
+ *
+ * RETURN
+ * 0            In case of success
+ * -1           Otherwise
+ * ------------------------------------------------------------------------- */
+int writePNMWithOptions(const char* filename, const PNMImage* image,
+                        const PNMWriteOptions* options, PNMWriteStats* stats);
+
+/* ------------------------------------------------------------------------- *
+ * Wait until the background synchronisations started by
+ * writePNMWithOptions() with PNM_SYNC_ASYNC are over.
+ *
+ * RETURN
+ * 0            if every synchronisation succeeded
+ * -1           Otherwise
+ * ------------------------------------------------------------------------- */
+int waitPNMSyncs(void);
+
+/* ------------------------------------------------------------------------- *
+ * Format the header of a PNM image, as written by writePNM().
+ *
+ * PARAMETERS
+ * buffer       The buffer receiving the header (null-terminated)
+ * size         The size of the buffer (in bytes)
+ * image        Pointer to the PNM image
+ *
+ * RETURN
+ * length       The length of the header (in bytes)
+ * -1           if the buffer is too small
+ * ------------------------------------------------------------------------- */
+int formatPNMHeader(char* buffer, size_t size, const PNMImage* image);
+
 #endif // _PNM_H_
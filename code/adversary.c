@@ -0,0 +1,331 @@
+/* ------------------------------------------------------------------------- *\
+ * NAME
+ *      adversary
+ * SYNOPSIS
+ *      adversary exact|astar|runs width height k output_file
+ *                [--iterations nbIterations] [--seed seed]
+ *                [--metric cells|time]
+ * DESCIRPTION
+ *      Search for an image of the given size whose reduction by k pixels
+ *      makes the given engine do as much work per groove as possible, and
+ *      write it, so that it can be kept as a regression input of the
+ *      benchmarks.
+ *      The work is measured by the counters of the reduction (cells), which
+ *      do not depend on the machine: the cells of the cost table updated by
+ *      the exact engine, the cells of the cost tables the astar engine
+ *      computes for each groove plus the energies it updates, or the
+ *      segments of cells of the runs engine. It may also be the time of the reduction (time), the
+ *      shortest of 3 runs.
+ *      The search starts from the worst of a few synthesised images (flat,
+ *      noise, vertical stripes, checkerboard, gradient, and their plateaus
+ *      of ties), then climbs: a rectangle of the image is changed (filled
+ *      with a color, noise, stripes or a gradient), and the change is kept
+ *      if the work does not decrease. The best work per groove is written
+ *      each time it improves.
+ * ARGUMENTS
+ *      exact|astar|runs  The engine whose work is maximised
+ *      width, height   The size of the image
+ *      k               The number of pixels removed (smaller than width)
+ *      output_file     The PNM file receiving the image found
+ *      nbIterations    The number of changes tried (default 2000)
+ *      seed            The seed of the changes (default 1), the search
+ *                      being reproducible for a given seed
+ * RETURN
+ *      0 if the image could be written, 1 otherwise.
+ *
+ * USAGE
+ *      ./adversary exact 160 120 40 pnm/adversarial/exact.pnm
+ *          will search for 2000 iterations an image of 160 x 120 pixels
+ *          whose reduction by 40 pixels updates many cells
+ \* ------------------------------------------------------------------------- */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "slimming.h"
+#include "PNM.h"
+
+// Number of synthesised starting images
+#define NB_FAMILIES 6
+
+// Number of kinds of changes of a rectangle
+#define NB_CHANGES 4
+
+// Number of runs of a reduction measured by its time (the shortest is kept)
+#define TIME_RUNS 3
+
+
+/* ------------------------------------------------------------------------- *
+ * Give the next pseudo-random number of a state (xorshift64*), the same on
+ * every platform for a given seed.
+ * ------------------------------------------------------------------------- */
+static uint64_t nextRandom(uint64_t* state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+
+    return *state * 2685821657736338717ULL;
+}
+
+/* ------------------------------------------------------------------------- *
+ * Give a pseudo-random number in [0, n).
+ * ------------------------------------------------------------------------- */
+static size_t randomBelow(uint64_t* state, size_t n)
+{
+    return (size_t)((nextRandom(state) >> 32) % n);
+}
+
+/* ------------------------------------------------------------------------- *
+ * Give a pseudo-random pixel.
+ * ------------------------------------------------------------------------- */
+static PNMPixel randomPixel(uint64_t* state)
+{
+    uint64_t value = nextRandom(state);
+    PNMPixel pixel = {(unsigned char)(value >> 40), (unsigned char)(value >> 48),
+                      (unsigned char)(value >> 56)};
+
+    return pixel;
+}
+
+/* ------------------------------------------------------------------------- *
+ * Fill a rectangle of an image with a pattern.
+ *
+ * PARAMETERS
+ * image        The image
+ * top, left    The first line and column of the rectangle
+ * width, height The size of the rectangle
+ * kind         The pattern: 0, a single color (plateaus of ties); 1,
+ *              noise; 2, vertical stripes 1 to 4 pixels wide, of two
+ *              colors; 3, a gradient along the lines or the columns
+ * state        The state of the pseudo-random numbers
+ * ------------------------------------------------------------------------- */
+static void fillRectangle(PNMImage* image, size_t top, size_t left, size_t width,
+                          size_t height, int kind, uint64_t* state)
+{
+    PNMPixel first = randomPixel(state), second = randomPixel(state);
+    size_t period = 1 + randomBelow(state, 4);
+    bool alongLines = randomBelow(state, 2) == 0;
+
+    for (size_t i = top; i < top + height; i++)
+    {
+        for (size_t j = left; j < left + width; j++)
+        {
+            PNMPixel* pixel = &image->data[i * image->width + j];
+
+            if (kind == 0)
+                *pixel = first;
+            else if (kind == 1)
+                *pixel = randomPixel(state);
+            else if (kind == 2)
+                *pixel = ((j - left) / period) % 2 == 0 ? first : second;
+            else
+            {
+                size_t position = alongLines ? j - left : i - top;
+                size_t length = alongLines ? width : height;
+                unsigned step = (unsigned)(255 * position / (length > 1 ? length - 1 : 1));
+
+                pixel->red = (unsigned char)((first.red + step) & 255);
+                pixel->green = (unsigned char)((first.green + step) & 255);
+                pixel->blue = (unsigned char)((first.blue + step) & 255);
+            }
+        }
+    }
+}
+
+/* ------------------------------------------------------------------------- *
+ * Synthesise a whole image of a family: flat, noise, vertical stripes,
+ * gradient, checkerboard of 1-pixel squares, or flat with a single column
+ * of another color (a plateau of ties beside a single edge).
+ * ------------------------------------------------------------------------- */
+static void synthesise(PNMImage* image, int family, uint64_t* state)
+{
+    if (family < NB_CHANGES)
+    {
+        fillRectangle(image, 0, 0, image->width, image->height, family, state);
+        return;
+    }
+
+    PNMPixel first = randomPixel(state), second = randomPixel(state);
+
+    for (size_t i = 0; i < image->height; i++)
+        for (size_t j = 0; j < image->width; j++)
+            image->data[i * image->width + j] =
+                family == NB_CHANGES ? ((i + j) % 2 == 0 ? first : second) :
+                                       (j == image->width / 2 ? second : first);
+}
+
+/* ------------------------------------------------------------------------- *
+ * Measure the work of the reduction of an image.
+ *
+ * PARAMETERS
+ * image        The image
+ * k            The number of pixels removed
+ * options      The options of the reduction, with measures
+ * useTime      Whether the work is the time rather than the counters
+ *
+ * RETURN
+ * work         The work of the reduction (cells or seconds)
+ * -1           if the reduction failed
+ * ------------------------------------------------------------------------- */
+static double measureWork(const PNMImage* image, size_t k, const SlimmingOptions* options,
+                          bool useTime)
+{
+    double best = -1;
+
+    for (int run = 0; run < (useTime ? TIME_RUNS : 1); run++)
+    {
+        PNMImage* output = reduceImageWidthWithOptions(image, k, options);
+        if (!output)
+            return -1;
+        freePNM(output);
+
+        const SlimmingStats* stats = options->stats;
+        double work = useTime ? stats->totalSeconds :
+                      (double)(stats->nbUpdatedCells + stats->nbSearchedCells);
+
+        if (best < 0 || work < best)
+            best = work;
+    }
+
+    return best;
+}
+
+
+int main(int argc, char* argv[])
+{
+    if (argc < 6)
+    {
+        fprintf(stderr, "Usage: %s exact|astar|runs width height k output.pnm "
+                        "[--iterations nbIterations] [--seed seed] [--metric cells|time]\n",
+                argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    SlimmingStats stats;
+    SlimmingOptions options;
+    initSlimmingOptions(&options);
+    options.stats = &stats;
+
+    if (strcmp(argv[1], "exact") == 0)
+        options.engine = SLIMMING_ENGINE_EXACT;
+    else if (strcmp(argv[1], "astar") == 0)
+        options.engine = SLIMMING_ENGINE_ASTAR;
+    else if (strcmp(argv[1], "runs") == 0)
+        options.engine = SLIMMING_ENGINE_RUNS;
+    else
+    {
+        fprintf(stderr, "Unknown engine '%s'\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    long width = strtol(argv[2], NULL, 10);
+    long height = strtol(argv[3], NULL, 10);
+    long k = strtol(argv[4], NULL, 10);
+    long nbIterations = 2000;
+    uint64_t state = 1;
+    bool useTime = false;
+
+    for (int i = 6; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc &&
+            (nbIterations = strtol(argv[i + 1], NULL, 10)) > 0)
+            i++;
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc &&
+                 (state = strtoull(argv[i + 1], NULL, 10)) != 0)
+            i++;
+        else if (strcmp(argv[i], "--metric") == 0 && i + 1 < argc &&
+                 (strcmp(argv[i + 1], "cells") == 0 || strcmp(argv[i + 1], "time") == 0))
+            useTime = strcmp(argv[++i], "time") == 0;
+        else
+        {
+            fprintf(stderr, "Invalid option '%s'\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (width < 2 || height < 2 || k < 1 || k >= width)
+    {
+        fprintf(stderr, "Aborting; the image must be at least 2 x 2 pixels, and k "
+                        "between 1 and its width - 1\n");
+        return EXIT_FAILURE;
+    }
+
+    PNMImage* best = createPNM((size_t)width, (size_t)height);
+    PNMImage* candidate = createPNM((size_t)width, (size_t)height);
+    if (!best || !candidate)
+    {
+        fprintf(stderr, "Aborting; out of memory\n");
+        freePNM(best);
+        freePNM(candidate);
+        return EXIT_FAILURE;
+    }
+
+    size_t nbPixels = (size_t)width * (size_t)height;
+    const char* unit = useTime ? "s" : "cells";
+    double bestWork = -1;
+
+    /* --- Worst synthesised image --- */
+    for (int family = 0; family < NB_FAMILIES; family++)
+    {
+        synthesise(candidate, family, &state);
+
+        double work = measureWork(candidate, (size_t)k, &options, useTime);
+        if (work > bestWork)
+        {
+            bestWork = work;
+            memcpy(best->data, candidate->data, sizeof(PNMPixel) * nbPixels);
+        }
+    }
+
+    if (bestWork < 0)
+    {
+        fprintf(stderr, "Aborting; cannot reduce the images\n");
+        freePNM(best);
+        freePNM(candidate);
+        return EXIT_FAILURE;
+    }
+
+    printf("start      %14.6g %s per groove\n", bestWork / k, unit);
+
+    /* --- Hill climbing --- */
+    for (long iteration = 1; iteration <= nbIterations; iteration++)
+    {
+        memcpy(candidate->data, best->data, sizeof(PNMPixel) * nbPixels);
+
+        size_t rectangleWidth = 1 + randomBelow(&state, (size_t)width);
+        size_t rectangleHeight = 1 + randomBelow(&state, (size_t)height);
+        size_t left = randomBelow(&state, (size_t)width - rectangleWidth + 1);
+        size_t top = randomBelow(&state, (size_t)height - rectangleHeight + 1);
+        int kind = (int)randomBelow(&state, NB_CHANGES);
+
+        fillRectangle(candidate, top, left, rectangleWidth, rectangleHeight, kind, &state);
+
+        double work = measureWork(candidate, (size_t)k, &options, useTime);
+        if (work < bestWork)
+            continue;
+
+        if (work > bestWork)
+            printf("%-10ld %14.6g %s per groove\n", iteration, work / k, unit);
+
+        // Equal work is kept too, to move across plateaus
+        bestWork = work;
+        PNMImage* swap = best;
+        best = candidate;
+        candidate = swap;
+    }
+
+    int resultWrite = writePNM(argv[5], best);
+    freePNM(best);
+    freePNM(candidate);
+
+    if (resultWrite < 0)
+    {
+        fprintf(stderr, "Aborting; cannot write image '%s'\n", argv[5]);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
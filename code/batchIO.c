@@ -0,0 +1,874 @@
+/* ------------------------------------------------------------------------- *
+ * Implementation of the batched input/output interface.
+ *
+ * io_uring is used through its system calls, so that no library is needed.
+ * ------------------------------------------------------------------------- */
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+#include "batchIO.h"
+#include "timing.h"
+
+/* ------------------------------------------------------------------------- *
+ *
+ * STRUCTURES
+ *
+ * ------------------------------------------------------------------------- */
+
+//Number of submission queue entries of a ring. A window of files uses at most one entry per file and per operation.
+#define RING_ENTRIES 128
+
+//Number of threads of the thread backend.
+#define NB_IO_THREADS 4
+
+//Maximal length of a PNM header written by formatPNMHeader().
+#define HEADER_SIZE 64
+
+//Structure representing an io_uring instance and its mapped queues.
+typedef struct Ring_t{
+	int fd; //File descriptor of the ring.
+	unsigned *sqHead, *sqTail, *sqMask, *sqArray; //Submission queue.
+	unsigned *cqHead, *cqTail, *cqMask; //Completion queue.
+	struct io_uring_sqe *sqes; //Submission queue entries.
+	struct io_uring_cqe *cqes; //Completion queue entries.
+	void *sqRing, *cqRing; //Mapped rings (the same if the kernel maps both at once).
+	size_t sqRingSize, cqRingSize, sqesSize; //Sizes of the mappings.
+	unsigned nbQueued; //Number of entries prepared but not submitted yet.
+}Ring;
+
+//Structure representing a file being loaded or written.
+typedef struct FileTransfer_t{
+	const char *filename; //Path to the file.
+	int fd; //File descriptor (-1 if not open).
+	unsigned char *buffer; //Content of the file, in a reused buffer (loading only).
+	PNMImage *image; //The loaded image (loading only).
+	size_t size; //Size of the content (in bytes).
+	size_t done; //Number of bytes already transferred.
+	struct statx status; //Status of the file (loading with io_uring only).
+	char header[HEADER_SIZE]; //Header of the image (writing only).
+	struct iovec parts[2]; //Header and pixels of the image (writing only).
+	struct iovec pending[2]; //What remains to be written of 'parts' (writing only).
+	bool failed; //True once an operation on the file failed.
+}FileTransfer;
+
+//Structure representing a batch processed by the thread backend.
+typedef struct ThreadBatch_t{
+	FileTransfer *files; //The files.
+	size_t nbFiles; //Number of files.
+	size_t next; //Index of the next file to process.
+	bool writing; //True to write the files, false to load them.
+	pthread_mutex_t lock; //Protects 'next'.
+}ThreadBatch;
+
+/* ------------------------------------------------------------------------- *
+ *
+ * PROTOTYPES OF STATIC FUNCTIONS
+ *
+ * ------------------------------------------------------------------------- */
+
+/* ------------------------------------------------------------------------- *
+ * Create an io_uring instance and check that it supports every operation
+ * needed by the batches.
+ *
+ * PARAMETERS
+ * ring         the ring to initialise
+ *
+ * RETURN
+ * 0, the ring can be used.
+ * -1, io_uring is not available.
+ * ------------------------------------------------------------------------- */
+static int ring_init(Ring* ring);
+
+/* ------------------------------------------------------------------------- *
+ * Unmap and close an io_uring instance.
+ *
+ * PARAMETERS
+ * ring         the ring to destroy
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void ring_destroy(Ring* ring);
+
+/* ------------------------------------------------------------------------- *
+ * Give a cleared submission queue entry, to be submitted by ring_run().
+ *
+ * PARAMETERS
+ * ring         the ring
+ * opcode       the operation
+ * fd           the file descriptor the operation applies to
+ * userData     the value identifying the completion of the operation
+ *
+ * RETURN
+ * sqe, the entry (the submission queue is never full as the windows are
+ * smaller than the ring).
+ * ------------------------------------------------------------------------- */
+static struct io_uring_sqe* ring_prepare(Ring* ring, unsigned char opcode, int fd, size_t userData);
+
+/* ------------------------------------------------------------------------- *
+ * Submit the prepared entries and wait for all of their completions.
+ *
+ * PARAMETERS
+ * ring         the ring
+ * results      array receiving the result of each operation, indexed by the
+ *              user data of its entry
+ *
+ * RETURN
+ * 0, every entry completed.
+ * -1, io_uring_enter() failed (the results of the entries completed so far
+ * are still collected).
+ * ------------------------------------------------------------------------- */
+static int ring_run(Ring* ring, int* results);
+
+/* ------------------------------------------------------------------------- *
+ * Give what remains to be written of the header and pixels of a file.
+ *
+ * PARAMETERS
+ * file         the file, whose 'pending' parts are updated
+ *
+ * RETURN
+ * nbParts, the number of non empty pending parts.
+ * ------------------------------------------------------------------------- */
+static int pending_parts(FileTransfer* file);
+
+/* ------------------------------------------------------------------------- *
+ * Parse the content of a loaded file into its image.
+ *
+ * PARAMETERS
+ * file         the file
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void parse_file(FileTransfer* file);
+
+/* ------------------------------------------------------------------------- *
+ * Load or write a window of at most RING_ENTRIES / 2 files with io_uring.
+ * When loading, the files are read in the buffers of a pool, which are
+ * enlarged if needed.
+ *
+ * PARAMETERS
+ * ring         the ring
+ * files        the files of the window
+ * nbFiles      the number of files of the window
+ * writing      true to write the files, false to load them
+ * pool         the buffers of the pool, one per file (loading only)
+ * capacities   the capacities of the buffers of the pool (loading only)
+ * results      array of 2 * nbFiles integers used to collect completions
+ *
+ * RETURN
+ * 0, the window was processed (files that failed are marked as such).
+ * -1, io_uring failed, no file of the window can be trusted (the files
+ * opened are closed).
+ * ------------------------------------------------------------------------- */
+static int uring_window(Ring* ring, FileTransfer* files, size_t nbFiles, bool writing,
+                        unsigned char** pool, size_t* capacities, int* results);
+
+/* ------------------------------------------------------------------------- *
+ * Load or write every file with io_uring.
+ *
+ * PARAMETERS
+ * files        the files
+ * nbFiles      the number of files
+ * writing      true to write the files, false to load them
+ *
+ * RETURN
+ * 0, the files were processed (files that failed are marked as such).
+ * -1, io_uring is not available, no file was processed.
+ * ------------------------------------------------------------------------- */
+static int uring_transfer(FileTransfer* files, size_t nbFiles, bool writing);
+
+/* ------------------------------------------------------------------------- *
+ * Load a file with open(), fstat() and pread().
+ *
+ * PARAMETERS
+ * file         the file, whose buffer may be reused and enlarged
+ * capacity     the capacity of the buffer of the file (updated)
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void pread_file(FileTransfer* file, size_t* capacity);
+
+/* ------------------------------------------------------------------------- *
+ * Write a file with open() and pwritev().
+ *
+ * PARAMETERS
+ * file         the file
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void pwrite_file(FileTransfer* file);
+
+/* ------------------------------------------------------------------------- *
+ * Routine of the threads of the thread backend: process files until the
+ * batch is exhausted.
+ *
+ * PARAMETERS
+ * argument     pointer to the ThreadBatch
+ *
+ * RETURN
+ * NULL
+ * ------------------------------------------------------------------------- */
+static void* transfer_routine(void* argument);
+
+/* ------------------------------------------------------------------------- *
+ * Load or write every file with the thread backend.
+ *
+ * PARAMETERS
+ * files        the files
+ * nbFiles      the number of files
+ * writing      true to write the files, false to load them
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void threads_transfer(FileTransfer* files, size_t nbFiles, bool writing);
+
+/* ------------------------------------------------------------------------- *
+ * Load or write every file with the requested backend, falling back to the
+ * thread backend if io_uring is not available.
+ *
+ * PARAMETERS
+ * files        the files
+ * nbFiles      the number of files
+ * writing      true to write the files, false to load them
+ * backend      the requested backend
+ * stats        pointer to the measures to fill (or NULL)
+ *
+ * RETURN
+ * nbFailed, the number of files that could not be processed.
+ * ------------------------------------------------------------------------- */
+static size_t transfer(FileTransfer* files, size_t nbFiles, bool writing, BatchIOBackend backend, BatchIOStats* stats);
+
+/* ------------------------------------------------------------------------- *
+ *
+ * IMPLEMENTATION
+ *
+ * ------------------------------------------------------------------------- */
+
+static int ring_init(Ring* ring){
+	memset(ring, 0, sizeof(Ring));
+
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+
+	ring->fd = (int)syscall(__NR_io_uring_setup, RING_ENTRIES, &params);
+	if(ring->fd < 0)
+		return -1;
+
+	//Check that the needed operations are supported (kernel 5.6 or later).
+	size_t probeSize = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+	struct io_uring_probe* probe = calloc(1, probeSize);
+	if(!probe){
+		close(ring->fd);
+		return -1;
+	}
+
+	const unsigned char needed[] = {IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ, IORING_OP_WRITEV, IORING_OP_CLOSE};
+	bool supported = syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_PROBE, probe, 256) == 0;
+
+	for(size_t i = 0; supported && i < sizeof(needed); ++i){
+		if(needed[i] > probe->last_op || !(probe->ops[needed[i]].flags & IO_URING_OP_SUPPORTED))
+			supported = false;
+	}
+
+	free(probe);
+
+	if(!supported){
+		close(ring->fd);
+		return -1;
+	}
+
+	//Map the queues.
+	ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	ring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+
+	if(params.features & IORING_FEAT_SINGLE_MMAP){
+		if(ring->cqRingSize > ring->sqRingSize)
+			ring->sqRingSize = ring->cqRingSize;
+		ring->cqRingSize = 0;
+	}
+
+	ring->sqRing = mmap(NULL, ring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+	                    ring->fd, IORING_OFF_SQ_RING);
+	if(ring->sqRing == MAP_FAILED){
+		close(ring->fd);
+		return -1;
+	}
+
+	ring->cqRing = ring->sqRing;
+	if(ring->cqRingSize){
+		ring->cqRing = mmap(NULL, ring->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+		                    ring->fd, IORING_OFF_CQ_RING);
+		if(ring->cqRing == MAP_FAILED){
+			munmap(ring->sqRing, ring->sqRingSize);
+			close(ring->fd);
+			return -1;
+		}
+	}
+
+	ring->sqes = mmap(NULL, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+	                  ring->fd, IORING_OFF_SQES);
+	if(ring->sqes == MAP_FAILED){
+		if(ring->cqRingSize)
+			munmap(ring->cqRing, ring->cqRingSize);
+		munmap(ring->sqRing, ring->sqRingSize);
+		close(ring->fd);
+		return -1;
+	}
+
+	unsigned char* sq = ring->sqRing;
+	unsigned char* cq = ring->cqRing;
+
+	ring->sqHead = (unsigned*)(sq + params.sq_off.head);
+	ring->sqTail = (unsigned*)(sq + params.sq_off.tail);
+	ring->sqMask = (unsigned*)(sq + params.sq_off.ring_mask);
+	ring->sqArray = (unsigned*)(sq + params.sq_off.array);
+	ring->cqHead = (unsigned*)(cq + params.cq_off.head);
+	ring->cqTail = (unsigned*)(cq + params.cq_off.tail);
+	ring->cqMask = (unsigned*)(cq + params.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+	return 0;
+}//End ring_init()
+
+static void ring_destroy(Ring* ring){
+	munmap(ring->sqes, ring->sqesSize);
+	if(ring->cqRingSize)
+		munmap(ring->cqRing, ring->cqRingSize);
+	munmap(ring->sqRing, ring->sqRingSize);
+	close(ring->fd);
+
+	return;
+}//End ring_destroy()
+
+static struct io_uring_sqe* ring_prepare(Ring* ring, unsigned char opcode, int fd, size_t userData){
+	unsigned tail = *ring->sqTail + ring->nbQueued;
+	unsigned index = tail & *ring->sqMask;
+
+	struct io_uring_sqe* sqe = &ring->sqes[index];
+	memset(sqe, 0, sizeof(struct io_uring_sqe));
+	sqe->opcode = opcode;
+	sqe->fd = fd;
+	sqe->user_data = userData;
+
+	ring->sqArray[index] = index;
+	ring->nbQueued++;
+
+	return sqe;
+}//End ring_prepare()
+
+static int ring_run(Ring* ring, int* results){
+	unsigned nbExpected = ring->nbQueued;
+
+	//Publish the prepared entries to the kernel.
+	__atomic_store_n(ring->sqTail, *ring->sqTail + ring->nbQueued, __ATOMIC_RELEASE);
+
+	unsigned nbToSubmit = ring->nbQueued;
+	ring->nbQueued = 0;
+
+	while(nbExpected > 0){
+		long resultEnter = syscall(__NR_io_uring_enter, ring->fd, nbToSubmit, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+		if(resultEnter < 0 && errno == EINTR)
+			continue;
+
+		if(resultEnter > 0)
+			nbToSubmit -= (unsigned)resultEnter;
+
+		//Collect the completions.
+		unsigned head = *ring->cqHead;
+		unsigned tail = __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+
+		for(; head != tail && nbExpected > 0; ++head, --nbExpected){
+			struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cqMask];
+			results[cqe->user_data] = cqe->res;
+		}
+
+		__atomic_store_n(ring->cqHead, head, __ATOMIC_RELEASE);
+
+		//The completions were collected, so that the caller may undo them (such as closing the files opened).
+		if(resultEnter < 0)
+			return -1;
+	}//End while()
+
+	return 0;
+}//End ring_run()
+
+static int pending_parts(FileTransfer* file){
+	size_t skipped = file->done;
+	int nbParts = 0;
+
+	for(size_t p = 0; p < 2; ++p){
+		if(skipped >= file->parts[p].iov_len){
+			skipped -= file->parts[p].iov_len;
+			continue;
+		}
+
+		file->pending[nbParts].iov_base = (unsigned char*)file->parts[p].iov_base + skipped;
+		file->pending[nbParts].iov_len = file->parts[p].iov_len - skipped;
+		skipped = 0;
+		nbParts++;
+	}
+
+	return nbParts;
+}//End pending_parts()
+
+static void parse_file(FileTransfer* file){
+	if(!file->failed)
+		file->image = parsePNM(file->buffer, file->size);
+
+	if(!file->image)
+		file->failed = true;
+
+	return;
+}//End parse_file()
+
+static int uring_window(Ring* ring, FileTransfer* files, size_t nbFiles, bool writing,
+                        unsigned char** pool, size_t* capacities, int* results){
+
+	//Open the files (and get their size when loading). The files which already failed are not opened, nor truncated.
+	for(size_t i = 0; i < nbFiles; ++i){
+		if(files[i].failed)
+			continue;
+
+		struct io_uring_sqe* sqe = ring_prepare(ring, IORING_OP_OPENAT, AT_FDCWD, 2 * i);
+		sqe->addr = (unsigned long)files[i].filename;
+
+		if(writing){
+			sqe->open_flags = O_WRONLY | O_CREAT | O_TRUNC;
+			sqe->len = 0644;
+		}else{
+			sqe->open_flags = O_RDONLY;
+
+			sqe = ring_prepare(ring, IORING_OP_STATX, AT_FDCWD, 2 * i + 1);
+			sqe->addr = (unsigned long)files[i].filename;
+			sqe->len = STATX_SIZE;
+			sqe->off = (unsigned long)&files[i].status;
+		}
+	}
+
+	//The files whose opening did not complete are not open.
+	for(size_t i = 0; i < 2 * nbFiles; ++i)
+		results[i] = -1;
+
+	if(ring_run(ring, results) < 0){
+		for(size_t i = 0; i < nbFiles; ++i){
+			if(results[2 * i] >= 0)
+				close(results[2 * i]);
+		}
+		return -1;
+	}
+
+	for(size_t i = 0; i < nbFiles; ++i){
+		files[i].fd = results[2 * i];
+
+		if(files[i].fd < 0){
+			files[i].failed = true;
+			continue;
+		}
+
+		if(writing)
+			continue;
+
+		if(results[2 * i + 1] < 0){
+			files[i].failed = true;
+			continue;
+		}
+
+		//Attach a buffer of the pool, large enough for the file.
+		files[i].size = files[i].status.stx_size;
+
+		if(files[i].size > capacities[i]){
+			unsigned char* nBuffer = realloc(pool[i], files[i].size);
+			if(!nBuffer){
+				files[i].failed = true;
+				continue;
+			}
+			pool[i] = nBuffer;
+			capacities[i] = files[i].size;
+		}
+
+		files[i].buffer = pool[i];
+	}//End for()
+
+	//Load the files in their buffers, or write their header and pixels, until everything is transferred.
+	for(;;){
+		bool remaining = false;
+
+		for(size_t i = 0; i < nbFiles; ++i){
+			if(files[i].failed || files[i].done == files[i].size)
+				continue;
+
+			remaining = true;
+
+			struct io_uring_sqe* sqe;
+
+			if(writing){
+				sqe = ring_prepare(ring, IORING_OP_WRITEV, files[i].fd, i);
+				sqe->len = pending_parts(&files[i]);
+				sqe->addr = (unsigned long)files[i].pending;
+			}else{
+				sqe = ring_prepare(ring, IORING_OP_READ, files[i].fd, i);
+				sqe->addr = (unsigned long)(files[i].buffer + files[i].done);
+				sqe->len = files[i].size - files[i].done;
+			}
+
+			sqe->off = files[i].done;
+		}//End for()
+
+		if(!remaining)
+			break;
+
+		if(ring_run(ring, results) < 0){
+			for(size_t i = 0; i < nbFiles; ++i){
+				if(files[i].fd >= 0)
+					close(files[i].fd);
+				files[i].fd = -1;
+			}
+			return -1;
+		}
+
+		for(size_t i = 0; i < nbFiles; ++i){
+			if(files[i].failed || files[i].done == files[i].size)
+				continue;
+
+			if(results[i] <= 0)
+				files[i].failed = true;
+			else
+				files[i].done += (size_t)results[i];
+		}
+	}//End for()
+
+	//Close the files. The results of the closings that did not complete stay positive.
+	for(size_t i = 0; i < nbFiles; ++i){
+		results[i] = 1;
+		if(files[i].fd >= 0)
+			ring_prepare(ring, IORING_OP_CLOSE, files[i].fd, i);
+	}
+
+	if(ring_run(ring, results) < 0){
+		for(size_t i = 0; i < nbFiles; ++i){
+			if(files[i].fd >= 0 && results[i] > 0)
+				close(files[i].fd);
+			files[i].fd = -1;
+		}
+		return -1;
+	}
+
+	for(size_t i = 0; i < nbFiles; ++i){
+		if(files[i].fd >= 0 && results[i] < 0)
+			files[i].failed = true;
+		files[i].fd = -1;
+	}
+
+	return 0;
+}//End uring_window()
+
+static int uring_transfer(FileTransfer* files, size_t nbFiles, bool writing){
+	Ring ring;
+
+	if(ring_init(&ring) < 0)
+		return -1;
+
+	const size_t windowSize = RING_ENTRIES / 2;
+
+	int* results = malloc(sizeof(int) * 2 * windowSize);
+	if(!results){
+		ring_destroy(&ring);
+		return -1;
+	}
+
+	//Buffers of the pool, reused by the successive windows (loading only).
+	unsigned char** pool = calloc(windowSize, sizeof(unsigned char*));
+	size_t* capacities = calloc(windowSize, sizeof(size_t));
+	if(!pool || !capacities){
+		free(pool);
+		free(capacities);
+		free(results);
+		ring_destroy(&ring);
+		return -1;
+	}
+
+	int result = 0;
+
+	for(size_t first = 0; first < nbFiles && result == 0; first += windowSize){
+		size_t nbWindow = nbFiles - first < windowSize ? nbFiles - first : windowSize;
+
+		result = uring_window(&ring, files + first, nbWindow, writing, pool, capacities, results);
+
+		//The buffers are reused by the next window, so the images are extracted now.
+		for(size_t i = 0; !writing && result == 0 && i < nbWindow; ++i)
+			parse_file(&files[first + i]);
+	}
+
+	for(size_t i = 0; i < windowSize; ++i)
+		free(pool[i]);
+
+	free(pool);
+	free(capacities);
+	free(results);
+	ring_destroy(&ring);
+
+	return result;
+}//End uring_transfer()
+
+static void pread_file(FileTransfer* file, size_t* capacity){
+	file->fd = open(file->filename, O_RDONLY);
+	if(file->fd < 0){
+		file->failed = true;
+		return;
+	}
+
+	struct stat status;
+	if(fstat(file->fd, &status) < 0){
+		file->failed = true;
+		close(file->fd);
+		return;
+	}
+
+	file->size = status.st_size;
+
+	if(file->size > *capacity){
+		unsigned char* nBuffer = realloc(file->buffer, file->size);
+		if(!nBuffer){
+			file->failed = true;
+			close(file->fd);
+			return;
+		}
+		file->buffer = nBuffer;
+		*capacity = file->size;
+	}
+
+	while(file->done < file->size){
+		ssize_t nbRead = pread(file->fd, file->buffer + file->done, file->size - file->done, file->done);
+		if(nbRead <= 0){
+			if(nbRead < 0 && errno == EINTR)
+				continue;
+			file->failed = true;
+			break;
+		}
+		file->done += (size_t)nbRead;
+	}
+
+	close(file->fd);
+	file->fd = -1;
+
+	return;
+}//End pread_file()
+
+static void pwrite_file(FileTransfer* file){
+	//A file whose image is missing is left untouched.
+	if(file->failed)
+		return;
+
+	file->fd = open(file->filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(file->fd < 0){
+		file->failed = true;
+		return;
+	}
+
+	while(file->done < file->size){
+		int nbParts = pending_parts(file);
+
+		ssize_t nbWritten = pwritev(file->fd, file->pending, nbParts, file->done);
+		if(nbWritten <= 0){
+			if(nbWritten < 0 && errno == EINTR)
+				continue;
+			file->failed = true;
+			break;
+		}
+
+		file->done += (size_t)nbWritten;
+	}
+
+	if(close(file->fd) < 0)
+		file->failed = true;
+	file->fd = -1;
+
+	return;
+}//End pwrite_file()
+
+static void* transfer_routine(void* argument){
+	ThreadBatch* batch = argument;
+
+	//Buffer reused by every file loaded by this thread.
+	unsigned char* buffer = NULL;
+	size_t capacity = 0;
+
+	for(;;){
+		pthread_mutex_lock(&batch->lock);
+		size_t i = batch->next++;
+		pthread_mutex_unlock(&batch->lock);
+
+		if(i >= batch->nbFiles)
+			break;
+
+		FileTransfer* file = &batch->files[i];
+
+		if(batch->writing){
+			pwrite_file(file);
+			continue;
+		}
+
+		file->buffer = buffer;
+		pread_file(file, &capacity);
+		buffer = file->buffer;
+
+		parse_file(file);
+		file->buffer = NULL;
+	}//End for()
+
+	free(buffer);
+
+	return NULL;
+}//End transfer_routine()
+
+static void threads_transfer(FileTransfer* files, size_t nbFiles, bool writing){
+	ThreadBatch batch;
+	batch.files = files;
+	batch.nbFiles = nbFiles;
+	batch.next = 0;
+	batch.writing = writing;
+	pthread_mutex_init(&batch.lock, NULL);
+
+	size_t nbThreads = nbFiles < NB_IO_THREADS ? nbFiles : NB_IO_THREADS;
+	pthread_t threads[NB_IO_THREADS];
+	size_t nbStarted = 0;
+
+	for(size_t t = 1; t < nbThreads; ++t){
+		if(pthread_create(&threads[t], NULL, transfer_routine, &batch) != 0)
+			break;
+		nbStarted = t;
+	}
+
+	//The current thread takes part, and processes everything if no thread could be started.
+	transfer_routine(&batch);
+
+	for(size_t t = 1; t <= nbStarted; ++t)
+		pthread_join(threads[t], NULL);
+
+	pthread_mutex_destroy(&batch.lock);
+
+	return;
+}//End threads_transfer()
+
+static size_t transfer(FileTransfer* files, size_t nbFiles, bool writing, BatchIOBackend backend, BatchIOStats* stats){
+	double startTime = getTimeSeconds();
+	BatchIOBackend used = BATCH_IO_URING;
+
+	if(backend == BATCH_IO_THREADS || uring_transfer(files, nbFiles, writing) < 0){
+		//io_uring could not process the files, they are all processed again from scratch.
+		for(size_t i = 0; i < nbFiles; ++i){
+			freePNM(files[i].image);
+			files[i].image = NULL;
+			files[i].buffer = NULL;
+			files[i].done = 0;
+			files[i].fd = -1;
+			files[i].failed = writing && files[i].size == 0;
+		}
+
+		threads_transfer(files, nbFiles, writing);
+		used = BATCH_IO_THREADS;
+	}
+
+	size_t nbFailed = 0;
+	size_t nbBytes = 0;
+
+	for(size_t i = 0; i < nbFiles; ++i){
+		if(files[i].failed)
+			nbFailed++;
+		else
+			nbBytes += files[i].size;
+	}
+
+	if(stats){
+		stats->backend = used;
+		stats->nbFiles = nbFiles;
+		stats->nbFailed = nbFailed;
+		stats->nbBytes = nbBytes;
+		stats->seconds = getTimeSeconds() - startTime;
+	}
+
+	return nbFailed;
+}//End transfer()
+
+size_t loadPNMBatch(const char* const* filenames, size_t nbFiles, PNMImage** images, BatchIOBackend backend, BatchIOStats* stats){
+	FileTransfer* files = calloc(nbFiles ? nbFiles : 1, sizeof(FileTransfer));
+	if(!files){
+		for(size_t i = 0; i < nbFiles; ++i)
+			images[i] = NULL;
+		return nbFiles;
+	}
+
+	for(size_t i = 0; i < nbFiles; ++i){
+		files[i].filename = filenames[i];
+		files[i].fd = -1;
+	}
+
+	size_t nbFailed = transfer(files, nbFiles, false, backend, stats);
+
+	for(size_t i = 0; i < nbFiles; ++i){
+		if(files[i].failed){
+			freePNM(files[i].image);
+			files[i].image = NULL;
+		}
+		images[i] = files[i].image;
+	}
+
+	free(files);
+
+	return nbFailed;
+}//End loadPNMBatch()
+
+size_t writePNMBatch(const char* const* filenames, const PNMImage* const* images, size_t nbFiles, int* results, BatchIOBackend backend, BatchIOStats* stats){
+	FileTransfer* files = calloc(nbFiles ? nbFiles : 1, sizeof(FileTransfer));
+	if(!files){
+		for(size_t i = 0; results && i < nbFiles; ++i)
+			results[i] = -1;
+		return nbFiles;
+	}
+
+	//Each file is written from the header and the pixels of its image, without copying them.
+	for(size_t i = 0; i < nbFiles; ++i){
+		int headerLength = -1;
+		if(images[i])
+			headerLength = formatPNMHeader(files[i].header, HEADER_SIZE, images[i]);
+
+		files[i].filename = filenames[i];
+		files[i].fd = -1;
+		files[i].failed = headerLength < 0;
+
+		if(headerLength >= 0){
+			files[i].parts[0].iov_base = files[i].header;
+			files[i].parts[0].iov_len = (size_t)headerLength;
+			files[i].parts[1].iov_base = images[i]->data;
+			files[i].parts[1].iov_len = 3 * images[i]->width * images[i]->height;
+			files[i].size = files[i].parts[0].iov_len + files[i].parts[1].iov_len;
+		}
+	}
+
+	size_t nbFailed = transfer(files, nbFiles, true, backend, stats);
+
+	for(size_t i = 0; results && i < nbFiles; ++i)
+		results[i] = files[i].failed ? -1 : 0;
+
+	free(files);
+
+	return nbFailed;
+}//End writePNMBatch()
@@ -0,0 +1,78 @@
+/* ------------------------------------------------------------------------- *
+ * Interface for loading and writing many PNM images at once.
+ *
+ * With the io_uring backend, the opens, reads (or writes) and closes of a
+ * whole window of files are each submitted with a single system call. The
+ * thread backend spreads the files over a few threads using pread() and
+ * pwrite(). In both cases, the files are read into reused buffers and their
+ * headers are parsed from memory.
+ * ------------------------------------------------------------------------- */
+
+#ifndef _BATCH_IO_H_
+#define _BATCH_IO_H_
+
+#include <stddef.h>
+
+#include "PNM.h"
+
+// Types ----------------------------------------------------------------------
+
+//Backends performing the batched input/output.
+typedef enum{
+    BATCH_IO_AUTO,      //io_uring if the kernel supports it, threads otherwise.
+    BATCH_IO_URING,     //Linux io_uring.
+    BATCH_IO_THREADS    //A few threads using pread() and pwrite().
+}BatchIOBackend;
+
+//Measures of batched input/output.
+typedef struct BatchIOStats_t{
+    BatchIOBackend backend; //Backend that was actually used.
+    size_t nbFiles;         //Number of files processed.
+    size_t nbFailed;        //Number of files that could not be processed.
+    size_t nbBytes;         //Number of bytes read or written.
+    double seconds;         //Time spent (in seconds).
+}BatchIOStats;
+
+
+// Methods --------------------------------------------------------------------
+
+/* ------------------------------------------------------------------------- *
+ * Load several PNM images.
+ * Each loaded image must later be deleted by calling freePNM().
+ *
+ * PARAMETERS
+ * filenames    Paths to the PNM files
+ * nbFiles      Number of files to load
+ * images       Array of nbFiles pointers, receiving the loaded images
+ *              (NULL for each file which could not be loaded)
+ * backend      The backend to use
+ * stats        Pointer to the measures to fill (or NULL)
+ *
+ * RETURN
+ * nbFailed     The number of files which could not be loaded
+ * ------------------------------------------------------------------------- */
+size_t loadPNMBatch(const char* const* filenames, size_t nbFiles,
+                    PNMImage** images, BatchIOBackend backend,
+                    BatchIOStats* stats);
+
+/* ------------------------------------------------------------------------- *
+ * Write several PNM images.
+ *
+ * PARAMETERS
+ * filenames    Paths to the PNM files
+ * images       The images to write
+ * nbFiles      Number of files to write
+ * results      Array of nbFiles integers, receiving 0 for each image that
+ *              was written and -1 for the others (or NULL)
+ * backend      The backend to use
+ * stats        Pointer to the measures to fill (or NULL)
+ *
+ * RETURN
+ * nbFailed     The number of images which could not be written
+ * ------------------------------------------------------------------------- */
+size_t writePNMBatch(const char* const* filenames,
+                     const PNMImage* const* images, size_t nbFiles,
+                     int* results, BatchIOBackend backend,
+                     BatchIOStats* stats);
+
+#endif // _BATCH_IO_H_
@@ -0,0 +1,654 @@
+/* ------------------------------------------------------------------------- *\
+ * NAME
+ *      bench-compare
+ * SYNOPSIS
+ *      bench-compare [--threshold percent] [--confidence level]
+ *                    [--min-time seconds] baseline_file candidate_file
+ * DESCIRPTION
+ *      Compare two files written by `bench --json`. The cases are matched by
+ *      image and number of removed pixels. For each phase of a case, the
+ *      mean times of the baseline and candidate runs are compared using
+ *      Welch's t-interval on the difference of the means: a phase regressed
+ *      if, at the given confidence level, the candidate is slower than the
+ *      baseline by more than the threshold. Phases whose baseline mean is
+ *      below the minimal time are reported but never flagged, their noise
+ *      being larger than any meaningful change.
+ * ARGUMENTS
+ *      baseline_file   JSON results of the reference version
+ *      candidate_file  JSON results of the version to check
+ *      percent         The tolerated slowdown, in percent (default 5)
+ *      level           The confidence level, 90, 95 or 99 (default 95)
+ *      seconds         The minimal mean time of a checked phase
+ *                      (default 0.001)
+ * RETURN
+ *      0 if no phase regressed, 1 if a phase regressed, 2 if the files could
+ *      not be compared.
+ *
+ * USAGE
+ *      ./bench-compare --threshold 3 base.json new.json
+ \* ------------------------------------------------------------------------- */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "slimming.h"
+
+// Maximal nesting depth of the JSON documents
+#define JSON_MAX_DEPTH 16
+
+// Exit code when the files cannot be compared
+#define EXIT_ERROR 2
+
+// Kinds of JSON values
+typedef enum {
+    JSON_NULL,
+    JSON_BOOLEAN,
+    JSON_NUMBER,
+    JSON_STRING,
+    JSON_ARRAY,
+    JSON_OBJECT
+} JsonType;
+
+// A JSON value; the members of an object have a key
+typedef struct JsonValue_t {
+    JsonType type;
+    double number;
+    char* string;                   // Value of a string
+    char* key;                      // Key of an object member
+    struct JsonValue_t** items;     // Elements of an array or members of an object
+    size_t nbItems;
+} JsonValue;
+
+// State of the JSON parser
+typedef struct {
+    const char* text;
+    const char* error;
+} JsonParser;
+
+// Statistics of the samples of a phase
+typedef struct {
+    size_t n;
+    double mean;
+    double variance;    // Unbiased sample variance
+} Samples;
+
+// Two-sided critical values of Student's t distribution for 1 to 30 degrees
+// of freedom, then for 40, 60, 120 and infinity
+static const double T_DEGREES[] = {40, 60, 120};
+static const double T_90[] = {
+    6.314, 2.920, 2.353, 2.132, 2.015, 1.943, 1.895, 1.860, 1.833, 1.812,
+    1.796, 1.782, 1.771, 1.761, 1.753, 1.746, 1.740, 1.734, 1.729, 1.725,
+    1.721, 1.717, 1.714, 1.711, 1.708, 1.706, 1.703, 1.701, 1.699, 1.697,
+    1.684, 1.671, 1.658, 1.645
+};
+static const double T_95[] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+    2.021, 2.000, 1.980, 1.960
+};
+static const double T_99[] = {
+    63.657, 9.925, 5.841, 4.604, 4.032, 3.707, 3.499, 3.355, 3.250, 3.169,
+    3.106, 3.055, 3.012, 2.977, 2.947, 2.921, 2.898, 2.878, 2.861, 2.845,
+    2.831, 2.819, 2.807, 2.797, 2.787, 2.779, 2.771, 2.763, 2.756, 2.750,
+    2.704, 2.660, 2.617, 2.576
+};
+
+
+/* ------------------------------------------------------------------------- *
+ * Free a JSON value and its children.
+ * ------------------------------------------------------------------------- */
+static void freeJson(JsonValue* value)
+{
+    if (!value)
+        return;
+
+    for (size_t i = 0; i < value->nbItems; i++)
+        freeJson(value->items[i]);
+
+    free(value->items);
+    free(value->string);
+    free(value->key);
+    free(value);
+}
+
+/* ------------------------------------------------------------------------- *
+ * Skip the white spaces at the current position of the parser.
+ * ------------------------------------------------------------------------- */
+static void skipSpaces(JsonParser* parser)
+{
+    while (*parser->text == ' ' || *parser->text == '\t' ||
+           *parser->text == '\n' || *parser->text == '\r')
+        parser->text++;
+}
+
+/* ------------------------------------------------------------------------- *
+ * Parse a JSON string. Escaped characters other than \" \\ \/ \n \t \r are
+ * not decoded, which does not matter for the files written by the bench.
+ *
+ * RETURN
+ * string       The decoded string, to be freed
+ * NULL         If the string is invalid or an allocation failed
+ * ------------------------------------------------------------------------- */
+static char* parseString(JsonParser* parser)
+{
+    const char* start = ++parser->text;
+    size_t length = 0;
+
+    while (*parser->text && *parser->text != '"')
+    {
+        if (*parser->text == '\\' && parser->text[1])
+            parser->text++;
+        parser->text++;
+        length++;
+    }
+
+    if (*parser->text != '"')
+    {
+        parser->error = "unterminated string";
+        return NULL;
+    }
+    parser->text++;
+
+    char* string = malloc(length + 1);
+    if (!string)
+    {
+        parser->error = "out of memory";
+        return NULL;
+    }
+
+    size_t i = 0;
+    for (const char* c = start; i < length; c++)
+    {
+        if (*c == '\\')
+        {
+            c++;
+            string[i++] = *c == 'n' ? '\n' : *c == 't' ? '\t' : *c == 'r' ? '\r' : *c;
+        }
+        else
+            string[i++] = *c;
+    }
+    string[length] = '\0';
+
+    return string;
+}
+
+/* ------------------------------------------------------------------------- *
+ * Append an item to an array or object.
+ *
+ * RETURN
+ * 0            In case of success
+ * -1           If an allocation failed
+ * ------------------------------------------------------------------------- */
+static int appendItem(JsonValue* container, JsonValue* item)
+{
+    JsonValue** items = realloc(container->items,
+                                sizeof(JsonValue*) * (container->nbItems + 1));
+    if (!items)
+        return -1;
+
+    container->items = items;
+    container->items[container->nbItems++] = item;
+
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * Parse the JSON value at the current position of the parser.
+ *
+ * PARAMETERS
+ * parser       The parser
+ * depth        The nesting depth of the value
+ *
+ * RETURN
+ * value        The parsed value, to be freed by freeJson()
+ * NULL         If the value is invalid (parser->error is set)
+ * ------------------------------------------------------------------------- */
+static JsonValue* parseValue(JsonParser* parser, int depth)
+{
+    if (depth > JSON_MAX_DEPTH)
+    {
+        parser->error = "too deeply nested";
+        return NULL;
+    }
+
+    JsonValue* value = calloc(1, sizeof(JsonValue));
+    if (!value)
+    {
+        parser->error = "out of memory";
+        return NULL;
+    }
+
+    skipSpaces(parser);
+    char c = *parser->text;
+
+    if (c == '{' || c == '[')
+    {
+        char end = c == '{' ? '}' : ']';
+        value->type = c == '{' ? JSON_OBJECT : JSON_ARRAY;
+        parser->text++;
+        skipSpaces(parser);
+
+        if (*parser->text == end)
+        {
+            parser->text++;
+            return value;
+        }
+
+        while (true)
+        {
+            char* key = NULL;
+
+            if (value->type == JSON_OBJECT)
+            {
+                skipSpaces(parser);
+                if (*parser->text != '"')
+                {
+                    parser->error = "expected a key";
+                    break;
+                }
+                if (!(key = parseString(parser)))
+                    break;
+                skipSpaces(parser);
+                if (*parser->text != ':')
+                {
+                    parser->error = "expected ':'";
+                    free(key);
+                    break;
+                }
+                parser->text++;
+            }
+
+            JsonValue* item = parseValue(parser, depth + 1);
+            if (!item)
+            {
+                free(key);
+                break;
+            }
+            item->key = key;
+
+            if (appendItem(value, item) < 0)
+            {
+                parser->error = "out of memory";
+                freeJson(item);
+                break;
+            }
+
+            skipSpaces(parser);
+            if (*parser->text == ',')
+            {
+                parser->text++;
+                continue;
+            }
+            if (*parser->text == end)
+            {
+                parser->text++;
+                return value;
+            }
+
+            parser->error = "expected ',' or end of container";
+            break;
+        }
+
+        freeJson(value);
+        return NULL;
+    }
+
+    if (c == '"')
+    {
+        value->type = JSON_STRING;
+        if (!(value->string = parseString(parser)))
+        {
+            free(value);
+            return NULL;
+        }
+        return value;
+    }
+
+    if (strncmp(parser->text, "true", 4) == 0 || strncmp(parser->text, "false", 5) == 0)
+    {
+        value->type = JSON_BOOLEAN;
+        value->number = c == 't';
+        parser->text += c == 't' ? 4 : 5;
+        return value;
+    }
+
+    if (strncmp(parser->text, "null", 4) == 0)
+    {
+        value->type = JSON_NULL;
+        parser->text += 4;
+        return value;
+    }
+
+    char* end;
+    value->type = JSON_NUMBER;
+    value->number = strtod(parser->text, &end);
+    if (end == parser->text)
+    {
+        parser->error = "unexpected character";
+        free(value);
+        return NULL;
+    }
+    parser->text = end;
+
+    return value;
+}
+
+/* ------------------------------------------------------------------------- *
+ * Load and parse a JSON file.
+ *
+ * RETURN
+ * value        The root value, to be freed by freeJson()
+ * NULL         If the file cannot be read or parsed (an error is printed)
+ * ------------------------------------------------------------------------- */
+static JsonValue* loadJson(const char* filename)
+{
+    FILE* fp = fopen(filename, "rb");
+    if (!fp)
+    {
+        fprintf(stderr, "Cannot open '%s'\n", filename);
+        return NULL;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    rewind(fp);
+
+    char* text = size >= 0 ? malloc((size_t)size + 1) : NULL;
+    if (!text || fread(text, 1, (size_t)size, fp) != (size_t)size)
+    {
+        fprintf(stderr, "Cannot read '%s'\n", filename);
+        free(text);
+        fclose(fp);
+        return NULL;
+    }
+    text[size] = '\0';
+    fclose(fp);
+
+    JsonParser parser = {text, NULL};
+    JsonValue* root = parseValue(&parser, 0);
+    if (root)
+    {
+        skipSpaces(&parser);
+        if (*parser.text)
+        {
+            parser.error = "trailing characters";
+            freeJson(root);
+            root = NULL;
+        }
+    }
+
+    if (!root)
+        fprintf(stderr, "Invalid JSON in '%s' at offset %ld: %s\n", filename,
+                (long)(parser.text - text), parser.error);
+
+    free(text);
+    return root;
+}
+
+/* ------------------------------------------------------------------------- *
+ * Give the member `key` of an object, of the given type.
+ *
+ * RETURN
+ * member       The member
+ * NULL         If `object` is not an object or has no such member
+ * ------------------------------------------------------------------------- */
+static const JsonValue* getMember(const JsonValue* object, const char* key,
+                                  JsonType type)
+{
+    if (!object || object->type != JSON_OBJECT)
+        return NULL;
+
+    for (size_t i = 0; i < object->nbItems; i++)
+        if (strcmp(object->items[i]->key, key) == 0 && object->items[i]->type == type)
+            return object->items[i];
+
+    return NULL;
+}
+
+/* ------------------------------------------------------------------------- *
+ * Find the case of `cases` reducing the image `image` by `k` pixels.
+ * ------------------------------------------------------------------------- */
+static const JsonValue* findCase(const JsonValue* cases, const char* image, double k)
+{
+    for (size_t i = 0; i < cases->nbItems; i++)
+    {
+        const JsonValue* name = getMember(cases->items[i], "image", JSON_STRING);
+        const JsonValue* pixels = getMember(cases->items[i], "k", JSON_NUMBER);
+
+        if (name && pixels && strcmp(name->string, image) == 0 && pixels->number == k)
+            return cases->items[i];
+    }
+
+    return NULL;
+}
+
+/* ------------------------------------------------------------------------- *
+ * Compute the statistics of the samples of the phase `phase` of a case.
+ *
+ * RETURN
+ * 0            In case of success
+ * -1           If the case has no sample for this phase
+ * ------------------------------------------------------------------------- */
+static int getSamples(const JsonValue* benchCase, const char* phase, Samples* samples)
+{
+    const JsonValue* phases = getMember(benchCase, "phases", JSON_OBJECT);
+    const JsonValue* seconds = getMember(getMember(phases, phase, JSON_OBJECT),
+                                         "seconds", JSON_ARRAY);
+    if (!seconds || !seconds->nbItems)
+        return -1;
+
+    double sum = 0;
+    for (size_t i = 0; i < seconds->nbItems; i++)
+        sum += seconds->items[i]->number;
+
+    samples->n = seconds->nbItems;
+    samples->mean = sum / samples->n;
+    samples->variance = 0;
+
+    if (samples->n > 1)
+    {
+        for (size_t i = 0; i < seconds->nbItems; i++)
+        {
+            double deviation = seconds->items[i]->number - samples->mean;
+            samples->variance += deviation * deviation;
+        }
+        samples->variance /= samples->n - 1;
+    }
+
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * Give the two-sided critical value of Student's t distribution for
+ * `degrees` degrees of freedom, rounded down to the nearest tabulated one.
+ * ------------------------------------------------------------------------- */
+static double criticalValue(const double* table, double degrees)
+{
+    if (degrees < 1)
+        degrees = 1;
+    if (degrees <= 30)
+        return table[(size_t)degrees - 1];
+
+    size_t i = 0;
+    while (i < sizeof(T_DEGREES) / sizeof(T_DEGREES[0]) && degrees >= T_DEGREES[i])
+        i++;
+
+    return i ? table[29 + i] : table[29];
+}
+
+
+int main(int argc, char* argv[])
+{
+    double threshold = 5;
+    double minTime = 1e-3;
+    const double* table = T_95;
+    int confidence = 95;
+    int first = 1;
+
+    /* --- Argument parsing --- */
+    while (first < argc && strncmp(argv[first], "--", 2) == 0)
+    {
+        double value;
+        char extra;
+
+        if (first + 1 >= argc ||
+            sscanf(argv[first + 1], "%lf%c", &value, &extra) != 1 || value < 0)
+        {
+            fprintf(stderr, "Invalid option '%s'\n", argv[first]);
+            return EXIT_ERROR;
+        }
+
+        if (strcmp(argv[first], "--threshold") == 0)
+            threshold = value;
+        else if (strcmp(argv[first], "--min-time") == 0)
+            minTime = value;
+        else if (strcmp(argv[first], "--confidence") == 0 &&
+                 (value == 90 || value == 95 || value == 99))
+        {
+            confidence = (int)value;
+            table = value == 90 ? T_90 : value == 95 ? T_95 : T_99;
+        }
+        else
+        {
+            fprintf(stderr, "Unknown option '%s'\n", argv[first]);
+            return EXIT_ERROR;
+        }
+
+        first += 2;
+    }
+
+    if (argc - first != 2)
+    {
+        fprintf(stderr, "Usage: %s [--threshold percent] [--confidence 90|95|99] "
+                        "[--min-time seconds] baseline.json candidate.json\n", argv[0]);
+        return EXIT_ERROR;
+    }
+
+    /* --- Loading of the results --- */
+    JsonValue* baseline = loadJson(argv[first]);
+    JsonValue* candidate = loadJson(argv[first + 1]);
+    const JsonValue* baseCases = getMember(baseline, "cases", JSON_ARRAY);
+    const JsonValue* candCases = getMember(candidate, "cases", JSON_ARRAY);
+
+    if (!baseCases || !candCases)
+    {
+        if (baseline && candidate)
+            fprintf(stderr, "The files do not contain bench results\n");
+        freeJson(baseline);
+        freeJson(candidate);
+        return EXIT_ERROR;
+    }
+
+    /* --- Comparison of each case --- */
+    const char* phases[NB_SLIMMING_PHASES + 1];
+    for (int phase = 0; phase < NB_SLIMMING_PHASES; phase++)
+        phases[phase] = getSlimmingPhaseName((SlimmingPhase)phase);
+    phases[NB_SLIMMING_PHASES] = "total";
+
+    size_t nbCompared = 0;
+    size_t nbRegressions = 0;
+
+    printf("threshold %.2f%%, confidence %d%%\n", threshold, confidence);
+
+    for (size_t i = 0; i < baseCases->nbItems; i++)
+    {
+        const JsonValue* baseCase = baseCases->items[i];
+        const JsonValue* image = getMember(baseCase, "image", JSON_STRING);
+        const JsonValue* k = getMember(baseCase, "k", JSON_NUMBER);
+        if (!image || !k)
+            continue;
+
+        const JsonValue* candCase = findCase(candCases, image->string, k->number);
+        if (!candCase)
+        {
+            printf("\n%s (k = %.0f): missing from the candidate\n", image->string, k->number);
+            continue;
+        }
+
+        nbCompared++;
+        printf("\n%s (k = %.0f)\n", image->string, k->number);
+        printf("%-10s %12s %12s %9s %21s  %s\n", "phase", "baseline", "candidate",
+               "change", "interval", "verdict");
+
+        for (int phase = 0; phase <= NB_SLIMMING_PHASES; phase++)
+        {
+            Samples base, cand;
+            if (getSamples(baseCase, phases[phase], &base) < 0 ||
+                getSamples(candCase, phases[phase], &cand) < 0)
+                continue;
+
+            // Welch's interval on the difference of the means, relative to
+            // the baseline mean; no interval without two samples on each side
+            double difference = cand.mean - base.mean;
+            double margin = 0;
+            bool interval = base.n > 1 && cand.n > 1;
+
+            if (interval)
+            {
+                double baseTerm = base.variance / base.n;
+                double candTerm = cand.variance / cand.n;
+                double error = sqrt(baseTerm + candTerm);
+                double degrees = baseTerm + candTerm > 0 ?
+                                 (baseTerm + candTerm) * (baseTerm + candTerm) /
+                                 (baseTerm * baseTerm / (base.n - 1) +
+                                  candTerm * candTerm / (cand.n - 1)) : 1e9;
+
+                margin = criticalValue(table, degrees) * error;
+            }
+
+            double scale = base.mean > 0 ? 100 / base.mean : 0;
+            double change = difference * scale;
+            double low = (difference - margin) * scale;
+            double high = (difference + margin) * scale;
+
+            const char* verdict;
+            if (base.mean < minTime)
+                verdict = "too short";
+            else if (low > threshold)
+            {
+                verdict = "REGRESSION";
+                nbRegressions++;
+            }
+            else if (high < -threshold)
+                verdict = "faster";
+            else if (low > 0 || high < 0)
+                verdict = "small change";
+            else
+                verdict = "no change";
+
+            char bounds[32];
+            if (interval)
+                snprintf(bounds, sizeof(bounds), "[%+.2f%%, %+.2f%%]", low, high);
+            else
+                snprintf(bounds, sizeof(bounds), "n/a");
+
+            printf("%-10s %12.6f %12.6f %+8.2f%% %21s  %s\n", phases[phase],
+                   base.mean, cand.mean, change, bounds, verdict);
+        }
+    }
+
+    for (size_t i = 0; i < candCases->nbItems; i++)
+    {
+        const JsonValue* image = getMember(candCases->items[i], "image", JSON_STRING);
+        const JsonValue* k = getMember(candCases->items[i], "k", JSON_NUMBER);
+
+        if (image && k && !findCase(baseCases, image->string, k->number))
+            printf("\n%s (k = %.0f): missing from the baseline\n", image->string, k->number);
+    }
+
+    freeJson(baseline);
+    freeJson(candidate);
+
+    if (!nbCompared)
+    {
+        fprintf(stderr, "No case in common\n");
+        return EXIT_ERROR;
+    }
+
+    printf("\n%zu case(s) compared, %zu regression(s)\n", nbCompared, nbRegressions);
+
+    return nbRegressions ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,1074 @@
+/* ------------------------------------------------------------------------- *\
+ * NAME
+ *      bench
+ * SYNOPSIS
+ *      bench [--runs nbRuns] [--k nbPix] [--json json_file]
+ *            [--probe-mb probeSize] [--lockstep nbCopies]
+ *            [--engine exact|astar|runs] [--groove-width grooveWidth]
+ *            [--scaling maxThreads] input_file...
+ * DESCIRPTION
+ *      Measure the time spent in each phase of reduceImageWidth() and
+ *      compare it with an analytic model of the bytes touched and the
+ *      operations performed by the phase, and with the bandwidth and
+ *      arithmetic throughput of the machine measured by STREAM-like probes.
+ *      For each phase, the achieved bandwidth is given as a fraction of the
+ *      peak memory bandwidth and of the peak cache bandwidth (probe on
+ *      arrays fitting in the caches), together with the arithmetic intensity
+ *      (operations per byte) and the resource (memory or compute) bounding
+ *      the phase according to the roofline model.
+ *      With --lockstep, each image is also reduced as a batch of nbCopies
+ *      variants (the image rotated vertically), once one image at a time and
+ *      once with reduceImagesWidth(), and both throughputs are compared.
+ *      With --groove-width, the reductions remove grooves of grooveWidth
+ *      columns, and each image is also reduced once with grooves of a
+ *      single column: both times and removed energies are compared.
+ *      With --scaling, each image is also reduced with 1 to maxThreads
+ *      threads, the calling thread being pinned on the first CPUs allowed
+ *      (the threads it creates inheriting them), and as a batch of 1 to
+ *      maxThreads jobs at once, each one reduced by a thread pinned on its
+ *      own CPU. The speedup and parallel efficiency (speedup per thread) of
+ *      each phase, of the whole job and of the batch throughput are given.
+ * ARGUMENTS
+ *      input_file      An input image file in PNM format
+ *      nbRuns          The number of reductions of each image (default 3);
+ *                      the median time of each phase is reported
+ *      nbPix           The number of pixels removed from each image
+ *                      (default 10% of its width)
+ *      json_file       A file receiving every measure in JSON format
+ *      probeSize       The size of each array of the memory bandwidth probe,
+ *                      in MiB (default 64)
+ *      nbCopies        The number of images of the lockstep batch
+ *      exact|astar|runs
+ *                      The engine performing the reductions (default exact);
+ *                      with astar, the number of cells of the cost tables
+ *                      computed for each groove is also reported
+ *      grooveWidth     The number of adjacent columns removed by each
+ *                      groove (default 1)
+ *      maxThreads      The largest number of threads measured
+ *
+ * USAGE
+ *      ./bench --runs 5 --json bench.json pnm/01.pnm pnm/07.pnm
+ \* ------------------------------------------------------------------------- */
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "slimming.h"
+#include "slimmingBatch.h"
+#include "timing.h"
+#include "PNM.h"
+
+// Number of repetitions of each kernel of the probes (the best is kept)
+#define PROBE_REPETITIONS 5
+
+// Size of each array of the cache bandwidth probe (in KiB)
+#define CACHE_PROBE_SIZE 64
+
+// Number of operations of the compute probe
+#define PROBE_OPERATIONS 400000000.0
+
+// Results of the probes
+typedef struct {
+    double copy, scale, add, triad; // Memory bandwidth of each kernel (bytes/s)
+    double peakBandwidth;           // Best of the kernels (bytes/s)
+    double cacheBandwidth;          // Best of the kernels in the caches (bytes/s)
+    double peakOperations;          // Arithmetic throughput (operations/s)
+} MachineProbe;
+
+// Analytic model of a phase of a whole reduction
+typedef struct {
+    double bytes;   // Bytes moved between the core and the memory
+    double ops;     // Arithmetic operations and comparisons
+} PhaseModel;
+
+// Measures of the reductions of an image with a number of threads
+typedef struct {
+    size_t nbThreads;
+    double seconds[NB_SLIMMING_PHASES + 1]; // Median time of each phase, then of the whole job
+    double batchRate;                       // Median number of images reduced per second by
+                                            // nbThreads jobs at once
+} ScalingPoint;
+
+// A job of a batch, reduced by a single thread
+typedef struct {
+    const PNMImage* image;
+    size_t nbPix;
+    const SlimmingOptions* options;
+    const cpu_set_t* allowed;   // The CPUs the benchmark may use
+    size_t cpu;                 // The index of the CPU of the job, among the allowed ones
+    int result;
+} BatchJob;
+
+
+/* ------------------------------------------------------------------------- *
+ * Measure the bandwidth of the copy, scale, add and triad kernels of STREAM
+ * on arrays of `size` bytes.
+ *
+ * PARAMETERS
+ * size         The size of each array (in bytes)
+ * repetitions  The number of repetitions of each kernel (the best is kept)
+ * best         Array receiving the bandwidth of each kernel (bytes/s)
+ *
+ * RETURN
+ * 0            In case of success
+ * -1           if the arrays could not be allocated
+ * ------------------------------------------------------------------------- */
+static int probeStream(size_t size, int repetitions, double best[4])
+{
+    size_t n = size / sizeof(double);
+    double* a = malloc(n * sizeof(double));
+    double* b = malloc(n * sizeof(double));
+    double* c = malloc(n * sizeof(double));
+
+    if (!a || !b || !c)
+    {
+        free(a);
+        free(b);
+        free(c);
+        return -1;
+    }
+
+    // First touch, so that page faults are not measured
+    for (size_t i = 0; i < n; i++)
+    {
+        a[i] = 1.0;
+        b[i] = 2.0;
+        c[i] = 0.0;
+    }
+
+    const double bytes[4] = {16.0 * n, 16.0 * n, 24.0 * n, 24.0 * n};
+    const double scalar = 3.0;
+
+    for (int kernel = 0; kernel < 4; kernel++)
+        best[kernel] = 0;
+
+    for (int r = 0; r < repetitions; r++)
+    {
+        double times[5];
+
+        times[0] = getTimeSeconds();
+        for (size_t i = 0; i < n; i++)
+            c[i] = a[i];
+        times[1] = getTimeSeconds();
+        for (size_t i = 0; i < n; i++)
+            b[i] = scalar * c[i];
+        times[2] = getTimeSeconds();
+        for (size_t i = 0; i < n; i++)
+            c[i] = a[i] + b[i];
+        times[3] = getTimeSeconds();
+        for (size_t i = 0; i < n; i++)
+            a[i] = b[i] + scalar * c[i];
+        times[4] = getTimeSeconds();
+
+        for (int kernel = 0; kernel < 4; kernel++)
+        {
+            double elapsed = times[kernel + 1] - times[kernel];
+            if (elapsed > 0 && bytes[kernel] / elapsed > best[kernel])
+                best[kernel] = bytes[kernel] / elapsed;
+        }
+    }
+
+    // Keep the arrays alive
+    volatile double sink = a[n / 2] + b[n / 3] + c[n / 4];
+    (void)sink;
+
+    free(a);
+    free(b);
+    free(c);
+
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * Measure the memory bandwidth on arrays of `size` MiB, the cache bandwidth
+ * and the throughput of independent floating point additions.
+ *
+ * PARAMETERS
+ * size         The size of each array of the memory probe (in MiB)
+ * probe        Where to store the results
+ *
+ * RETURN
+ * 0            In case of success
+ * -1           if the arrays could not be allocated
+ * ------------------------------------------------------------------------- */
+static int probeMachine(size_t size, MachineProbe* probe)
+{
+    double best[4];
+    double cache[4];
+
+    if (probeStream(size << 20, PROBE_REPETITIONS, best) < 0 ||
+        probeStream(CACHE_PROBE_SIZE << 10, 200 * PROBE_REPETITIONS, cache) < 0)
+        return -1;
+
+    probe->copy = best[0];
+    probe->scale = best[1];
+    probe->add = best[2];
+    probe->triad = best[3];
+    probe->peakBandwidth = 0;
+    probe->cacheBandwidth = 0;
+    for (int kernel = 0; kernel < 4; kernel++)
+    {
+        if (best[kernel] > probe->peakBandwidth)
+            probe->peakBandwidth = best[kernel];
+        if (cache[kernel] > probe->cacheBandwidth)
+            probe->cacheBandwidth = cache[kernel];
+    }
+
+    // Independent additions, as in the energy and cost computations
+    float accumulators[16];
+    for (int i = 0; i < 16; i++)
+        accumulators[i] = (float)i;
+
+    volatile float increment = 1e-7f;
+    float step = increment;
+    size_t nbIterations = (size_t)(PROBE_OPERATIONS / 16);
+
+    double start = getTimeSeconds();
+    for (size_t i = 0; i < nbIterations; i++)
+    {
+        for (int j = 0; j < 16; j++)
+            accumulators[j] += step;
+    }
+    double elapsed = getTimeSeconds() - start;
+
+    volatile float total = 0;
+    for (int i = 0; i < 16; i++)
+        total += accumulators[i];
+
+    probe->peakOperations = elapsed > 0 ? PROBE_OPERATIONS / elapsed : 0;
+
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * Model the bytes touched and the operations performed by each phase of the
+ * reduction of a `width` x `height` image by k pixels.
+ *
+ * The models follow the implementation of slimming.c:
+ * - energy: each pixel (3 bytes) is read once thanks to the caches, and its
+ *   energy (a float) written; 3 channels x (2 differences, 2 absolute
+ *   values, 2 halvings, 2 sums) plus 2 sums.
+ * - DP build: each cell reads its energy and the previous line (4 bytes
+ *   each, amortised) and writes its cost; 2 comparisons and 1 sum.
+ * - backtrack: a scan of the last line, then 3 cells per line of the
+ *   table. The table is a single allocation, so the walk goes up at a
+ *   constant stride of one line: a cache line per line of the table, or
+ *   less when its lines are shorter than a cache line; about 2 comparisons
+ *   per cell visited.
+ * - removal: each line is moved once, each pixel being read and written.
+ * - update: each line of the cost table is shifted after the groove (half
+ *   a line on average, read and written), then the cells of the cone below
+ *   the first pixel of the groove get a new energy and cost.
+ *
+ * With the astar engine, or grooves of several columns (whatever the
+ * engine), the cost table is built anew for each groove, over the energies
+ * (or the sums of the energies of the columns of the groove):
+ * - DP build and update: each cell reads the energies of its columns
+ *   (sliding sum: 2 energies) and the 3 costs above it, and writes its
+ *   cost; 2 sums for the energies, 3 comparisons and 1 sum.
+ * - backtrack: as for the exact engine.
+ * - removal: half of each line of pixels and energies moves on average,
+ *   read and written.
+ * - update: the updated cells get a new energy.
+ *
+ * With the astar and runs engines, a bulk pass first reads the pixels to
+ * find the uniform columns, then moves each line once (read and written)
+ * if it removes some: those grooves need no cost table.
+ *
+ * With the run-length engine (runs, or astar on flat-color images), the
+ * cost table is built for each groove over segments of cells, whose number
+ * is given by the updated cells of the measures:
+ * - energy: the encoding of the lines as runs reads each pixel once.
+ * - DP build and update: each segment reads its 5 neighbouring runs and 3
+ *   segments of the line above (16 bytes each) and writes its cost and
+ *   start; the energy of one pixel, 3 comparisons and 1 sum.
+ * - backtrack: a binary search of 3 cells per line, about 4 cache lines.
+ * - removal: the runs of each line are scanned up to the groove, about as
+ *   many as its segments.
+ *
+ * PARAMETERS
+ * width        Width of the image (in pixels)
+ * height       Height of the image (in pixels)
+ * k            The number of pixels removed
+ * engine       The engine performing the reduction
+ * grooveWidth  The number of columns removed by each groove
+ * stats        The measures of a reduction (numbers of bulk grooves and updated
+ *              cells)
+ * models       Array receiving the model of each phase
+ * ------------------------------------------------------------------------- */
+static void modelPhases(size_t width, size_t height, size_t k, SlimmingEngine engine,
+                        size_t grooveWidth, const SlimmingStats* stats,
+                        PhaseModel models[NB_SLIMMING_PHASES])
+{
+    const double energyBytes = 3 + 4, energyOps = 3 * 8 + 2;
+    const double costBytes = 4 + 4 + 4, costOps = 3;
+    double w = (double)width, h = (double)height;
+
+    models[SLIMMING_PHASE_ENERGY].bytes = w * h * energyBytes;
+    models[SLIMMING_PHASE_ENERGY].ops = w * h * energyOps;
+    models[SLIMMING_PHASE_DP_BUILD].bytes = w * (h - 1) * costBytes;
+    models[SLIMMING_PHASE_DP_BUILD].ops = w * (h - 1) * costOps;
+
+    for (int phase = SLIMMING_PHASE_BACKTRACK; phase < NB_SLIMMING_PHASES; phase++)
+    {
+        models[phase].bytes = 0;
+        models[phase].ops = 0;
+    }
+
+    // The bulk pass reads the image once, and compacts its lines if it removes columns
+    double bulkBytes = 0;
+    if (engine != SLIMMING_ENGINE_EXACT && grooveWidth == 1)
+        bulkBytes = w * h * 3 * (stats->nbBulkGrooves > 0 ? 3 : 1);
+
+    if (bulkBytes > 0 && stats->nbBulkGrooves >= k)
+    {
+        for (int phase = 0; phase < NB_SLIMMING_PHASES; phase++)
+        {
+            models[phase].bytes = 0;
+            models[phase].ops = 0;
+        }
+
+        models[SLIMMING_PHASE_REMOVAL].bytes = bulkBytes;
+        return;
+    }
+
+    if (grooveWidth > 1 || (engine == SLIMMING_ENGINE_ASTAR && stats->nbRunGrooves == 0))
+    {
+        double updated = (double)stats->nbUpdatedCells;
+
+        models[SLIMMING_PHASE_DP_BUILD].bytes = 0;
+        models[SLIMMING_PHASE_DP_BUILD].ops = 0;
+
+        models[SLIMMING_PHASE_REMOVAL].bytes = bulkBytes;
+
+        // The grooves removed with uniform columns need no cost table
+        for (size_t removed = stats->nbBulkGrooves; removed < k; removed += grooveWidth)
+        {
+            double current = (double)(width - removed);
+            int phase = removed == stats->nbBulkGrooves ? SLIMMING_PHASE_DP_BUILD : SLIMMING_PHASE_UPDATE;
+
+            models[phase].bytes += current * h * (2 * 4 + costBytes);
+            models[phase].ops += current * h * (2 + costOps + 1);
+
+            models[SLIMMING_PHASE_BACKTRACK].bytes += current * 4 + h * fmin(64, current * 4);
+            models[SLIMMING_PHASE_BACKTRACK].ops += current + 2 * h;
+            models[SLIMMING_PHASE_REMOVAL].bytes += (3 + 4) * current * h;
+        }
+
+        models[SLIMMING_PHASE_UPDATE].bytes += updated * energyBytes;
+        models[SLIMMING_PHASE_UPDATE].ops += updated * energyOps;
+        return;
+    }
+
+    if (stats->nbRunGrooves > 0)
+    {
+        double segments = (double)stats->nbUpdatedCells;
+        double grooves = (double)stats->nbRunGrooves;
+        double perTable = grooves > 1 ? segments / (grooves - 1) : w * h;
+
+        models[SLIMMING_PHASE_ENERGY].bytes = w * h * 3;
+        models[SLIMMING_PHASE_ENERGY].ops = w * h;
+        models[SLIMMING_PHASE_DP_BUILD].bytes = perTable * (8 * 16 + 16);
+        models[SLIMMING_PHASE_DP_BUILD].ops = perTable * (energyOps + costOps + 1);
+        models[SLIMMING_PHASE_BACKTRACK].bytes = grooves * h * 4 * 64;
+        models[SLIMMING_PHASE_BACKTRACK].ops = grooves * h * 3 * log2(perTable / h + 1);
+        models[SLIMMING_PHASE_REMOVAL].bytes = grooves * perTable / 2 * 16 + w * h * 3 + bulkBytes;
+        models[SLIMMING_PHASE_REMOVAL].ops = grooves * perTable / 2;
+        models[SLIMMING_PHASE_UPDATE].bytes = segments * (8 * 16 + 16);
+        models[SLIMMING_PHASE_UPDATE].ops = segments * (energyOps + costOps + 1);
+        return;
+    }
+
+    for (size_t groove = 0; groove < k; groove++)
+    {
+        double current = (double)(width - groove);
+
+        models[SLIMMING_PHASE_BACKTRACK].bytes += current * 4 + h * fmin(64, current * 4);
+        models[SLIMMING_PHASE_BACKTRACK].ops += current + 2 * h;
+
+        models[SLIMMING_PHASE_REMOVAL].bytes += 2 * 3 * current * h;
+
+        // The cone widens by 2 cells per line, up to the width of the table
+        double cone = 0;
+        for (size_t i = 1; i < height; i++)
+        {
+            double cells = 2.0 * i + 1;
+            cone += cells < current - 1 ? cells : current - 1;
+        }
+
+        models[SLIMMING_PHASE_UPDATE].bytes += current * h * 4 +
+                                               cone * (energyBytes + costBytes);
+        models[SLIMMING_PHASE_UPDATE].ops += cone * (energyOps + costOps);
+    }
+}
+
+/* ------------------------------------------------------------------------- *
+ * Compare two doubles, for qsort().
+ * ------------------------------------------------------------------------- */
+static int compareDoubles(const void* a, const void* b)
+{
+    double first = *(const double*)a;
+    double second = *(const double*)b;
+
+    return (first > second) - (first < second);
+}
+
+/* ------------------------------------------------------------------------- *
+ * Give the median of n values (the values are sorted).
+ * ------------------------------------------------------------------------- */
+static double median(double* values, size_t n)
+{
+    qsort(values, n, sizeof(double), compareDoubles);
+
+    if (n % 2 == 1)
+        return values[n / 2];
+
+    return (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+/* ------------------------------------------------------------------------- *
+ * Write a JSON array of n doubles.
+ * ------------------------------------------------------------------------- */
+static void writeJsonArray(FILE* fp, const double* values, size_t n)
+{
+    fprintf(fp, "[");
+    for (size_t i = 0; i < n; i++)
+        fprintf(fp, "%s%.9f", i ? ", " : "", values[i]);
+    fprintf(fp, "]");
+}
+
+/* ------------------------------------------------------------------------- *
+ * Write a string as a JSON string.
+ * ------------------------------------------------------------------------- */
+static void writeJsonString(FILE* fp, const char* string)
+{
+    fputc('"', fp);
+    for (; *string; string++)
+    {
+        if (*string == '"' || *string == '\\')
+            fputc('\\', fp);
+        fputc(*string, fp);
+    }
+    fputc('"', fp);
+}
+
+/* ------------------------------------------------------------------------- *
+ * Reduce nbCopies variants of an image one at a time, then in lockstep, and
+ * print the throughput of both ways. The variant c is the image rotated
+ * vertically by c * height / nbCopies lines, so that the grooves differ.
+ *
+ * PARAMETERS
+ * image        The image
+ * nbPix        The number of pixels to remove
+ * nbCopies     The number of variants
+ *
+ * RETURN
+ * 0            In case of success
+ * -1           if a reduction failed or the results differ
+ * ------------------------------------------------------------------------- */
+static int compareLockstep(const PNMImage* image, size_t nbPix, size_t nbCopies)
+{
+    PNMImage** copies = calloc(nbCopies, sizeof(PNMImage*));
+    PNMImage** single = calloc(nbCopies, sizeof(PNMImage*));
+    PNMImage** lockstep = calloc(nbCopies, sizeof(PNMImage*));
+    int result = copies && single && lockstep ? 0 : -1;
+
+    for (size_t c = 0; c < nbCopies && result == 0; c++)
+    {
+        copies[c] = createPNM(image->width, image->height);
+        if (!copies[c])
+        {
+            result = -1;
+            break;
+        }
+
+        size_t shift = c * image->height / nbCopies;
+        for (size_t i = 0; i < image->height; i++)
+            memcpy(&copies[c]->data[i * image->width],
+                   &image->data[((i + shift) % image->height) * image->width],
+                   sizeof(PNMPixel) * image->width);
+    }
+
+    double singleSeconds = 0, lockstepSeconds = 0;
+
+    if (result == 0)
+    {
+        double start = getTimeSeconds();
+        for (size_t c = 0; c < nbCopies && result == 0; c++)
+            if (!(single[c] = reduceImageWidth(copies[c], nbPix)))
+                result = -1;
+        singleSeconds = getTimeSeconds() - start;
+    }
+
+    if (result == 0)
+    {
+        double start = getTimeSeconds();
+        if (reduceImagesWidth((const PNMImage* const*)copies, nbCopies, nbPix,
+                              lockstep, NULL) < 0)
+            result = -1;
+        lockstepSeconds = getTimeSeconds() - start;
+    }
+
+    bool identical = result == 0;
+    for (size_t c = 0; c < nbCopies && identical; c++)
+        identical = memcmp(single[c]->data, lockstep[c]->data,
+                           sizeof(PNMPixel) * single[c]->width * single[c]->height) == 0;
+
+    if (result == 0)
+        printf("lockstep   %zu images: %.1f images/s one at a time, %.1f images/s "
+               "in lockstep (x%.2f), %s results\n", nbCopies,
+               nbCopies / singleSeconds, nbCopies / lockstepSeconds,
+               singleSeconds / lockstepSeconds, identical ? "identical" : "DIFFERENT");
+
+    for (size_t c = 0; c < nbCopies; c++)
+    {
+        if (copies)
+            freePNM(copies[c]);
+        if (single)
+            freePNM(single[c]);
+        if (lockstep)
+            freePNM(lockstep[c]);
+    }
+    free(copies);
+    free(single);
+    free(lockstep);
+
+    return identical ? 0 : -1;
+}
+
+/* ------------------------------------------------------------------------- *
+ * Reduce an image with grooves of a single column, and write its time and
+ * removed energy next to the ones of the reduction with grooves of several
+ * columns.
+ *
+ * PARAMETERS
+ * image        The image
+ * nbPix        The number of pixels to remove
+ * options      The options of the reduction with grooves of several
+ *              columns, whose measures are the ones of that reduction
+ *
+ * RETURN
+ * 0            In case of success
+ * -1           if a reduction failed
+ * ------------------------------------------------------------------------- */
+static int compareSingleGrooves(const PNMImage* image, size_t nbPix,
+                                const SlimmingOptions* options)
+{
+    SlimmingOptions singleOptions = *options;
+    SlimmingStats singleStats;
+    singleOptions.grooveWidth = 1;
+    singleOptions.stats = &singleStats;
+
+    PNMImage* single = reduceImageWidthWithOptions(image, nbPix, &singleOptions);
+    if (!single)
+        return -1;
+
+    printf("grooves    %zu of 1 column: %.6f s, energy %.0f; %zu of %zu columns: "
+           "%.6f s (x%.2f), energy %.0f (%+.1f%%)\n", singleStats.nbGrooves,
+           singleStats.totalSeconds, singleStats.removedEnergy,
+           options->stats->nbGrooves, options->grooveWidth, options->stats->totalSeconds,
+           singleStats.totalSeconds / options->stats->totalSeconds,
+           options->stats->removedEnergy,
+           singleStats.removedEnergy > 0 ?
+           100 * (options->stats->removedEnergy / singleStats.removedEnergy - 1) : 0.0);
+
+    freePNM(single);
+
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * Pin the calling thread on nbCpus CPUs, the CPUs first to first+nbCpus-1
+ * among the allowed ones (taken again from the first when there are fewer
+ * allowed CPUs). The threads it creates then run on the same CPUs.
+ *
+ * PARAMETERS
+ * allowed      The CPUs the benchmark may use
+ * first        The index of the first CPU, among the allowed ones
+ * nbCpus       The number of CPUs
+ *
+ * RETURN
+ * 0            In case of success
+ * -1           if the thread could not be pinned
+ * ------------------------------------------------------------------------- */
+static int pinThread(const cpu_set_t* allowed, size_t first, size_t nbCpus)
+{
+    size_t nbAllowed = (size_t)CPU_COUNT(allowed);
+    cpu_set_t set;
+    CPU_ZERO(&set);
+
+    for (size_t c = first; c < first + nbCpus && c < first + nbAllowed; c++)
+    {
+        // The (c % nbAllowed)-th allowed CPU
+        size_t index = c % nbAllowed;
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+            if (CPU_ISSET(cpu, allowed) && index-- == 0)
+            {
+                CPU_SET(cpu, &set);
+                break;
+            }
+    }
+
+    return sched_setaffinity(0, sizeof(cpu_set_t), &set) == 0 ? 0 : -1;
+}
+
+/* ------------------------------------------------------------------------- *
+ * Reduce an image on a single thread pinned on a CPU, as a job of a batch.
+ * ------------------------------------------------------------------------- */
+static void* runBatchJob(void* argument)
+{
+    BatchJob* job = argument;
+
+    job->result = pinThread(job->allowed, job->cpu, 1);
+
+    PNMImage* output = reduceImageWidthWithOptions(job->image, job->nbPix, job->options);
+    if (!output)
+        job->result = -1;
+    freePNM(output);
+
+    return NULL;
+}
+
+/* ------------------------------------------------------------------------- *
+ * Measure the reduction of an image with 1 to maxThreads threads: the
+ * median time of each phase and of the whole job, with the thread reducing
+ * the image pinned on the first CPUs, and the median throughput of as many
+ * jobs at once, each one reduced by a single thread pinned on its own CPU.
+ *
+ * PARAMETERS
+ * image        The image
+ * nbPix        The number of pixels to remove
+ * options      The options of the reductions (whose number of threads and
+ *              measures are replaced)
+ * nbRuns       The number of repetitions of each measure
+ * allowed      The CPUs the benchmark may use
+ * points       Array of maxThreads points to fill
+ * maxThreads   The largest number of threads
+ *
+ * RETURN
+ * 0            In case of success
+ * -1           if a reduction failed, or if a thread could not be created
+ *              or pinned
+ * ------------------------------------------------------------------------- */
+static int measureScaling(const PNMImage* image, size_t nbPix, const SlimmingOptions* options,
+                          size_t nbRuns, const cpu_set_t* allowed, ScalingPoint* points,
+                          size_t maxThreads)
+{
+    double* seconds = malloc(sizeof(double) * nbRuns * (NB_SLIMMING_PHASES + 1));
+    BatchJob* jobs = malloc(sizeof(BatchJob) * maxThreads);
+    pthread_t* threads = malloc(sizeof(pthread_t) * maxThreads);
+    int result = seconds && jobs && threads ? 0 : -1;
+
+    SlimmingStats stats;
+    SlimmingOptions threadOptions = *options;
+    SlimmingOptions jobOptions = *options;
+    threadOptions.stats = &stats;
+    jobOptions.stats = NULL;
+    jobOptions.nbThreads = 1;
+
+    for (size_t t = 1; t <= maxThreads && result == 0; t++)
+    {
+        ScalingPoint* point = &points[t - 1];
+        point->nbThreads = t;
+        threadOptions.nbThreads = t;
+
+        // One job reduced by t threads
+        if (pinThread(allowed, 0, t) < 0)
+            result = -1;
+
+        for (size_t run = 0; run < nbRuns && result == 0; run++)
+        {
+            PNMImage* output = reduceImageWidthWithOptions(image, nbPix, &threadOptions);
+            if (!output)
+                result = -1;
+            freePNM(output);
+
+            for (int phase = 0; phase < NB_SLIMMING_PHASES; phase++)
+                seconds[phase * nbRuns + run] = stats.phaseSeconds[phase];
+            seconds[NB_SLIMMING_PHASES * nbRuns + run] = stats.totalSeconds;
+        }
+
+        for (int phase = 0; phase <= NB_SLIMMING_PHASES && result == 0; phase++)
+            point->seconds[phase] = median(&seconds[phase * nbRuns], nbRuns);
+
+        // t jobs reduced at once by a thread each
+        for (size_t run = 0; run < nbRuns && result == 0; run++)
+        {
+            size_t nbStarted = 0;
+            double start = getTimeSeconds();
+
+            for (; nbStarted < t; nbStarted++)
+            {
+                jobs[nbStarted] = (BatchJob){image, nbPix, &jobOptions, allowed, nbStarted, 0};
+                if (pthread_create(&threads[nbStarted], NULL, runBatchJob, &jobs[nbStarted]) != 0)
+                {
+                    result = -1;
+                    break;
+                }
+            }
+
+            for (size_t j = 0; j < nbStarted; j++)
+            {
+                pthread_join(threads[j], NULL);
+                if (jobs[j].result < 0)
+                    result = -1;
+            }
+
+            seconds[run] = (double)t / (getTimeSeconds() - start);
+        }
+
+        if (result == 0)
+            point->batchRate = median(seconds, nbRuns);
+    }
+
+    if (pinThread(allowed, 0, (size_t)CPU_COUNT(allowed)) < 0)
+        result = -1;
+
+    free(seconds);
+    free(jobs);
+    free(threads);
+
+    return result;
+}
+
+/* ------------------------------------------------------------------------- *
+ * Write the speedup and the parallel efficiency (speedup per thread) of
+ * each phase, of the whole job and of the batch throughput, for each
+ * number of threads.
+ *
+ * PARAMETERS
+ * points       The measures at each number of threads
+ * maxThreads   The largest number of threads
+ * ------------------------------------------------------------------------- */
+static void printScaling(const ScalingPoint* points, size_t maxThreads)
+{
+    printf("scaling    1 thread:");
+    for (int phase = 0; phase < NB_SLIMMING_PHASES; phase++)
+        printf(" %s %.6f s,", getSlimmingPhaseName(phase), points[0].seconds[phase]);
+    printf(" total %.6f s, batch %.2f images/s\n", points[0].seconds[NB_SLIMMING_PHASES],
+           points[0].batchRate);
+
+    for (int table = 0; table < 2; table++)
+    {
+        printf("%-11s", table == 0 ? "speedup" : "efficiency");
+        for (int phase = 0; phase < NB_SLIMMING_PHASES; phase++)
+            printf(" %9s", getSlimmingPhaseName(phase));
+        printf(" %9s %9s\n", "total", "batch");
+
+        for (size_t t = 0; t < maxThreads; t++)
+        {
+            double divisor = table == 0 ? 1 : (double)points[t].nbThreads;
+
+            printf("%3zu %-7s", points[t].nbThreads, points[t].nbThreads > 1 ? "threads" : "thread");
+            for (int phase = 0; phase <= NB_SLIMMING_PHASES; phase++)
+                printf(" %9.3f", points[t].seconds[phase] > 0 ?
+                       points[0].seconds[phase] / points[t].seconds[phase] / divisor : 0.0);
+            printf(" %9.3f\n", points[0].batchRate > 0 ?
+                   points[t].batchRate / points[0].batchRate / divisor : 0.0);
+        }
+    }
+}
+
+/* ------------------------------------------------------------------------- *
+ * Write the measures at each number of threads as a JSON array.
+ * ------------------------------------------------------------------------- */
+static void writeJsonScaling(FILE* fp, const ScalingPoint* points, size_t maxThreads)
+{
+    fprintf(fp, "[");
+    for (size_t t = 0; t < maxThreads; t++)
+    {
+        fprintf(fp, "%s\n       {\"threads\": %zu, \"seconds\": {", t ? "," : "",
+                points[t].nbThreads);
+        for (int phase = 0; phase <= NB_SLIMMING_PHASES; phase++)
+            fprintf(fp, "%s\"%s\": %.9f", phase ? ", " : "",
+                    phase < NB_SLIMMING_PHASES ? getSlimmingPhaseName(phase) : "total",
+                    points[t].seconds[phase]);
+        fprintf(fp, "}, \"batch_images_per_second\": %.3f}", points[t].batchRate);
+    }
+    fprintf(fp, "]");
+}
+
+
+int main(int argc, char* argv[])
+{
+    size_t nbRuns = 3;
+    size_t k = 0;
+    size_t probeSize = 64;
+    size_t nbCopies = 0;
+    size_t grooveWidth = 1;
+    size_t maxThreads = 0;
+    SlimmingEngine engine = SLIMMING_ENGINE_EXACT;
+    const char* jsonFile = NULL;
+    int first = 1;
+
+    /* --- Argument parsing --- */
+    while (first < argc && strncmp(argv[first], "--", 2) == 0)
+    {
+        int value;
+        char extra;
+
+        if (first + 1 >= argc ||
+            (strcmp(argv[first], "--json") != 0 && strcmp(argv[first], "--engine") != 0 &&
+             (sscanf(argv[first + 1], "%d%c", &value, &extra) != 1 || value <= 0)))
+        {
+            fprintf(stderr, "Invalid option '%s'\n", argv[first]);
+            return EXIT_FAILURE;
+        }
+
+        if (strcmp(argv[first], "--runs") == 0)
+            nbRuns = (size_t)value;
+        else if (strcmp(argv[first], "--k") == 0)
+            k = (size_t)value;
+        else if (strcmp(argv[first], "--probe-mb") == 0)
+            probeSize = (size_t)value;
+        else if (strcmp(argv[first], "--lockstep") == 0)
+            nbCopies = (size_t)value;
+        else if (strcmp(argv[first], "--groove-width") == 0)
+            grooveWidth = (size_t)value;
+        else if (strcmp(argv[first], "--scaling") == 0)
+            maxThreads = (size_t)value;
+        else if (strcmp(argv[first], "--json") == 0)
+            jsonFile = argv[first + 1];
+        else if (strcmp(argv[first], "--engine") == 0 &&
+                 strcmp(argv[first + 1], "exact") == 0)
+            engine = SLIMMING_ENGINE_EXACT;
+        else if (strcmp(argv[first], "--engine") == 0 &&
+                 strcmp(argv[first + 1], "astar") == 0)
+            engine = SLIMMING_ENGINE_ASTAR;
+        else if (strcmp(argv[first], "--engine") == 0 &&
+                 strcmp(argv[first + 1], "runs") == 0)
+            engine = SLIMMING_ENGINE_RUNS;
+        else
+        {
+            fprintf(stderr, "Unknown option '%s'\n", argv[first]);
+            return EXIT_FAILURE;
+        }
+
+        first += 2;
+    }
+
+    if (first >= argc)
+    {
+        fprintf(stderr, "Usage: %s [--runs nbRuns] [--k nbPix] [--json bench.json] "
+                        "[--probe-mb probeSize] [--lockstep nbCopies] [--engine exact|astar|runs] "
+                        "[--groove-width grooveWidth] [--scaling maxThreads] input.pnm...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    /* --- Machine probes --- */
+    MachineProbe probe;
+    if (probeMachine(probeSize, &probe) < 0)
+    {
+        fprintf(stderr, "Aborting; cannot allocate the bandwidth probe\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("probe: copy %.2f GB/s, scale %.2f GB/s, add %.2f GB/s, triad %.2f GB/s, "
+           "peak %.2f GB/s, cache %.2f GB/s, %.2f Gop/s\n", probe.copy / 1e9,
+           probe.scale / 1e9, probe.add / 1e9, probe.triad / 1e9,
+           probe.peakBandwidth / 1e9, probe.cacheBandwidth / 1e9,
+           probe.peakOperations / 1e9);
+
+    FILE* json = NULL;
+    if (jsonFile)
+    {
+        json = fopen(jsonFile, "w");
+        if (!json)
+        {
+            fprintf(stderr, "Aborting; cannot open '%s'\n", jsonFile);
+            return EXIT_FAILURE;
+        }
+
+        fprintf(json, "{\n  \"probe\": {\"copy\": %.0f, \"scale\": %.0f, \"add\": %.0f, "
+                      "\"triad\": %.0f, \"peak_bandwidth\": %.0f, \"cache_bandwidth\": %.0f, "
+                      "\"peak_operations\": %.0f},\n  \"cases\": [",
+                probe.copy, probe.scale, probe.add, probe.triad, probe.peakBandwidth,
+                probe.cacheBandwidth, probe.peakOperations);
+    }
+
+    cpu_set_t allowed;
+    if (maxThreads && sched_getaffinity(0, sizeof(cpu_set_t), &allowed) != 0)
+    {
+        fprintf(stderr, "Aborting; cannot get the CPUs of the process\n");
+        return EXIT_FAILURE;
+    }
+
+    double* seconds = malloc(sizeof(double) * nbRuns * (NB_SLIMMING_PHASES + 1));
+    double* sorted = malloc(sizeof(double) * nbRuns);
+    ScalingPoint* points = malloc(sizeof(ScalingPoint) * (maxThreads ? maxThreads : 1));
+    if (!seconds || !sorted || !points)
+    {
+        fprintf(stderr, "Aborting; out of memory\n");
+        return EXIT_FAILURE;
+    }
+
+    int status = EXIT_SUCCESS;
+    size_t nbCases = 0;
+
+    /* --- Benchmark of each image --- */
+    for (int arg = first; arg < argc; arg++)
+    {
+        PNMImage* image = readPNM(argv[arg]);
+        if (!image)
+        {
+            fprintf(stderr, "Cannot load image '%s'\n", argv[arg]);
+            status = EXIT_FAILURE;
+            continue;
+        }
+
+        size_t nbPix = k ? k : (image->width / 10 ? image->width / 10 : 1);
+        if (nbPix >= image->width)
+        {
+            fprintf(stderr, "Image '%s' cannot be reduced by %zu pixels\n", argv[arg], nbPix);
+            freePNM(image);
+            status = EXIT_FAILURE;
+            continue;
+        }
+
+        SlimmingStats stats;
+        SlimmingOptions options;
+        initSlimmingOptions(&options);
+        options.stats = &stats;
+        options.engine = engine;
+        options.grooveWidth = grooveWidth;
+
+        // seconds[phase * nbRuns + run], the total being the last "phase"
+        size_t run;
+        for (run = 0; run < nbRuns; run++)
+        {
+            PNMImage* output = reduceImageWidthWithOptions(image, nbPix, &options);
+            if (!output)
+                break;
+            freePNM(output);
+
+            for (int phase = 0; phase < NB_SLIMMING_PHASES; phase++)
+                seconds[phase * nbRuns + run] = stats.phaseSeconds[phase];
+            seconds[NB_SLIMMING_PHASES * nbRuns + run] = stats.totalSeconds;
+        }
+
+        if (run < nbRuns)
+        {
+            fprintf(stderr, "Cannot reduce image '%s'\n", argv[arg]);
+            freePNM(image);
+            status = EXIT_FAILURE;
+            continue;
+        }
+
+        PhaseModel models[NB_SLIMMING_PHASES];
+        modelPhases(image->width, image->height, nbPix, engine, grooveWidth, &stats, models);
+
+        printf("\n%s (%zu x %zu, k = %zu, %zu runs, median)\n", argv[arg],
+               image->width, image->height, nbPix, nbRuns);
+        printf("%-10s %10s %10s %10s %8s %8s %8s %9s %8s %8s\n", "phase", "seconds", "MB",
+               "Mop", "GB/s", "%peakBW", "%cache", "op/byte", "%roof", "bound");
+
+        for (int phase = 0; phase < NB_SLIMMING_PHASES; phase++)
+        {
+            memcpy(sorted, &seconds[phase * nbRuns], sizeof(double) * nbRuns);
+            double time = median(sorted, nbRuns);
+            double bandwidth = time > 0 ? models[phase].bytes / time : 0;
+            double intensity = models[phase].bytes > 0 ?
+                               models[phase].ops / models[phase].bytes : 0;
+
+            // Roofline: attainable throughput given the arithmetic intensity
+            double memoryRoof = intensity * probe.peakBandwidth;
+            bool memoryBound = memoryRoof < probe.peakOperations;
+            double roof = memoryBound ? memoryRoof : probe.peakOperations;
+            double achieved = time > 0 ? models[phase].ops / time : 0;
+
+            printf("%-10s %10.6f %10.3f %10.3f %8.3f %7.1f%% %7.1f%% %9.3f %7.1f%% %8s\n",
+                   getSlimmingPhaseName(phase), time, models[phase].bytes / 1e6,
+                   models[phase].ops / 1e6, bandwidth / 1e9,
+                   100 * bandwidth / probe.peakBandwidth,
+                   100 * bandwidth / probe.cacheBandwidth, intensity,
+                   roof > 0 ? 100 * achieved / roof : 0.0,
+                   models[phase].ops == 0 || memoryBound ? "memory" : "compute");
+        }
+
+        memcpy(sorted, &seconds[NB_SLIMMING_PHASES * nbRuns], sizeof(double) * nbRuns);
+        printf("%-10s %10.6f\n", "total", median(sorted, nbRuns));
+
+        if (stats.nbSearchedCells)
+            printf("search     %zu cells searched\n", stats.nbSearchedCells);
+        if (stats.nbBulkGrooves)
+            printf("bulk       %zu of %zu grooves removed with uniform columns\n", stats.nbBulkGrooves,
+                   stats.nbGrooves);
+        if (stats.nbRunGrooves)
+            printf("runs       %zu of %zu grooves found over runs of identical pixels\n", stats.nbRunGrooves,
+                   stats.nbGrooves);
+
+        if (grooveWidth > 1 && compareSingleGrooves(image, nbPix, &options) < 0)
+        {
+            fprintf(stderr, "Cannot reduce image '%s' with single grooves\n", argv[arg]);
+            status = EXIT_FAILURE;
+        }
+
+        if (nbCopies && compareLockstep(image, nbPix, nbCopies) < 0)
+        {
+            fprintf(stderr, "Cannot reduce image '%s' in lockstep\n", argv[arg]);
+            status = EXIT_FAILURE;
+        }
+
+        bool scaled = maxThreads &&
+                      measureScaling(image, nbPix, &options, nbRuns, &allowed, points, maxThreads) == 0;
+        if (scaled)
+            printScaling(points, maxThreads);
+        else if (maxThreads)
+        {
+            fprintf(stderr, "Cannot measure the scaling on image '%s'\n", argv[arg]);
+            status = EXIT_FAILURE;
+        }
+
+        if (json)
+        {
+            fprintf(json, "%s\n    {\"image\": ", nbCases ? "," : "");
+            writeJsonString(json, argv[arg]);
+            fprintf(json, ", \"width\": %zu, \"height\": %zu, \"k\": %zu, \"runs\": %zu,\n"
+                          "     \"phases\": {", image->width, image->height, nbPix, nbRuns);
+
+            for (int phase = 0; phase <= NB_SLIMMING_PHASES; phase++)
+            {
+                const char* name = phase < NB_SLIMMING_PHASES ?
+                                   getSlimmingPhaseName(phase) : "total";
+
+                fprintf(json, "%s\n       \"%s\": {", phase ? "," : "", name);
+                if (phase < NB_SLIMMING_PHASES)
+                    fprintf(json, "\"bytes\": %.0f, \"ops\": %.0f, ",
+                            models[phase].bytes, models[phase].ops);
+                fprintf(json, "\"seconds\": ");
+                writeJsonArray(json, &seconds[phase * nbRuns], nbRuns);
+                fprintf(json, "}");
+            }
+
+            fprintf(json, "}");
+            if (scaled)
+            {
+                fprintf(json, ",\n     \"scaling\": ");
+                writeJsonScaling(json, points, maxThreads);
+            }
+            fprintf(json, "}");
+        }
+
+        nbCases++;
+        freePNM(image);
+    }
+
+    if (json)
+    {
+        fprintf(json, "\n  ]\n}\n");
+        if (fclose(json) != 0)
+            status = EXIT_FAILURE;
+    }
+
+    free(seconds);
+    free(sorted);
+    free(points);
+
+    return status;
+}
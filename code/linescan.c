@@ -0,0 +1,255 @@
+/* ------------------------------------------------------------------------- *\
+ * NAME
+ *      linescan
+ * SYNOPSIS
+ *      linescan input_file k [--delay nbDelay] [--lines nbLines]
+ *               [--output output_file]
+ *      linescan --raw width k [--delay nbDelay]
+ * DESCIRPTION
+ *      Narrow a stream of lines by k pixels with the streaming engine, each
+ *      line being committed once nbDelay more lines have arrived, and
+ *      measure the sustained throughput.
+ *      The lines of input_file are streamed from top to bottom, looping over
+ *      the image, as a line-scan camera would send them. With --raw, the
+ *      lines are read on the standard input (3 * width bytes each, in RGB
+ *      order, until its end) and each committed line is written on the
+ *      standard output at once.
+ *      The number of lines, the lines per second, the latency of the lines
+ *      (from their arrival to their commit) and the memory of the engine are
+ *      written on the standard error.
+ * ARGUMENTS
+ *      input_file      An input image file in PNM format
+ *      width           The width of the lines (in pixels)
+ *      k               The number of pixels removed from each line
+ *      nbDelay         The number of lines received after a line before it
+ *                      is committed (default 32)
+ *      nbLines         The number of lines streamed (default the height of
+ *                      the image)
+ *      output_file     A PNM file receiving the committed lines
+ * RETURN
+ *      0 if every line was committed, 1 otherwise.
+ *
+ * USAGE
+ *      ./linescan pnm/01.pnm 50 --delay 16 --lines 100000
+ *          will narrow 100000 lines of the image looped by 50 pixels
+ *      camera | ./linescan --raw 4096 256 | sink
+ *          will narrow the lines sent by a camera on the fly
+ \* ------------------------------------------------------------------------- */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "slimmingStream.h"
+#include "timing.h"
+#include "PNM.h"
+
+// Delay of the commits by default (in lines)
+#define DEFAULT_DELAY 32
+
+// Latencies of the lines
+typedef struct {
+    double* arrivals;   // Arrival time of each pending line (ring of delay + 1)
+    size_t size;        // Size of the ring
+    size_t nbCommitted; // Number of lines committed
+    double maximum;     // Largest latency (in seconds)
+    double total;       // Sum of the latencies (in seconds)
+} Latencies;
+
+
+/* ------------------------------------------------------------------------- *
+ * Record the commit of the oldest pending line.
+ *
+ * PARAMETERS
+ * latencies    The latencies
+ * ------------------------------------------------------------------------- */
+static void recordCommit(Latencies* latencies)
+{
+    double latency = getTimeSeconds() -
+                     latencies->arrivals[latencies->nbCommitted % latencies->size];
+
+    if (latency > latencies->maximum)
+        latencies->maximum = latency;
+    latencies->total += latency;
+    latencies->nbCommitted++;
+}
+
+/* ------------------------------------------------------------------------- *
+ * Parse a positive (or zero) number of an argument.
+ *
+ * PARAMETERS
+ * argument     The argument
+ * value        Where to store the number
+ *
+ * RETURN
+ * 0            In case of success
+ * -1           if the argument is not a number
+ * ------------------------------------------------------------------------- */
+static int parseSize(const char* argument, size_t* value)
+{
+    long long parsed;
+    char extra;
+
+    if (sscanf(argument, "%lld%c", &parsed, &extra) != 1 || parsed < 0)
+        return -1;
+
+    *value = (size_t)parsed;
+    return 0;
+}
+
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3 || (strcmp(argv[1], "--raw") == 0 && argc < 4))
+    {
+        fprintf(stderr, "Usage: %s input.pnm k [--delay nbDelay] [--lines nbLines] [--output output.pnm]\n"
+                        "       %s --raw width k [--delay nbDelay]\n",
+                argv[0], argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    bool raw = strcmp(argv[1], "--raw") == 0;
+    int first = raw ? 4 : 3;
+    size_t width = 0, k, delay = DEFAULT_DELAY, nbLines = 0;
+    const char* outputFile = NULL;
+    PNMImage* image = NULL;
+
+    if ((raw && parseSize(argv[2], &width) < 0) || parseSize(argv[first - 1], &k) < 0)
+    {
+        fprintf(stderr, "Invalid width or k\n");
+        return EXIT_FAILURE;
+    }
+
+    for (int i = first; i < argc; i += 2)
+    {
+        const char* value = i + 1 < argc ? argv[i + 1] : "";
+
+        if (strcmp(argv[i], "--delay") == 0 && parseSize(value, &delay) == 0)
+            continue;
+
+        if (!raw && strcmp(argv[i], "--lines") == 0 && parseSize(value, &nbLines) == 0)
+            continue;
+
+        if (!raw && strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+        {
+            outputFile = value;
+            continue;
+        }
+
+        fprintf(stderr, "Invalid option '%s %s'\n", argv[i], value);
+        return EXIT_FAILURE;
+    }
+
+    if (!raw)
+    {
+        image = readPNM(argv[1]);
+        if (!image)
+        {
+            fprintf(stderr, "Aborting; cannot load image '%s'\n", argv[1]);
+            return EXIT_FAILURE;
+        }
+
+        width = image->width;
+        if (nbLines == 0)
+            nbLines = image->height;
+    }
+
+    SlimmingStream* stream = createSlimmingStream(width, k, delay);
+    PNMImage* output = (k < width) ? createPNM(width - k, outputFile ? nbLines : 1) : NULL;
+    PNMPixel* line = malloc(sizeof(PNMPixel) * width);
+    Latencies latencies = {malloc(sizeof(double) * (delay + 1)), delay + 1, 0, 0, 0};
+
+    if (!stream || !output || !line || !latencies.arrivals)
+    {
+        fprintf(stderr, "Aborting; cannot create a stream of %zu pixels wide lines less %zu\n",
+                width, k);
+        freeSlimmingStream(stream);
+        freePNM(output);
+        freePNM(image);
+        free(line);
+        free(latencies.arrivals);
+        return EXIT_FAILURE;
+    }
+
+    /* --- Streaming --- */
+    size_t nbReceived = 0;
+    bool failed = false;
+    double startTime = getTimeSeconds();
+
+    while (raw || nbReceived < nbLines)
+    {
+        const PNMPixel* received;
+
+        if (raw)
+        {
+            size_t nbRead = fread(line, sizeof(PNMPixel), width, stdin);
+            if (nbRead == 0)
+                break;
+            if (nbRead < width)
+            {
+                fprintf(stderr, "Ignoring the last line, of %zu pixels only\n", nbRead);
+                failed = true;
+                break;
+            }
+            received = line;
+        }
+        else
+            received = &image->data[(nbReceived % image->height) * width];
+
+        latencies.arrivals[nbReceived % latencies.size] = getTimeSeconds();
+        nbReceived++;
+
+        PNMPixel* committed = &output->data[outputFile ? latencies.nbCommitted * output->width : 0];
+
+        if (pushStreamLine(stream, received, committed) == 1)
+        {
+            recordCommit(&latencies);
+
+            if (raw && fwrite(committed, sizeof(PNMPixel), output->width, stdout) != output->width)
+                failed = true;
+        }
+    }
+
+    // The last lines are committed with the lines left
+    while (true)
+    {
+        PNMPixel* committed = &output->data[outputFile ? latencies.nbCommitted * output->width : 0];
+
+        if (flushStreamLine(stream, committed) != 1)
+            break;
+
+        recordCommit(&latencies);
+
+        if (raw && fwrite(committed, sizeof(PNMPixel), output->width, stdout) != output->width)
+            failed = true;
+    }
+
+    double seconds = getTimeSeconds() - startTime;
+
+    if (raw && fflush(stdout) != 0)
+        failed = true;
+
+    /* --- Report --- */
+    fprintf(stderr, "linescan: %zu lines of %zu pixels in %f s (%.1f lines/s, %.1f MB/s)\n",
+            latencies.nbCommitted, width, seconds,
+            seconds > 0 ? (double)latencies.nbCommitted / seconds : 0.0,
+            seconds > 0 ? 3.0 * (double)width * (double)latencies.nbCommitted / seconds / 1e6 : 0.0);
+    fprintf(stderr, "linescan: delay %zu lines, latency %f s on average, %f s at most\n",
+            delay, latencies.nbCommitted ? latencies.total / (double)latencies.nbCommitted : 0.0,
+            latencies.maximum);
+    fprintf(stderr, "linescan: %zu bytes of memory for the stream\n", getSlimmingStreamSize(stream));
+
+    if (outputFile && writePNM(outputFile, output) < 0)
+    {
+        fprintf(stderr, "Cannot write the committed lines into '%s'\n", outputFile);
+        failed = true;
+    }
+
+    freeSlimmingStream(stream);
+    freePNM(output);
+    freePNM(image);
+    free(line);
+    free(latencies.arrivals);
+
+    return (failed || latencies.nbCommitted != nbReceived) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
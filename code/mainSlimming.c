@@ -2,7 +2,27 @@
  * NAME
  *      slimming
  * SYNOPSIS
- *      slimming input_file output_file nbPix
+ *      slimming input_file output_file nbPix [--threads nbThreads]
+ *               [--sync none|data|async] [--direct] [--chunk chunkSize]
+ *               [--stats] [--engine exact|astar|runs] [--stream]
+ *               [--read-threads nbReaders] [--read-chunk readChunkSize]
+ *               [--groove-width grooveWidth] [--release-memory]
+ *               [--output-size outputWidthxoutputHeight]
+ *               [--region left,top,width,height]
+ *      slimming --batch jobs_file [--workers nbWorkers] [--aging aging]
+ *               [--report report_file] [--io-batch ioBatchSize]
+ *               [--io auto|uring|threads] [--engine exact|astar|runs]
+ *               [--record record_file] [--metrics metrics_file]
+ *               [--keep-slowest nbSlowest --slow-dir slow_dir]
+ *               [--cache cache_name] [--cache-size cacheSize]
+ *      slimming --watch spool_dir output_dir nbPix [--workers nbWorkers]
+ *               [--aging aging] [--report report_file]
+ *               [--io-batch ioBatchSize] [--io auto|uring|threads]
+ *               [--engine exact|astar|runs] [--status statusInterval]
+ *               [--record record_file] [--metrics metrics_file]
+ *               [--keep-slowest nbSlowest --slow-dir slow_dir]
+ *               [--cache cache_name] [--cache-size cacheSize]
+ *      slimming --object input_file mask_file output_file [--stats]
  * DESCIRPTION
  *      Apply the slimming algorithm to the given input image
  * ARGUMENTS
@@ -10,24 +30,711 @@
  *      output_file     An output image file (format will be PNM)
  *      nbPix           The number of pixel (integer) by which
  *                      to decrease the input image (nbPix > 0)
+ *      nbThreads       The number of threads used to slim the image
+ *                      (default 1)
+ *      none|data|async When the output must reach the storage device: left
+ *                      to the system (none, the default), before exiting
+ *                      (data, fdatasync) or in the background while the
+ *                      program ends its work (async)
+ *      --direct        Write the output bypassing the page cache (O_DIRECT)
+ *      chunkSize       The size of each write of the output, in KiB
+ *                      (default 8192)
+ *      --stats         Print measures of the run on the standard error
+ *      exact|astar|runs
+ *                      The engine finding the grooves: a cost table updated
+ *                      after each groove (exact, the default), a cost table
+ *                      computed anew for each groove over energies kept up
+ *                      to date (astar), or
+ *                      a cost table over runs of identical pixels, finding
+ *                      the grooves of astar faster on flat-color images
+ *                      (runs, chosen by astar for such images)
+ *      nbReaders       The number of threads reading the input at the same
+ *                      time (default 4)
+ *      readChunkSize   The size of each read of the input, in KiB
+ *                      (default 8192)
+ *      grooveWidth     The number of adjacent columns removed by each
+ *                      groove, searched over the sums of their energies
+ *                      (default 1; fewer passes, whatever the engine)
+ *      --release-memory
+ *                      Give back to the system the memory of the image and
+ *                      of its cost table left unused as it narrows (exact
+ *                      engine), and the rest of the image at the end; with
+ *                      --stats, the resident memory is printed
+ *      outputWidthxoutputHeight
+ *                      The size to which the reduced image is downscaled
+ *                      (averaging the area each output pixel covers) as it
+ *                      is gathered, before being written; 0 keeps the
+ *                      reduced width or height (e.g. 160x0)
+ *      left,top,width,height
+ *                      A rectangle of the input, which alone is slimmed
+ *                      (in place, within the loaded image) and written as
+ *                      the output (not with --stream nor --output-size)
+ *      --stream        Load the input in the background, the exact engine
+ *                      computing the energies and costs of the rows that
+ *                      have arrived while the next ones are read
+ *      jobs_file       A file listing one job per line, as
+ *                      "input_file output_file nbPix" (lines starting
+ *                      with '#' are ignored)
+ *      nbWorkers       The number of jobs run at the same time (default 1)
+ *      aging           The priority gained by a waiting job, in expected
+ *                      seconds of work per second of waiting (default 1)
+ *      report_file     A file in which the percentiles of the queue wait
+ *                      and service times of each size class are written
+ *      ioBatchSize     The number of small jobs whose files are loaded and
+ *                      written together (default 1, no batching)
+ *      auto|uring|...  The backend loading and writing the batched files:
+ *                      io_uring if available (auto, the default), io_uring
+ *                      or a few threads using pread/pwrite
+ *      spool_dir       A directory whose images are slimmed as they arrive
+ *                      (files closed after writing or moved into it, whose
+ *                      name does not start with '.'), until SIGINT or
+ *                      SIGTERM; the images already there whose output does
+ *                      not exist are slimmed first
+ *      output_dir      The directory receiving the outputs, under the name
+ *                      of their input (not the spool directory)
+ *      statusInterval  The time between two writes of the counters (queued,
+ *                      running, done and failed images, images per second)
+ *                      on the standard error, in seconds (default 10)
+ *
+ *      record_file     A file to which a line is appended for each finished
+ *                      job (submission offset, size, nbPix, engine, threads,
+ *                      hash of the image, wait and service times, result,
+ *                      input), to be replayed by the replay tool
+ *      nbSlowest       The number of slowest inputs copied into slow_dir,
+ *                      named after the hash of the image
+ *      metrics_file    A file replaced by the metrics of the scheduler in
+ *                      the Prometheus text format (jobs, queue depth,
+ *                      thread utilization, pixels, seams, phase times and
+ *                      latency histograms), every statusInterval in watch
+ *                      mode, and once every job is done
+ *      cache_name      A result cache shared by the processes of the host:
+ *                      the result of an image already slimmed by nbPix
+ *                      with the same engine is copied from it. A name such
+ *                      as /slimming is a POSIX shared memory segment, any
+ *                      other one the path to a file mapped in memory
+ *      cacheSize       The size of the cache when it is created, in MiB
+ *                      (default 256)
+ *      mask_file       A PNM image as large as the input, whose non-black
+ *                      pixels cover an object: grooves crossing it are
+ *                      removed until none of its pixels is left
+ *
+ *      Every output of the batch and watch modes is written to a hidden
+ *      file, then renamed into place.
  *
  * USAGE
  *      ./slimming input.pnm output.pnm 50
  *          will ouput an image whose width is 50 pixels less than the input
+ *      ./slimming input.pnm banner.pnm 50 --region 0,0,400,100
+ *          will slim the top-left 400 x 100 pixels of the input by 50
+ *          pixels and write them as a 350 x 100 image
+ *      ./slimming input.pnm thumbnail.pnm 50 --output-size 160x120
+ *          will slim the input by 50 pixels and write it as a 160 x 120
+ *          thumbnail
+ *      ./slimming --batch jobs.txt --workers 4
+ *          will run the jobs listed in jobs.txt, shortest expected job first
+ *      ./slimming --watch spool/ slimmed/ 50 --workers 4
+ *          will slim every image dropped into spool/ into slimmed/
+ *      ./slimming --object photo.pnm person.pnm output.pnm
+ *          will remove the person covered by person.pnm from photo.pnm
  \* ------------------------------------------------------------------------- */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdbool.h>
 
 #include "slimming.h"
+#include "scheduler.h"
+#include "watch.h"
 #include "PNM.h"
 
 
+/* ------------------------------------------------------------------------- *
+ * Parse a strictly positive integer.
+ *
+ * PARAMETERS
+ * string       The string to parse
+ * value        Where to store the parsed integer
+ *
+ * RETURN
+ * 0            In case of success
+ * -1           Otherwise
+ * ------------------------------------------------------------------------- */
+static int parsePositive(const char* string, size_t* value)
+{
+    int parsed;
+    char extra;
+
+    if (sscanf(string, "%d%c", &parsed, &extra) != 1 || parsed <= 0)
+        return -1;
+
+    *value = (size_t)parsed;
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * Parse a size, as "widthxheight", each being a positive integer or 0.
+ *
+ * PARAMETERS
+ * string       The string to parse
+ * width        Where to store the parsed width
+ * height       Where to store the parsed height
+ *
+ * RETURN
+ * 0            In case of success
+ * -1           Otherwise
+ * ------------------------------------------------------------------------- */
+static int parseSize(const char* string, size_t* width, size_t* height)
+{
+    int parsedWidth, parsedHeight;
+    char extra;
+
+    if (sscanf(string, "%dx%d%c", &parsedWidth, &parsedHeight, &extra) != 2 ||
+        parsedWidth < 0 || parsedHeight < 0)
+        return -1;
+
+    *width = (size_t)parsedWidth;
+    *height = (size_t)parsedHeight;
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * Parse a rectangle, as "left,top,width,height", its width and height being
+ * positive.
+ *
+ * PARAMETERS
+ * string       The string to parse
+ * bounds       Array receiving the left, top, width and height
+ *
+ * RETURN
+ * 0            In case of success
+ * -1           Otherwise
+ * ------------------------------------------------------------------------- */
+static int parseRegion(const char* string, size_t* bounds)
+{
+    int parsed[4];
+    char extra;
+
+    if (sscanf(string, "%d,%d,%d,%d%c", &parsed[0], &parsed[1], &parsed[2],
+               &parsed[3], &extra) != 4 || parsed[0] < 0 || parsed[1] < 0 ||
+        parsed[2] <= 0 || parsed[3] <= 0)
+        return -1;
+
+    for (int i = 0; i < 4; i++)
+        bounds[i] = (size_t)parsed[i];
+
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * Parse the name of an engine.
+ *
+ * PARAMETERS
+ * string       The string to parse
+ * engine       Where to store the engine
+ *
+ * RETURN
+ * 0            In case of success
+ * -1           Otherwise
+ * ------------------------------------------------------------------------- */
+static int parseEngine(const char* string, SlimmingEngine* engine)
+{
+    if (strcmp(string, "exact") == 0)
+        *engine = SLIMMING_ENGINE_EXACT;
+    else if (strcmp(string, "astar") == 0)
+        *engine = SLIMMING_ENGINE_ASTAR;
+    else if (strcmp(string, "runs") == 0)
+        *engine = SLIMMING_ENGINE_RUNS;
+    else
+        return -1;
+
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * Wait until some lines of an image loading in the background are loaded,
+ * as SlimmingOptions.waitLines.
+ *
+ * PARAMETERS
+ * source       The PNMLoad
+ * nbLines      The number of lines needed
+ *
+ * RETURN
+ * nbLoaded     The number of lines loaded
+ * ------------------------------------------------------------------------- */
+static size_t waitLoadedLines(void* source, size_t nbLines)
+{
+    return waitPNMRows(source, nbLines);
+}
+
+/* ------------------------------------------------------------------------- *
+ * Submit every job listed in a file to a scheduler, and wait for them.
+ *
+ * PARAMETERS
+ * scheduler    The scheduler running the jobs
+ * jobsFile     Path to the file listing the jobs
+ * engine       The engine performing the jobs
+ *
+ * RETURN
+ * EXIT_SUCCESS if every job succeeded, EXIT_FAILURE otherwise
+ * ------------------------------------------------------------------------- */
+static int runBatch(Scheduler* scheduler, const char* jobsFile,
+                    SlimmingEngine engine)
+{
+    FILE* fp = fopen(jobsFile, "r");
+    if (!fp)
+    {
+        fprintf(stderr, "Aborting; cannot open jobs file '%s'\n", jobsFile);
+        return EXIT_FAILURE;
+    }
+
+    char line[8192], input[4096], output[4096], nbPix[32];
+    size_t nbRejected = 0;
+    size_t lineNumber = 0;
+
+    while (fgets(line, sizeof(line), fp))
+    {
+        lineNumber++;
+
+        if (line[0] == '#' || sscanf(line, "%4095s", input) != 1)
+            continue;
+
+        size_t k;
+        if (sscanf(line, "%4095s %4095s %31s", input, output, nbPix) != 3 ||
+            parsePositive(nbPix, &k) < 0)
+        {
+            fprintf(stderr, "%s:%zu: expected 'input output nbPix'\n",
+                    jobsFile, lineNumber);
+            nbRejected++;
+            continue;
+        }
+
+        int resultSubmit = submitJob(scheduler, input, output, k, engine);
+        if (resultSubmit < 0)
+        {
+            fprintf(stderr, "%s:%zu: cannot queue '%s' (error %d)\n",
+                    jobsFile, lineNumber, input, resultSubmit);
+            nbRejected++;
+        }
+    }
+
+    fclose(fp);
+
+    size_t nbFailed = waitScheduler(scheduler);
+
+    return (nbFailed + nbRejected == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* ------------------------------------------------------------------------- *
+ * Slim the images dropped into a spool directory through a scheduler, until
+ * SIGINT or SIGTERM is received, and wait for the queued images.
+ *
+ * PARAMETERS
+ * scheduler    The scheduler running the jobs
+ * spoolDir     Path to the watched directory
+ * outputDir    Path to the directory receiving the outputs
+ * k            The number of pixels to be removed from each image
+ * engine       The engine performing the reductions
+ * statusInterval The time between two writes of the counters (in seconds)
+ * metricsFile  Path to the metrics file (or NULL)
+ *
+ * RETURN
+ * EXIT_SUCCESS if the directory could be watched, EXIT_FAILURE otherwise
+ * ------------------------------------------------------------------------- */
+static int runWatch(Scheduler* scheduler, const char* spoolDir,
+                    const char* outputDir, size_t k, SlimmingEngine engine,
+                    double statusInterval, const char* metricsFile)
+{
+    int resultWatch = watchDirectory(scheduler, spoolDir, outputDir, k, engine,
+                                     statusInterval, metricsFile);
+    if (resultWatch < 0)
+        fprintf(stderr, "Aborting; cannot watch '%s' into '%s'\n", spoolDir,
+                outputDir);
+
+    // The queued images are slimmed before exiting
+    waitScheduler(scheduler);
+
+    return resultWatch == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
 int main(int argc, char* argv[])
 {
+    /* --- Batch and watch modes --- */
+    bool watch = argc >= 5 && strcmp(argv[1], "--watch") == 0;
+
+    if ((argc >= 3 && strcmp(argv[1], "--batch") == 0) || watch)
+    {
+        size_t nbWorkers = 1;
+        double statusInterval = 10.0;
+        double aging = 1.0;
+        const char* reportFile = NULL;
+        const char* recordFile = NULL;
+        const char* metricsFile = NULL;
+        const char* cacheName = NULL;
+        size_t cacheSize = 256;
+        const char* slowDir = NULL;
+        size_t nbSlowest = 0;
+        size_t ioBatchSize = 1;
+        BatchIOBackend ioBackend = BATCH_IO_AUTO;
+        SlimmingEngine engine = SLIMMING_ENGINE_EXACT;
+
+        for (int i = watch ? 5 : 3; i < argc; i += 2)
+        {
+            char extra;
+
+            if (i + 1 >= argc)
+            {
+                fprintf(stderr, "Missing value for option '%s'\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+
+            if (strcmp(argv[i], "--workers") == 0 &&
+                parsePositive(argv[i + 1], &nbWorkers) == 0)
+                continue;
+
+            if (strcmp(argv[i], "--aging") == 0 &&
+                sscanf(argv[i + 1], "%lf%c", &aging, &extra) == 1 && aging >= 0)
+                continue;
+
+            if (watch && strcmp(argv[i], "--status") == 0 &&
+                sscanf(argv[i + 1], "%lf%c", &statusInterval, &extra) == 1 &&
+                statusInterval > 0)
+                continue;
+
+            if (strcmp(argv[i], "--report") == 0)
+            {
+                reportFile = argv[i + 1];
+                continue;
+            }
+
+            if (strcmp(argv[i], "--record") == 0)
+            {
+                recordFile = argv[i + 1];
+                continue;
+            }
+
+            if (strcmp(argv[i], "--metrics") == 0)
+            {
+                metricsFile = argv[i + 1];
+                continue;
+            }
+
+            if (strcmp(argv[i], "--cache") == 0)
+            {
+                cacheName = argv[i + 1];
+                continue;
+            }
+
+            if (strcmp(argv[i], "--cache-size") == 0 &&
+                parsePositive(argv[i + 1], &cacheSize) == 0)
+                continue;
+
+            if (strcmp(argv[i], "--slow-dir") == 0)
+            {
+                slowDir = argv[i + 1];
+                continue;
+            }
+
+            if (strcmp(argv[i], "--keep-slowest") == 0 &&
+                parsePositive(argv[i + 1], &nbSlowest) == 0)
+                continue;
+
+            if (strcmp(argv[i], "--engine") == 0 &&
+                parseEngine(argv[i + 1], &engine) == 0)
+                continue;
+
+            if (strcmp(argv[i], "--io-batch") == 0 &&
+                parsePositive(argv[i + 1], &ioBatchSize) == 0)
+                continue;
+
+            if (strcmp(argv[i], "--io") == 0)
+            {
+                if (strcmp(argv[i + 1], "auto") == 0)
+                    ioBackend = BATCH_IO_AUTO;
+                else if (strcmp(argv[i + 1], "uring") == 0)
+                    ioBackend = BATCH_IO_URING;
+                else if (strcmp(argv[i + 1], "threads") == 0)
+                    ioBackend = BATCH_IO_THREADS;
+                else
+                {
+                    fprintf(stderr, "Unknown backend '%s'\n", argv[i + 1]);
+                    return EXIT_FAILURE;
+                }
+                continue;
+            }
+
+            fprintf(stderr, "Invalid option '%s %s'\n", argv[i], argv[i + 1]);
+            return EXIT_FAILURE;
+        }
+
+        size_t k;
+        if (watch && parsePositive(argv[4], &k) < 0)
+        {
+            fprintf(stderr, "nbPix must be strictly positive. Got '%s'\n", argv[4]);
+            return EXIT_FAILURE;
+        }
+
+        if (nbSlowest > 0 && !slowDir)
+        {
+            fprintf(stderr, "--keep-slowest needs --slow-dir\n");
+            return EXIT_FAILURE;
+        }
+
+        FILE* record = NULL;
+        if (recordFile && !(record = fopen(recordFile, "a")))
+        {
+            fprintf(stderr, "Aborting; cannot open record file '%s'\n", recordFile);
+            return EXIT_FAILURE;
+        }
+
+        ResultCache* cache = NULL;
+        if (cacheName && !(cache = openResultCache(cacheName, cacheSize << 20)))
+        {
+            fprintf(stderr, "Aborting; cannot open cache '%s'\n", cacheName);
+            if (record)
+                fclose(record);
+            return EXIT_FAILURE;
+        }
+
+        Scheduler* scheduler = createScheduler(nbWorkers, aging);
+        if (!scheduler || setSchedulerRecord(scheduler, record, slowDir, nbSlowest) < 0)
+        {
+            fprintf(stderr, "Aborting; cannot start the scheduler\n");
+            freeScheduler(scheduler);
+            closeResultCache(cache);
+            if (record)
+                fclose(record);
+            return EXIT_FAILURE;
+        }
+
+        setSchedulerIO(scheduler, ioBatchSize, ioBackend);
+        setSchedulerCache(scheduler, cache);
+
+        int result = watch ?
+                     runWatch(scheduler, argv[2], argv[3], k, engine, statusInterval, metricsFile) :
+                     runBatch(scheduler, argv[2], engine);
+
+        if (metricsFile && exportSchedulerMetrics(scheduler, metricsFile) < 0)
+        {
+            fprintf(stderr, "Cannot write metrics '%s'\n", metricsFile);
+            result = EXIT_FAILURE;
+        }
+
+        if (reportFile)
+        {
+            FILE* report = fopen(reportFile, "w");
+            if (!report || writeSchedulerReport(scheduler, report) < 0)
+            {
+                fprintf(stderr, "Cannot write report '%s'\n", reportFile);
+                result = EXIT_FAILURE;
+            }
+            if (report)
+                fclose(report);
+        }
+
+        freeScheduler(scheduler);
+        closeResultCache(cache);
+
+        if (record && fclose(record) != 0)
+        {
+            fprintf(stderr, "Cannot write record file '%s'\n", recordFile);
+            result = EXIT_FAILURE;
+        }
+
+        return result;
+    }
+
+    /* --- Object removal --- */
+    if (argc >= 5 && strcmp(argv[1], "--object") == 0)
+    {
+        SlimmingOptions options;
+        initSlimmingOptions(&options);
+
+        SlimmingStats slimmingStats;
+        bool showStats = argc == 6 && strcmp(argv[5], "--stats") == 0;
+
+        if (argc > 5 && !showStats)
+        {
+            fprintf(stderr, "Invalid option '%s'\n", argv[5]);
+            return EXIT_FAILURE;
+        }
+
+        if (showStats)
+            options.stats = &slimmingStats;
+
+        PNMImage* input = readPNM(argv[2]);
+        PNMImage* mask = input ? readPNM(argv[3]) : NULL;
+        if (!mask)
+        {
+            fprintf(stderr, "Aborting; cannot load image '%s'\n", input ? argv[3] : argv[2]);
+            freePNM(input);
+            return EXIT_FAILURE;
+        }
+
+        size_t nbRemoved;
+        PNMImage* output = removeObject(input, mask, &options, &nbRemoved);
+        freePNM(input);
+        freePNM(mask);
+
+        if (!output)
+        {
+            fprintf(stderr, "Aborting; cannot remove the object of '%s' (is the mask as large as the image?)\n",
+                    argv[3]);
+            return EXIT_FAILURE;
+        }
+
+        int resultWrite = writePNM(argv[4], output);
+        freePNM(output);
+
+        if (resultWrite < 0)
+        {
+            fprintf(stderr, "Aborting; cannot write image '%s'\n", argv[4]);
+            return EXIT_FAILURE;
+        }
+
+        if (showStats)
+            fprintf(stderr, "object: %zu grooves in %.6f s, %zu band cells searched\n",
+                    nbRemoved, slimmingStats.totalSeconds, slimmingStats.nbSearchedCells);
+
+        return EXIT_SUCCESS;
+    }
+
     /* --- Argument parsing --- */
-    if (argc != 4) {
-        fprintf(stderr, "Usage: %s input.pnm output.pnm nbPix\n", argv[0]);
+    if (argc < 4)
+    {
+        fprintf(stderr, "Usage: %s input.pnm output.pnm nbPix [--threads nbThreads]\n"
+                        "                [--sync none|data|async] [--direct] [--chunk chunkSize] [--stats]\n"
+                        "                [--engine exact|astar|runs] [--stream] [--read-threads nbReaders]\n"
+                        "                [--read-chunk readChunkSize] [--groove-width grooveWidth]\n"
+                        "                [--release-memory] [--output-size outputWidthxoutputHeight]\n"
+                        "                [--region left,top,width,height]\n"
+                        "       %s --batch jobs.txt [--workers nbWorkers] [--aging aging] [--report report.txt]\n"
+                        "                [--io-batch ioBatchSize] [--io auto|uring|threads] [--engine exact|astar|runs]\n"
+                        "                [--record record.log] [--metrics metrics.prom]\n"
+                        "                [--keep-slowest nbSlowest --slow-dir slow/] [--cache /name] [--cache-size MiB]\n"
+                        "       %s --watch spool/ output/ nbPix [--workers nbWorkers] [--aging aging]\n"
+                        "                [--report report.txt] [--io-batch ioBatchSize] [--io auto|uring|threads]\n"
+                        "                [--engine exact|astar|runs] [--status statusInterval] [--record record.log]\n"
+                        "                [--metrics metrics.prom] [--keep-slowest nbSlowest --slow-dir slow/]\n"
+                        "                [--cache /name] [--cache-size MiB]\n"
+                        "       %s --object input.pnm mask.pnm output.pnm [--stats]\n",
+                argv[0], argv[0], argv[0], argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    SlimmingOptions options;
+    initSlimmingOptions(&options);
+
+    PNMWriteOptions writeOptions;
+    initPNMWriteOptions(&writeOptions);
+
+    PNMReadOptions readOptions;
+    initPNMReadOptions(&readOptions);
+
+    SlimmingStats slimmingStats;
+    bool showStats = false;
+    bool stream = false;
+    bool region = false;
+    size_t regionBounds[4];
+
+    for (int i = 4; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--stats") == 0)
+        {
+            showStats = true;
+            continue;
+        }
+
+        if (strcmp(argv[i], "--direct") == 0)
+        {
+            writeOptions.direct = true;
+            continue;
+        }
+
+        if (strcmp(argv[i], "--stream") == 0)
+        {
+            stream = true;
+            continue;
+        }
+
+        if (strcmp(argv[i], "--release-memory") == 0)
+        {
+            options.releaseMemory = true;
+            continue;
+        }
+
+        size_t chunkSize;
+        const char* value = i + 1 < argc ? argv[i + 1] : "";
+
+        if (strcmp(argv[i], "--engine") == 0 &&
+            parseEngine(value, &options.engine) == 0)
+        {
+            i++;
+            continue;
+        }
+
+        if (strcmp(argv[i], "--threads") == 0 &&
+            parsePositive(value, &options.nbThreads) == 0)
+        {
+            i++;
+            continue;
+        }
+
+        if (strcmp(argv[i], "--groove-width") == 0 &&
+            parsePositive(value, &options.grooveWidth) == 0)
+        {
+            i++;
+            continue;
+        }
+
+        if (strcmp(argv[i], "--output-size") == 0 &&
+            parseSize(value, &options.outputWidth, &options.outputHeight) == 0)
+        {
+            i++;
+            continue;
+        }
+
+        if (strcmp(argv[i], "--region") == 0 &&
+            parseRegion(value, regionBounds) == 0)
+        {
+            region = true;
+            i++;
+            continue;
+        }
+
+        if (strcmp(argv[i], "--read-threads") == 0 &&
+            parsePositive(value, &readOptions.nbThreads) == 0)
+        {
+            i++;
+            continue;
+        }
+
+        if (strcmp(argv[i], "--read-chunk") == 0 &&
+            parsePositive(value, &chunkSize) == 0)
+        {
+            readOptions.chunkSize = chunkSize << 10;
+            i++;
+            continue;
+        }
+
+        if (strcmp(argv[i], "--chunk") == 0 &&
+            parsePositive(value, &chunkSize) == 0)
+        {
+            writeOptions.chunkSize = chunkSize << 10;
+            i++;
+            continue;
+        }
+
+        if (strcmp(argv[i], "--sync") == 0 && (strcmp(value, "none") == 0 ||
+            strcmp(value, "data") == 0 || strcmp(value, "async") == 0))
+        {
+            writeOptions.sync = value[0] == 'n' ? PNM_SYNC_NONE :
+                                value[0] == 'd' ? PNM_SYNC_DATA : PNM_SYNC_ASYNC;
+            i++;
+            continue;
+        }
+
+        fprintf(stderr, "Invalid option '%s %s'\n", argv[i], value);
         return EXIT_FAILURE;
     }
 
@@ -45,23 +752,96 @@ int main(int argc, char* argv[])
     }
     size_t k = (size_t)nbPix;
 
-    // Load image
-    PNMImage* original = readPNM(argv[1]);
-    if (!original)
+    if (region && (stream || options.outputWidth > 0 || options.outputHeight > 0))
+    {
+        fprintf(stderr, "Aborting; --region cannot be used with --stream nor --output-size\n");
+        return EXIT_FAILURE;
+    }
+
+    // Load image (in the background while slimming it with --stream)
+    PNMLoad* load = NULL;
+    PNMImage* original = NULL;
+    const PNMImage* input;
+    PNMReadStats readStats;
+
+    if (stream)
+    {
+        load = startPNMLoad(argv[1], 0);
+        input = load ? getPNMLoadImage(load) : NULL;
+    }
+    else
+        input = original = readPNMWithOptions(argv[1], &readOptions, &readStats);
+
+    if (!input)
     {
         fprintf(stderr, "Aborting; cannot load image '%s'\n", argv[1]);
         return EXIT_FAILURE;
     }
 
-    if(k >= original->width)
+    if(k >= input->width)
     {
-        fprintf(stderr, "Aborting; image of width %zu cannot be reduced by %zu pixels\n", original->width, k);
-        freePNM(original);
+        fprintf(stderr, "Aborting; image of width %zu cannot be reduced by %zu pixels\n", input->width, k);
+        freePNM(load ? finishPNMLoad(load) : original);
         return EXIT_FAILURE;
     }
 
     /* --- Slimming --- */
-    PNMImage* output = reduceImageWidth(original, k);
+    if (showStats)
+        options.stats = &slimmingStats;
+
+    // Slim only a rectangle of the image, within the loaded image, and write it
+    if (region)
+    {
+        PNMView view = getPNMView(original), subView;
+
+        if (getPNMSubView(&view, regionBounds[1], regionBounds[0], regionBounds[2],
+                          regionBounds[3], &subView) < 0 || k >= subView.width)
+        {
+            fprintf(stderr, "Aborting; the region must fit in the image of %zu x %zu "
+                            "pixels, and be wider than %zu pixels\n",
+                    original->width, original->height, k);
+            freePNM(original);
+            return EXIT_FAILURE;
+        }
+
+        if (reduceViewWidth(&subView, k, &options) < 0)
+        {
+            fprintf(stderr, "Aborting; cannot slim the region\n");
+            freePNM(original);
+            return EXIT_FAILURE;
+        }
+
+        int resultWrite = writePNMView(argv[2], &subView);
+        freePNM(original);
+
+        if (resultWrite < 0)
+        {
+            fprintf(stderr, "Aborting; cannot write image '%s'\n", argv[2]);
+            return EXIT_FAILURE;
+        }
+
+        if (showStats)
+            fprintf(stderr, "slimming: %zu grooves in a region of %zu x %zu pixels in %.6f s\n",
+                    slimmingStats.nbGrooves, regionBounds[2], regionBounds[3],
+                    slimmingStats.totalSeconds);
+
+        return EXIT_SUCCESS;
+    }
+
+    if (load)
+    {
+        options.waitLines = waitLoadedLines;
+        options.source = load;
+    }
+
+    PNMImage* output = reduceImageWidthWithOptions(input, k, &options);
+
+    if (load && !(original = finishPNMLoad(load)))
+    {
+        fprintf(stderr, "Aborting; cannot load image '%s'\n", argv[1]);
+        freePNM(output);
+        return EXIT_FAILURE;
+    }
 
     /* --- Writing output --- */
     if (!output)
@@ -72,9 +852,44 @@ int main(int argc, char* argv[])
     }
 
     // Save and free
-    writePNM(argv[2], output);
+    PNMWriteStats writeStats;
+    int resultWrite = writePNMWithOptions(argv[2], output, &writeOptions,
+                                          &writeStats);
     freePNM(original);
     freePNM(output);
 
+    if (resultWrite < 0 || waitPNMSyncs() < 0)
+    {
+        fprintf(stderr, "Aborting; cannot write image '%s'\n", argv[2]);
+        return EXIT_FAILURE;
+    }
+
+    if (showStats)
+    {
+        if (!stream)
+            fprintf(stderr, "read: %zu bytes in %.6f s (%.2f GB/s)\n",
+                    readStats.nbBytes, readStats.seconds,
+                    readStats.seconds > 0 ?
+                    readStats.nbBytes / readStats.seconds / 1e9 : 0.0);
+        fprintf(stderr, "slimming: %zu grooves in %.6f s", slimmingStats.nbGrooves,
+                slimmingStats.totalSeconds);
+        if (slimmingStats.nbSearchedCells)
+            fprintf(stderr, ", %zu cells searched", slimmingStats.nbSearchedCells);
+        if (slimmingStats.nbBulkGrooves)
+            fprintf(stderr, ", %zu removed with uniform columns", slimmingStats.nbBulkGrooves);
+        if (slimmingStats.nbRunGrooves)
+            fprintf(stderr, ", %zu found over runs", slimmingStats.nbRunGrooves);
+        fprintf(stderr, ", energy removed %.0f\n", slimmingStats.removedEnergy);
+        if (options.releaseMemory)
+            fprintf(stderr, "memory: peak %.1f MiB, final %.1f MiB, %.1f MiB released\n",
+                    slimmingStats.peakResidentBytes / 1048576.0,
+                    slimmingStats.finalResidentBytes / 1048576.0,
+                    slimmingStats.releasedBytes / 1048576.0);
+        fprintf(stderr, "write: %zu bytes in %.6f s (%.1f MB/s)\n",
+                writeStats.nbBytes, writeStats.seconds,
+                writeStats.seconds > 0 ?
+                writeStats.nbBytes / writeStats.seconds / 1e6 : 0.0);
+    }
+
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,313 @@
+/* ------------------------------------------------------------------------- *\
+ * NAME
+ *      multispectral
+ * SYNOPSIS
+ *      multispectral input_file output_file k [--stats]
+ *      multispectral --bench input_file k [--depths d1,d2,...]
+ *                    [--runs nbRuns]
+ * DESCIRPTION
+ *      Reduce the width of a PAM image of any number of channels (or of a
+ *      PNM image, of 3 channels) by k pixels, and write it as a PAM image.
+ *      With --bench, measure how the number of channels weighs on the
+ *      reduction: for each depth, an image of that many channels is made
+ *      from the input (each channel mixing two channels of the input), then
+ *      reduced nbRuns times. The median time of each phase is written, with
+ *      the time of the energies per byte of pixel and the time of the whole
+ *      reduction per pixel and groove.
+ * ARGUMENTS
+ *      input_file      An input image file in PAM (P7) or PNM (P6) format
+ *      output_file     The output PAM image file
+ *      k               The number of pixels to be removed
+ *      --stats         Print the time of each phase on the standard error
+ *      d1,d2,...       The numbers of channels measured (default
+ *                      1,3,4,8,16)
+ *      nbRuns          The number of reductions of each image (default 3)
+ * RETURN
+ *      0 if the image could be reduced, 1 otherwise.
+ *
+ * USAGE
+ *      ./multispectral capture.pam capture-narrow.pam 100
+ *          will reduce the width of capture.pam by 100 pixels
+ *      ./multispectral --bench pnm/01.pnm 50 --depths 3,8,16
+ *          will measure the reductions of images of 3, 8 and 16 channels
+ \* ------------------------------------------------------------------------- */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "slimmingChannels.h"
+#include "PAM.h"
+
+// Largest number of depths measured
+#define MAX_DEPTHS 32
+
+// Number of runs of each image by default
+#define DEFAULT_RUNS 3
+
+
+/* ------------------------------------------------------------------------- *
+ * Compare two doubles, for qsort().
+ * ------------------------------------------------------------------------- */
+static int compareDoubles(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+
+    return (x > y) - (x < y);
+}
+
+/* ------------------------------------------------------------------------- *
+ * Give the median of n values (the values are sorted).
+ * ------------------------------------------------------------------------- */
+static double median(double* values, size_t n)
+{
+    qsort(values, n, sizeof(double), compareDoubles);
+
+    if (n % 2 == 1)
+        return values[n / 2];
+
+    return (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+/* ------------------------------------------------------------------------- *
+ * Make an image of `depth` channels from an image: channel c mixes the
+ * channels c and c + 1 of the image (modulo its depth), weighted by c.
+ *
+ * PARAMETERS
+ * image        The image
+ * depth        The number of channels of the new image
+ *
+ * RETURN
+ * image        Pointer to the new image
+ * NULL         if an allocation failed
+ * ------------------------------------------------------------------------- */
+static PAMImage* mixChannels(const PAMImage* image, size_t depth)
+{
+    size_t nbPixels = image->width * image->height;
+    PAMImage* mixed = createPAM(image->width, image->height, depth);
+    if (!mixed)
+        return NULL;
+
+    for (size_t p = 0; p < nbPixels; p++)
+    {
+        const unsigned char* pixel = &image->data[p * image->depth];
+
+        for (size_t c = 0; c < depth; c++)
+        {
+            unsigned weight = (unsigned)(c / image->depth) + 1;
+
+            mixed->data[p * depth + c] = (unsigned char)
+                ((pixel[c % image->depth] * weight + pixel[(c + 1) % image->depth]) / (weight + 1));
+        }
+    }
+
+    return mixed;
+}
+
+/* ------------------------------------------------------------------------- *
+ * Measure the reductions of images of several depths made from an image,
+ * and write a line of results per depth on the standard output.
+ *
+ * PARAMETERS
+ * image        The image
+ * k            The number of pixels removed
+ * depths       The numbers of channels
+ * nbDepths     The number of depths
+ * nbRuns       The number of reductions of each image
+ *
+ * RETURN
+ * 0            In case of success
+ * -1           if an image could not be made or reduced
+ * ------------------------------------------------------------------------- */
+static int benchDepths(const PAMImage* image, size_t k, const size_t* depths,
+                       size_t nbDepths, size_t nbRuns)
+{
+    double* seconds = malloc(sizeof(double) * (NB_SLIMMING_PHASES + 1) * nbRuns);
+    if (!seconds)
+        return -1;
+
+    printf("%zu x %zu, k = %zu, %zu runs, median times in seconds\n",
+           image->width, image->height, k, nbRuns);
+    printf("depth ");
+    for (int phase = 0; phase < NB_SLIMMING_PHASES; phase++)
+        printf(" %10s", getSlimmingPhaseName(phase));
+    printf(" %10s %12s %12s\n", "total", "energy ns/B", "ns/px/groove");
+
+    for (size_t d = 0; d < nbDepths; d++)
+    {
+        PAMImage* mixed = mixChannels(image, depths[d]);
+        if (!mixed)
+        {
+            free(seconds);
+            return -1;
+        }
+
+        for (size_t run = 0; run < nbRuns; run++)
+        {
+            SlimmingStats stats;
+            PAMImage* reduced = reducePAMWidth(mixed, k, &stats);
+            if (!reduced)
+            {
+                freePAM(mixed);
+                free(seconds);
+                return -1;
+            }
+            freePAM(reduced);
+
+            for (int phase = 0; phase < NB_SLIMMING_PHASES; phase++)
+                seconds[phase * nbRuns + run] = stats.phaseSeconds[phase];
+            seconds[NB_SLIMMING_PHASES * nbRuns + run] = stats.totalSeconds;
+        }
+
+        double medians[NB_SLIMMING_PHASES + 1];
+        for (int phase = 0; phase <= NB_SLIMMING_PHASES; phase++)
+            medians[phase] = median(&seconds[phase * nbRuns], nbRuns);
+
+        double nbBytes = (double)image->width * (double)image->height * (double)depths[d];
+        double work = (double)image->width * (double)image->height * (double)(k > 0 ? k : 1);
+
+        printf("%5zu ", depths[d]);
+        for (int phase = 0; phase <= NB_SLIMMING_PHASES; phase++)
+            printf(" %10.6f", medians[phase]);
+        printf(" %12.3f %12.3f\n", 1e9 * medians[SLIMMING_PHASE_ENERGY] / nbBytes,
+               1e9 * medians[NB_SLIMMING_PHASES] / work);
+
+        freePAM(mixed);
+    }
+
+    free(seconds);
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * Parse a comma-separated list of depths.
+ *
+ * PARAMETERS
+ * argument     The argument
+ * depths       Array of MAX_DEPTHS depths to fill
+ * nbDepths     Where to store the number of depths
+ *
+ * RETURN
+ * 0            In case of success
+ * -1           if the list is invalid
+ * ------------------------------------------------------------------------- */
+static int parseDepths(const char* argument, size_t* depths, size_t* nbDepths)
+{
+    *nbDepths = 0;
+
+    while (*argument)
+    {
+        char* end;
+        long depth = strtol(argument, &end, 10);
+
+        if (end == argument || depth < 1 || *nbDepths == MAX_DEPTHS ||
+            (*end != ',' && *end != '\0'))
+            return -1;
+
+        depths[(*nbDepths)++] = (size_t)depth;
+        argument = *end == ',' ? end + 1 : end;
+    }
+
+    return *nbDepths > 0 ? 0 : -1;
+}
+
+
+int main(int argc, char* argv[])
+{
+    bool bench = argc > 1 && strcmp(argv[1], "--bench") == 0;
+    int first = 4;
+
+    if (argc < 4)
+    {
+        fprintf(stderr, "Usage: %s input.pam output.pam k [--stats]\n"
+                        "       %s --bench input.pam k [--depths d1,d2,...] [--runs nbRuns]\n",
+                argv[0], argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const char* inputFile = argv[bench ? 2 : 1];
+    long k = strtol(argv[3], NULL, 10);
+    size_t depths[MAX_DEPTHS] = {1, 3, 4, 8, 16};
+    size_t nbDepths = 5, nbRuns = DEFAULT_RUNS;
+    bool printStats = false;
+
+    if (k < 0)
+    {
+        fprintf(stderr, "Invalid k '%s'\n", argv[3]);
+        return EXIT_FAILURE;
+    }
+
+    for (int i = first; i < argc; i++)
+    {
+        if (!bench && strcmp(argv[i], "--stats") == 0)
+            printStats = true;
+        else if (bench && strcmp(argv[i], "--depths") == 0 && i + 1 < argc &&
+                 parseDepths(argv[i + 1], depths, &nbDepths) == 0)
+            i++;
+        else if (bench && strcmp(argv[i], "--runs") == 0 && i + 1 < argc &&
+                 atoi(argv[i + 1]) > 0)
+            nbRuns = (size_t)atoi(argv[++i]);
+        else
+        {
+            fprintf(stderr, "Invalid option '%s'\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    PAMImage* image = readPAM(inputFile);
+    if (!image)
+    {
+        fprintf(stderr, "Aborting; cannot load image '%s'\n", inputFile);
+        return EXIT_FAILURE;
+    }
+
+    if ((size_t)k >= image->width)
+    {
+        fprintf(stderr, "Aborting; k (%ld) must be smaller than the width (%zu)\n",
+                k, image->width);
+        freePAM(image);
+        return EXIT_FAILURE;
+    }
+
+    if (bench)
+    {
+        int result = benchDepths(image, (size_t)k, depths, nbDepths, nbRuns);
+        freePAM(image);
+
+        if (result < 0)
+        {
+            fprintf(stderr, "Cannot measure the reductions\n");
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    SlimmingStats stats;
+    PAMImage* reduced = reducePAMWidth(image, (size_t)k, &stats);
+    freePAM(image);
+
+    if (!reduced)
+    {
+        fprintf(stderr, "Cannot reduce the image\n");
+        return EXIT_FAILURE;
+    }
+
+    if (writePAM(argv[2], reduced) < 0)
+    {
+        fprintf(stderr, "Cannot write the reduced image into '%s'\n", argv[2]);
+        freePAM(reduced);
+        return EXIT_FAILURE;
+    }
+
+    if (printStats)
+    {
+        for (int phase = 0; phase < NB_SLIMMING_PHASES; phase++)
+            fprintf(stderr, "%-10s %f s\n", getSlimmingPhaseName(phase), stats.phaseSeconds[phase]);
+        fprintf(stderr, "slimming: %zu grooves of %zu channels in %f s\n",
+                stats.nbGrooves, reduced->depth, stats.totalSeconds);
+    }
+
+    freePAM(reduced);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,546 @@
+/* ------------------------------------------------------------------------- *\
+ * NAME
+ *      quality
+ * SYNOPSIS
+ *      quality [--k nbPix] [--candidates c1,c2,...] [--threads nbThreads]
+ *              input_file...
+ * DESCIRPTION
+ *      Compare the images reduced by approximate engines or modes with the
+ *      ones reduced by the exact engine (reduceImageWidth()), at the same
+ *      width. For each image and each candidate, the following are written:
+ *      - the time of the reduction, and its speedup over the exact one;
+ *      - the energy removed by the grooves, and its excess over the exact
+ *        reduction;
+ *      - the displacement of the grooves: the column of the input from
+ *        which each pixel of the output comes is recovered (the line of the
+ *        output being a subsequence of the line of the input), and the mean
+ *        and largest distances between the columns of the same pixel in the
+ *        two outputs are given, with the lines whose pixels all come from
+ *        the same columns (the lines which are not made of pixels of the same
+ *        line of the input are left out: the exact engine moves a few
+ *        pixels between its last lines);
+ *      - the mean structural similarity (SSIM) of the luminances of both
+ *        outputs, over windows of 7 x 7 pixels.
+ *      The totals over all the images are written last.
+ *      A candidate is an engine (exact, astar or runs), followed by ':' and
+ *      the width of its grooves when they are wider than one column.
+ * ARGUMENTS
+ *      input_file      An input image file in PNM format
+ *      nbPix           The number of pixels removed from each image
+ *                      (default 10% of its width)
+ *      c1,c2,...       The candidates compared with the exact reduction
+ *                      (default astar,runs,astar:2,astar:4)
+ *      nbThreads       The number of threads of each reduction (default 1)
+ * RETURN
+ *      0 if every image could be compared, 1 otherwise.
+ *
+ * USAGE
+ *      ./quality --candidates astar,exact:2 pnm/0[1-5].pnm
+ *          will compare the astar engine and the grooves of 2 columns with
+ *          the exact engine on every image of the corpus
+ \* ------------------------------------------------------------------------- */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "slimming.h"
+#include "PNM.h"
+
+// Largest number of candidates
+#define MAX_CANDIDATES 16
+
+// Side of the windows of the structural similarity
+#define SSIM_WINDOW 7
+
+// Stabilising constants of the structural similarity, (0.01 L)^2 and (0.03 L)^2
+#define SSIM_C1 (0.01f * 255 * 0.01f * 255)
+#define SSIM_C2 (0.03f * 255 * 0.03f * 255)
+
+// A reduction compared with the exact one
+typedef struct {
+    const char* name;
+    SlimmingEngine engine;
+    size_t grooveWidth;
+} Candidate;
+
+// Measures of a candidate, for an image or summed over the images
+typedef struct {
+    double seconds;
+    double removedEnergy;
+    double totalShift;      // Sum of the displacements of the pixels
+    size_t maxShift;
+    size_t nbPixels;        // Number of pixels of the outputs
+    size_t nbSameLines;
+    size_t nbLines;
+    double totalSimilarity; // Sum of the mean similarities of the images
+    size_t nbImages;
+} Quality;
+
+
+/* ------------------------------------------------------------------------- *
+ * Parse a comma-separated list of candidates, such as "astar,exact:2".
+ *
+ * PARAMETERS
+ * argument     The argument (kept, the names pointing into it)
+ * candidates   Array of MAX_CANDIDATES candidates to fill
+ * nbCandidates Where to store the number of candidates
+ *
+ * RETURN
+ * 0            In case of success
+ * -1           if the list is invalid
+ * ------------------------------------------------------------------------- */
+static int parseCandidates(char* argument, Candidate* candidates, size_t* nbCandidates)
+{
+    *nbCandidates = 0;
+
+    for (char* name = strtok(argument, ","); name; name = strtok(NULL, ","))
+    {
+        if (*nbCandidates == MAX_CANDIDATES)
+            return -1;
+
+        Candidate* candidate = &candidates[(*nbCandidates)++];
+        const char* width = strchr(name, ':');
+        size_t length = width ? (size_t)(width - name) : strlen(name);
+
+        candidate->name = name;
+        candidate->grooveWidth = 1;
+
+        if (length == 5 && strncmp(name, "exact", 5) == 0)
+            candidate->engine = SLIMMING_ENGINE_EXACT;
+        else if (length == 5 && strncmp(name, "astar", 5) == 0)
+            candidate->engine = SLIMMING_ENGINE_ASTAR;
+        else if (length == 4 && strncmp(name, "runs", 4) == 0)
+            candidate->engine = SLIMMING_ENGINE_RUNS;
+        else
+            return -1;
+
+        if (width)
+        {
+            char extra;
+            int value;
+
+            if (sscanf(width + 1, "%d%c", &value, &extra) != 1 || value <= 0)
+                return -1;
+            candidate->grooveWidth = (size_t)value;
+        }
+    }
+
+    return *nbCandidates > 0 ? 0 : -1;
+}
+
+/* ------------------------------------------------------------------------- *
+ * Recover the column of the input from which each pixel of a reduced image
+ * comes. The pixels of a line keep their order, so that each line of the
+ * output is matched with the leftmost pixels of the input which hold it
+ * (identical neighbouring pixels cannot be told apart). The first column
+ * of a line which is not made of pixels of the same line of the input is
+ * set to input->width.
+ *
+ * PARAMETERS
+ * input        The input image
+ * output       The image reduced from it
+ * columns      Array of output->width * output->height columns to fill
+ * ------------------------------------------------------------------------- */
+static void findSourceColumns(const PNMImage* input, const PNMImage* output, size_t* columns)
+{
+    for (size_t i = 0; i < output->height; i++)
+    {
+        const PNMPixel* inputLine = &input->data[i * input->width];
+        const PNMPixel* outputLine = &output->data[i * output->width];
+        size_t* lineColumns = &columns[i * output->width];
+        size_t column = 0;
+
+        for (size_t j = 0; j < output->width; j++, column++)
+        {
+            while (column < input->width &&
+                   memcmp(&inputLine[column], &outputLine[j], sizeof(PNMPixel)) != 0)
+                column++;
+
+            if (column == input->width)
+            {
+                lineColumns[0] = input->width;
+                break;
+            }
+
+            lineColumns[j] = column;
+        }
+    }
+}
+
+/* ------------------------------------------------------------------------- *
+ * Give the luminance of each pixel of an image.
+ *
+ * PARAMETERS
+ * image        The image
+ * luminances   Array of image->width * image->height values to fill
+ * ------------------------------------------------------------------------- */
+static void computeLuminances(const PNMImage* image, float* luminances)
+{
+    size_t nbPixels = image->width * image->height;
+
+    for (size_t p = 0; p < nbPixels; p++)
+        luminances[p] = 0.299f * image->data[p].red + 0.587f * image->data[p].green +
+                        0.114f * image->data[p].blue;
+}
+
+/* ------------------------------------------------------------------------- *
+ * Give the mean structural similarity of the luminances of two images of
+ * the same size, over every window of SSIM_WINDOW x SSIM_WINDOW pixels (or
+ * as large as the images, if they are smaller).
+ *
+ * The sums of each window are computed in two passes, both looping over
+ * the columns of a line with independent iterations, which the compiler
+ * vectorises: the sums over SSIM_WINDOW lines of each column, then the sums
+ * of SSIM_WINDOW neighbouring columns.
+ *
+ * PARAMETERS
+ * a            The first image
+ * b            The second image
+ *
+ * RETURN
+ * similarity   The mean similarity (1 for identical images)
+ * -1           if an allocation failed
+ * ------------------------------------------------------------------------- */
+static double computeSimilarity(const PNMImage* a, const PNMImage* b)
+{
+    size_t width = a->width, height = a->height;
+    size_t window = SSIM_WINDOW;
+    if (window > width)
+        window = width;
+    if (window > height)
+        window = height;
+
+    size_t nbColumns = width - window + 1;
+
+    // Luminances of both images, then 5 column sums and 5 window sums
+    float* buffer = malloc(sizeof(float) * (2 * width * height + 10 * width));
+    if (!buffer)
+        return -1;
+
+    float* x = buffer;
+    float* y = &x[width * height];
+    float* sums[5];
+    float* windowSums[5];
+    for (int s = 0; s < 5; s++)
+    {
+        sums[s] = &y[width * height + s * width];
+        windowSums[s] = &y[width * height + (5 + s) * width];
+    }
+
+    computeLuminances(a, x);
+    computeLuminances(b, y);
+
+    const float n = (float)(window * window);
+    double total = 0;
+
+    for (size_t i = 0; i + window <= height; i++)
+    {
+        float* sx = sums[0], * sy = sums[1], * sxx = sums[2], * syy = sums[3], * sxy = sums[4];
+
+        for (size_t j = 0; j < width; j++)
+            sx[j] = sy[j] = sxx[j] = syy[j] = sxy[j] = 0;
+
+        for (size_t t = 0; t < window; t++)
+        {
+            const float* lineX = &x[(i + t) * width];
+            const float* lineY = &y[(i + t) * width];
+
+            for (size_t j = 0; j < width; j++)
+            {
+                sx[j] += lineX[j];
+                sy[j] += lineY[j];
+                sxx[j] += lineX[j] * lineX[j];
+                syy[j] += lineY[j] * lineY[j];
+                sxy[j] += lineX[j] * lineY[j];
+            }
+        }
+
+        for (int s = 0; s < 5; s++)
+        {
+            float* windowSum = windowSums[s];
+            const float* sum = sums[s];
+
+            memcpy(windowSum, sum, sizeof(float) * nbColumns);
+            for (size_t t = 1; t < window; t++)
+                for (size_t j = 0; j < nbColumns; j++)
+                    windowSum[j] += sum[j + t];
+        }
+
+        // The similarity of each window replaces its sum of x
+        float* similarity = windowSums[0];
+        for (size_t j = 0; j < nbColumns; j++)
+        {
+            float meanX = windowSums[0][j] / n, meanY = windowSums[1][j] / n;
+            float varianceX = windowSums[2][j] / n - meanX * meanX;
+            float varianceY = windowSums[3][j] / n - meanY * meanY;
+            float covariance = windowSums[4][j] / n - meanX * meanY;
+
+            similarity[j] = (2 * meanX * meanY + SSIM_C1) * (2 * covariance + SSIM_C2) /
+                            ((meanX * meanX + meanY * meanY + SSIM_C1) *
+                             (varianceX + varianceY + SSIM_C2));
+        }
+
+        for (size_t j = 0; j < nbColumns; j++)
+            total += similarity[j];
+    }
+
+    free(buffer);
+    return total / ((double)nbColumns * (double)(height - window + 1));
+}
+
+/* ------------------------------------------------------------------------- *
+ * Measure an output against the exact one, and add the measures to the
+ * ones of its candidate.
+ *
+ * PARAMETERS
+ * output       The output of the candidate
+ * exact        The output of the exact engine
+ * outputColumns The source columns of the pixels of the output
+ * exactColumns The source columns of the pixels of the exact output
+ * inputWidth   The width of the input (marking the lines left out)
+ * quality      The measures of the image, whose time and removed energy
+ *              are set, to complete
+ *
+ * RETURN
+ * 0            In case of success
+ * -1           if an allocation failed
+ * ------------------------------------------------------------------------- */
+static int measureOutput(const PNMImage* output, const PNMImage* exact,
+                         const size_t* outputColumns, const size_t* exactColumns,
+                         size_t inputWidth, Quality* quality)
+{
+    double similarity = computeSimilarity(output, exact);
+    if (similarity < 0)
+        return -1;
+
+    quality->totalShift = 0;
+    quality->maxShift = 0;
+    quality->nbSameLines = 0;
+    quality->nbPixels = 0;
+    quality->nbLines = 0;
+
+    for (size_t i = 0; i < output->height; i++)
+    {
+        size_t lineShift = 0;
+
+        if (outputColumns[i * output->width] == inputWidth ||
+            exactColumns[i * output->width] == inputWidth)
+            continue;
+
+        for (size_t j = 0; j < output->width; j++)
+        {
+            size_t p = i * output->width + j;
+            size_t shift = outputColumns[p] > exactColumns[p] ?
+                           outputColumns[p] - exactColumns[p] : exactColumns[p] - outputColumns[p];
+
+            lineShift += shift;
+            if (shift > quality->maxShift)
+                quality->maxShift = shift;
+        }
+
+        quality->totalShift += (double)lineShift;
+        quality->nbSameLines += lineShift == 0;
+        quality->nbPixels += output->width;
+        quality->nbLines++;
+    }
+    quality->totalSimilarity = similarity;
+    quality->nbImages = 1;
+
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * Write a line of measures of a candidate.
+ *
+ * PARAMETERS
+ * image        The name of the image (or of the totals)
+ * name         The name of the candidate
+ * quality      The measures of the candidate
+ * exact        The measures of the exact engine
+ * ------------------------------------------------------------------------- */
+static void printQuality(const char* image, const char* name, const Quality* quality,
+                         const Quality* exact)
+{
+    printf("%-16s %-10s %10.6f %8.2f %12.0f %+8.2f%% %8.3f %6zu %8.1f%% %8.5f\n",
+           image, name, quality->seconds,
+           quality->seconds > 0 ? exact->seconds / quality->seconds : 0.0,
+           quality->removedEnergy,
+           exact->removedEnergy > 0 ? 100 * (quality->removedEnergy / exact->removedEnergy - 1) : 0.0,
+           quality->nbPixels ? quality->totalShift / (double)quality->nbPixels : 0.0,
+           quality->maxShift,
+           quality->nbLines ? 100.0 * quality->nbSameLines / quality->nbLines : 100.0,
+           quality->nbImages ? quality->totalSimilarity / quality->nbImages : 1.0);
+}
+
+/* ------------------------------------------------------------------------- *
+ * Add the measures of an image to the totals of its candidate.
+ *
+ * PARAMETERS
+ * total        The totals
+ * quality      The measures of the image
+ * ------------------------------------------------------------------------- */
+static void addQuality(Quality* total, const Quality* quality)
+{
+    total->seconds += quality->seconds;
+    total->removedEnergy += quality->removedEnergy;
+    total->totalShift += quality->totalShift;
+    if (quality->maxShift > total->maxShift)
+        total->maxShift = quality->maxShift;
+    total->nbPixels += quality->nbPixels;
+    total->nbSameLines += quality->nbSameLines;
+    total->nbLines += quality->nbLines;
+    total->totalSimilarity += quality->totalSimilarity;
+    total->nbImages += quality->nbImages;
+}
+
+
+int main(int argc, char* argv[])
+{
+    size_t k = 0;
+    size_t nbThreads = 1;
+    char defaultCandidates[] = "astar,runs,astar:2,astar:4";
+    char* candidateList = defaultCandidates;
+    int first = 1;
+
+    /* --- Argument parsing --- */
+    while (first + 1 < argc && strncmp(argv[first], "--", 2) == 0)
+    {
+        int value;
+        char extra;
+        bool numeric = sscanf(argv[first + 1], "%d%c", &value, &extra) == 1 && value > 0;
+
+        if (strcmp(argv[first], "--k") == 0 && numeric)
+            k = (size_t)value;
+        else if (strcmp(argv[first], "--threads") == 0 && numeric)
+            nbThreads = (size_t)value;
+        else if (strcmp(argv[first], "--candidates") == 0)
+            candidateList = argv[first + 1];
+        else
+        {
+            fprintf(stderr, "Invalid option '%s'\n", argv[first]);
+            return EXIT_FAILURE;
+        }
+
+        first += 2;
+    }
+
+    Candidate candidates[MAX_CANDIDATES];
+    size_t nbCandidates;
+
+    if (first >= argc || parseCandidates(candidateList, candidates, &nbCandidates) < 0)
+    {
+        fprintf(stderr, "Usage: %s [--k nbPix] [--candidates c1,c2,...] [--threads nbThreads] "
+                        "input.pnm...\n"
+                        "       where a candidate is exact, astar or runs, with ':width' for "
+                        "wider grooves\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    Quality exactTotal = {0};
+    Quality totals[MAX_CANDIDATES];
+    memset(totals, 0, sizeof(totals));
+    int status = EXIT_SUCCESS;
+
+    printf("%-16s %-10s %10s %8s %12s %9s %8s %6s %9s %8s\n", "image", "candidate", "seconds",
+           "speedup", "energy", "excess", "shift", "max", "same", "ssim");
+
+    /* --- Comparison of each image --- */
+    for (int arg = first; arg < argc; arg++)
+    {
+        PNMImage* image = readPNM(argv[arg]);
+        if (!image)
+        {
+            fprintf(stderr, "Cannot load image '%s'\n", argv[arg]);
+            status = EXIT_FAILURE;
+            continue;
+        }
+
+        size_t nbPix = k ? k : (image->width / 10 ? image->width / 10 : 1);
+        if (nbPix >= image->width)
+        {
+            fprintf(stderr, "Image '%s' cannot be reduced by %zu pixels\n", argv[arg], nbPix);
+            freePNM(image);
+            status = EXIT_FAILURE;
+            continue;
+        }
+
+        SlimmingStats stats;
+        SlimmingOptions options;
+        initSlimmingOptions(&options);
+        options.nbThreads = nbThreads;
+        options.stats = &stats;
+
+        size_t nbPixels = (image->width - nbPix) * image->height;
+        size_t* exactColumns = malloc(sizeof(size_t) * nbPixels);
+        size_t* columns = malloc(sizeof(size_t) * nbPixels);
+        PNMImage* exact = reduceImageWidthWithOptions(image, nbPix, &options);
+
+        if (!exactColumns || !columns || !exact)
+        {
+            fprintf(stderr, "Cannot reduce image '%s'\n", argv[arg]);
+            free(exactColumns);
+            free(columns);
+            freePNM(exact);
+            freePNM(image);
+            status = EXIT_FAILURE;
+            continue;
+        }
+
+        findSourceColumns(image, exact, exactColumns);
+
+        Quality exactQuality = {0};
+        exactQuality.seconds = stats.totalSeconds;
+        exactQuality.removedEnergy = stats.removedEnergy;
+        exactQuality.nbPixels = nbPixels;
+        exactQuality.nbLines = exactQuality.nbSameLines = image->height;
+        exactQuality.totalSimilarity = 1;
+        exactQuality.nbImages = 1;
+
+        const char* name = strrchr(argv[arg], '/') ? strrchr(argv[arg], '/') + 1 : argv[arg];
+        printQuality(name, "exact", &exactQuality, &exactQuality);
+
+        for (size_t c = 0; c < nbCandidates; c++)
+        {
+            options.engine = candidates[c].engine;
+            options.grooveWidth = candidates[c].grooveWidth;
+
+            PNMImage* output = reduceImageWidthWithOptions(image, nbPix, &options);
+            Quality quality = {0};
+            quality.seconds = stats.totalSeconds;
+            quality.removedEnergy = stats.removedEnergy;
+
+            if (output)
+                findSourceColumns(image, output, columns);
+
+            if (!output || measureOutput(output, exact, columns, exactColumns,
+                                         image->width, &quality) < 0)
+            {
+                fprintf(stderr, "Cannot compare '%s' on image '%s'\n", candidates[c].name, argv[arg]);
+                freePNM(output);
+                status = EXIT_FAILURE;
+                continue;
+            }
+
+            printQuality(name, candidates[c].name, &quality, &exactQuality);
+            addQuality(&totals[c], &quality);
+            freePNM(output);
+        }
+
+        addQuality(&exactTotal, &exactQuality);
+
+        free(exactColumns);
+        free(columns);
+        freePNM(exact);
+        freePNM(image);
+    }
+
+    /* --- Totals --- */
+    printf("\n");
+    printQuality("total", "exact", &exactTotal, &exactTotal);
+    for (size_t c = 0; c < nbCandidates; c++)
+        printQuality("total", candidates[c].name, &totals[c], &exactTotal);
+
+    return status;
+}
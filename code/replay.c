@@ -0,0 +1,364 @@
+/* ------------------------------------------------------------------------- *\
+ * NAME
+ *      replay
+ * SYNOPSIS
+ *      replay record_file output_dir [--speed factor] [--workers nbWorkers]
+ *             [--io-batch ioBatchSize] [--inputs slow_dir]
+ *             [--record replay_file]
+ * DESCIRPTION
+ *      Re-issue the jobs recorded by `slimming --record` to a local
+ *      scheduler, each one at its recorded submission offset divided by the
+ *      speed factor, and compare the latencies (wait and service times) of
+ *      the successful jobs with the recorded ones: for each size class, the
+ *      number of jobs and the 50th, 90th and 99th percentiles of the
+ *      recorded and replayed latencies are written on the standard output.
+ *      Running it with two builds on the same record compares the builds.
+ * ARGUMENTS
+ *      record_file     A file written by `slimming --record`
+ *      output_dir      The directory receiving the outputs of the jobs
+ *      factor          The replay pace, relatively to the recorded one
+ *                      (default 1; 0 submits every job at once)
+ *      nbWorkers       The number of jobs run at the same time (default 1)
+ *      ioBatchSize     The number of small jobs whose files are loaded and
+ *                      written together (default 1)
+ *      slow_dir        A directory of inputs kept by `slimming
+ *                      --keep-slowest`: a job whose input is there (named
+ *                      after its hash) uses it instead of its recorded path
+ *      replay_file     A file receiving the record of the replayed jobs
+ * RETURN
+ *      0 if every job was replayed successfully, 1 otherwise.
+ *
+ * USAGE
+ *      ./replay prod.log /tmp/out --speed 4 --workers 4
+ *          will replay the jobs of prod.log four times faster
+ \* ------------------------------------------------------------------------- */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "slimming.h"
+#include "scheduler.h"
+#include "timing.h"
+
+// A recorded job
+typedef struct {
+    double offset;              // Submission time since the start of the record
+    char input[4096];           // Path to the input PNM file
+    size_t width, height, k;
+    SlimmingEngine engine;
+    unsigned long long hash;    // Hash of the input image
+    double latency;             // Wait and service times
+    int result;                 // 0 for a success
+} Record;
+
+// Names of the size classes in the report
+static const char* SIZE_CLASS_NAMES[NB_SIZE_CLASSES] = {"small", "medium", "large"};
+
+
+/* ------------------------------------------------------------------------- *
+ * Load the records of a file written by `slimming --record`.
+ *
+ * PARAMETERS
+ * fp           Stream on the record file
+ * records      Where to store the array of records (to free)
+ * nbRecords    Where to store the number of records
+ *
+ * RETURN
+ * 0            In case of success
+ * -1           if a line is malformed or if an allocation failed
+ * ------------------------------------------------------------------------- */
+static int loadRecords(FILE* fp, Record** records, size_t* nbRecords)
+{
+    char line[8192], engine[8];
+    size_t capacity = 0;
+    double wait, service;
+    size_t nbThreads;
+    int inputStart;
+
+    *records = NULL;
+    *nbRecords = 0;
+
+    while (fgets(line, sizeof(line), fp))
+    {
+        if (line[0] == '#' || line[0] == '\n')
+            continue;
+
+        if (*nbRecords == capacity)
+        {
+            capacity = capacity ? 2 * capacity : 64;
+            Record* nRecords = realloc(*records, sizeof(Record) * capacity);
+            if (!nRecords)
+                return -1;
+            *records = nRecords;
+        }
+
+        Record* record = &(*records)[*nbRecords];
+
+        // The input is the rest of the line, which may hold spaces
+        if (sscanf(line, "%lf %zu %zu %zu %7s %zu %llx %lf %lf %d %n",
+                   &record->offset, &record->width, &record->height,
+                   &record->k, engine, &nbThreads, &record->hash, &wait,
+                   &service, &record->result, &inputStart) != 10)
+            return -1;
+
+        size_t inputLength = strcspn(&line[inputStart], "\n");
+        if (inputLength == 0 || inputLength >= sizeof(record->input))
+            return -1;
+
+        memcpy(record->input, &line[inputStart], inputLength);
+        record->input[inputLength] = '\0';
+
+        record->engine = SLIMMING_ENGINE_EXACT;
+        if (strcmp(engine, "astar") == 0)
+            record->engine = SLIMMING_ENGINE_ASTAR;
+        else if (strcmp(engine, "runs") == 0)
+            record->engine = SLIMMING_ENGINE_RUNS;
+        record->latency = wait + service;
+        (*nbRecords)++;
+    }
+
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * Compare the submission offsets of two records, for qsort().
+ * ------------------------------------------------------------------------- */
+static int compareOffsets(const void* a, const void* b)
+{
+    double first = ((const Record*)a)->offset;
+    double second = ((const Record*)b)->offset;
+
+    return (first > second) - (first < second);
+}
+
+/* ------------------------------------------------------------------------- *
+ * Compare two doubles, for qsort().
+ * ------------------------------------------------------------------------- */
+static int compareDoubles(const void* a, const void* b)
+{
+    double first = *(const double*)a;
+    double second = *(const double*)b;
+
+    return (first > second) - (first < second);
+}
+
+/* ------------------------------------------------------------------------- *
+ * Write the number of successful jobs of a size class, and the 50th, 90th
+ * and 99th percentiles (nearest-rank) of their latencies.
+ *
+ * PARAMETERS
+ * source       The name of the records ("recorded" or "replayed")
+ * sizeClass    The size class
+ * records      The records
+ * nbRecords    The number of records
+ * latencies    An array of at least nbRecords doubles, used as a buffer
+ * ------------------------------------------------------------------------- */
+static void printLatencies(const char* source, SizeClass sizeClass,
+                           const Record* records, size_t nbRecords,
+                           double* latencies)
+{
+    size_t size = 0;
+
+    for (size_t i = 0; i < nbRecords; i++)
+    {
+        if (records[i].result == 0 &&
+            getSizeClass(records[i].width, records[i].height) == sizeClass)
+            latencies[size++] = records[i].latency;
+    }
+
+    printf("%s %s %zu", SIZE_CLASS_NAMES[sizeClass], source, size);
+
+    if (size == 0)
+    {
+        printf(" - - -\n");
+        return;
+    }
+
+    qsort(latencies, size, sizeof(double), compareDoubles);
+
+    const double percents[] = {50, 90, 99};
+    for (size_t p = 0; p < 3; p++)
+    {
+        size_t rank = (size_t)ceil(percents[p] / 100.0 * (double)size);
+        printf(" %.6f", latencies[(rank < 1 ? 1 : rank) - 1]);
+    }
+    printf("\n");
+}
+
+/* ------------------------------------------------------------------------- *
+ * Sleep until a given time.
+ *
+ * PARAMETERS
+ * time         The time to wait for, as given by getTimeSeconds()
+ * ------------------------------------------------------------------------- */
+static void sleepUntil(double time)
+{
+    double remaining;
+
+    while ((remaining = time - getTimeSeconds()) > 0)
+    {
+        struct timespec delay;
+        delay.tv_sec = (time_t)remaining;
+        delay.tv_nsec = (long)((remaining - (double)delay.tv_sec) * 1e9);
+        nanosleep(&delay, NULL);
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "Usage: %s record.log output_dir [--speed factor] [--workers nbWorkers]\n"
+                        "                [--io-batch ioBatchSize] [--inputs slow/] [--record replay.log]\n",
+                argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    double speed = 1.0;
+    size_t nbWorkers = 1;
+    size_t ioBatchSize = 1;
+    const char* inputsDir = NULL;
+    const char* replayFile = NULL;
+
+    for (int i = 3; i < argc; i += 2)
+    {
+        char extra;
+        int parsed;
+        const char* value = i + 1 < argc ? argv[i + 1] : "";
+
+        if (strcmp(argv[i], "--speed") == 0 &&
+            sscanf(value, "%lf%c", &speed, &extra) == 1 && speed >= 0)
+            continue;
+
+        if (strcmp(argv[i], "--workers") == 0 &&
+            sscanf(value, "%d%c", &parsed, &extra) == 1 && parsed > 0)
+        {
+            nbWorkers = (size_t)parsed;
+            continue;
+        }
+
+        if (strcmp(argv[i], "--io-batch") == 0 &&
+            sscanf(value, "%d%c", &parsed, &extra) == 1 && parsed > 0)
+        {
+            ioBatchSize = (size_t)parsed;
+            continue;
+        }
+
+        if (strcmp(argv[i], "--inputs") == 0 && i + 1 < argc)
+        {
+            inputsDir = value;
+            continue;
+        }
+
+        if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+        {
+            replayFile = value;
+            continue;
+        }
+
+        fprintf(stderr, "Invalid option '%s %s'\n", argv[i], value);
+        return EXIT_FAILURE;
+    }
+
+    // Load the recorded jobs, in submission order
+    FILE* fp = fopen(argv[1], "r");
+    if (!fp)
+    {
+        fprintf(stderr, "Aborting; cannot open record file '%s'\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    Record* records;
+    size_t nbRecords;
+    int resultLoad = loadRecords(fp, &records, &nbRecords);
+    fclose(fp);
+
+    if (resultLoad < 0)
+    {
+        fprintf(stderr, "Aborting; cannot read record file '%s'\n", argv[1]);
+        free(records);
+        return EXIT_FAILURE;
+    }
+
+    qsort(records, nbRecords, sizeof(Record), compareOffsets);
+
+    // The replayed jobs are recorded too, to measure their latencies
+    FILE* replay = replayFile ? fopen(replayFile, "w+") : tmpfile();
+    Scheduler* scheduler = replay ? createScheduler(nbWorkers, 1.0) : NULL;
+
+    if (!scheduler || setSchedulerRecord(scheduler, replay, NULL, 0) < 0)
+    {
+        fprintf(stderr, "Aborting; cannot start the scheduler\n");
+        freeScheduler(scheduler);
+        if (replay)
+            fclose(replay);
+        free(records);
+        return EXIT_FAILURE;
+    }
+
+    setSchedulerIO(scheduler, ioBatchSize, BATCH_IO_AUTO);
+
+    char input[4096], output[4096];
+    size_t nbRejected = 0;
+    double startTime = getTimeSeconds();
+
+    for (size_t i = 0; i < nbRecords; i++)
+    {
+        if (speed > 0)
+            sleepUntil(startTime + records[i].offset / speed);
+
+        snprintf(input, sizeof(input), "%s/%016llx.pnm", inputsDir ? inputsDir : "",
+                 records[i].hash);
+        if (!inputsDir || access(input, R_OK) != 0)
+            snprintf(input, sizeof(input), "%s", records[i].input);
+
+        snprintf(output, sizeof(output), "%s/replay_%zu.pnm", argv[2], i);
+
+        if (submitJob(scheduler, input, output, records[i].k, records[i].engine) < 0)
+        {
+            fprintf(stderr, "Cannot replay '%s'\n", input);
+            nbRejected++;
+        }
+    }
+
+    size_t nbFailed = waitScheduler(scheduler);
+    freeScheduler(scheduler);
+
+    // Compare the latencies
+    Record* replayed = NULL;
+    size_t nbReplayed = 0;
+    double* latencies = malloc(sizeof(double) * (nbRecords + 1));
+
+    rewind(replay);
+    resultLoad = loadRecords(replay, &replayed, &nbReplayed);
+    fclose(replay);
+
+    if (resultLoad < 0 || !latencies || nbReplayed > nbRecords)
+    {
+        fprintf(stderr, "Aborting; cannot read the replayed jobs\n");
+        free(records);
+        free(replayed);
+        free(latencies);
+        return EXIT_FAILURE;
+    }
+
+    printf("# class source jobs latency_p50 latency_p90 latency_p99\n");
+    for (size_t c = 0; c < NB_SIZE_CLASSES; c++)
+    {
+        printLatencies("recorded", (SizeClass)c, records, nbRecords, latencies);
+        printLatencies("replayed", (SizeClass)c, replayed, nbReplayed, latencies);
+    }
+
+    free(records);
+    free(replayed);
+    free(latencies);
+
+    return (nbFailed + nbRejected == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
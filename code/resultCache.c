@@ -0,0 +1,680 @@
+/* ------------------------------------------------------------------------- *
+ * Implementation of the shared result cache interface.
+ *
+ * The segment holds a header, then the shards. Each shard holds its
+ * counters and mutex, an open addressing (linear probing) table of slots,
+ * the links of its pages (a result is stored in a chain of pages, the free
+ * pages form a list), then the pages. Offsets are derived from the header,
+ * so that every process maps the same layout.
+ * ------------------------------------------------------------------------- */
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "resultCache.h"
+
+/* ------------------------------------------------------------------------- *
+ *
+ * STRUCTURES
+ *
+ * ------------------------------------------------------------------------- */
+
+//Value of the magic number of an initialised segment ("SLIMCAC2", the slots holding a second hash).
+#define CACHE_MAGIC 0x534c494d43414332ULL
+
+//Size of a page storing (part of) a result.
+#define CACHE_PAGE_SIZE (64 * 1024)
+
+//Maximal number of shards of a cache.
+#define MAX_CACHE_SHARDS 16
+
+//Alignment of the areas of the segment.
+#define CACHE_ALIGNMENT 64
+
+//Link of the last page of a chain.
+#define NO_PAGE UINT32_MAX
+
+//Time an opening process waits for the creator to initialise the segment (in milliseconds).
+#define OPEN_TIMEOUT 5000
+
+//Structure representing the header of the segment.
+typedef struct CacheHeader_t{
+	unsigned long long magic; //Set last by the creator, once the segment is initialised.
+	size_t size; //Size of the segment.
+	size_t nbShards; //Number of shards.
+	size_t nbPages, nbSlots; //Number of pages and of slots of each shard.
+	size_t shardSize; //Size of the area of a shard.
+	size_t pagesOffset; //Offset of the pages in the area of a shard.
+}CacheHeader;
+
+//Structure representing a slot of the table of a shard.
+typedef struct CacheSlot_t{
+	unsigned long long hash; //Hash of the input image.
+	unsigned long long check; //Second hash of the input image.
+	size_t width, height, k; //Size of the input image, and number of pixels removed.
+	int engine; //Engine of the reduction.
+	bool used; //True if the slot holds a result.
+	bool referenced; //True if the result was read since the clock hand last passed.
+	size_t nbBytes; //Size of the result.
+	uint32_t firstPage; //First page of the chain storing the result.
+}CacheSlot;
+
+//Structure representing the metadata of a shard.
+typedef struct CacheShard_t{
+	pthread_mutex_t lock; //Robust and process-shared, protects the whole shard.
+	uint32_t freePage; //First page of the list of free pages.
+	size_t nbFree; //Number of free pages.
+	size_t hand; //Position of the clock hand in the table.
+	size_t nbEntries, nbBytes; //Number and size of the stored results.
+	size_t nbHits, nbMisses, nbInsertions, nbEvictions; //Counters of the shard.
+}CacheShard;
+
+struct ResultCache_t{
+	unsigned char *base; //The mapped segment.
+	size_t size; //Size of the mapping.
+	const CacheHeader *header; //Header of the segment.
+};
+
+/* ------------------------------------------------------------------------- *
+ *
+ * PROTOTYPES OF STATIC FUNCTIONS
+ *
+ * ------------------------------------------------------------------------- */
+
+/* ------------------------------------------------------------------------- *
+ * Round a size up to the alignment of the areas.
+ *
+ * PARAMETERS
+ * size         the size to round
+ *
+ * RETURN
+ * the rounded size.
+ * ------------------------------------------------------------------------- */
+static size_t align_size(size_t size);
+
+/* ------------------------------------------------------------------------- *
+ * Tell whether a name designates a file rather than a shared memory segment.
+ *
+ * PARAMETERS
+ * name         the name of the cache
+ *
+ * RETURN
+ * true if the name is a path to a file, false otherwise.
+ * ------------------------------------------------------------------------- */
+static bool is_file_name(const char* name);
+
+/* ------------------------------------------------------------------------- *
+ * Give the layout of a segment of (at most) the given size.
+ *
+ * PARAMETERS
+ * header       the header to fill
+ * size         the size of the segment
+ *
+ * RETURN
+ * 0, the layout was computed.
+ * -1, the size is too small.
+ * ------------------------------------------------------------------------- */
+static int compute_layout(CacheHeader* header, size_t size);
+
+/* ------------------------------------------------------------------------- *
+ * Give the metadata, slots, page links or a page of a shard.
+ *
+ * PARAMETERS
+ * cache        the cache
+ * shard        the index of the shard (or its metadata)
+ * page         the index of the page
+ *
+ * RETURN
+ * a pointer to the requested area.
+ * ------------------------------------------------------------------------- */
+static CacheShard* get_shard(const ResultCache* cache, size_t shard);
+static CacheSlot* get_slots(CacheShard* shard);
+static uint32_t* get_links(const ResultCache* cache, CacheShard* shard);
+static unsigned char* get_page(const ResultCache* cache, CacheShard* shard, uint32_t page);
+
+/* ------------------------------------------------------------------------- *
+ * Mix a key into the hash selecting its shard and its first slot.
+ *
+ * PARAMETERS
+ * hash         the hash of the input image
+ * k            the number of pixels removed
+ * engine       the engine of the reduction
+ *
+ * RETURN
+ * the hash of the key.
+ * ------------------------------------------------------------------------- */
+static unsigned long long hash_key(unsigned long long hash, size_t k, int engine);
+
+/* ------------------------------------------------------------------------- *
+ * Empty a shard: every page is free and every slot unused.
+ *
+ * PARAMETERS
+ * cache        the cache
+ * shard        the shard
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void reset_shard(const ResultCache* cache, CacheShard* shard);
+
+/* ------------------------------------------------------------------------- *
+ * Lock a shard. If its previous owner died holding the lock, the shard,
+ * which may be inconsistent, is emptied.
+ *
+ * PARAMETERS
+ * cache        the cache
+ * shard        the shard
+ *
+ * RETURN
+ * 0, the shard is locked.
+ * -1, the shard could not be locked.
+ * ------------------------------------------------------------------------- */
+static int lock_shard(const ResultCache* cache, CacheShard* shard);
+
+/* ------------------------------------------------------------------------- *
+ * Find the slot of a key in the table of a shard.
+ *
+ * PARAMETERS
+ * cache        the cache
+ * shard        the shard
+ * keyHash      the hash of the key
+ * hash, check, width, height, k, engine     the key
+ *
+ * RETURN
+ * the index of the slot holding the key, or of the unused slot ending its
+ * probe sequence.
+ * ------------------------------------------------------------------------- */
+static size_t find_slot(const ResultCache* cache, CacheShard* shard, unsigned long long keyHash,
+                        unsigned long long hash, unsigned long long check, size_t width, size_t height,
+                        size_t k, int engine);
+
+/* ------------------------------------------------------------------------- *
+ * Evict the result of a slot: its pages are freed, and the following slots
+ * of its probe sequence are shifted back.
+ *
+ * PARAMETERS
+ * cache        the cache
+ * shard        the shard
+ * position     the index of the slot
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void evict_slot(const ResultCache* cache, CacheShard* shard, size_t position);
+
+/* ------------------------------------------------------------------------- *
+ * Open the file or shared memory segment of a cache.
+ *
+ * PARAMETERS
+ * name         the name of the cache
+ * flags        the flags of open()
+ *
+ * RETURN
+ * the file descriptor, or -1 if it could not be opened.
+ * ------------------------------------------------------------------------- */
+static int open_segment(const char* name, int flags);
+
+/* ------------------------------------------------------------------------- *
+ * Initialise a new segment.
+ *
+ * PARAMETERS
+ * cache        the cache, whose segment is mapped
+ * layout       the layout of the segment
+ *
+ * RETURN
+ * 0, the segment is initialised.
+ * -1, a mutex could not be initialised.
+ * ------------------------------------------------------------------------- */
+static int initialise_segment(ResultCache* cache, const CacheHeader* layout);
+
+/* ------------------------------------------------------------------------- *
+ *
+ * IMPLEMENTATION
+ *
+ * ------------------------------------------------------------------------- */
+
+static size_t align_size(size_t size){
+	return (size + CACHE_ALIGNMENT - 1) / CACHE_ALIGNMENT * CACHE_ALIGNMENT;
+}//End align_size()
+
+static bool is_file_name(const char* name){
+	return name[0] != '/' || strchr(name + 1, '/') != NULL;
+}//End is_file_name()
+
+static int compute_layout(CacheHeader* header, size_t size){
+	size_t headerSize = align_size(sizeof(CacheHeader));
+	if(size < (1 << 20) || size > (size_t)UINT32_MAX * CACHE_PAGE_SIZE)
+		return -1;
+
+	//One shard per MiB, up to the maximum: each shard has at least a few pages.
+	size_t nbShards = size >> 20;
+	if(nbShards > MAX_CACHE_SHARDS)
+		nbShards = MAX_CACHE_SHARDS;
+
+	//Each page comes with its link and two slots (the table is at most half full).
+	size_t shardSize = (size - headerSize) / nbShards;
+	size_t metadataSize = align_size(sizeof(CacheShard)) + CACHE_ALIGNMENT;
+	size_t pageCost = CACHE_PAGE_SIZE + sizeof(uint32_t) + 2 * sizeof(CacheSlot);
+
+	header->nbShards = nbShards;
+	header->nbPages = (shardSize - metadataSize) / pageCost;
+	header->nbSlots = 2 * header->nbPages;
+	header->pagesOffset = align_size(align_size(sizeof(CacheShard)) + header->nbSlots * sizeof(CacheSlot) +
+	                                 header->nbPages * sizeof(uint32_t));
+	header->shardSize = header->pagesOffset + header->nbPages * CACHE_PAGE_SIZE;
+	header->size = headerSize + nbShards * header->shardSize;
+	header->magic = 0;
+
+	return 0;
+}//End compute_layout()
+
+static CacheShard* get_shard(const ResultCache* cache, size_t shard){
+	return (CacheShard*)(cache->base + align_size(sizeof(CacheHeader)) + shard * cache->header->shardSize);
+}//End get_shard()
+
+static CacheSlot* get_slots(CacheShard* shard){
+	return (CacheSlot*)((unsigned char*)shard + align_size(sizeof(CacheShard)));
+}//End get_slots()
+
+static uint32_t* get_links(const ResultCache* cache, CacheShard* shard){
+	return (uint32_t*)(get_slots(shard) + cache->header->nbSlots);
+}//End get_links()
+
+static unsigned char* get_page(const ResultCache* cache, CacheShard* shard, uint32_t page){
+	return (unsigned char*)shard + cache->header->pagesOffset + (size_t)page * CACHE_PAGE_SIZE;
+}//End get_page()
+
+static unsigned long long hash_key(unsigned long long hash, size_t k, int engine){
+	unsigned long long key = hash ^ ((unsigned long long)k * 0x9e3779b97f4a7c15ULL) ^ (unsigned long long)engine;
+
+	//Final mix of splitmix64, so that every bit of the key selects the shard and the slot.
+	key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	key = (key ^ (key >> 27)) * 0x94d049bb133111ebULL;
+
+	return key ^ (key >> 31);
+}//End hash_key()
+
+static void reset_shard(const ResultCache* cache, CacheShard* shard){
+	CacheSlot* slots = get_slots(shard);
+	uint32_t* links = get_links(cache, shard);
+	size_t nbPages = cache->header->nbPages;
+
+	memset(slots, 0, sizeof(CacheSlot) * cache->header->nbSlots);
+
+	for(size_t p = 0; p < nbPages; ++p)
+		links[p] = p + 1 < nbPages ? (uint32_t)(p + 1) : NO_PAGE;
+
+	shard->freePage = nbPages > 0 ? 0 : NO_PAGE;
+	shard->nbFree = nbPages;
+	shard->hand = 0;
+	shard->nbEntries = 0;
+	shard->nbBytes = 0;
+
+	return;
+}//End reset_shard()
+
+static int lock_shard(const ResultCache* cache, CacheShard* shard){
+	int resultLock = pthread_mutex_lock(&shard->lock);
+
+	if(resultLock == EOWNERDEAD){
+		reset_shard(cache, shard);
+		pthread_mutex_consistent(&shard->lock);
+		return 0;
+	}
+
+	return resultLock == 0 ? 0 : -1;
+}//End lock_shard()
+
+static size_t find_slot(const ResultCache* cache, CacheShard* shard, unsigned long long keyHash,
+                        unsigned long long hash, unsigned long long check, size_t width, size_t height,
+                        size_t k, int engine){
+	CacheSlot* slots = get_slots(shard);
+	size_t nbSlots = cache->header->nbSlots;
+	size_t position = (keyHash / cache->header->nbShards) % nbSlots;
+
+	//The table is at most half full: an unused slot ends every probe sequence.
+	while(slots[position].used){
+		const CacheSlot* slot = &slots[position];
+
+		//Every field of the key is compared: two inputs whose hashes collide are different keys.
+		if(slot->hash == hash && slot->check == check && slot->width == width && slot->height == height &&
+		   slot->k == k && slot->engine == engine)
+			break;
+
+		position = (position + 1) % nbSlots;
+	}
+
+	return position;
+}//End find_slot()
+
+static void evict_slot(const ResultCache* cache, CacheShard* shard, size_t position){
+	CacheSlot* slots = get_slots(shard);
+	uint32_t* links = get_links(cache, shard);
+	size_t nbSlots = cache->header->nbSlots;
+
+	//Free the pages.
+	uint32_t page = slots[position].firstPage;
+	while(page != NO_PAGE){
+		uint32_t next = links[page];
+		links[page] = shard->freePage;
+		shard->freePage = page;
+		shard->nbFree++;
+		page = next;
+	}
+
+	shard->nbEntries--;
+	shard->nbBytes -= slots[position].nbBytes;
+	shard->nbEvictions++;
+
+	//Shift back the slots which could not be placed at their first slot, until an unused slot.
+	size_t hole = position;
+	for(size_t next = (hole + 1) % nbSlots; slots[next].used; next = (next + 1) % nbSlots){
+		const CacheSlot* slot = &slots[next];
+		size_t home = (hash_key(slot->hash, slot->k, slot->engine) / cache->header->nbShards) % nbSlots;
+
+		//The slot may fill the hole if its first slot is not cyclically in ]hole, next].
+		bool movable = hole <= next ? (home <= hole || home > next) : (home <= hole && home > next);
+		if(movable){
+			slots[hole] = *slot;
+			hole = next;
+		}
+	}
+
+	slots[hole].used = false;
+
+	return;
+}//End evict_slot()
+
+static int open_segment(const char* name, int flags){
+	if(is_file_name(name))
+		return open(name, flags | O_CLOEXEC, 0600);
+
+	return shm_open(name, flags, 0600);
+}//End open_segment()
+
+static int initialise_segment(ResultCache* cache, const CacheHeader* layout){
+	CacheHeader* header = (CacheHeader*)cache->base;
+	*header = *layout;
+
+	pthread_mutexattr_t attributes;
+	pthread_mutexattr_init(&attributes);
+	pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+	pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+
+	int result = 0;
+
+	for(size_t s = 0; s < header->nbShards && result == 0; ++s){
+		CacheShard* shard = get_shard(cache, s);
+
+		memset(shard, 0, sizeof(CacheShard));
+		if(pthread_mutex_init(&shard->lock, &attributes) != 0)
+			result = -1;
+		else
+			reset_shard(cache, shard);
+	}
+
+	pthread_mutexattr_destroy(&attributes);
+
+	//The processes opening the segment wait for the magic number.
+	if(result == 0)
+		__atomic_store_n(&header->magic, CACHE_MAGIC, __ATOMIC_RELEASE);
+
+	return result;
+}//End initialise_segment()
+
+ResultCache* openResultCache(const char* name, size_t size){
+	if(!name)
+		return NULL;
+
+	CacheHeader layout;
+	if(compute_layout(&layout, size) < 0)
+		return NULL;
+
+	ResultCache* cache = malloc(sizeof(ResultCache));
+	if(!cache)
+		return NULL;
+
+	//The creator is the process whose exclusive creation succeeds.
+	bool created = true;
+	int fd = open_segment(name, O_RDWR | O_CREAT | O_EXCL);
+	if(fd < 0 && errno == EEXIST){
+		created = false;
+		fd = open_segment(name, O_RDWR);
+	}
+
+	if(fd < 0){
+		free(cache);
+		return NULL;
+	}
+
+	if(created){
+		if(ftruncate(fd, (off_t)layout.size) != 0 ||
+		   (cache->base = mmap(NULL, layout.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED){
+			close(fd);
+			removeResultCache(name);
+			free(cache);
+			return NULL;
+		}
+
+		cache->size = layout.size;
+		cache->header = (const CacheHeader*)cache->base;
+
+		if(initialise_segment(cache, &layout) < 0){
+			close(fd);
+			munmap(cache->base, cache->size);
+			removeResultCache(name);
+			free(cache);
+			return NULL;
+		}
+
+		close(fd);
+		return cache;
+	}
+
+	//Wait for the creator to size and initialise the segment.
+	for(size_t waited = 0; ; waited += 10){
+		struct stat status;
+		cache->base = MAP_FAILED;
+
+		if(fstat(fd, &status) == 0 && (size_t)status.st_size >= sizeof(CacheHeader)){
+			cache->size = (size_t)status.st_size;
+			cache->base = mmap(NULL, cache->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		}
+
+		if(cache->base != MAP_FAILED){
+			const CacheHeader* header = (const CacheHeader*)cache->base;
+
+			if(__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) == CACHE_MAGIC && header->size == cache->size)
+				break;
+
+			munmap(cache->base, cache->size);
+		}
+
+		if(waited >= OPEN_TIMEOUT){
+			close(fd);
+			free(cache);
+			return NULL;
+		}
+
+		struct timespec delay = {0, 10 * 1000 * 1000};
+		nanosleep(&delay, NULL);
+	}
+
+	close(fd);
+	cache->header = (const CacheHeader*)cache->base;
+
+	return cache;
+}//End openResultCache()
+
+PNMImage* getCachedResult(ResultCache* cache, unsigned long long hash, unsigned long long check, size_t width,
+                          size_t height, size_t k, SlimmingEngine engine){
+	if(!cache || k >= width)
+		return NULL;
+
+	unsigned long long keyHash = hash_key(hash, k, (int)engine);
+	CacheShard* shard = get_shard(cache, keyHash % cache->header->nbShards);
+
+	if(lock_shard(cache, shard) < 0)
+		return NULL;
+
+	CacheSlot* slot = &get_slots(shard)[find_slot(cache, shard, keyHash, hash, check, width, height, k, (int)engine)];
+	PNMImage* result = NULL;
+
+	if(!slot->used)
+		shard->nbMisses++;
+	else if((result = createPNM(width - k, height)) != NULL){
+		const uint32_t* links = get_links(cache, shard);
+		unsigned char* data = (unsigned char*)result->data;
+
+		for(uint32_t page = slot->firstPage; page != NO_PAGE; page = links[page]){
+			size_t size = slot->nbBytes - (size_t)(data - (unsigned char*)result->data);
+			memcpy(data, get_page(cache, shard, page), size < CACHE_PAGE_SIZE ? size : CACHE_PAGE_SIZE);
+			data += CACHE_PAGE_SIZE;
+		}
+
+		slot->referenced = true;
+		shard->nbHits++;
+	}
+
+	pthread_mutex_unlock(&shard->lock);
+
+	return result;
+}//End getCachedResult()
+
+int putCachedResult(ResultCache* cache, unsigned long long hash, unsigned long long check, size_t width, size_t k,
+                    SlimmingEngine engine, const PNMImage* result){
+	if(!cache || !result || result->width + k != width)
+		return -1;
+
+	size_t nbBytes = sizeof(PNMPixel) * result->width * result->height;
+	size_t nbPages = (nbBytes + CACHE_PAGE_SIZE - 1) / CACHE_PAGE_SIZE;
+	if(nbPages == 0 || nbPages > cache->header->nbPages / 2)
+		return -1;
+
+	unsigned long long keyHash = hash_key(hash, k, (int)engine);
+	CacheShard* shard = get_shard(cache, keyHash % cache->header->nbShards);
+
+	if(lock_shard(cache, shard) < 0)
+		return -2;
+
+	CacheSlot* slots = get_slots(shard);
+	uint32_t* links = get_links(cache, shard);
+	size_t nbSlots = cache->header->nbSlots;
+
+	if(slots[find_slot(cache, shard, keyHash, hash, check, width, result->height, k, (int)engine)].used){
+		pthread_mutex_unlock(&shard->lock);
+		return 0;
+	}
+
+	//CLOCK: the hand evicts the first result not read since it last passed.
+	while(shard->nbFree < nbPages){
+		CacheSlot* slot = &slots[shard->hand];
+
+		if(slot->used && !slot->referenced){
+			//A following slot may be shifted into this one: the hand stays.
+			evict_slot(cache, shard, shard->hand);
+			continue;
+		}
+
+		slot->referenced = false;
+		shard->hand = (shard->hand + 1) % nbSlots;
+	}
+
+	//Copy the result into a chain of free pages.
+	const unsigned char* data = (const unsigned char*)result->data;
+	uint32_t firstPage = shard->freePage;
+	uint32_t lastPage = NO_PAGE;
+
+	for(size_t p = 0; p < nbPages; ++p){
+		lastPage = shard->freePage;
+		shard->freePage = links[lastPage];
+
+		size_t size = nbBytes - p * CACHE_PAGE_SIZE;
+		memcpy(get_page(cache, shard, lastPage), data + p * CACHE_PAGE_SIZE,
+		       size < CACHE_PAGE_SIZE ? size : CACHE_PAGE_SIZE);
+	}
+
+	links[lastPage] = NO_PAGE;
+	shard->nbFree -= nbPages;
+
+	//The evictions may have moved the slots: the key is looked up again.
+	CacheSlot* slot = &slots[find_slot(cache, shard, keyHash, hash, check, width, result->height, k, (int)engine)];
+	slot->hash = hash;
+	slot->check = check;
+	slot->width = width;
+	slot->height = result->height;
+	slot->k = k;
+	slot->engine = (int)engine;
+	slot->used = true;
+	slot->referenced = false;
+	slot->nbBytes = nbBytes;
+	slot->firstPage = firstPage;
+
+	shard->nbEntries++;
+	shard->nbBytes += nbBytes;
+	shard->nbInsertions++;
+
+	pthread_mutex_unlock(&shard->lock);
+
+	return 0;
+}//End putCachedResult()
+
+void getResultCacheStats(ResultCache* cache, ResultCacheStats* stats){
+	if(!stats)
+		return;
+
+	memset(stats, 0, sizeof(ResultCacheStats));
+	if(!cache)
+		return;
+
+	for(size_t s = 0; s < cache->header->nbShards; ++s){
+		CacheShard* shard = get_shard(cache, s);
+
+		if(lock_shard(cache, shard) < 0)
+			continue;
+
+		stats->nbHits += shard->nbHits;
+		stats->nbMisses += shard->nbMisses;
+		stats->nbInsertions += shard->nbInsertions;
+		stats->nbEvictions += shard->nbEvictions;
+		stats->nbEntries += shard->nbEntries;
+		stats->nbBytes += shard->nbBytes;
+
+		pthread_mutex_unlock(&shard->lock);
+	}
+
+	stats->capacity = cache->header->nbShards * cache->header->nbPages * CACHE_PAGE_SIZE;
+
+	return;
+}//End getResultCacheStats()
+
+void closeResultCache(ResultCache* cache){
+
+	if(cache){
+		munmap(cache->base, cache->size);
+		free(cache);
+	}
+
+	return;
+}//End closeResultCache()
+
+int removeResultCache(const char* name){
+	if(!name)
+		return -1;
+
+	if(is_file_name(name))
+		return unlink(name) == 0 ? 0 : -1;
+
+	return shm_unlink(name) == 0 ? 0 : -1;
+}//End removeResultCache()
@@ -0,0 +1,136 @@
+/* ------------------------------------------------------------------------- *
+ * Interface for a result cache shared by the processes of a host.
+ *
+ * The cache maps (hash of the input image, k, engine) to the reduced image.
+ * A result is only served if the size of the input image and a second hash
+ * of it match too, so that a collision of the hashes is not taken for a hit.
+ * It lives in a POSIX shared memory segment (or a memory-mapped file), so
+ * that any local process slimming the same image by the same number of
+ * pixels serves it with a copy instead of a reduction.
+ *
+ * The segment is split into shards, selected by the hash of the key, each
+ * one protected by its own (robust, process-shared) mutex. The results are
+ * stored in fixed-size pages; when a shard is full, entries are evicted with
+ * the CLOCK algorithm (an entry read since the hand last passed gets a
+ * second chance).
+ * ------------------------------------------------------------------------- */
+
+#ifndef _RESULT_CACHE_H_
+#define _RESULT_CACHE_H_
+
+#include <stddef.h>
+
+#include "PNM.h"
+#include "slimming.h"
+
+// Types ----------------------------------------------------------------------
+
+//Counters of a cache, shared by every process using it.
+typedef struct ResultCacheStats_t{
+    size_t nbHits;          //Number of lookups that found their result.
+    size_t nbMisses;        //Number of lookups that did not.
+    size_t nbInsertions;    //Number of results stored.
+    size_t nbEvictions;     //Number of results evicted to make room.
+    size_t nbEntries;       //Number of results currently stored.
+    size_t nbBytes;         //Size of the results currently stored (in bytes).
+    size_t capacity;        //Size of the pages storing the results (in bytes).
+}ResultCacheStats;
+
+typedef struct ResultCache_t ResultCache;
+
+
+// Methods --------------------------------------------------------------------
+
+/* ------------------------------------------------------------------------- *
+ * Open a cache, creating it if it does not exist yet.
+ * The cache must later be closed by calling closeResultCache().
+ *
+ * A name containing no '/' but a leading one (such as "/slimming") names a
+ * POSIX shared memory segment; any other name is the path to a file mapped
+ * in memory (which survives a reboot). An existing cache keeps its size.
+ *
+ * PARAMETERS
+ * name         Name of the shared memory segment, or path to the file
+ * size         Size of the cache to create (in bytes, at least 1 MiB)
+ *
+ * RETURN
+ * cache        Pointer to the cache
+ * NULL         if an error occured
+ * ------------------------------------------------------------------------- */
+ResultCache* openResultCache(const char* name, size_t size);
+
+/* ------------------------------------------------------------------------- *
+ * Look for the result of the reduction of an image.
+ *
+ * The PNM image must later be deleted by calling freePNM().
+ *
+ * PARAMETERS
+ * cache        Pointer to the cache
+ * hash         Hash of the input image (its width and height included)
+ * check        Second hash of the input image, computed differently
+ * width        Width of the input image
+ * height       Height of the input image
+ * k            The number of pixels removed
+ * engine       The engine of the reduction
+ *
+ * RETURN
+ * image        Pointer to a new PNM image holding the cached result
+ * NULL         if the result is not cached (or an allocation failed)
+ * ------------------------------------------------------------------------- */
+PNMImage* getCachedResult(ResultCache* cache, unsigned long long hash,
+                          unsigned long long check, size_t width,
+                          size_t height, size_t k, SlimmingEngine engine);
+
+/* ------------------------------------------------------------------------- *
+ * Store the result of the reduction of an image, evicting older results if
+ * needed. A result larger than half a shard is not stored.
+ *
+ * PARAMETERS
+ * cache        Pointer to the cache
+ * hash         Hash of the input image (its width and height included)
+ * check        Second hash of the input image, computed differently
+ * width        Width of the input image
+ * k            The number of pixels removed
+ * engine       The engine of the reduction
+ * result       The reduced image (`width - k` pixels wide)
+ *
+ * RETURN
+ * 0            In case of success (or if the result was already stored)
+ * -1           if the result is too large to be stored
+ * -2           if the shard could not be locked
+ * ------------------------------------------------------------------------- */
+int putCachedResult(ResultCache* cache, unsigned long long hash,
+                    unsigned long long check, size_t width, size_t k,
+                    SlimmingEngine engine, const PNMImage* result);
+
+/* ------------------------------------------------------------------------- *
+ * Give the counters of a cache (summed over its shards).
+ *
+ * PARAMETERS
+ * cache        Pointer to the cache
+ * stats        Pointer to the counters to fill
+ * ------------------------------------------------------------------------- */
+void getResultCacheStats(ResultCache* cache, ResultCacheStats* stats);
+
+/* ------------------------------------------------------------------------- *
+ * Unmap a cache. The cache itself remains for the other processes.
+ *
+ * PARAMETERS
+ * cache        Pointer to the cache
+ * ------------------------------------------------------------------------- */
+void closeResultCache(ResultCache* cache);
+
+/* ------------------------------------------------------------------------- *
+ * Remove a cache (the processes which opened it keep using it until they
+ * close it).
+ *
+ * PARAMETERS
+ * name         Name of the shared memory segment, or path to the file
+ *
+ * RETURN
+ * 0            In case of success
+ * -1           Otherwise
+ * ------------------------------------------------------------------------- */
+int removeResultCache(const char* name);
+
+#endif // _RESULT_CACHE_H_
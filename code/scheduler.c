@@ -0,0 +1,1396 @@
+/* ------------------------------------------------------------------------- *
+ * Implementation of the scheduler interface.
+ * ------------------------------------------------------------------------- */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "scheduler.h"
+#include "slimmingBatch.h"
+#include "PNM.h"
+#include "timing.h"
+
+/* ------------------------------------------------------------------------- *
+ *
+ * STRUCTURES
+ *
+ * ------------------------------------------------------------------------- */
+
+//Number of buckets of the latency histograms (besides the unbounded one).
+#define NB_LATENCY_BUCKETS 14
+
+//Structure representing a job waiting in (or taken from) the queue.
+typedef struct Job_t{
+	char *input, *output; //Paths to the input and output PNM files.
+	char *temporary; //Path to the hidden file the output is written to, then renamed into place.
+	size_t k; //Number of pixels to remove.
+	size_t width, height; //Size of the input image.
+	SlimmingEngine engine; //Engine performing the reduction.
+	SizeClass sizeClass; //Size class of the input image.
+	double submitTime; //Time at which the job was queued.
+	double priority; //Expected duration minus aging * waiting time, up to a constant (smallest first).
+	unsigned long sequence; //Submission order, used to break ties.
+	size_t nbThreads; //Number of threads the reduction could use.
+	bool hashed; //True if the input image is hashed (to be recorded, kept if slow or cached).
+	unsigned long long hash; //Hash of the input image (if hashed and loaded).
+	unsigned long long check; //Second hash of the input image, checked by the cache against collisions of 'hash'.
+	SlimmingStats stats; //Measures of the reduction (zero if the image was not reduced).
+}Job;
+
+//Structure representing an input kept as one of the slowest ones.
+typedef struct SlowInput_t{
+	double serviceTime; //Time spent running its job.
+	unsigned long long hash; //Hash of the input image, which names the copy.
+}SlowInput;
+
+//Structure representing a growing set of measures.
+typedef struct Samples_t{
+	double *values; //The measures.
+	size_t size, capacity; //Number of measures, and number of measures that fit in 'values'.
+}Samples;
+
+struct Scheduler_t{
+	pthread_mutex_t lock; //Protects every field below.
+	pthread_cond_t wakeWorkers; //Signaled when a job is queued or threads are released.
+	pthread_cond_t jobsDone; //Signaled when no job is queued nor running anymore.
+
+	Job **queue; //Binary heap of the queued jobs, ordered by priority.
+	size_t queueSize, queueCapacity; //Number of queued jobs, and number of jobs that fit in 'queue'.
+
+	pthread_t *workers; //The workers.
+	size_t nbWorkers; //Number of workers, which is also the number of available cores.
+	size_t threadsInUse; //Number of threads used by the running jobs.
+
+	size_t ioBatchSize; //Maximal number of small jobs run as a group.
+	BatchIOBackend ioBackend; //Backend performing the input/output of the groups.
+	BatchIOStats ioStats; //Cumulated measures of the input/output of the groups.
+
+	size_t nbUnfinished; //Number of queued or running jobs.
+	size_t nbFailed; //Number of jobs that failed.
+	size_t nbDone; //Number of jobs finished (succeeded or failed).
+	double startTime; //Time at which the scheduler was created.
+	unsigned long nextSequence; //Sequence number of the next submitted job.
+	double aging; //Priority gained per second of waiting.
+	bool stopping; //True once the workers must stop after the queue is empty.
+
+	Samples waitTimes[NB_SIZE_CLASSES]; //Time spent in the queue, by size class.
+	Samples serviceTimes[NB_SIZE_CLASSES]; //Time spent running, by size class.
+
+	SlimmingStats reductionStats; //Cumulated measures of the reductions of the finished jobs.
+	size_t nbPixels; //Number of pixels of the input images of the finished jobs.
+	double busySeconds; //Time spent running jobs, multiplied by the number of threads they used.
+	size_t latencyCounts[NB_SIZE_CLASSES][NB_LATENCY_BUCKETS + 1]; //Finished jobs per latency bucket (the last one unbounded).
+	double latencySums[NB_SIZE_CLASSES]; //Sum of the latencies (wait and service times) of the finished jobs.
+
+	FILE *record; //Stream on which each finished job is recorded (or NULL).
+	char *slowDir; //Directory receiving copies of the slowest inputs (or NULL).
+	pthread_mutex_t slowLock; //Protects the fields below (held while copying an input).
+	SlowInput *slowest; //The slowest inputs kept.
+	size_t nbSlowest, nbKept; //Number of slowest inputs to keep, and number kept.
+
+	ResultCache *cache; //Cache of the results shared with the other processes (or NULL).
+};
+
+//Maximal number of small jobs run as a group.
+#define MAX_IO_BATCH_SIZE 256
+
+//Structure representing the idle cores lent to a large job, given back once its reduction runs on a
+//single thread.
+typedef struct ThreadLoan_t{
+	Scheduler *scheduler; //The scheduler owning the cores.
+	size_t nbThreads; //Number of threads still lent.
+	double startTime; //Time at which they were lent.
+}ThreadLoan;
+
+//Names of the size classes in the reports.
+static const char* SIZE_CLASS_NAMES[NB_SIZE_CLASSES] = {"small", "medium", "large"};
+
+//Upper bounds of the buckets of the latency histograms (in seconds).
+static const double LATENCY_BUCKETS[NB_LATENCY_BUCKETS] = {0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5,
+                                                           1, 2.5, 5, 10, 30, 60, 120};
+
+/* ------------------------------------------------------------------------- *
+ *
+ * PROTOTYPES OF STATIC FUNCTIONS
+ *
+ * ------------------------------------------------------------------------- */
+
+/* ------------------------------------------------------------------------- *
+ * Tell whether job 'a' must run before job 'b'.
+ *
+ * PARAMETERS
+ * a, b         the jobs to compare
+ *
+ * RETURN
+ * true if 'a' has the smallest priority (or was submitted first in case of
+ * equality), false otherwise.
+ * ------------------------------------------------------------------------- */
+static bool runs_before(const Job* a, const Job* b);
+
+/* ------------------------------------------------------------------------- *
+ * Insert a job in the queue.
+ *
+ * PARAMETERS
+ * scheduler    the scheduler
+ * job          the job to insert
+ *
+ * RETURN
+ * 0, the job was inserted.
+ * -1, the queue could not be enlarged.
+ * ------------------------------------------------------------------------- */
+static int push_job(Scheduler* scheduler, Job* job);
+
+/* ------------------------------------------------------------------------- *
+ * Remove the job which must run first from the (non empty) queue.
+ *
+ * PARAMETERS
+ * scheduler    the scheduler
+ *
+ * RETURN
+ * job, the removed job.
+ * ------------------------------------------------------------------------- */
+static Job* pop_job(Scheduler* scheduler);
+
+/* ------------------------------------------------------------------------- *
+ * Free the memory of a job.
+ *
+ * PARAMETERS
+ * job          the job we want to free
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void destroy_job(Job* job);
+
+/* ------------------------------------------------------------------------- *
+ * Give the path of the temporary file of an output: the same name, hidden
+ * and ending with ".part", in the same directory (so that it can be renamed
+ * atomically).
+ *
+ * PARAMETERS
+ * output       the path to the output file
+ *
+ * NOTE
+ * The returned pointer should be freed after usage.
+ *
+ * RETURN
+ * temporary, the path to the temporary file.
+ * NULL, not enough memory.
+ * ------------------------------------------------------------------------- */
+static char* temporary_path(const char* output);
+
+/* ------------------------------------------------------------------------- *
+ * Move the temporary file of a written output into place.
+ *
+ * PARAMETERS
+ * job          the job whose output was written
+ *
+ * RETURN
+ * 0, the output is in place.
+ * -1, the temporary file could not be renamed (it is removed).
+ * ------------------------------------------------------------------------- */
+static int publish_output(const Job* job);
+
+/* ------------------------------------------------------------------------- *
+ * Compute the hash (64 bits FNV-1a) of the size and pixels of an image, and
+ * a second hash of its pixels computed differently (multiply and shift), so
+ * that the cache does not take two images whose hashes collide for the same.
+ *
+ * PARAMETERS
+ * image        the image
+ * check        where to store the second hash
+ *
+ * RETURN
+ * the hash of the image.
+ * ------------------------------------------------------------------------- */
+static unsigned long long hash_image(const PNMImage* image, unsigned long long* check);
+
+/* ------------------------------------------------------------------------- *
+ * Copy a file.
+ *
+ * PARAMETERS
+ * source       the path to the file to copy
+ * destination  the path to the copy
+ *
+ * RETURN
+ * 0, the file was copied.
+ * -1, otherwise (the copy is removed).
+ * ------------------------------------------------------------------------- */
+static int copy_file(const char* source, const char* destination);
+
+/* ------------------------------------------------------------------------- *
+ * Keep a copy of the input of a job if it is one of the slowest ones, the
+ * copy of the fastest kept input being removed if there are too many.
+ *
+ * PARAMETERS
+ * scheduler    the scheduler
+ * job          the job, run successfully
+ * serviceTime  the time spent running the job
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void keep_slow_input(Scheduler* scheduler, const Job* job, double serviceTime);
+
+/* ------------------------------------------------------------------------- *
+ * Load the input image of a job, reduce it and write the result.
+ * The result is written to a temporary file, renamed once complete.
+ * The input image is hashed if needed. If a cache is given, the result is
+ * taken from it if possible, and stored into it otherwise.
+ *
+ * PARAMETERS
+ * job          the job to run
+ * nbThreads    the number of threads the reduction may use
+ * cache        the cache of the results (or NULL)
+ * context      the buffers of the reduction, kept by the worker (or NULL)
+ * loan         the threads beyond the first one, given back once the
+ *              reduction no longer uses them (or NULL)
+ *
+ * RETURN
+ * 0, the job succeeded.
+ * -1, the input image could not be loaded.
+ * -2, the reduction failed.
+ * -3, the output image could not be written.
+ * ------------------------------------------------------------------------- */
+static int run_job(Job* job, size_t nbThreads, ResultCache* cache, SlimmingContext* context, ThreadLoan* loan);
+
+/* ------------------------------------------------------------------------- *
+ * Give the threads lent to a job back to the scheduler, as
+ * SlimmingOptions.parallelDone, and wake the workers waiting for them.
+ *
+ * PARAMETERS
+ * context      the ThreadLoan
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void return_thread_loan(void* context);
+
+/* ------------------------------------------------------------------------- *
+ * Load the input images of a group of jobs in a batch, reduce them and
+ * write the results in a batch. The images of the same size, reduced by the
+ * same number of pixels, are reduced in lockstep by reduceImagesWidth().
+ * The results found in the cache are not reduced.
+ *
+ * PARAMETERS
+ * jobs         the jobs of the group
+ * nbJobs       the number of jobs
+ * backend      the backend performing the batched input/output
+ * cache        the cache of the results (or NULL)
+ * context      the buffers of the reductions, kept by the worker (or NULL)
+ * results      array receiving the result of each job, as run_job()
+ * serviceTimes array receiving the time spent on each job (the time spent
+ *              in input/output is shared equally)
+ * ioStats      the measures of input/output, increased by the ones of the
+ *              two batches
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void run_job_group(Job** jobs, size_t nbJobs, BatchIOBackend backend, ResultCache* cache,
+                          SlimmingContext* context, int* results, double* serviceTimes, BatchIOStats* ioStats);
+
+/* ------------------------------------------------------------------------- *
+ * Add the measures of a batch to cumulated measures.
+ *
+ * PARAMETERS
+ * total        the cumulated measures
+ * batch        the measures of a batch
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void add_io_stats(BatchIOStats* total, const BatchIOStats* batch);
+
+/* ------------------------------------------------------------------------- *
+ * Add the measures of a reduction to cumulated measures.
+ *
+ * PARAMETERS
+ * total        the cumulated measures
+ * stats        the measures of a reduction
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void add_slimming_stats(SlimmingStats* total, const SlimmingStats* stats);
+
+/* ------------------------------------------------------------------------- *
+ * Routine of the workers: run jobs until the scheduler stops.
+ *
+ * PARAMETERS
+ * argument     pointer to the scheduler
+ *
+ * RETURN
+ * NULL
+ * ------------------------------------------------------------------------- */
+static void* worker_routine(void* argument);
+
+/* ------------------------------------------------------------------------- *
+ * Add a measure to a set of measures.
+ *
+ * PARAMETERS
+ * samples      the set of measures
+ * value        the measure to add
+ *
+ * RETURN
+ * 0, the measure was added.
+ * -1, the set could not be enlarged.
+ * ------------------------------------------------------------------------- */
+static int add_sample(Samples* samples, double value);
+
+/* ------------------------------------------------------------------------- *
+ * Give a percentile of a set of measures (nearest-rank method).
+ *
+ * PARAMETERS
+ * sorted       the measures, in increasing order
+ * size         the number of measures (> 0)
+ * percent      the percentile to compute (in ]0, 100])
+ *
+ * RETURN
+ * the percentile.
+ * ------------------------------------------------------------------------- */
+static double percentile(const double* sorted, size_t size, double percent);
+
+/* ------------------------------------------------------------------------- *
+ * Compare two doubles, for qsort().
+ *
+ * PARAMETERS
+ * a, b         pointers to the doubles to compare
+ *
+ * RETURN
+ * < 0, = 0 or > 0 if *a is smaller than, equal to or greater than *b.
+ * ------------------------------------------------------------------------- */
+static int compare_doubles(const void* a, const void* b);
+
+/* ------------------------------------------------------------------------- *
+ *
+ * IMPLEMENTATION
+ *
+ * ------------------------------------------------------------------------- */
+
+static bool runs_before(const Job* a, const Job* b){
+	if(a->priority != b->priority)
+		return a->priority < b->priority;
+
+	return a->sequence < b->sequence;
+}//End runs_before()
+
+static int push_job(Scheduler* scheduler, Job* job){
+	if(scheduler->queueSize == scheduler->queueCapacity){
+		size_t nCapacity = scheduler->queueCapacity ? 2 * scheduler->queueCapacity : 64;
+
+		Job** nQueue = realloc(scheduler->queue, sizeof(Job*) * nCapacity);
+		if(!nQueue)
+			return -1;
+
+		scheduler->queue = nQueue;
+		scheduler->queueCapacity = nCapacity;
+	}
+
+	//Sift up.
+	size_t position = scheduler->queueSize++;
+
+	while(position > 0 && runs_before(job, scheduler->queue[(position - 1) / 2])){
+		scheduler->queue[position] = scheduler->queue[(position - 1) / 2];
+		position = (position - 1) / 2;
+	}
+
+	scheduler->queue[position] = job;
+
+	return 0;
+}//End push_job()
+
+static Job* pop_job(Scheduler* scheduler){
+	Job* first = scheduler->queue[0];
+	Job* last = scheduler->queue[--scheduler->queueSize];
+
+	//Sift down.
+	size_t position = 0;
+	size_t child;
+
+	while((child = 2 * position + 1) < scheduler->queueSize){
+		if(child + 1 < scheduler->queueSize && runs_before(scheduler->queue[child + 1], scheduler->queue[child]))
+			++child;
+
+		if(!runs_before(scheduler->queue[child], last))
+			break;
+
+		scheduler->queue[position] = scheduler->queue[child];
+		position = child;
+	}
+
+	if(scheduler->queueSize > 0)
+		scheduler->queue[position] = last;
+
+	return first;
+}//End pop_job()
+
+static void destroy_job(Job* job){
+
+	if(job){
+		free(job->input);
+		free(job->output);
+		free(job->temporary);
+		free(job);
+	}
+
+	return;
+}//End destroy_job()
+
+static char* temporary_path(const char* output){
+	const char* separator = strrchr(output, '/');
+	size_t directoryLength = separator ? (size_t)(separator - output) + 1 : 0;
+
+	char* temporary = malloc(strlen(output) + sizeof(".") + sizeof(".part") - 1);
+	if(!temporary)
+		return NULL;
+
+	memcpy(temporary, output, directoryLength);
+	sprintf(temporary + directoryLength, ".%s.part", output + directoryLength);
+
+	return temporary;
+}//End temporary_path()
+
+static int publish_output(const Job* job){
+	if(rename(job->temporary, job->output) != 0){
+		remove(job->temporary);
+		return -1;
+	}
+
+	return 0;
+}//End publish_output()
+
+static unsigned long long hash_image(const PNMImage* image, unsigned long long* check){
+	unsigned long long hash = 14695981039346656037ULL;
+	unsigned long long second = 0x9e3779b97f4a7c15ULL;
+	const unsigned char* bytes = (const unsigned char*)image->data;
+	size_t size = 3 * image->width * image->height;
+
+	hash = (hash ^ image->width) * 1099511628211ULL;
+	hash = (hash ^ image->height) * 1099511628211ULL;
+
+	for(size_t i = 0; i < size; ++i){
+		hash = (hash ^ bytes[i]) * 1099511628211ULL;
+		second = (second + bytes[i]) * 0xbf58476d1ce4e5b9ULL;
+		second ^= second >> 31;
+	}
+
+	*check = second;
+	return hash;
+}//End hash_image()
+
+static int copy_file(const char* source, const char* destination){
+	FILE* input = fopen(source, "rb");
+	if(!input)
+		return -1;
+
+	FILE* output = fopen(destination, "wb");
+	if(!output){
+		fclose(input);
+		return -1;
+	}
+
+	char buffer[65536];
+	size_t size;
+	bool failed = false;
+
+	while(!failed && (size = fread(buffer, 1, sizeof(buffer), input)) > 0)
+		failed = fwrite(buffer, 1, size, output) != size;
+
+	failed = failed || ferror(input);
+	fclose(input);
+
+	if(fclose(output) != 0 || failed){
+		remove(destination);
+		return -1;
+	}
+
+	return 0;
+}//End copy_file()
+
+static void keep_slow_input(Scheduler* scheduler, const Job* job, double serviceTime){
+	char path[4096];
+
+	pthread_mutex_lock(&scheduler->slowLock);
+
+	//The input replaces the fastest kept one, unless there is room left (or it is already kept).
+	size_t slot = scheduler->nbKept;
+	for(size_t i = 0; i < scheduler->nbKept; ++i){
+		if(scheduler->slowest[i].hash == job->hash){
+			slot = i;
+			break;
+		}
+		if(scheduler->nbKept == scheduler->nbSlowest &&
+		   (slot == scheduler->nbKept || scheduler->slowest[i].serviceTime < scheduler->slowest[slot].serviceTime))
+			slot = i;
+	}
+
+	if(slot < scheduler->nbKept && scheduler->slowest[slot].serviceTime >= serviceTime){
+		pthread_mutex_unlock(&scheduler->slowLock);
+		return;
+	}
+
+	if(slot < scheduler->nbKept && scheduler->slowest[slot].hash != job->hash){
+		snprintf(path, sizeof(path), "%s/%016llx.pnm", scheduler->slowDir, scheduler->slowest[slot].hash);
+		remove(path);
+	}
+
+	snprintf(path, sizeof(path), "%s/%016llx.pnm", scheduler->slowDir, job->hash);
+
+	if(copy_file(job->input, path) == 0){
+		if(slot == scheduler->nbKept)
+			scheduler->nbKept++;
+
+		scheduler->slowest[slot].serviceTime = serviceTime;
+		scheduler->slowest[slot].hash = job->hash;
+	}
+	else if(slot < scheduler->nbKept){
+		//The copy it replaced is gone.
+		scheduler->slowest[slot] = scheduler->slowest[--scheduler->nbKept];
+	}
+
+	pthread_mutex_unlock(&scheduler->slowLock);
+
+	return;
+}//End keep_slow_input()
+
+static int run_job(Job* job, size_t nbThreads, ResultCache* cache, SlimmingContext* context, ThreadLoan* loan){
+	PNMImage* image = readPNM(job->input);
+	if(!image)
+		return -1;
+
+	if(job->hashed)
+		job->hash = hash_image(image, &job->check);
+
+	PNMImage* reducedImage = getCachedResult(cache, job->hash, job->check, image->width, image->height, job->k,
+	                                         job->engine);
+
+	if(!reducedImage){
+		SlimmingOptions options;
+		initSlimmingOptions(&options);
+		options.engine = job->engine;
+		options.nbThreads = nbThreads;
+		options.stats = &job->stats;
+		options.context = context;
+		if(loan){
+			options.parallelDone = return_thread_loan;
+			options.parallelContext = loan;
+		}
+
+		reducedImage = reduceImageWidthWithOptions(image, job->k, &options);
+		if(reducedImage && cache)
+			putCachedResult(cache, job->hash, job->check, image->width, job->k, job->engine, reducedImage);
+	}
+
+	freePNM(image);
+	if(!reducedImage)
+		return -2;
+
+	int resultWrite = writePNM(job->temporary, reducedImage);
+	freePNM(reducedImage);
+	if(resultWrite < 0){
+		remove(job->temporary);
+		return -3;
+	}
+
+	if(publish_output(job) < 0)
+		return -3;
+
+	return 0;
+}//End run_job()
+
+static void return_thread_loan(void* context){
+	ThreadLoan* loan = context;
+	Scheduler* scheduler = loan->scheduler;
+
+	pthread_mutex_lock(&scheduler->lock);
+
+	scheduler->threadsInUse -= loan->nbThreads;
+	scheduler->busySeconds += (getTimeSeconds() - loan->startTime) * (double)loan->nbThreads;
+	loan->nbThreads = 0;
+	pthread_cond_broadcast(&scheduler->wakeWorkers);
+
+	pthread_mutex_unlock(&scheduler->lock);
+
+	return;
+}//End return_thread_loan()
+
+static void add_io_stats(BatchIOStats* total, const BatchIOStats* batch){
+	total->backend = batch->backend;
+	total->nbFiles += batch->nbFiles;
+	total->nbFailed += batch->nbFailed;
+	total->nbBytes += batch->nbBytes;
+	total->seconds += batch->seconds;
+
+	return;
+}//End add_io_stats()
+
+static void add_slimming_stats(SlimmingStats* total, const SlimmingStats* stats){
+	for(size_t p = 0; p < NB_SLIMMING_PHASES; ++p)
+		total->phaseSeconds[p] += stats->phaseSeconds[p];
+
+	total->totalSeconds += stats->totalSeconds;
+	total->nbGrooves += stats->nbGrooves;
+	total->nbUpdatedCells += stats->nbUpdatedCells;
+	total->nbSearchedCells += stats->nbSearchedCells;
+	total->nbBulkGrooves += stats->nbBulkGrooves;
+	total->nbRunGrooves += stats->nbRunGrooves;
+
+	return;
+}//End add_slimming_stats()
+
+static void run_job_group(Job** jobs, size_t nbJobs, BatchIOBackend backend, ResultCache* cache,
+                          SlimmingContext* context, int* results, double* serviceTimes, BatchIOStats* ioStats){
+	const char** filenames = malloc(sizeof(char*) * nbJobs);
+	PNMImage** images = malloc(sizeof(PNMImage*) * nbJobs);
+	PNMImage** reducedImages = calloc(nbJobs, sizeof(PNMImage*));
+	int* resultsWrite = malloc(sizeof(int) * nbJobs);
+
+	if(!filenames || !images || !reducedImages || !resultsWrite){
+		//Not enough memory to group the jobs, they are run one by one.
+		for(size_t i = 0; i < nbJobs; ++i){
+			double startTime = getTimeSeconds();
+			results[i] = run_job(jobs[i], 1, cache, context, NULL);
+			serviceTimes[i] = getTimeSeconds() - startTime;
+		}
+
+		free(filenames);
+		free(images);
+		free(reducedImages);
+		free(resultsWrite);
+		return;
+	}
+
+	BatchIOStats batchStats;
+
+	//Load every input.
+	for(size_t i = 0; i < nbJobs; ++i)
+		filenames[i] = jobs[i]->input;
+
+	loadPNMBatch(filenames, nbJobs, images, backend, &batchStats);
+	add_io_stats(ioStats, &batchStats);
+
+	for(size_t i = 0; i < nbJobs; ++i){
+		jobs[i]->nbThreads = 1;
+		if(jobs[i]->hashed && images[i])
+			jobs[i]->hash = hash_image(images[i], &jobs[i]->check);
+	}
+	double ioSeconds = batchStats.seconds;
+
+	//Reduce the images. The images of the same size, reduced by the same number of pixels
+	//with the exact engine, are reduced in lockstep (the time is shared equally).
+	SlimmingOptions options;
+	initSlimmingOptions(&options);
+	options.context = context;
+
+	bool reduced[MAX_IO_BATCH_SIZE] = {false};
+	const PNMImage* similarImages[MAX_IO_BATCH_SIZE];
+	PNMImage* similarResults[MAX_IO_BATCH_SIZE];
+	size_t similarJobs[MAX_IO_BATCH_SIZE];
+
+	//The results found in the cache are not reduced.
+	for(size_t i = 0; i < nbJobs && cache; ++i){
+		double startTime = getTimeSeconds();
+
+		if(images[i] && (reducedImages[i] = getCachedResult(cache, jobs[i]->hash, jobs[i]->check, images[i]->width,
+		                                                     images[i]->height, jobs[i]->k, jobs[i]->engine))){
+			results[i] = 0;
+			reduced[i] = true;
+			freePNM(images[i]);
+			serviceTimes[i] = getTimeSeconds() - startTime;
+		}
+	}
+
+	for(size_t i = 0; i < nbJobs; ++i){
+		if(reduced[i])
+			continue;
+
+		double startTime = getTimeSeconds();
+		size_t nbSimilar = 0;
+
+		if(images[i] && jobs[i]->engine == SLIMMING_ENGINE_EXACT){
+			for(size_t j = i; j < nbJobs; ++j){
+				if(!reduced[j] && images[j] && jobs[j]->engine == SLIMMING_ENGINE_EXACT && jobs[j]->k == jobs[i]->k &&
+				   images[j]->width == images[i]->width && images[j]->height == images[i]->height){
+					similarImages[nbSimilar] = images[j];
+					similarJobs[nbSimilar++] = j;
+				}
+			}
+		}
+
+		if(nbSimilar > 1){
+			//The measures of the lockstep reduction are given to its first job.
+			options.stats = &jobs[i]->stats;
+			int resultReduce = reduceImagesWidth(similarImages, nbSimilar, jobs[i]->k, similarResults, &options);
+			double serviceTime = (getTimeSeconds() - startTime) / nbSimilar;
+
+			for(size_t s = 0; s < nbSimilar; ++s){
+				size_t j = similarJobs[s];
+
+				reducedImages[j] = resultReduce < 0 ? NULL : similarResults[s];
+				results[j] = reducedImages[j] ? 0 : -2;
+				if(reducedImages[j] && cache)
+					putCachedResult(cache, jobs[j]->hash, jobs[j]->check, images[j]->width, jobs[j]->k,
+					                jobs[j]->engine, reducedImages[j]);
+				serviceTimes[j] = serviceTime;
+				reduced[j] = true;
+				freePNM(images[j]);
+			}
+			continue;
+		}
+
+		if(!images[i])
+			results[i] = -1;
+		else{
+			options.engine = jobs[i]->engine;
+			options.stats = &jobs[i]->stats;
+			reducedImages[i] = reduceImageWidthWithOptions(images[i], jobs[i]->k, &options);
+			results[i] = reducedImages[i] ? 0 : -2;
+			if(reducedImages[i] && cache)
+				putCachedResult(cache, jobs[i]->hash, jobs[i]->check, images[i]->width, jobs[i]->k,
+				                jobs[i]->engine, reducedImages[i]);
+			freePNM(images[i]);
+		}
+
+		reduced[i] = true;
+		serviceTimes[i] = getTimeSeconds() - startTime;
+	}
+
+	//Write every output, to the temporary files.
+	for(size_t i = 0; i < nbJobs; ++i)
+		filenames[i] = jobs[i]->temporary;
+
+	writePNMBatch(filenames, (const PNMImage* const*)reducedImages, nbJobs, resultsWrite, backend, &batchStats);
+
+	//The images which could not be reduced are not counted as failed writes, and leave no temporary file behind.
+	for(size_t i = 0; i < nbJobs; ++i){
+		if(!reducedImages[i]){
+			batchStats.nbFailed--;
+			remove(jobs[i]->temporary);
+		}
+		else if(resultsWrite[i] < 0){
+			remove(jobs[i]->temporary);
+			results[i] = -3;
+		}
+		else if(publish_output(jobs[i]) < 0)
+			results[i] = -3;
+	}
+
+	add_io_stats(ioStats, &batchStats);
+	ioSeconds += batchStats.seconds;
+
+	for(size_t i = 0; i < nbJobs; ++i){
+		serviceTimes[i] += ioSeconds / nbJobs;
+		freePNM(reducedImages[i]);
+	}
+
+	free(filenames);
+	free(images);
+	free(reducedImages);
+	free(resultsWrite);
+
+	return;
+}//End run_job_group()
+
+static void* worker_routine(void* argument){
+	Scheduler* scheduler = argument;
+
+	//Jobs of the group being run, with their results.
+	Job* group[MAX_IO_BATCH_SIZE];
+	int results[MAX_IO_BATCH_SIZE];
+	double serviceTimes[MAX_IO_BATCH_SIZE];
+
+	//Buffers of the reductions, sized to the largest image this worker reduced (without them, each
+	//reduction allocates its own).
+	SlimmingContext* context = createSlimmingContext();
+
+	pthread_mutex_lock(&scheduler->lock);
+
+	for(;;){
+		//Wait for a job, and for a free core to run it.
+		while((scheduler->queueSize == 0 && !scheduler->stopping) ||
+		      (scheduler->queueSize > 0 && scheduler->threadsInUse >= scheduler->nbWorkers))
+			pthread_cond_wait(&scheduler->wakeWorkers, &scheduler->lock);
+
+		if(scheduler->queueSize == 0)
+			break;
+
+		group[0] = pop_job(scheduler);
+		size_t nbJobs = 1;
+
+		//A large job also gets the idle cores, but only if no other job is waiting for them, and only
+		//while it computes its energies: they are then given back to the jobs queued meanwhile.
+		size_t nbThreads = 1;
+		if(group[0]->sizeClass == SIZE_CLASS_LARGE && scheduler->queueSize == 0)
+			nbThreads = scheduler->nbWorkers - scheduler->threadsInUse;
+
+		//Small jobs following a small job in the queue are run with it, as a group.
+		if(group[0]->sizeClass == SIZE_CLASS_SMALL){
+			while(nbJobs < scheduler->ioBatchSize && scheduler->queueSize > 0 &&
+			      scheduler->queue[0]->sizeClass == SIZE_CLASS_SMALL)
+				group[nbJobs++] = pop_job(scheduler);
+		}
+
+		scheduler->threadsInUse += nbThreads;
+		BatchIOBackend ioBackend = scheduler->ioBackend;
+		ResultCache* cache = scheduler->cache;
+
+		pthread_mutex_unlock(&scheduler->lock);
+
+		double startTime = getTimeSeconds();
+		BatchIOStats ioStats;
+		memset(&ioStats, 0, sizeof(ioStats));
+
+		if(nbJobs > 1)
+			run_job_group(group, nbJobs, ioBackend, cache, context, results, serviceTimes, &ioStats);
+		else{
+			ThreadLoan loan = {scheduler, nbThreads - 1, startTime};
+
+			group[0]->nbThreads = nbThreads;
+			results[0] = run_job(group[0], nbThreads, cache, context, nbThreads > 1 ? &loan : NULL);
+
+			//The threads are still lent if the reduction did not run (cached result, error).
+			if(loan.nbThreads > 0)
+				return_thread_loan(&loan);
+			serviceTimes[0] = getTimeSeconds() - startTime;
+		}
+
+		//The number of slowest inputs to keep is set before any job is submitted.
+		for(size_t i = 0; i < nbJobs && scheduler->nbSlowest > 0; ++i){
+			if(results[i] == 0)
+				keep_slow_input(scheduler, group[i], serviceTimes[i]);
+		}
+
+		double endTime = getTimeSeconds();
+
+		pthread_mutex_lock(&scheduler->lock);
+
+		scheduler->threadsInUse -= 1;
+		scheduler->busySeconds += endTime - startTime;
+		if(nbJobs > 1)
+			add_io_stats(&scheduler->ioStats, &ioStats);
+
+		for(size_t i = 0; i < nbJobs; ++i){
+			if(results[i] < 0){
+				fprintf(stderr, "Cannot slim '%s' into '%s'\n", group[i]->input, group[i]->output);
+				scheduler->nbFailed++;
+			}
+
+			add_sample(&scheduler->waitTimes[group[i]->sizeClass], startTime - group[i]->submitTime);
+			add_sample(&scheduler->serviceTimes[group[i]->sizeClass], serviceTimes[i]);
+
+			double latency = startTime - group[i]->submitTime + serviceTimes[i];
+			size_t bucket = 0;
+			while(bucket < NB_LATENCY_BUCKETS && latency > LATENCY_BUCKETS[bucket])
+				++bucket;
+
+			scheduler->latencyCounts[group[i]->sizeClass][bucket]++;
+			scheduler->latencySums[group[i]->sizeClass] += latency;
+			scheduler->nbPixels += group[i]->width * group[i]->height;
+			add_slimming_stats(&scheduler->reductionStats, &group[i]->stats);
+
+			if(scheduler->record){
+				//The input comes last, so that its path may hold spaces.
+				fprintf(scheduler->record, "%.6f %zu %zu %zu %s %zu %016llx %.6f %.6f %d %s\n",
+				        group[i]->submitTime - scheduler->startTime, group[i]->width, group[i]->height,
+				        group[i]->k, getSlimmingEngineName(group[i]->engine), group[i]->nbThreads,
+				        group[i]->hash, startTime - group[i]->submitTime, serviceTimes[i], results[i],
+				        group[i]->input);
+				fflush(scheduler->record);
+			}
+
+			destroy_job(group[i]);
+			scheduler->nbUnfinished--;
+			scheduler->nbDone++;
+		}
+
+		if(scheduler->nbUnfinished == 0)
+			pthread_cond_broadcast(&scheduler->jobsDone);
+
+		pthread_cond_broadcast(&scheduler->wakeWorkers);
+	}//End for()
+
+	pthread_mutex_unlock(&scheduler->lock);
+
+	destroySlimmingContext(context);
+
+	return NULL;
+}//End worker_routine()
+
+static int add_sample(Samples* samples, double value){
+	if(samples->size == samples->capacity){
+		size_t nCapacity = samples->capacity ? 2 * samples->capacity : 64;
+
+		double* nValues = realloc(samples->values, sizeof(double) * nCapacity);
+		if(!nValues)
+			return -1;
+
+		samples->values = nValues;
+		samples->capacity = nCapacity;
+	}
+
+	samples->values[samples->size++] = value;
+
+	return 0;
+}//End add_sample()
+
+static double percentile(const double* sorted, size_t size, double percent){
+	size_t rank = (size_t)ceil(percent / 100.0 * (double)size);
+
+	if(rank < 1)
+		rank = 1;
+	if(rank > size)
+		rank = size;
+
+	return sorted[rank - 1];
+}//End percentile()
+
+static int compare_doubles(const void* a, const void* b){
+	double first = *(const double*)a;
+	double second = *(const double*)b;
+
+	return (first > second) - (first < second);
+}//End compare_doubles()
+
+Scheduler* createScheduler(size_t nbWorkers, double aging){
+	if(nbWorkers < 1 || aging < 0)
+		return NULL;
+
+	Scheduler* scheduler = calloc(1, sizeof(Scheduler));
+	if(!scheduler)
+		return NULL;
+
+	scheduler->workers = malloc(sizeof(pthread_t) * nbWorkers);
+	if(!scheduler->workers){
+		free(scheduler);
+		return NULL;
+	}
+
+	scheduler->aging = aging;
+	scheduler->startTime = getTimeSeconds();
+	scheduler->ioBatchSize = 1;
+	scheduler->ioBackend = BATCH_IO_AUTO;
+
+	pthread_mutex_init(&scheduler->lock, NULL);
+	pthread_mutex_init(&scheduler->slowLock, NULL);
+	pthread_cond_init(&scheduler->wakeWorkers, NULL);
+	pthread_cond_init(&scheduler->jobsDone, NULL);
+
+	for(size_t i = 0; i < nbWorkers; ++i){
+		if(pthread_create(&scheduler->workers[i], NULL, worker_routine, scheduler) != 0)
+			break;
+		scheduler->nbWorkers++;
+	}
+
+	if(scheduler->nbWorkers == 0){
+		freeScheduler(scheduler);
+		return NULL;
+	}
+
+	return scheduler;
+}//End createScheduler()
+
+void setSchedulerIO(Scheduler* scheduler, size_t ioBatchSize, BatchIOBackend backend){
+	if(!scheduler)
+		return;
+
+	if(ioBatchSize < 1)
+		ioBatchSize = 1;
+	if(ioBatchSize > MAX_IO_BATCH_SIZE)
+		ioBatchSize = MAX_IO_BATCH_SIZE;
+
+	pthread_mutex_lock(&scheduler->lock);
+	scheduler->ioBatchSize = ioBatchSize;
+	scheduler->ioBackend = backend;
+	pthread_mutex_unlock(&scheduler->lock);
+
+	return;
+}//End setSchedulerIO()
+
+int setSchedulerRecord(Scheduler* scheduler, FILE* record, const char* slowDir, size_t nbSlowest){
+	if(!scheduler || (nbSlowest > 0 && !slowDir))
+		return -1;
+
+	char* nSlowDir = NULL;
+	SlowInput* nSlowest = NULL;
+
+	if(nbSlowest > 0){
+		nSlowDir = malloc(strlen(slowDir) + 1);
+		nSlowest = malloc(sizeof(SlowInput) * nbSlowest);
+		if(!nSlowDir || !nSlowest){
+			free(nSlowDir);
+			free(nSlowest);
+			return -1;
+		}
+
+		strcpy(nSlowDir, slowDir);
+	}
+
+	pthread_mutex_lock(&scheduler->lock);
+
+	scheduler->record = record;
+	if(record)
+		fprintf(record, "# offset width height k engine threads hash wait service result input\n");
+
+	pthread_mutex_unlock(&scheduler->lock);
+
+	pthread_mutex_lock(&scheduler->slowLock);
+
+	free(scheduler->slowDir);
+	free(scheduler->slowest);
+	scheduler->slowDir = nSlowDir;
+	scheduler->slowest = nSlowest;
+	scheduler->nbSlowest = nbSlowest;
+	scheduler->nbKept = 0;
+
+	pthread_mutex_unlock(&scheduler->slowLock);
+
+	return 0;
+}//End setSchedulerRecord()
+
+void setSchedulerCache(Scheduler* scheduler, ResultCache* cache){
+	if(!scheduler)
+		return;
+
+	pthread_mutex_lock(&scheduler->lock);
+	scheduler->cache = cache;
+	pthread_mutex_unlock(&scheduler->lock);
+
+	return;
+}//End setSchedulerCache()
+
+SizeClass getSizeClass(size_t width, size_t height){
+	double nbPixels = (double)width * (double)height;
+
+	if(nbPixels < 1e6)
+		return SIZE_CLASS_SMALL;
+	if(nbPixels < 16e6)
+		return SIZE_CLASS_MEDIUM;
+
+	return SIZE_CLASS_LARGE;
+}//End getSizeClass()
+
+int submitJob(Scheduler* scheduler, const char* input, const char* output, size_t k, SlimmingEngine engine){
+	if(!scheduler || !input || !output)
+		return -3;
+
+	size_t width, height;
+	if(readPNMHeader(input, &width, &height) < 0)
+		return -1;
+
+	if(k >= width)
+		return -2;
+
+	Job* job = calloc(1, sizeof(Job));
+	if(!job)
+		return -3;
+
+	job->input = malloc(strlen(input) + 1);
+	job->output = malloc(strlen(output) + 1);
+	job->temporary = temporary_path(output);
+	if(!job->input || !job->output || !job->temporary){
+		destroy_job(job);
+		return -3;
+	}
+
+	strcpy(job->input, input);
+	strcpy(job->output, output);
+	job->k = k;
+	job->width = width;
+	job->height = height;
+	job->engine = engine;
+	job->sizeClass = getSizeClass(width, height);
+	job->submitTime = getTimeSeconds();
+	job->nbThreads = 1;
+
+	/*
+	 Waiting w seconds lowers the priority by aging * w. As every queued job ages at the same
+	 rate, subtracting aging * submitTime instead keeps the order of the queue constant.
+	*/
+	job->priority = estimateReductionTime(width, height, k, engine) - scheduler->aging * job->submitTime;
+
+	pthread_mutex_lock(&scheduler->lock);
+
+	job->sequence = scheduler->nextSequence++;
+	job->hashed = scheduler->record != NULL || scheduler->nbSlowest > 0 || scheduler->cache != NULL;
+
+	if(push_job(scheduler, job) < 0){
+		pthread_mutex_unlock(&scheduler->lock);
+		destroy_job(job);
+		return -3;
+	}
+
+	scheduler->nbUnfinished++;
+	pthread_cond_signal(&scheduler->wakeWorkers);
+
+	pthread_mutex_unlock(&scheduler->lock);
+
+	return 0;
+}//End submitJob()
+
+size_t waitScheduler(Scheduler* scheduler){
+	if(!scheduler)
+		return 0;
+
+	pthread_mutex_lock(&scheduler->lock);
+
+	while(scheduler->nbUnfinished > 0)
+		pthread_cond_wait(&scheduler->jobsDone, &scheduler->lock);
+
+	size_t nbFailed = scheduler->nbFailed;
+
+	pthread_mutex_unlock(&scheduler->lock);
+
+	return nbFailed;
+}//End waitScheduler()
+
+void getSchedulerCounters(Scheduler* scheduler, SchedulerCounters* counters){
+	if(!scheduler || !counters)
+		return;
+
+	pthread_mutex_lock(&scheduler->lock);
+
+	counters->nbQueued = scheduler->queueSize;
+	counters->nbRunning = scheduler->nbUnfinished - scheduler->queueSize;
+	counters->nbDone = scheduler->nbDone;
+	counters->nbFailed = scheduler->nbFailed;
+	counters->seconds = getTimeSeconds() - scheduler->startTime;
+
+	pthread_mutex_unlock(&scheduler->lock);
+
+	return;
+}//End getSchedulerCounters()
+
+int writeSchedulerReport(Scheduler* scheduler, FILE* fp){
+	if(!scheduler || !fp)
+		return -1;
+
+	int result = 0;
+
+	pthread_mutex_lock(&scheduler->lock);
+
+	fprintf(fp, "# class jobs wait_p50 wait_p90 wait_p99 service_p50 service_p90 service_p99\n");
+
+	for(size_t c = 0; c < NB_SIZE_CLASSES && result == 0; ++c){
+		size_t size = scheduler->waitTimes[c].size;
+
+		fprintf(fp, "%s %zu", SIZE_CLASS_NAMES[c], size);
+
+		if(size == 0){
+			fprintf(fp, " - - - - - -\n");
+			continue;
+		}
+
+		double* sorted = malloc(sizeof(double) * size);
+		if(!sorted){
+			result = -1;
+			break;
+		}
+
+		const Samples* measures[2] = {&scheduler->waitTimes[c], &scheduler->serviceTimes[c]};
+
+		for(size_t m = 0; m < 2; ++m){
+			memcpy(sorted, measures[m]->values, sizeof(double) * size);
+			qsort(sorted, size, sizeof(double), compare_doubles);
+
+			fprintf(fp, " %.6f %.6f %.6f", percentile(sorted, size, 50),
+			        percentile(sorted, size, 90), percentile(sorted, size, 99));
+		}
+
+		fprintf(fp, "\n");
+		free(sorted);
+	}//End for()
+
+	if(result == 0 && scheduler->ioStats.nbFiles > 0){
+		const BatchIOStats* io = &scheduler->ioStats;
+
+		fprintf(fp, "# io backend files failed bytes seconds files_per_second\n");
+		fprintf(fp, "io %s %zu %zu %zu %.6f %.1f\n", io->backend == BATCH_IO_URING ? "io_uring" : "threads",
+		        io->nbFiles, io->nbFailed, io->nbBytes, io->seconds,
+		        io->seconds > 0 ? (double)io->nbFiles / io->seconds : 0.0);
+	}
+
+	pthread_mutex_unlock(&scheduler->lock);
+
+	if(ferror(fp))
+		result = -1;
+
+	return result;
+}//End writeSchedulerReport()
+
+int writeSchedulerMetrics(Scheduler* scheduler, FILE* fp){
+	if(!scheduler || !fp)
+		return -1;
+
+	pthread_mutex_lock(&scheduler->lock);
+
+	fprintf(fp, "# HELP slimming_jobs_total Jobs finished, by result.\n"
+	            "# TYPE slimming_jobs_total counter\n"
+	            "slimming_jobs_total{result=\"success\"} %zu\n"
+	            "slimming_jobs_total{result=\"failure\"} %zu\n",
+	        scheduler->nbDone - scheduler->nbFailed, scheduler->nbFailed);
+
+	fprintf(fp, "# HELP slimming_queue_depth Jobs waiting in the queue.\n"
+	            "# TYPE slimming_queue_depth gauge\n"
+	            "slimming_queue_depth %zu\n"
+	            "# HELP slimming_running_jobs Jobs running.\n"
+	            "# TYPE slimming_running_jobs gauge\n"
+	            "slimming_running_jobs %zu\n",
+	        scheduler->queueSize, scheduler->nbUnfinished - scheduler->queueSize);
+
+	fprintf(fp, "# HELP slimming_workers Threads of the scheduler.\n"
+	            "# TYPE slimming_workers gauge\n"
+	            "slimming_workers %zu\n"
+	            "# HELP slimming_threads_in_use Threads used by the running jobs.\n"
+	            "# TYPE slimming_threads_in_use gauge\n"
+	            "slimming_threads_in_use %zu\n"
+	            "# HELP slimming_busy_thread_seconds_total Time spent running jobs, times the threads they used.\n"
+	            "# TYPE slimming_busy_thread_seconds_total counter\n"
+	            "slimming_busy_thread_seconds_total %.6f\n"
+	            "# HELP slimming_uptime_seconds Time since the scheduler was created.\n"
+	            "# TYPE slimming_uptime_seconds gauge\n"
+	            "slimming_uptime_seconds %.6f\n",
+	        scheduler->nbWorkers, scheduler->threadsInUse, scheduler->busySeconds,
+	        getTimeSeconds() - scheduler->startTime);
+
+	const SlimmingStats* stats = &scheduler->reductionStats;
+
+	fprintf(fp, "# HELP slimming_pixels_total Pixels of the input images of the finished jobs.\n"
+	            "# TYPE slimming_pixels_total counter\n"
+	            "slimming_pixels_total %zu\n"
+	            "# HELP slimming_seams_total Seams removed.\n"
+	            "# TYPE slimming_seams_total counter\n"
+	            "slimming_seams_total %zu\n"
+	            "# HELP slimming_bulk_seams_total Seams removed at once with uniform columns.\n"
+	            "# TYPE slimming_bulk_seams_total counter\n"
+	            "slimming_bulk_seams_total %zu\n"
+	            "# HELP slimming_run_seams_total Seams found over runs of identical pixels.\n"
+	            "# TYPE slimming_run_seams_total counter\n"
+	            "slimming_run_seams_total %zu\n",
+	        scheduler->nbPixels, stats->nbGrooves, stats->nbBulkGrooves, stats->nbRunGrooves);
+
+	fprintf(fp, "# HELP slimming_phase_seconds_total Time spent in each phase of the reductions.\n"
+	            "# TYPE slimming_phase_seconds_total counter\n");
+	for(size_t p = 0; p < NB_SLIMMING_PHASES; ++p)
+		fprintf(fp, "slimming_phase_seconds_total{phase=\"%s\"} %.6f\n",
+		        getSlimmingPhaseName((SlimmingPhase)p), stats->phaseSeconds[p]);
+
+	fprintf(fp, "# HELP slimming_job_latency_seconds Wait and service time of the finished jobs.\n"
+	            "# TYPE slimming_job_latency_seconds histogram\n");
+	for(size_t c = 0; c < NB_SIZE_CLASSES; ++c){
+		size_t cumulated = 0;
+
+		for(size_t b = 0; b < NB_LATENCY_BUCKETS; ++b){
+			cumulated += scheduler->latencyCounts[c][b];
+			fprintf(fp, "slimming_job_latency_seconds_bucket{class=\"%s\",le=\"%g\"} %zu\n",
+			        SIZE_CLASS_NAMES[c], LATENCY_BUCKETS[b], cumulated);
+		}
+
+		cumulated += scheduler->latencyCounts[c][NB_LATENCY_BUCKETS];
+		fprintf(fp, "slimming_job_latency_seconds_bucket{class=\"%s\",le=\"+Inf\"} %zu\n"
+		            "slimming_job_latency_seconds_sum{class=\"%s\"} %.6f\n"
+		            "slimming_job_latency_seconds_count{class=\"%s\"} %zu\n",
+		        SIZE_CLASS_NAMES[c], cumulated, SIZE_CLASS_NAMES[c], scheduler->latencySums[c],
+		        SIZE_CLASS_NAMES[c], cumulated);
+	}
+
+	ResultCache* cache = scheduler->cache;
+
+	pthread_mutex_unlock(&scheduler->lock);
+
+	//The counters of the cache are shared by every process using it.
+	if(cache){
+		ResultCacheStats cacheStats;
+		getResultCacheStats(cache, &cacheStats);
+
+		fprintf(fp, "# HELP slimming_cache_lookups_total Lookups of the shared result cache, by result.\n"
+		            "# TYPE slimming_cache_lookups_total counter\n"
+		            "slimming_cache_lookups_total{result=\"hit\"} %zu\n"
+		            "slimming_cache_lookups_total{result=\"miss\"} %zu\n"
+		            "# HELP slimming_cache_insertions_total Results stored in the shared cache.\n"
+		            "# TYPE slimming_cache_insertions_total counter\n"
+		            "slimming_cache_insertions_total %zu\n"
+		            "# HELP slimming_cache_evictions_total Results evicted from the shared cache.\n"
+		            "# TYPE slimming_cache_evictions_total counter\n"
+		            "slimming_cache_evictions_total %zu\n"
+		            "# HELP slimming_cache_entries Results stored in the shared cache.\n"
+		            "# TYPE slimming_cache_entries gauge\n"
+		            "slimming_cache_entries %zu\n"
+		            "# HELP slimming_cache_bytes Size of the results stored in the shared cache.\n"
+		            "# TYPE slimming_cache_bytes gauge\n"
+		            "slimming_cache_bytes %zu\n"
+		            "# HELP slimming_cache_capacity_bytes Size of the pages of the shared cache.\n"
+		            "# TYPE slimming_cache_capacity_bytes gauge\n"
+		            "slimming_cache_capacity_bytes %zu\n",
+		        cacheStats.nbHits, cacheStats.nbMisses, cacheStats.nbInsertions, cacheStats.nbEvictions,
+		        cacheStats.nbEntries, cacheStats.nbBytes, cacheStats.capacity);
+	}
+
+	return ferror(fp) ? -1 : 0;
+}//End writeSchedulerMetrics()
+
+int exportSchedulerMetrics(Scheduler* scheduler, const char* filename){
+	if(!scheduler || !filename)
+		return -1;
+
+	//Written next to the file then renamed, a scraper never reads a partial file.
+	char* temporary = temporary_path(filename);
+	if(!temporary)
+		return -1;
+
+	FILE* fp = fopen(temporary, "w");
+	if(!fp){
+		free(temporary);
+		return -1;
+	}
+
+	int result = writeSchedulerMetrics(scheduler, fp);
+
+	if(fclose(fp) != 0 || result < 0 || rename(temporary, filename) != 0){
+		remove(temporary);
+		result = -1;
+	}
+
+	free(temporary);
+
+	return result;
+}//End exportSchedulerMetrics()
+
+void freeScheduler(Scheduler* scheduler){
+
+	if(scheduler){
+
+		pthread_mutex_lock(&scheduler->lock);
+		scheduler->stopping = true;
+		pthread_cond_broadcast(&scheduler->wakeWorkers);
+		pthread_mutex_unlock(&scheduler->lock);
+
+		for(size_t i = 0; i < scheduler->nbWorkers; ++i)
+			pthread_join(scheduler->workers[i], NULL);
+
+		for(size_t i = 0; i < scheduler->queueSize; ++i)
+			destroy_job(scheduler->queue[i]);
+
+		for(size_t c = 0; c < NB_SIZE_CLASSES; ++c){
+			free(scheduler->waitTimes[c].values);
+			free(scheduler->serviceTimes[c].values);
+		}
+
+		pthread_cond_destroy(&scheduler->jobsDone);
+		pthread_cond_destroy(&scheduler->wakeWorkers);
+		pthread_mutex_destroy(&scheduler->slowLock);
+		pthread_mutex_destroy(&scheduler->lock);
+
+		free(scheduler->slowDir);
+		free(scheduler->slowest);
+
+		free(scheduler->queue);
+		free(scheduler->workers);
+		free(scheduler);
+	}
+
+	return;
+}//End freeScheduler()
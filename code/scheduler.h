@@ -0,0 +1,237 @@
+/* ------------------------------------------------------------------------- *
+ * Interface for scheduling slimming jobs on a pool of workers.
+ *
+ * Each job is given an expected duration estimated from the size of its
+ * image, the number of pixels to remove and the engine. Jobs are run
+ * shortest-expected-job-first, with aging: every second spent waiting
+ * lowers the expected duration used to order a job by `aging` seconds, so
+ * large jobs cannot be starved by a continuous flow of small ones.
+ *
+ * Small jobs may be grouped so that their files are loaded and written with
+ * batched input/output.
+ *
+ * Each output is written to a hidden temporary file of the same directory,
+ * then renamed into place: a complete output appears at once.
+ * ------------------------------------------------------------------------- */
+
+#ifndef _SCHEDULER_H_
+#define _SCHEDULER_H_
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "slimming.h"
+#include "batchIO.h"
+#include "resultCache.h"
+
+// Types ----------------------------------------------------------------------
+
+//Size classes of the jobs (by number of pixels of the input image).
+typedef enum{
+    SIZE_CLASS_SMALL,   //Less than 1 megapixel.
+    SIZE_CLASS_MEDIUM,  //Less than 16 megapixels.
+    SIZE_CLASS_LARGE,   //At least 16 megapixels.
+    NB_SIZE_CLASSES
+}SizeClass;
+
+//Counters of the jobs of a scheduler.
+typedef struct SchedulerCounters_t{
+    size_t nbQueued;    //Number of jobs waiting in the queue (backlog).
+    size_t nbRunning;   //Number of jobs running.
+    size_t nbDone;      //Number of jobs finished (succeeded or failed).
+    size_t nbFailed;    //Number of jobs that failed.
+    double seconds;     //Time elapsed since the scheduler was created.
+}SchedulerCounters;
+
+typedef struct Scheduler_t Scheduler;
+
+
+// Methods --------------------------------------------------------------------
+
+/* ------------------------------------------------------------------------- *
+ * Create a scheduler and start its workers.
+ * The scheduler must later be deleted by calling freeScheduler().
+ *
+ * PARAMETERS
+ * nbWorkers    Number of jobs that may run at the same time (at least 1)
+ * aging        Priority gained by a waiting job (in expected seconds of
+ *              work per second of waiting, >= 0)
+ *
+ * RETURN
+ * scheduler    Pointer to the new scheduler
+ * NULL         if an error occured
+ * ------------------------------------------------------------------------- */
+Scheduler* createScheduler(size_t nbWorkers, double aging);
+
+/* ------------------------------------------------------------------------- *
+ * Group up to `ioBatchSize` small jobs, consecutive in the queue, so that
+ * their inputs are loaded, and their outputs written, as a single batch.
+ * Jobs are not grouped by default (`ioBatchSize` equal to 1).
+ *
+ * PARAMETERS
+ * scheduler    Pointer to the scheduler
+ * ioBatchSize  Maximal number of jobs in a group (at least 1)
+ * backend      The backend performing the batched input/output
+ * ------------------------------------------------------------------------- */
+void setSchedulerIO(Scheduler* scheduler, size_t ioBatchSize,
+                    BatchIOBackend backend);
+
+/* ------------------------------------------------------------------------- *
+ * Record every job finishing from now on, as a line of `record`:
+ *
+ *     offset width height k engine threads hash wait service result input
+ *
+ * where offset is the time of the submission since the creation of the
+ * scheduler, engine is exact, astar or runs, threads the number of threads the
+ * reduction could use, hash the 64 bits FNV-1a hash (in hexadecimal) of the
+ * input image (0 if it could not be loaded), wait and service the times
+ * spent in the queue and running (in seconds), and result 0 for a success
+ * or a negative error code. The input is the path of the input image, up
+ * to the end of the line (it may hold spaces). The line starting with '#'
+ * written first names the fields.
+ *
+ * A copy of the `nbSlowest` inputs whose job took the longest is kept into
+ * `slowDir`, named after the hash of the image (as "hash.pnm").
+ * Must be called before any job is submitted.
+ *
+ * PARAMETERS
+ * scheduler    Pointer to the scheduler
+ * record       Stream receiving the records (NULL for no record)
+ * slowDir      Path to the directory receiving the slowest inputs (may be
+ *              NULL if nbSlowest is 0)
+ * nbSlowest    Number of slowest inputs to keep (0 for none)
+ *
+ * RETURN
+ * 0            In case of success
+ * -1           Otherwise
+ * ------------------------------------------------------------------------- */
+int setSchedulerRecord(Scheduler* scheduler, FILE* record, const char* slowDir,
+                       size_t nbSlowest);
+
+/* ------------------------------------------------------------------------- *
+ * Use a result cache: the result of a job found in the cache is copied
+ * instead of being computed, and every computed result is stored into it.
+ * The cache must remain open until the scheduler is freed.
+ * Must be called before any job is submitted.
+ *
+ * PARAMETERS
+ * scheduler    Pointer to the scheduler
+ * cache        Pointer to the cache (NULL for no cache)
+ * ------------------------------------------------------------------------- */
+void setSchedulerCache(Scheduler* scheduler, ResultCache* cache);
+
+/* ------------------------------------------------------------------------- *
+ * Give the size class of a `width` x `height` image.
+ *
+ * PARAMETERS
+ * width        Width of the image (in pixels)
+ * height       Height of the image (in pixels)
+ *
+ * RETURN
+ * sizeClass    The size class of the image
+ * ------------------------------------------------------------------------- */
+SizeClass getSizeClass(size_t width, size_t height);
+
+/* ------------------------------------------------------------------------- *
+ * Queue a job reducing the width of the image stored in `input` by k pixels
+ * and writing the result into `output`. Only the header of the input is read
+ * at submission.
+ *
+ * PARAMETERS
+ * scheduler    Pointer to the scheduler
+ * input        Path to the input PNM file
+ * output       Path to the output PNM file
+ * k            The number of pixels to be removed (along the width axis)
+ * engine       The engine performing the reduction
+ *
+ * RETURN
+ * 0            In case of success
+ * -1           if the header of the input could not be read
+ * -2           if k is not smaller than the width of the input
+ * -3           if an allocation failed
+ * ------------------------------------------------------------------------- */
+int submitJob(Scheduler* scheduler, const char* input, const char* output,
+              size_t k, SlimmingEngine engine);
+
+/* ------------------------------------------------------------------------- *
+ * Wait until every submitted job has been run.
+ *
+ * PARAMETERS
+ * scheduler    Pointer to the scheduler
+ *
+ * RETURN
+ * nbFailed     The number of jobs that failed so far
+ * ------------------------------------------------------------------------- */
+size_t waitScheduler(Scheduler* scheduler);
+
+/* ------------------------------------------------------------------------- *
+ * Give the current counters of the jobs of a scheduler.
+ *
+ * PARAMETERS
+ * scheduler    Pointer to the scheduler
+ * counters     Pointer to the counters to fill
+ * ------------------------------------------------------------------------- */
+void getSchedulerCounters(Scheduler* scheduler, SchedulerCounters* counters);
+
+/* ------------------------------------------------------------------------- *
+ * Write, for each size class, the number of jobs and the 50th, 90th and
+ * 99th percentiles of their queue wait and service times (in seconds).
+ * One line per size class, fields separated by spaces. If jobs were
+ * grouped, a last line gives the number of files loaded or written in
+ * batches, and the number of files per second.
+ *
+ * PARAMETERS
+ * scheduler    Pointer to the scheduler
+ * fp           Stream on which the report is written
+ *
+ * RETURN
+ * 0            In case of success
+ * -1           Otherwise
+ * ------------------------------------------------------------------------- */
+int writeSchedulerReport(Scheduler* scheduler, FILE* fp);
+
+/* ------------------------------------------------------------------------- *
+ * Write the metrics of a scheduler in the Prometheus text exposition format:
+ * finished jobs by result, queue depth, running jobs, workers and threads in
+ * use, busy thread-seconds (whose rate over the number of workers is the
+ * utilization), pixels and seams processed, time spent in each phase of the
+ * reductions (the measures of --stats), and a histogram of the latencies
+ * (wait and service times) of the finished jobs by size class. If a result
+ * cache is used, its lookups, insertions, evictions and occupancy follow
+ * (counted over every process using it).
+ *
+ * PARAMETERS
+ * scheduler    Pointer to the scheduler
+ * fp           Stream on which the metrics are written
+ *
+ * RETURN
+ * 0            In case of success
+ * -1           Otherwise
+ * ------------------------------------------------------------------------- */
+int writeSchedulerMetrics(Scheduler* scheduler, FILE* fp);
+
+/* ------------------------------------------------------------------------- *
+ * Replace a file by the metrics of a scheduler, as writeSchedulerMetrics().
+ * The metrics are written to a hidden temporary file of the same directory,
+ * then renamed into place, so that a scraper (such as the textfile collector
+ * of the node exporter) never reads a partial file.
+ *
+ * PARAMETERS
+ * scheduler    Pointer to the scheduler
+ * filename     Path to the metrics file
+ *
+ * RETURN
+ * 0            In case of success
+ * -1           Otherwise (the file is left unchanged)
+ * ------------------------------------------------------------------------- */
+int exportSchedulerMetrics(Scheduler* scheduler, const char* filename);
+
+/* ------------------------------------------------------------------------- *
+ * Wait for the submitted jobs, stop the workers and free the scheduler.
+ *
+ * PARAMETERS
+ * scheduler    Pointer to the scheduler
+ * ------------------------------------------------------------------------- */
+void freeScheduler(Scheduler* scheduler);
+
+#endif // _SCHEDULER_H_
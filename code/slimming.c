@@ -2,12 +2,33 @@
  * Implementation of the slimming interface.
  * Maxime GOFFART (180521) et Olivier JORIS (182113).
  * ------------------------------------------------------------------------- */
+#define _GNU_SOURCE
+
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
 #include <float.h>
+#include <limits.h>
 #include <math.h>
 #include <stdbool.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 #include "slimming.h"
+#include "timing.h"
+
+//Smallest number of pixels per run (on average) for which the astar engine hands the
+//image over to the run-length engine.
+#define MIN_PIXELS_PER_RUN 4
+
+//The exact engine releases the memory left unused as the image narrows once its width has
+//dropped by 1 / RELEASE_FRACTION since the last release, and by at least RELEASE_MIN_BYTES.
+#define RELEASE_FRACTION 16
+#define RELEASE_MIN_BYTES (1 << 20)
+
+//Number of tables a SlimmingContext may lend at once (the energies and the costs of the wide grooves).
+#define NB_CONTEXT_TABLES 2
 
 /* ------------------------------------------------------------------------- *
  *
@@ -18,9 +39,20 @@
 //Structure representing a table which will store the cost of each pixel.
 typedef struct CostTable_t{
 	size_t height, width; //Height and width of the table.
-	float **table; //Table of size width * height that will store the cost of each pixel.
+	float **table; //Table of size width * height that will store the cost of each pixel (the lines
+	               //are consecutive in a single allocation, starting at table[0]).
+	SlimmingContext *context; //The context which lent the table (or NULL), to which destroy_cost_table() gives it back.
 }CostTable;
 
+//Structure representing the buffers kept from one reduction to the next.
+struct SlimmingContext_t{
+	CostTable tables[NB_CONTEXT_TABLES]; //The tables lent to the reductions.
+	float *cells[NB_CONTEXT_TABLES]; //The cells of each table, where its lines start.
+	size_t nbCells[NB_CONTEXT_TABLES]; //Number of cells allocated for each table.
+	size_t nbLines[NB_CONTEXT_TABLES]; //Number of lines allocated for each table.
+	bool lent[NB_CONTEXT_TABLES]; //Whether each table is lent to a reduction.
+};
+
 //Structure representing the coordinates of a pixel.
 typedef struct PixelCoordinates_t{
 	size_t line; //Line index of the pixel.
@@ -33,6 +65,88 @@ typedef struct Groove_t{
 	float cost; //The cost of the groove.
 }Groove;
 
+//Structure representing a band of lines whose pixel energies are computed by one thread.
+typedef struct EnergyBand_t{
+	const PNMView *image; //The image.
+	CostTable *nCostTable; //The table in which the energies are stored.
+	size_t firstLine, lastLine; //The band covers the lines [firstLine, lastLine).
+	int error; //Not 0 if an energy could not be computed.
+}EnergyBand;
+
+//Structure representing the mask of an object to remove, and the band of the cells lying on a
+//groove which crosses the mask (see compute_mask_band()).
+typedef struct ObjectMask_t{
+	PNMImage *storage; //The pixels of the mask.
+	PNMView mask; //The mask, reduced with the image. A pixel is masked if it is not black.
+	size_t nbMasked; //Number of masked pixels left.
+	long *maskFirst, *maskLast; //The masked pixels of line i are in the columns [maskFirst[i], maskLast[i]] (empty if first > last).
+	long *first, *last; //The band covers the columns [first[i], last[i]] of line i.
+	CostTable *costs; //Cost of the best groove from the first line to each cell of the band (first[i] + j is column j of line i).
+	CostTable *counts; //Number of masked pixels of that groove (-1 if no groove of the band reaches the cell).
+}ObjectMask;
+
+//Structure representing a run of identical pixels of a line.
+typedef struct PixelRun_t{
+	PNMPixel pixel; //The color of the pixels of the run.
+	size_t length; //Number of pixels of the run.
+}PixelRun;
+
+//Structure representing a segment of a line of a cost table, whose cells have the same cost.
+typedef struct CostSegment_t{
+	size_t start; //First column of the segment, which ends where the next one starts.
+	float cost; //Cost of the cells of the segment.
+}CostSegment;
+
+//Structure representing an image as lines of runs, and its cost table as lines of segments.
+typedef struct RunImage_t{
+	size_t width, height; //Width and height of the image.
+	PixelRun *runs; //Runs of the lines, the ones of line i starting at runs[firstRun[i]].
+	size_t *firstRun; //Index of the first run of each line.
+	size_t *nbRuns; //Number of runs of each line.
+	CostSegment *segments; //Segments of the lines of the cost table, the ones of line i being
+	                       //segments[firstSegment[i]] to segments[firstSegment[i + 1] - 1].
+	size_t *firstSegment; //Index of the first segment of each line (height + 1 entries).
+	size_t capacity; //Number of segments that fit in segments.
+}RunImage;
+
+//Structure representing a position in the runs of a line, only moving to the right.
+typedef struct RunCursor_t{
+	const PixelRun *runs; //The runs of the line.
+	size_t index; //Index of the current run.
+	size_t end; //The current run ends before the column end.
+}RunCursor;
+
+//Structure representing a position in the segments of a line, only moving to the right.
+typedef struct SegmentCursor_t{
+	const CostSegment *segments; //The segments of the line.
+	size_t nbSegments; //Number of segments of the line.
+	size_t width; //Width of the line.
+	size_t index; //Index of the current segment.
+	size_t end; //The current segment ends before the column end.
+}SegmentCursor;
+
+//Structure representing the weights of an area resampling along one axis: each output pixel is the
+//average of the source pixels it covers, weighted by the part of each one it covers.
+typedef struct AreaWeights_t{
+	size_t *first; //First source pixel covered by each output pixel.
+	size_t *count; //Number of source pixels covered by each output pixel.
+	size_t *offset; //Position in weights of the weight of the first source pixel of each output pixel.
+	float *weights; //Weights of the source pixels covered, consecutive for each output pixel (summing to 1).
+}AreaWeights;
+
+//Nominal throughput of each engine (width * height * k per second), used for estimations.
+static const double ENGINE_THROUGHPUT[] = {
+	2.0e7, //SLIMMING_ENGINE_EXACT
+	2.6e8, //SLIMMING_ENGINE_ASTAR
+	3.4e7  //SLIMMING_ENGINE_RUNS
+};
+
+//Names of the engines in the reports and records.
+static const char* ENGINE_NAMES[] = {"exact", "astar", "runs"};
+
+//Names of the phases in the reports.
+static const char* PHASE_NAMES[NB_SLIMMING_PHASES] = {"energy", "dp_build", "backtrack", "removal", "update"};
+
 //Different color channels possible.
 typedef enum{
     red,
@@ -69,21 +183,113 @@ static int copy_pnm_image(const PNMImage *source, const PNMImage *destination);
 
 /* ------------------------------------------------------------------------- *
  * Compute the cost of each pixel and stores it in a CostTable.
+ * The pixel energies are computed by 'nbThreads' threads, each one handling
+ * a band of lines. The cumulative costs are then computed line by line.
  *
  * PARAMETERS
  * image        the PNM image
+ * nbThreads    the number of threads computing the pixel energies
+ * context      the context lending the table (or NULL)
+ * stats        the measures, whose energy and DP build times are set (or NULL)
+ *
+ * NOTE
+ * The returned pointer should be freed using destroy_cost_table() after usage.
+ *
+ * RETURN
+ * nCostTable, pointer to the CostTable associated to the 'image'.
+ * NULL in case of error.
+ * ------------------------------------------------------------------------- */
+static CostTable* compute_cost_table(const PNMView *image, size_t nbThreads, SlimmingContext* context,
+                                     SlimmingStats* stats);
+
+/* ------------------------------------------------------------------------- *
+ * Allocate a CostTable whose cells are all 0, or borrow one from a context
+ * (its cells are then left as they were), enlarged if needed. A new table
+ * is allocated if every table of the context is already lent.
+ *
+ * PARAMETERS
+ * width        the width of the table
+ * height       the height of the table
+ * context      the context lending the table (or NULL)
+ *
+ * NOTE
+ * The returned pointer should be freed using destroy_cost_table() after usage.
+ *
+ * RETURN
+ * nCostTable, pointer to the CostTable.
+ * NULL in case of error.
+ * ------------------------------------------------------------------------- */
+static CostTable* create_cost_table(size_t width, size_t height, SlimmingContext* context);
+
+/* ------------------------------------------------------------------------- *
+ * Add to the energies of the line i of a CostTable the smallest cost of
+ * their neighbours on the line above.
+ *
+ * PARAMETERS
+ * nCostTable   the CostTable, whose line i - 1 holds costs
+ * i            the line index (i > 0)
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void compute_cost_line(CostTable* nCostTable, size_t i);
+
+/* ------------------------------------------------------------------------- *
+ * Compute the cost table of an image whose lines are still being loaded,
+ * line by line as they arrive: the energies of a line are computed as soon
+ * as the line below it is loaded, followed by its cumulative costs. The
+ * loaded lines are copied into 'copy' on the way.
+ *
+ * PARAMETERS
+ * image        the PNM image being loaded
+ * copy         the view, of the same size, receiving the loaded lines
+ * options      the options, whose waitLines() gives the loaded lines
+ * stats        the measures, whose energy and DP build times are set (or NULL)
  *
  * NOTE
  * The returned pointer should be freed using destroy_cost_table() after usage.
  *
  * RETURN
  * nCostTable, pointer to the CostTable associated to the 'image'.
+ * NULL in case of error (or if the loading failed).
+ * ------------------------------------------------------------------------- */
+static CostTable* compute_cost_table_while_loading(const PNMImage *image, PNMView *copy,
+                                                   const SlimmingOptions* options, SlimmingStats* stats);
+
+/* ------------------------------------------------------------------------- *
+ * Compute the energy of each pixel and stores it in a CostTable.
+ * The pixel energies are computed by 'nbThreads' threads, each one handling
+ * a band of lines.
+ *
+ * PARAMETERS
+ * image        the PNM image
+ * nbThreads    the number of threads computing the pixel energies
+ * context      the context lending the table (or NULL)
+ *
+ * NOTE
+ * The returned pointer should be freed using destroy_cost_table() after usage.
+ *
+ * RETURN
+ * nCostTable, pointer to the CostTable holding the energies of the 'image'.
  * NULL in case of error.
  * ------------------------------------------------------------------------- */
-static CostTable* compute_cost_table(const PNMImage *image);
+static CostTable* compute_energy_table(const PNMView *image, size_t nbThreads, SlimmingContext* context);
 
 /* ------------------------------------------------------------------------- *
- * Free the memory of a CostTable.
+ * Store the energy of each pixel of a band of lines in the CostTable.
+ * Can be used as the routine of a thread.
+ *
+ * PARAMETERS
+ * argument     pointer to the EnergyBand to compute
+ *
+ * RETURN
+ * NULL
+ * ------------------------------------------------------------------------- */
+static void* compute_energy_band(void* argument);
+
+/* ------------------------------------------------------------------------- *
+ * Free the memory of a CostTable, or give it back to the context which lent
+ * it.
  *
  * PARAMETERS
  * nCostTable    The CostTable we want to free.
@@ -108,7 +314,7 @@ static void destroy_cost_table(CostTable* nCostTable);
  * -3, the i index is bigger than the height of the image.
  * -4, the j index is bigger than the width of the image.
  * ------------------------------------------------------------------------- */
-static float pixel_energy(const PNMImage *image, const size_t i, const size_t j);
+static float pixel_energy(const PNMView *image, const size_t i, const size_t j);
 
 /* ------------------------------------------------------------------------- *
  * Calculate the energy of a channel color of the pixel (i, j)
@@ -126,7 +332,7 @@ static float pixel_energy(const PNMImage *image, const size_t i, const size_t j)
  * -3.0, the i index is bigger than the height of the image.
  * -4.0, the j index is bigger than the width of the image.
  * ------------------------------------------------------------------------- */
-static float color_energy(const PNMImage *image, const size_t i, const size_t j, const colorChannel channel);
+static float color_energy(const PNMView *image, const size_t i, const size_t j, const colorChannel channel);
 
 /* ------------------------------------------------------------------------- *
  * Give the value associated to a channel of the pixel (i, j)
@@ -145,7 +351,7 @@ static float color_energy(const PNMImage *image, const size_t i, const size_t j,
  * -4, the j index is bigger than the width of the image.
  * -5, the channel doesn't exist.
  * ------------------------------------------------------------------------- */
-static float color_value(const PNMImage *image, const size_t i, const size_t j, const colorChannel channel);
+static float color_value(const PNMView *image, const size_t i, const size_t j, const colorChannel channel);
 
 /* ------------------------------------------------------------------------- *
  * Give the minimum between 2 values
@@ -215,37 +421,25 @@ static Groove* find_optimal_groove(const CostTable* nCostTable);
 static void destroy_groove(Groove* nGroove);
 
 /* ------------------------------------------------------------------------- *
- * Function to shift elements one position left from position to the end of
- * the data attribut of image.
- *
- * PARAMETERS
- * image     The image in which we need to shift elements.
- * position  The index of the beginning of the shift.
- *
- * RETURN
- * 0, shift has been realized.
- * -1, pointer to image equals NULL.
- * -2, pointer to data attribut of image equals NULL.
- * ------------------------------------------------------------------------- */
-static int shift_left(PNMImage* image, const size_t position);
-
-/* ------------------------------------------------------------------------- *
- * Remove Groove 'nGroove' in PNMImage 'image'.
+ * Remove Groove 'nGroove' in the view 'image', each line being shifted
+ * within its stride. As the removal of the reference implementation, which
+ * shifted the pixels of contiguous lines, only the first (width - 1) * height
+ * pixels (numbered line by line) lose the pixels of the groove, the last
+ * ones being filled with the pixel at position (width - 1) * height - 1.
  *
  * PARAMETERS
  * image    The image in which we want to remove the Groove 'nGroove'.
- * nGroove  The Groove we want to remove from PNMImage 'image'.
+ * nGroove  The Groove we want to remove from the view 'image'.
  *
  * RETURN
- * 0, the Groove 'nGroove' was removed from PNMImage 'image'.
- * -1, error while shifting elements in data attribut of PNMImage.
+ * 0, the Groove 'nGroove' was removed from the view 'image'.
  * -2, pointer to image equals NULL.
  * -3, pointer to data attribut of image equals NULL.
  * -4, pointer to nGroove equals NULL.
  * -5, pointer to path attribut in Groove equals NULL.
- * -6, image has a width equal to 0.
+ * -6, image has a width lower than 2.
  * ------------------------------------------------------------------------- */
-static int remove_groove_image(PNMImage *image, const Groove* nGroove);
+static int remove_groove_image(PNMView *image, const Groove* nGroove);
 
 /* ------------------------------------------------------------------------- *
  * Update the cost table after removing a Groove.
@@ -254,118 +448,811 @@ static int remove_groove_image(PNMImage *image, const Groove* nGroove);
  * image      The image in which we have removed the Groove 'nGroove'.
  * nCostTable The costTable we want to update.
  * nGroove    The Groove we have removed from the image.
+ * stats      The measures, whose number of updated cells is increased (or NULL).
  *
  * RETURN
  * nCostTable, the costTable updated.
  * NULL, in case of error
  * ------------------------------------------------------------------------- */
-static CostTable* update_cost_table(const PNMImage* image, CostTable* nCostTable, const Groove* optimalGroove);
+static CostTable* update_cost_table(const PNMView* image, CostTable* nCostTable, const Groove* optimalGroove, SlimmingStats* stats);
 
 /* ------------------------------------------------------------------------- *
+ * Remove Groove 'nGroove' in the view 'image', each line being shifted
+ * within its stride.
  *
- * IMPLEMENTATION
+ * PARAMETERS
+ * image    The image in which we want to remove the Groove 'nGroove'.
+ * nGroove  The Groove we want to remove from the view 'image'.
  *
+ * RETURN
+ * /
  * ------------------------------------------------------------------------- */
+static void remove_groove_lines(PNMView *image, const Groove* nGroove);
 
-static int copy_pnm_image(const PNMImage *source, const PNMImage *destination){
-	if(!source)
-		return -1;
-	if(!source->data)
-		return -2;
-	if(!destination)
-		return -3;
-	if(!destination->data)
-		return -4;
-
-	//Check if 'source' and 'destination' have the same size.
-	if(source->width != destination->width || source->height != destination->height)
-		return -5;
+/* ------------------------------------------------------------------------- *
+ * Remove at once the columns of uniform bands which the astar and runs
+ * engines would remove first, one groove at a time.
+ *
+ * A band is a run of at least 3 adjacent columns all of a single color. Its
+ * inner columns have a zero energy, so that a groove of zero cost goes down
+ * it. That groove only removes pixels of the band (all of the same color)
+ * as long as no pixel of the last line on the left of the band has a zero
+ * energy, and no pixel of the column on its right has a zero energy: its
+ * removal then equals the removal of a column of the band. The energies of
+ * the remaining columns do not change while the band keeps 2 columns, so
+ * that the next grooves go down the same band. The bands are considered
+ * from the left, and the search stops at the first one which could be
+ * skipped by a groove. Only the energies of the last line, and of the
+ * columns on the right of the bands, are computed.
+ *
+ * PARAMETERS
+ * image        The image to reduce, in place.
+ * k            The maximal number of columns to remove.
+ * nbRemoved    Receives the number of columns removed.
+ *
+ * RETURN
+ * 0, the columns were removed.
+ * -1, not enough memory.
+ * ------------------------------------------------------------------------- */
+static int remove_uniform_columns(PNMView* image, size_t k, size_t* nbRemoved);
 
-	for(size_t i = 0; i < source->width * source->height; ++i)
-		destination->data[i] = source->data[i];
+/* ------------------------------------------------------------------------- *
+ * Count the runs of identical pixels of the lines of an image.
+ *
+ * PARAMETERS
+ * image        The image.
+ *
+ * RETURN
+ * nbRuns, the number of runs over all the lines.
+ * ------------------------------------------------------------------------- */
+static size_t count_runs(const PNMView* image);
 
-	return 0;
-}//End copy_pnm_image()
+/* ------------------------------------------------------------------------- *
+ * Encode the lines of an image as runs of identical pixels.
+ *
+ * PARAMETERS
+ * image        The image.
+ *
+ * NOTE
+ * The returned pointer should be freed using destroy_run_image() after usage.
+ *
+ * RETURN
+ * runImage, pointer to the new RunImage (its cost table not computed yet).
+ * NULL in case of error.
+ * ------------------------------------------------------------------------- */
+static RunImage* create_run_image(const PNMView* image);
 
-static CostTable* compute_cost_table(const PNMImage *image){
-	if(!image || !image->data)
-		return NULL;
+/* ------------------------------------------------------------------------- *
+ * Free the memory of a RunImage.
+ *
+ * PARAMETERS
+ * runImage     The RunImage we want to free.
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void destroy_run_image(RunImage* runImage);
 
-	//Allocate struct.
-	CostTable* nCostTable = malloc(sizeof(CostTable));
-	if(!nCostTable)
-		return NULL;
+/* ------------------------------------------------------------------------- *
+ * Move a cursor to the run covering a column, at or after its current run.
+ *
+ * PARAMETERS
+ * cursor       The cursor.
+ * column       The column.
+ *
+ * RETURN
+ * run, the run covering the column.
+ * ------------------------------------------------------------------------- */
+static inline const PixelRun* run_at(RunCursor* cursor, size_t column);
 
-	nCostTable->width = image->width;
-	nCostTable->height = image->height;
+/* ------------------------------------------------------------------------- *
+ * Tell whether two pixels have the same color.
+ *
+ * PARAMETERS
+ * first, second  The pixels.
+ *
+ * RETURN
+ * true if the pixels have the same color, false otherwise.
+ * ------------------------------------------------------------------------- */
+static inline bool same_pixel(const PNMPixel* first, const PNMPixel* second);
 
-	//Allocate table attribut.
-	nCostTable->table = malloc(sizeof(float*) * image->height);
-	if(!nCostTable->table){
-		if(nCostTable)
-			free(nCostTable);
-		return NULL;
-	}
+/* ------------------------------------------------------------------------- *
+ * Move a cursor to the segment covering a column, at or after its current
+ * segment.
+ *
+ * PARAMETERS
+ * cursor       The cursor.
+ * column       The column.
+ *
+ * RETURN
+ * cost, the cost of the segment covering the column.
+ * ------------------------------------------------------------------------- */
+static inline float segment_at(SegmentCursor* cursor, size_t column);
 
-	for(size_t i = 0; i < image->height; ++i){
+/* ------------------------------------------------------------------------- *
+ * Compute the energy of a pixel from its neighbours, as pixel_energy() does
+ * (a neighbour outside the image being the pixel itself).
+ *
+ * PARAMETERS
+ * up, down     The pixels above and below the pixel.
+ * left, right  The pixels on the left and on the right of the pixel.
+ *
+ * RETURN
+ * energy, the energy of the pixel.
+ * ------------------------------------------------------------------------- */
+static inline float run_pixel_energy(const PNMPixel* up, const PNMPixel* down, const PNMPixel* left,
+                                     const PNMPixel* right);
 
-		nCostTable->table[i] = calloc(image->width, sizeof(float));
-		if(!nCostTable->table[i]){
-			for(size_t j = 0; j < i; ++j){
-				if(nCostTable->table[j])
-					free(nCostTable->table[j]);
-			}
+/* ------------------------------------------------------------------------- *
+ * Compute the cost table of a RunImage, as compute_cost_table() does, line
+ * by line as segments of cells of the same cost. Within a segment, the
+ * pixel, its 4 neighbours and the 3 cells above it belong to the same runs
+ * and segments: its energy and cost are only computed once. The adjacent
+ * segments of the same cost are merged.
+ *
+ * PARAMETERS
+ * runImage     The RunImage, whose segments are replaced.
+ *
+ * RETURN
+ * 0, the cost table was computed.
+ * -1, not enough memory.
+ * ------------------------------------------------------------------------- */
+static int compute_run_costs(RunImage* runImage);
 
-			free(nCostTable->table);
-			free(nCostTable);
-			return NULL;
-		}
-	}//End for()
+/* ------------------------------------------------------------------------- *
+ * Give the cost of a cell of the cost table of a RunImage.
+ *
+ * PARAMETERS
+ * runImage     The RunImage, whose cost table is computed.
+ * line         The line of the cell.
+ * column       The column of the cell.
+ *
+ * RETURN
+ * cost, the cost of the cell.
+ * ------------------------------------------------------------------------- */
+static float run_cost(const RunImage* runImage, size_t line, size_t column);
 
-	//We compute the cost table
-	//We fill the first line.
-	for(size_t i = 0; i < image->width; ++i){
-		nCostTable->table[0][i] = pixel_energy(image, 0, i);
+/* ------------------------------------------------------------------------- *
+ * Find the groove with the smallest cost in the cost table of a RunImage,
+ * breaking the ties as find_optimal_groove() does.
+ *
+ * PARAMETERS
+ * runImage     The RunImage, whose cost table is computed.
+ *
+ * NOTE
+ * The returned pointer should be freed using destroy_groove() after usage.
+ *
+ * RETURN
+ * optimalGroove, pointer to the groove with the smallest energy (cost).
+ * NULL in case of error.
+ * ------------------------------------------------------------------------- */
+static Groove* find_run_groove(const RunImage* runImage);
 
-		if(nCostTable->table[0][i] < 0){
-			destroy_cost_table(nCostTable);
-			return NULL;
-		}
-	}
+/* ------------------------------------------------------------------------- *
+ * Remove a Groove from a RunImage by shortening the run holding its pixel
+ * on each line. An emptied run is removed, its neighbours being merged if
+ * they have the same color.
+ *
+ * PARAMETERS
+ * runImage     The RunImage.
+ * nGroove      The Groove we want to remove.
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void remove_run_groove(RunImage* runImage, const Groove* nGroove);
 
-	//We fill the other lines.
-	for(size_t i = 1; i < image->height; ++i){
+/* ------------------------------------------------------------------------- *
+ * Write the pixels of a RunImage into the lines of a view, whose width
+ * becomes the one of the RunImage.
+ *
+ * PARAMETERS
+ * runImage     The RunImage.
+ * image        The view, at least as wide as the RunImage.
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void expand_run_image(const RunImage* runImage, PNMView* image);
 
-		//On the left edge of the image, only 2 possible values.
-		nCostTable->table[i][0] = pixel_energy(image, i, 0) +
-			min_with_two_arguments(nCostTable->table[i-1][0], nCostTable->table[i-1][1]);
+/* ------------------------------------------------------------------------- *
+ * Remove k grooves from an image with the run-length engine: the image is
+ * encoded as runs of identical pixels, and the grooves are the ones of the
+ * astar engine (the optimal groove of the cost table computed anew after
+ * each removal), found over segments of cells instead of pixels.
+ *
+ * PARAMETERS
+ * image      The image to reduce, in place (at least 2 lines high).
+ * k          The number of grooves to remove.
+ * stats      The measures (or NULL).
+ *
+ * RETURN
+ * 0, the grooves were removed.
+ * -1, not enough memory.
+ * ------------------------------------------------------------------------- */
+static int reduce_image_runs(PNMView* image, size_t k, SlimmingStats* stats);
 
-		//In the middle of the image.
-		for(size_t j = 1; j < image->width - 1; ++j){
+/* ------------------------------------------------------------------------- *
+ * Fill the cost table of the grooves 'grooveWidth' pixels wide: the energy
+ * of the cell (i, j) is the sum of the energies of the pixels j to
+ * j + grooveWidth - 1 of line i, and its cost adds the smallest cost of its
+ * neighbours on the line above, as compute_cost_line() does. The width of
+ * the table becomes the number of positions of such a groove on a line.
+ *
+ * PARAMETERS
+ * energies     The energies of the pixels of the image.
+ * nCostTable   The CostTable, at least as large as the energies.
+ * grooveWidth  The width of the grooves (smaller than the width of the image).
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void compute_wide_costs(const CostTable* energies, CostTable* nCostTable, size_t grooveWidth);
 
-			nCostTable->table[i][j] = pixel_energy(image, i, j) +
-				min_with_three_arguments(nCostTable->table[i-1][j], nCostTable->table[i-1][j+1], nCostTable->table[i-1][j-1]);
-		}//End for()
+/* ------------------------------------------------------------------------- *
+ * Remove a groove 'grooveWidth' pixels wide from a view and from its
+ * energies, then compute again the energies of the pixels next to the
+ * groove, or whose neighbour above or below moved differently.
+ *
+ * PARAMETERS
+ * image        The view.
+ * energies     The energies of the pixels of the view.
+ * nGroove      The Groove, giving the first removed column of each line.
+ * grooveWidth  The width of the groove.
+ *
+ * RETURN
+ * nbUpdated, the number of energies computed again.
+ * ------------------------------------------------------------------------- */
+static size_t remove_wide_groove(PNMView* image, CostTable* energies, const Groove* nGroove, size_t grooveWidth);
 
-		//On the right edge of the image, only 2 possible values.
-		nCostTable->table[i][image->width-1] = pixel_energy(image, i, image->width-1) +
-			min_with_two_arguments(nCostTable->table[i-1][image->width-1], nCostTable->table[i-1][image->width-2]);
-	}
+/* ------------------------------------------------------------------------- *
+ * Remove k columns from an image, 'grooveWidth' adjacent columns (fewer for
+ * the last groove) at a time: each groove is the optimal one of the cost
+ * table of the grooves of that width, computed anew (grooves one column
+ * wide being the ones of the astar engine).
+ *
+ * PARAMETERS
+ * image        The image to reduce, in place.
+ * k            The number of columns to remove.
+ * grooveWidth  The number of columns removed by each groove.
+ * options      The options (the number of threads computing the initial
+ *              energies, and the function told when they are computed).
+ * stats        The measures (or NULL).
+ *
+ * RETURN
+ * 0, the columns were removed.
+ * -1, not enough memory.
+ * ------------------------------------------------------------------------- */
+static int reduce_image_wide(PNMView* image, size_t k, size_t grooveWidth, const SlimmingOptions* options,
+                             SlimmingStats* stats);
 
-	return nCostTable;
-}//End compute_cost_table()
+/* ------------------------------------------------------------------------- *
+ * Tell the caller of a reduction that it no longer uses more than one
+ * thread, through options->parallelDone (if set).
+ *
+ * PARAMETERS
+ * options      The options of the reduction.
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void end_parallel_phase(const SlimmingOptions* options);
 
-static void destroy_cost_table(CostTable* nCostTable){
+/* ------------------------------------------------------------------------- *
+ * Create the ObjectMask of a mask.
+ *
+ * PARAMETERS
+ * mask       The mask, as large as the image.
+ *
+ * RETURN
+ * object, the ObjectMask.
+ * NULL, not enough memory.
+ * ------------------------------------------------------------------------- */
+static ObjectMask* create_object_mask(const PNMImage* mask);
 
-	if(nCostTable){
+/* ------------------------------------------------------------------------- *
+ * Free the memory of an ObjectMask.
+ *
+ * PARAMETERS
+ * object     The ObjectMask.
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void destroy_object_mask(ObjectMask* object);
 
-		if(nCostTable->table){
+/* ------------------------------------------------------------------------- *
+ * Tell whether a pixel of the mask is masked.
+ *
+ * PARAMETERS
+ * object     The ObjectMask.
+ * i, j       The line and column of the pixel.
+ *
+ * RETURN
+ * true if the pixel is masked, false otherwise.
+ * ------------------------------------------------------------------------- */
+static inline bool is_masked(const ObjectMask* object, size_t i, size_t j);
 
-			for(size_t i = 0; i < nCostTable->height; ++i){
+/* ------------------------------------------------------------------------- *
+ * Compute the band of the grooves crossing the mask from the masked columns
+ * of each line, and enlarge the tables of the band if needed.
+ *
+ * PARAMETERS
+ * object           The ObjectMask, some pixels being masked.
+ * crossEveryLine   If true, the band only holds the grooves crossing every
+ *                  line with masked pixels within its masked columns (for an
+ *                  object as high as the image, the band is the object).
+ *                  Otherwise, the grooves crossing any masked pixel.
+ *
+ * RETURN
+ * 0, the band was computed.
+ * 1, the band is empty (only if crossEveryLine).
+ * -1, not enough memory.
+ * ------------------------------------------------------------------------- */
+static int compute_mask_band(ObjectMask* object, bool crossEveryLine);
+
+/* ------------------------------------------------------------------------- *
+ * Fill the tables of the band: the energy of each cell, then the best groove
+ * reaching it, the one crossing the most masked pixels then having the
+ * smallest cost.
+ *
+ * PARAMETERS
+ * image      The image.
+ * object     The ObjectMask, whose band is computed.
+ *
+ * RETURN
+ * 0, the tables were filled.
+ * -1, an energy could not be computed.
+ * ------------------------------------------------------------------------- */
+static int compute_band_costs(const PNMView* image, ObjectMask* object);
+
+/* ------------------------------------------------------------------------- *
+ * Find the best groove of the band.
+ *
+ * PARAMETERS
+ * object     The ObjectMask, whose tables are filled.
+ *
+ * RETURN
+ * groove, the best groove.
+ * NULL, not enough memory.
+ * ------------------------------------------------------------------------- */
+static Groove* find_band_groove(const ObjectMask* object);
+
+/* ------------------------------------------------------------------------- *
+ * Remove a groove from the mask, and update the number of masked pixels and
+ * the masked columns of each line.
+ *
+ * PARAMETERS
+ * object     The ObjectMask.
+ * nGroove    The groove.
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void remove_mask_groove(ObjectMask* object, const Groove* nGroove);
+
+/* ------------------------------------------------------------------------- *
+ * Reset the measures of a reduction.
+ *
+ * PARAMETERS
+ * stats      The measures (or NULL).
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void reset_stats(SlimmingStats* stats);
+
+/* ------------------------------------------------------------------------- *
+ * Remove k grooves from a view, in place, with the engine of the options.
+ * The width of the view decreases, its stride does not change.
+ *
+ * PARAMETERS
+ * view       The view to reduce.
+ * k          The number of grooves to remove (smaller than the width).
+ * image      The PNM image being loaded, whose lines are copied into the view
+ *            as they arrive (only with the exact engine), or NULL if the view
+ *            already holds every line.
+ * options    The options.
+ * owned      Whether the view covers a whole buffer of its own, which may
+ *            then be packed (if options->releaseMemory is set).
+ *
+ * RETURN
+ * 0, the grooves were removed.
+ * -1, not enough memory (or the loading failed).
+ * ------------------------------------------------------------------------- */
+static int reduce_view(PNMView* view, size_t k, const PNMImage* image, const SlimmingOptions* options, bool owned);
+
+/* ------------------------------------------------------------------------- *
+ * Move the lines of a view next to each other, from its first pixel, so that
+ * its stride becomes its width.
+ *
+ * PARAMETERS
+ * view       The view.
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void pack_view_lines(PNMView* view);
+
+/* ------------------------------------------------------------------------- *
+ * Give back to the system the whole pages of a buffer between two offsets.
+ * The pages are only released up to the last whole page of the buffer, and
+ * the ones before the first offset are kept.
+ *
+ * PARAMETERS
+ * buffer     The buffer.
+ * from, to   The offsets of the released bytes, in the buffer.
+ * size       The size of the buffer, in bytes.
+ *
+ * RETURN
+ * released, the number of bytes given back.
+ * ------------------------------------------------------------------------- */
+static size_t release_pages(void* buffer, size_t from, size_t to, size_t size);
+
+/* ------------------------------------------------------------------------- *
+ * Move the lines of a view and of its cost table next to each other, then
+ * give back to the system the memory after them which was still in use at
+ * the last release (both started with lines of 'capacity' / height cells).
+ *
+ * PARAMETERS
+ * view       The view, covering the whole buffer of its pixels.
+ * nCostTable The CostTable of the view, its lines having the stride of the view.
+ * capacity   The number of pixels (and costs) allocated.
+ * stats      The measures, whose memory is sampled and released bytes are
+ *            increased (or NULL).
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void release_tail_memory(PNMView* view, CostTable* nCostTable, size_t capacity, SlimmingStats* stats);
+
+/* ------------------------------------------------------------------------- *
+ * Record a sample of the resident memory of the process in the measures.
+ *
+ * PARAMETERS
+ * stats      The measures, whose peak is raised if needed (or NULL).
+ *
+ * RETURN
+ * resident, the resident memory (0 without measures).
+ * ------------------------------------------------------------------------- */
+static size_t sample_resident_memory(SlimmingStats* stats);
+
+/* ------------------------------------------------------------------------- *
+ * Compute the weights of an area resampling of an axis of 'from' pixels to
+ * 'to' pixels. With the source pixels 'to' units long and the output pixels
+ * 'from' units long, the parts covered are integers, so that the weights do
+ * not drift along the axis.
+ *
+ * PARAMETERS
+ * from       The number of source pixels (> 0).
+ * to         The number of output pixels (> 0).
+ *
+ * NOTE
+ * The returned pointer should be freed using destroy_area_weights() after usage.
+ *
+ * RETURN
+ * areaWeights, pointer to the AreaWeights.
+ * NULL in case of error.
+ * ------------------------------------------------------------------------- */
+static AreaWeights* create_area_weights(size_t from, size_t to);
+
+/* ------------------------------------------------------------------------- *
+ * Free the memory of an AreaWeights.
+ *
+ * PARAMETERS
+ * areaWeights  The AreaWeights we want to free (or NULL).
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void destroy_area_weights(AreaWeights* areaWeights);
+
+/* ------------------------------------------------------------------------- *
+ * Resample the pixels of a view to the size of an image, each pixel of the
+ * image being the average of the area of the view it covers. Each output
+ * line sums the source lines it covers, once resampled along the width, in
+ * a line of floats the compiler vectorises.
+ *
+ * PARAMETERS
+ * view       The view, whose lines may have any stride.
+ * output     The image receiving the resampled pixels.
+ *
+ * RETURN
+ * 0, the view was resampled.
+ * -1, not enough memory.
+ * ------------------------------------------------------------------------- */
+static int resample_view(const PNMView* view, PNMImage* output);
+
+/* ------------------------------------------------------------------------- *
+ *
+ * IMPLEMENTATION
+ *
+ * ------------------------------------------------------------------------- */
+
+static int copy_pnm_image(const PNMImage *source, const PNMImage *destination){
+	if(!source)
+		return -1;
+	if(!source->data)
+		return -2;
+	if(!destination)
+		return -3;
+	if(!destination->data)
+		return -4;
+
+	//Check if 'source' and 'destination' have the same size.
+	if(source->width != destination->width || source->height != destination->height)
+		return -5;
+
+	for(size_t i = 0; i < source->width * source->height; ++i)
+		destination->data[i] = source->data[i];
+
+	return 0;
+}//End copy_pnm_image()
+
+static CostTable* create_cost_table(size_t width, size_t height, SlimmingContext* context){
+	//Borrow a table of the context, if one is not lent yet. Its cells and lines only grow.
+	for(size_t t = 0; context && t < NB_CONTEXT_TABLES; ++t){
+		if(context->lent[t])
+			continue;
+
+		if(context->nbCells[t] < width * height){
+			free(context->cells[t]);
+			context->cells[t] = malloc(sizeof(float) * width * height);
+			context->nbCells[t] = context->cells[t] ? width * height : 0;
+			if(!context->cells[t])
+				break;
+		}
+
+		if(context->nbLines[t] < height){
+			float** table = realloc(context->tables[t].table, sizeof(float*) * height);
+			if(!table)
+				break;
+			context->tables[t].table = table;
+			context->nbLines[t] = height;
+		}
 
-				if(nCostTable->table[i])
-					free(nCostTable->table[i]);
-			}//End for()
+		CostTable* nCostTable = &context->tables[t];
+		nCostTable->width = width;
+		nCostTable->height = height;
+		nCostTable->context = context;
+
+		for(size_t i = 0; i < height; ++i)
+			nCostTable->table[i] = &context->cells[t][i * width];
+
+		context->lent[t] = true;
+
+		return nCostTable;
+	}//End for()
+
+	//Allocate struct.
+	CostTable* nCostTable = malloc(sizeof(CostTable));
+	if(!nCostTable)
+		return NULL;
+
+	nCostTable->width = width;
+	nCostTable->height = height;
+	nCostTable->context = NULL;
+
+	//Allocate table attribut.
+	nCostTable->table = malloc(sizeof(float*) * height);
+	if(!nCostTable->table){
+		if(nCostTable)
+			free(nCostTable);
+		return NULL;
+	}
+
+	//Allocate the lines, next to each other.
+	float* lines = calloc(width * height, sizeof(float));
+	if(!lines && width * height > 0){
+		free(nCostTable->table);
+		free(nCostTable);
+		return NULL;
+	}
+
+	for(size_t i = 0; i < height; ++i)
+		nCostTable->table[i] = &lines[i * width];
+
+	return nCostTable;
+}//End create_cost_table()
+
+static CostTable* compute_energy_table(const PNMView *image, size_t nbThreads, SlimmingContext* context){
+	if(!image || !image->data)
+		return NULL;
+
+	CostTable* nCostTable = create_cost_table(image->width, image->height, context);
+	if(!nCostTable)
+		return NULL;
+
+	//We compute the energy of each pixel, the bands of lines being shared between the threads.
+	if(nbThreads < 1)
+		nbThreads = 1;
+	if(nbThreads > image->height)
+		nbThreads = image->height;
+
+	EnergyBand* bands = malloc(sizeof(EnergyBand) * nbThreads);
+	pthread_t* threads = malloc(sizeof(pthread_t) * nbThreads);
+	if(!bands || !threads){
+		free(bands);
+		free(threads);
+		destroy_cost_table(nCostTable);
+		return NULL;
+	}
+
+	size_t nbStarted = 0;
+	bool error = false;
+
+	for(size_t t = 0; t < nbThreads; ++t){
+		bands[t].image = image;
+		bands[t].nCostTable = nCostTable;
+		bands[t].firstLine = (image->height * t) / nbThreads;
+		bands[t].lastLine = (image->height * (t + 1)) / nbThreads;
+		bands[t].error = 0;
+	}
+
+	//The first band is computed by the current thread.
+	for(size_t t = 1; t < nbThreads; ++t){
+		if(pthread_create(&threads[t], NULL, compute_energy_band, &bands[t]) != 0)
+			break;
+		nbStarted = t;
+	}
+
+	compute_energy_band(&bands[0]);
+
+	for(size_t t = 1; t <= nbStarted; ++t)
+		pthread_join(threads[t], NULL);
+
+	//If a thread could not be created, its band (and the following ones) are computed now.
+	for(size_t t = nbStarted + 1; t < nbThreads; ++t)
+		compute_energy_band(&bands[t]);
+
+	for(size_t t = 0; t < nbThreads; ++t){
+		if(bands[t].error)
+			error = true;
+	}
+
+	free(bands);
+	free(threads);
+
+	if(error){
+		destroy_cost_table(nCostTable);
+		return NULL;
+	}
+
+	return nCostTable;
+}//End compute_energy_table()
+
+static CostTable* compute_cost_table(const PNMView *image, size_t nbThreads, SlimmingContext* context,
+                                     SlimmingStats* stats){
+	double startTime = getTimeSeconds();
+
+	CostTable* nCostTable = compute_energy_table(image, nbThreads, context);
+	if(!nCostTable)
+		return NULL;
+
+	double energyTime = getTimeSeconds();
+
+	//We compute the cost table
+	//The first line only contains the energies. We fill the other lines.
+	for(size_t i = 1; i < image->height; ++i)
+		compute_cost_line(nCostTable, i);
+
+	if(stats){
+		stats->phaseSeconds[SLIMMING_PHASE_ENERGY] += energyTime - startTime;
+		stats->phaseSeconds[SLIMMING_PHASE_DP_BUILD] += getTimeSeconds() - energyTime;
+	}
+
+	return nCostTable;
+}//End compute_cost_table()
+
+static void compute_cost_line(CostTable* nCostTable, size_t i){
+	size_t width = nCostTable->width;
+
+	//On the left edge of the image, only 2 possible values.
+	nCostTable->table[i][0] += min_with_two_arguments(nCostTable->table[i-1][0], nCostTable->table[i-1][1]);
+
+	//In the middle of the image.
+	for(size_t j = 1; j < width - 1; ++j){
+
+		nCostTable->table[i][j] +=
+			min_with_three_arguments(nCostTable->table[i-1][j], nCostTable->table[i-1][j+1], nCostTable->table[i-1][j-1]);
+	}//End for()
+
+	//On the right edge of the image, only 2 possible values.
+	nCostTable->table[i][width-1] +=
+		min_with_two_arguments(nCostTable->table[i-1][width-1], nCostTable->table[i-1][width-2]);
+
+	return;
+}//End compute_cost_line()
+
+static CostTable* compute_cost_table_while_loading(const PNMImage *image, PNMView *copy,
+                                                   const SlimmingOptions* options, SlimmingStats* stats){
+	size_t height = image->height, width = image->width;
+	size_t nbCopied = 0;
+	double energySeconds = 0, costSeconds = 0;
+
+	CostTable* nCostTable = create_cost_table(width, height, options->context);
+	if(!nCostTable)
+		return NULL;
+
+	for(size_t i = 0; i < height; ++i){
+
+		//The energies of the line need the line below it.
+		size_t nbNeeded = i + 2 < height ? i + 2 : height;
+
+		if(nbCopied < nbNeeded){
+			size_t nbLoaded = options->waitLines(options->source, nbNeeded);
+			if(nbLoaded < nbNeeded){
+				destroy_cost_table(nCostTable);
+				return NULL;
+			}
+
+			for(; nbCopied < nbLoaded; ++nbCopied)
+				memcpy(&copy->data[nbCopied * copy->stride], &image->data[nbCopied * width], sizeof(PNMPixel) * width);
+		}
+
+		double startTime = getTimeSeconds();
+
+		for(size_t j = 0; j < width; ++j){
+			nCostTable->table[i][j] = pixel_energy(copy, i, j);
+
+			if(nCostTable->table[i][j] < 0){
+				destroy_cost_table(nCostTable);
+				return NULL;
+			}
+		}
+
+		double energyTime = getTimeSeconds();
+
+		if(i > 0)
+			compute_cost_line(nCostTable, i);
+
+		energySeconds += energyTime - startTime;
+		costSeconds += getTimeSeconds() - energyTime;
+	}
+
+	if(stats){
+		stats->phaseSeconds[SLIMMING_PHASE_ENERGY] += energySeconds;
+		stats->phaseSeconds[SLIMMING_PHASE_DP_BUILD] += costSeconds;
+	}
+
+	return nCostTable;
+}//End compute_cost_table_while_loading()
+
+static void* compute_energy_band(void* argument){
+	EnergyBand* band = argument;
+
+	for(size_t i = band->firstLine; i < band->lastLine; ++i){
+		for(size_t j = 0; j < band->image->width; ++j){
+			band->nCostTable->table[i][j] = pixel_energy(band->image, i, j);
+
+			if(band->nCostTable->table[i][j] < 0){
+				band->error = 1;
+				return NULL;
+			}
+		}
+	}
+
+	return NULL;
+}//End compute_energy_band()
+
+static void destroy_cost_table(CostTable* nCostTable){
+
+	//A table lent by a context is kept for the next reduction.
+	if(nCostTable && nCostTable->context){
+		for(size_t t = 0; t < NB_CONTEXT_TABLES; ++t){
+			if(&nCostTable->context->tables[t] == nCostTable)
+				nCostTable->context->lent[t] = false;
+		}
+		return;
+	}
+
+	if(nCostTable){
+
+		if(nCostTable->table){
+
+			//The lines start at the first one.
+			if(nCostTable->height > 0)
+				free(nCostTable->table[0]);
 
 			free(nCostTable->table);
 		}
@@ -376,7 +1263,7 @@ static void destroy_cost_table(CostTable* nCostTable){
 	return;
 }//End of destroy_cost_table()
 
-static float pixel_energy(const PNMImage *image, const size_t i, const size_t j){
+static float pixel_energy(const PNMView *image, const size_t i, const size_t j){
     if(!image)
         return -1;
 
@@ -393,7 +1280,7 @@ static float pixel_energy(const PNMImage *image, const size_t i, const size_t j)
            color_energy(image, i, j, blue);
 }//End pixel_energy()
 
-static float color_energy(const PNMImage *image, const size_t i, const size_t j, const colorChannel channel){
+static float color_energy(const PNMView *image, const size_t i, const size_t j, const colorChannel channel){
     if(!image)
         return -1.0;
 
@@ -453,7 +1340,7 @@ static float color_energy(const PNMImage *image, const size_t i, const size_t j,
            (fabs(color_value(image, i, j - 1, channel) - color_value(image, i, j + 1, channel)) / 2);
 }//End color_energy()
 
-static float color_value(const PNMImage *image, const size_t i, const size_t j, const colorChannel channel){
+static float color_value(const PNMView *image, const size_t i, const size_t j, const colorChannel channel){
     if(!image)
         return -1;
 
@@ -468,13 +1355,13 @@ static float color_value(const PNMImage *image, const size_t i, const size_t j,
 
     switch(channel){
         case red:
-            return image->data[(i * image->width) + j].red;
+            return image->data[(i * image->stride) + j].red;
             break;
         case green:
-            return image->data[(i * image->width) + j].green;
+            return image->data[(i * image->stride) + j].green;
             break;
         case blue:
-            return image->data[(i * image->width) + j].blue;
+            return image->data[(i * image->stride) + j].blue;
             break;
         default:
            return -5;
@@ -629,19 +1516,7 @@ static void destroy_groove(Groove* nGroove){
 	return;
 }//End destroy_groove()
 
-static int shift_left(PNMImage* image, const size_t position){
-	if(!image)
-		return -1;
-	if(!image->data)
-		return -2;
-
-	for(size_t i = position; i < (image->width * image->height) - 1; ++i)
-		image->data[i] = image->data[i + 1];
-
-	return 0;
-}//End shift_left()
-
-static int remove_groove_image(PNMImage *image, const Groove* nGroove){
+static int remove_groove_image(PNMView *image, const Groove* nGroove){
 	if(!image)
 		return -2;
 	if(!image->data)
@@ -651,30 +1526,36 @@ static int remove_groove_image(PNMImage *image, const Groove* nGroove){
 	if(!nGroove->path)
 		return -5;
 
-	if(image->width <= 0)
+	if(image->width < 2)
 		return -6;
 
-	//We are going to remove a pixel on a each line. So we reduce the width of one pixel.
-	image->width--;
+	size_t width = image->width, stride = image->stride;
+	size_t window = (width - 1) * image->height;
 
-	size_t indexOfPixelToRemove;
-	int resultShift;
+	//The pixels of the groove within the window are removed, and as many pixels at its end get the last one.
+	PNMPixel tail = image->data[((window - 1) / width) * stride + (window - 1) % width];
+	size_t nbRemoved = 0;
 
-	//We are going to remove each pixel contained in 'nGroove'.
 	for(size_t i = 0; i < image->height; ++i){
+		PNMPixel* line = &image->data[i * stride];
+		size_t column = nGroove->path[i].column;
 
-		indexOfPixelToRemove = (nGroove->path[i].line * image->width) + nGroove->path[i].column;
-
-		resultShift = shift_left(image, indexOfPixelToRemove);
-		if(resultShift < 0)
-			return -1;
+		if(i * width + column < window)
+			nbRemoved++;
 
+		memmove(line + column, line + column + 1, sizeof(PNMPixel) * (width - column - 1));
 	}
 
+	//We are going to remove a pixel on a each line. So we reduce the width of one pixel.
+	image->width--;
+
+	for(size_t position = window - nbRemoved; position < window; ++position)
+		image->data[(position / image->width) * stride + position % image->width] = tail;
+
 	return 0;
 }//End remove_groove_image()
 
-static CostTable* update_cost_table(const PNMImage* image, CostTable* nCostTable, const Groove* optimalGroove){
+static CostTable* update_cost_table(const PNMView* image, CostTable* nCostTable, const Groove* optimalGroove, SlimmingStats* stats){
 	if(!image)
 		return NULL;
 	if(!nCostTable || !nCostTable->table)
@@ -719,6 +1600,7 @@ static CostTable* update_cost_table(const PNMImage* image, CostTable* nCostTable
 	}
 
 	int j = 0; //Must be int because it can be < 0 and size_t is an unsigned type.
+	size_t nbUpdatedCells = 0;
 
 	//We only update the changed values. Represent a cone beginning at the first pixel of the groove.
 	for(int i = 1; i < (int)image->height; ++i){
@@ -727,6 +1609,11 @@ static CostTable* update_cost_table(const PNMImage* image, CostTable* nCostTable
 		if(j < 0)
 			j = 0;
 
+		if((int)firstColumn + i + 1 < (int)nCostTable->width)
+			nbUpdatedCells += firstColumn + i + 1 - j;
+		else if(j < (int)nCostTable->width)
+			nbUpdatedCells += nCostTable->width - j;
+
 		for(; j < (int)nCostTable->width && j <= (int)firstColumn + i; ++j){
 
 			//On the left edge of the image, only 2 possible values.
@@ -765,68 +1652,1468 @@ static CostTable* update_cost_table(const PNMImage* image, CostTable* nCostTable
 		}//End for()
 	}
 
+	if(stats)
+		stats->nbUpdatedCells += nbUpdatedCells;
+
 	return nCostTable;
 }//End update_cost_table()
 
-PNMImage* reduceImageWidth(const PNMImage* image, size_t k){
+static void remove_groove_lines(PNMView *image, const Groove* nGroove){
+	size_t width = image->width;
 
-	if(k >= image->width)
-		return NULL;
+	//Each line loses the pixel of the groove, the pixels on its right being moved left.
+	for(size_t i = 0; i < image->height; ++i){
+		PNMPixel* line = &image->data[i * image->stride];
+		size_t column = nGroove->path[i].column;
 
-	//Create the PNMImage which will be containing the image with a width of image->width - 'k'.
-	PNMImage* reducedImage = createPNM(image->width, image->height);
-	if(!reducedImage)
+		memmove(line + column, line + column + 1, sizeof(PNMPixel) * (width - column - 1));
+	}
+
+	image->width--;
+
+	return;
+}//End remove_groove_lines()
+
+static int remove_uniform_columns(PNMView* image, size_t k, size_t* nbRemoved){
+	size_t width = image->width, height = image->height;
+	const PNMPixel* first = image->data;
+
+	*nbRemoved = 0;
+
+	//The energies of an image of a single line are not defined by its neighbours.
+	if(height < 2)
+		return 0;
+
+	bool* uniform = malloc(sizeof(bool) * width);
+	bool* removed = calloc(width, sizeof(bool));
+	if(!uniform || !removed){
+		free(uniform);
+		free(removed);
+		return -1;
+	}
+
+	//A column is uniform if each of its pixels has the color of its first one (without branches, for vectorisation).
+	for(size_t j = 0; j < width; ++j)
+		uniform[j] = true;
+
+	for(size_t i = 1; i < height; ++i){
+		const PNMPixel* line = &image->data[i * image->stride];
+
+		for(size_t j = 0; j < width; ++j)
+			uniform[j] = uniform[j] & (line[j].red == first[j].red) & (line[j].green == first[j].green) &
+			             (line[j].blue == first[j].blue);
+	}
+
+	//A groove of zero cost may end on the left of the band if one pixel of the last line there has a zero energy.
+	bool zeroOnLeft = false;
+	size_t j = 0;
+
+	while(j < width && *nbRemoved < k){
+		if(!uniform[j]){
+			zeroOnLeft = zeroOnLeft || pixel_energy(image, height - 1, j) == 0;
+			++j;
+			continue;
+		}
+
+		size_t last = j;
+		while(last + 1 < width && uniform[last + 1] && first[last + 1].red == first[j].red &&
+		      first[last + 1].green == first[j].green && first[last + 1].blue == first[j].blue)
+			++last;
+
+		//A groove in the band may leave it through the column on its right if one of its pixels has a zero energy.
+		bool closed = last - j + 1 >= 3 && !zeroOnLeft;
+		for(size_t i = 0; last + 1 < width && i < height && closed; ++i)
+			closed = pixel_energy(image, i, last + 1) != 0;
+
+		if(closed){
+			size_t nbColumns = last - j - 1 < k - *nbRemoved ? last - j - 1 : k - *nbRemoved;
+
+			for(size_t column = j + 1; column <= j + nbColumns; ++column)
+				removed[column] = true;
+
+			*nbRemoved += nbColumns;
+		}
+
+		for(size_t column = j; column <= last; ++column)
+			zeroOnLeft = zeroOnLeft || (!removed[column] && pixel_energy(image, height - 1, column) == 0);
+
+		j = last + 1;
+	}
+
+	//Every line is compacted once.
+	if(*nbRemoved > 0){
+		for(size_t i = 0; i < height; ++i){
+			PNMPixel* line = &image->data[i * image->stride];
+			size_t column = 0;
+
+			for(size_t source = 0; source < width; ++source){
+				if(removed[source])
+					continue;
+
+				line[column] = line[source];
+				++column;
+			}
+		}
+
+		image->width -= *nbRemoved;
+	}
+
+	free(uniform);
+	free(removed);
+
+	return 0;
+}//End remove_uniform_columns()
+
+static size_t count_runs(const PNMView* image){
+	size_t nbRuns = 0;
+
+	for(size_t i = 0; i < image->height; ++i){
+		const PNMPixel* line = &image->data[i * image->stride];
+
+		nbRuns++;
+		for(size_t j = 1; j < image->width; ++j){
+			if(!same_pixel(&line[j - 1], &line[j]))
+				nbRuns++;
+		}
+	}
+
+	return nbRuns;
+}//End count_runs()
+
+static RunImage* create_run_image(const PNMView* image){
+	size_t width = image->width, height = image->height;
+	size_t nbRuns = count_runs(image);
+
+	RunImage* runImage = calloc(1, sizeof(RunImage));
+	if(!runImage)
 		return NULL;
 
-	//Copy 'image' into 'reducedImage'.
-	int resultCopy = copy_pnm_image(image, reducedImage);
-	if(resultCopy < 0){
-		freePNM(reducedImage);
+	runImage->width = width;
+	runImage->height = height;
+	//The segments of a line never outnumber its pixels. The buffer grows as needed.
+	runImage->capacity = nbRuns + width;
+
+	runImage->runs = malloc(sizeof(PixelRun) * nbRuns);
+	runImage->firstRun = malloc(sizeof(size_t) * height);
+	runImage->nbRuns = malloc(sizeof(size_t) * height);
+	runImage->segments = malloc(sizeof(CostSegment) * runImage->capacity);
+	runImage->firstSegment = calloc(height + 1, sizeof(size_t));
+	if(!runImage->runs || !runImage->firstRun || !runImage->nbRuns || !runImage->segments || !runImage->firstSegment){
+		destroy_run_image(runImage);
 		return NULL;
 	}
 
-	Groove* optimalGroove;
+	size_t nbStored = 0;
 
-	//Compute the the CostTable. Dynamic programming - memoization.
-	CostTable* nCostTable = compute_cost_table(reducedImage);
-	if(!nCostTable){
-		freePNM(reducedImage);
+	for(size_t i = 0; i < height; ++i){
+		const PNMPixel* line = &image->data[i * image->stride];
+
+		runImage->firstRun[i] = nbStored;
+
+		for(size_t j = 0; j < width; ++j){
+			if(j == 0 || !same_pixel(&line[j - 1], &line[j])){
+				runImage->runs[nbStored].pixel = line[j];
+				runImage->runs[nbStored].length = 0;
+				nbStored++;
+			}
+
+			runImage->runs[nbStored - 1].length++;
+		}
+
+		runImage->nbRuns[i] = nbStored - runImage->firstRun[i];
+	}
+
+	return runImage;
+}//End create_run_image()
+
+static void destroy_run_image(RunImage* runImage){
+
+	if(runImage){
+		free(runImage->runs);
+		free(runImage->firstRun);
+		free(runImage->nbRuns);
+		free(runImage->segments);
+		free(runImage->firstSegment);
+		free(runImage);
+	}
+
+	return;
+}//End destroy_run_image()
+
+static inline const PixelRun* run_at(RunCursor* cursor, size_t column){
+
+	while(column >= cursor->end){
+		cursor->index++;
+		cursor->end += cursor->runs[cursor->index].length;
+	}
+
+	return &cursor->runs[cursor->index];
+}//End run_at()
+
+static inline bool same_pixel(const PNMPixel* first, const PNMPixel* second){
+	return first->red == second->red && first->green == second->green && first->blue == second->blue;
+}//End same_pixel()
+
+static inline float segment_at(SegmentCursor* cursor, size_t column){
+
+	while(column >= cursor->end){
+		cursor->index++;
+		cursor->end = cursor->index + 1 < cursor->nbSegments ? cursor->segments[cursor->index + 1].start : cursor->width;
+	}
+
+	return cursor->segments[cursor->index].cost;
+}//End segment_at()
+
+static inline float run_pixel_energy(const PNMPixel* up, const PNMPixel* down, const PNMPixel* left,
+                                     const PNMPixel* right){
+	//Same operations as color_energy(), on the values of color_value().
+	float redEnergy = (fabs((float)up->red - (float)down->red) / 2) + (fabs((float)left->red - (float)right->red) / 2);
+	float greenEnergy = (fabs((float)up->green - (float)down->green) / 2) +
+	                    (fabs((float)left->green - (float)right->green) / 2);
+	float blueEnergy = (fabs((float)up->blue - (float)down->blue) / 2) + (fabs((float)left->blue - (float)right->blue) / 2);
+
+	return redEnergy + greenEnergy + blueEnergy;
+}//End run_pixel_energy()
+
+static int compute_run_costs(RunImage* runImage){
+	size_t width = runImage->width, height = runImage->height;
+	size_t nbSegments = 0;
+
+	for(size_t i = 0; i < height; ++i){
+
+		//A line has at most one segment per pixel.
+		if(runImage->capacity < nbSegments + width){
+			size_t capacity = 2 * runImage->capacity > nbSegments + width ? 2 * runImage->capacity : nbSegments + width;
+			CostSegment* segments = realloc(runImage->segments, sizeof(CostSegment) * capacity);
+			if(!segments)
+				return -1;
+
+			runImage->segments = segments;
+			runImage->capacity = capacity;
+		}
+
+		runImage->firstSegment[i] = nbSegments;
+
+		//A neighbour outside the image is the pixel itself.
+		const PixelRun* line = &runImage->runs[runImage->firstRun[i]];
+		const PixelRun* lineAbove = &runImage->runs[runImage->firstRun[i > 0 ? i - 1 : i]];
+		const PixelRun* lineBelow = &runImage->runs[runImage->firstRun[i + 1 < height ? i + 1 : i]];
+
+		RunCursor left = {line, 0, line[0].length}, center = left, right = left;
+		RunCursor above = {lineAbove, 0, lineAbove[0].length}, below = {lineBelow, 0, lineBelow[0].length};
+
+		SegmentCursor previousLeft = {NULL, 0, width, 0, width};
+		if(i > 0){
+			previousLeft.segments = &runImage->segments[runImage->firstSegment[i - 1]];
+			previousLeft.nbSegments = nbSegments - runImage->firstSegment[i - 1];
+			previousLeft.end = previousLeft.nbSegments > 1 ? previousLeft.segments[1].start : width;
+		}
+		SegmentCursor previousCenter = previousLeft, previousRight = previousLeft;
+
+		size_t j = 0;
+
+		while(j < width){
+			size_t jLeft = j > 0 ? j - 1 : j, jRight = j + 1 < width ? j + 1 : j;
+
+			const PixelRun* leftRun = run_at(&left, jLeft);
+			const PixelRun* rightRun = run_at(&right, jRight);
+			const PixelRun* aboveRun = run_at(&above, j);
+			const PixelRun* belowRun = run_at(&below, j);
+			run_at(&center, j);
+
+			//The next cells whose neighbours lie in the same runs (and segments) have the same cost.
+			size_t next = right.end - 1;
+			next = center.end < next ? center.end : next;
+			next = left.end + 1 < next ? left.end + 1 : next;
+			next = above.end < next ? above.end : next;
+			next = below.end < next ? below.end : next;
+
+			float cost = run_pixel_energy(&aboveRun->pixel, &belowRun->pixel, &leftRun->pixel, &rightRun->pixel);
+
+			if(i > 0){
+				float leftCost = segment_at(&previousLeft, jLeft);
+				float centerCost = segment_at(&previousCenter, j);
+				float rightCost = segment_at(&previousRight, jRight);
+
+				next = previousRight.end - 1 < next ? previousRight.end - 1 : next;
+				next = previousCenter.end < next ? previousCenter.end : next;
+				next = previousLeft.end + 1 < next ? previousLeft.end + 1 : next;
+
+				cost += min_with_three_arguments(centerCost, rightCost, leftCost);
+			}
+
+			//On the right edge, the right neighbour does not change.
+			if(next <= j)
+				next = j + 1;
+
+			if(nbSegments == runImage->firstSegment[i] || runImage->segments[nbSegments - 1].cost != cost){
+				runImage->segments[nbSegments].start = j;
+				runImage->segments[nbSegments].cost = cost;
+				nbSegments++;
+			}
+
+			j = next < width ? next : width;
+		}//End while()
+	}//End for()
+
+	runImage->firstSegment[height] = nbSegments;
+
+	return 0;
+}//End compute_run_costs()
+
+static float run_cost(const RunImage* runImage, size_t line, size_t column){
+	const CostSegment* segments = &runImage->segments[runImage->firstSegment[line]];
+	size_t low = 0, high = runImage->firstSegment[line + 1] - runImage->firstSegment[line];
+
+	//The cell is in the last segment starting at or before its column.
+	while(high - low > 1){
+		size_t middle = (low + high) / 2;
+
+		if(segments[middle].start <= column)
+			low = middle;
+		else
+			high = middle;
+	}
+
+	return segments[low].cost;
+}//End run_cost()
+
+static Groove* find_run_groove(const RunImage* runImage){
+	size_t width = runImage->width, height = runImage->height;
+
+	Groove* optimalGroove = malloc(sizeof(Groove));
+	if(!optimalGroove)
 		return NULL;
+
+	optimalGroove->path = malloc(sizeof(PixelCoordinates) * height);
+	if(!optimalGroove->path){
+		free(optimalGroove);
+		return NULL;
+	}
+
+	//The leftmost cell with the minimum cost on the last line starts a segment.
+	float minLastLine = FLT_MAX;
+	size_t column = 0;
+
+	for(size_t s = runImage->firstSegment[height - 1]; s < runImage->firstSegment[height]; ++s){
+		if(runImage->segments[s].cost < minLastLine){
+			minLastLine = runImage->segments[s].cost;
+			column = runImage->segments[s].start;
+		}
 	}
 
+	optimalGroove->path[height - 1].line = height - 1;
+	optimalGroove->path[height - 1].column = column;
+	optimalGroove->cost = minLastLine;
+
+	//Bottom-up, each neighbour on the line above is chosen as find_optimal_pixel() does.
+	for(size_t i = height - 1; i > 0; --i){
+
+		if(column == 0){
+			if(!(run_cost(runImage, i - 1, 0) < run_cost(runImage, i - 1, 1)))
+				column = 1;
+		}
+		else if(column == width - 1){
+			if(!(run_cost(runImage, i - 1, column) < run_cost(runImage, i - 1, column - 1)))
+				column--;
+		}
+		else{
+			float leftCost = run_cost(runImage, i - 1, column - 1);
+			float centerCost = run_cost(runImage, i - 1, column);
+			float rightCost = run_cost(runImage, i - 1, column + 1);
+
+			if(leftCost < centerCost && leftCost < rightCost)
+				column--;
+			else if(!(centerCost < rightCost))
+				column++;
+		}
+
+		optimalGroove->path[i - 1].line = i - 1;
+		optimalGroove->path[i - 1].column = column;
+	}//End for()
+
+	return optimalGroove;
+}//End find_run_groove()
+
+static void remove_run_groove(RunImage* runImage, const Groove* nGroove){
+
+	for(size_t i = 0; i < runImage->height; ++i){
+		PixelRun* runs = &runImage->runs[runImage->firstRun[i]];
+		size_t r = 0, end = runs[0].length;
+
+		while(end <= nGroove->path[i].column)
+			end += runs[++r].length;
+
+		if(--runs[r].length > 0)
+			continue;
+
+		size_t nbRuns = --runImage->nbRuns[i];
+		memmove(&runs[r], &runs[r + 1], sizeof(PixelRun) * (nbRuns - r));
+
+		//The runs on both sides of the removed one may have the same color.
+		if(r > 0 && r < nbRuns && same_pixel(&runs[r - 1].pixel, &runs[r].pixel)){
+			runs[r - 1].length += runs[r].length;
+			nbRuns = --runImage->nbRuns[i];
+			memmove(&runs[r], &runs[r + 1], sizeof(PixelRun) * (nbRuns - r));
+		}
+	}//End for()
+
+	runImage->width--;
+
+	return;
+}//End remove_run_groove()
+
+static void expand_run_image(const RunImage* runImage, PNMView* image){
+
+	for(size_t i = 0; i < runImage->height; ++i){
+		const PixelRun* runs = &runImage->runs[runImage->firstRun[i]];
+		PNMPixel* pixel = &image->data[i * image->stride];
+
+		for(size_t r = 0; r < runImage->nbRuns[i]; ++r){
+			for(size_t j = 0; j < runs[r].length; ++j)
+				*pixel++ = runs[r].pixel;
+		}
+	}
+
+	image->width = runImage->width;
+
+	return;
+}//End expand_run_image()
+
+static int reduce_image_runs(PNMView* image, size_t k, SlimmingStats* stats){
+	double phaseStart = getTimeSeconds();
+
+	RunImage* runImage = create_run_image(image);
+	if(!runImage)
+		return -1;
+
+	if(stats)
+		stats->phaseSeconds[SLIMMING_PHASE_ENERGY] += getTimeSeconds() - phaseStart;
+
 	for(size_t number = 0; number < k; ++number){
 
-		optimalGroove = find_optimal_groove(nCostTable);
+		phaseStart = getTimeSeconds();
+
+		//The cost table is computed anew after each removal, segment by segment.
+		if(compute_run_costs(runImage) < 0){
+			destroy_run_image(runImage);
+			return -1;
+		}
+
+		double costTime = getTimeSeconds();
+
+		Groove* optimalGroove = find_run_groove(runImage);
 		if(!optimalGroove){
-			freePNM(reducedImage);
-			destroy_cost_table(nCostTable);
-			return NULL;
+			destroy_run_image(runImage);
+			return -1;
 		}
 
-		int resultRemove = remove_groove_image(reducedImage, optimalGroove);
-		if(resultRemove < 0){
-			destroy_groove(optimalGroove);
+		double searchTime = getTimeSeconds();
+
+		remove_run_groove(runImage, optimalGroove);
+
+		if(stats)
+			stats->removedEnergy += optimalGroove->cost;
+
+		destroy_groove(optimalGroove);
+
+		if(stats){
+			stats->phaseSeconds[number == 0 ? SLIMMING_PHASE_DP_BUILD : SLIMMING_PHASE_UPDATE] += costTime - phaseStart;
+			stats->phaseSeconds[SLIMMING_PHASE_BACKTRACK] += searchTime - costTime;
+			stats->phaseSeconds[SLIMMING_PHASE_REMOVAL] += getTimeSeconds() - searchTime;
+			if(number > 0)
+				stats->nbUpdatedCells += runImage->firstSegment[runImage->height];
+			stats->nbGrooves++;
+			stats->nbRunGrooves++;
+		}
+	}//End for()
+
+	phaseStart = getTimeSeconds();
+
+	expand_run_image(runImage, image);
+	destroy_run_image(runImage);
+
+	if(stats)
+		stats->phaseSeconds[SLIMMING_PHASE_REMOVAL] += getTimeSeconds() - phaseStart;
+
+	return 0;
+}//End reduce_image_runs()
+
+static void compute_wide_costs(const CostTable* energies, CostTable* nCostTable, size_t grooveWidth){
+	size_t nbPositions = energies->width - grooveWidth + 1;
+
+	nCostTable->width = nbPositions;
+
+	for(size_t i = 0; i < energies->height; ++i){
+		const float* line = energies->table[i];
+		float* costs = nCostTable->table[i];
+
+		//The sum over the groove slides along the line (a groove one pixel wide takes the energies as they are).
+		if(grooveWidth == 1)
+			memcpy(costs, line, sizeof(float) * nbPositions);
+		else{
+			float sum = 0;
+			for(size_t t = 0; t < grooveWidth; ++t)
+				sum += line[t];
+
+			costs[0] = sum;
+			for(size_t j = 1; j < nbPositions; ++j){
+				sum += line[j + grooveWidth - 1] - line[j - 1];
+				costs[j] = sum;
+			}
+		}
+
+		if(i > 0)
+			compute_cost_line(nCostTable, i);
+	}//End for()
+
+	return;
+}//End compute_wide_costs()
+
+static size_t remove_wide_groove(PNMView* image, CostTable* energies, const Groove* nGroove, size_t grooveWidth){
+	size_t height = image->height;
+	size_t width = image->width - grooveWidth;
+	size_t nbUpdated = 0;
+
+	//Each line loses the pixels of the groove, the pixels on their right being moved left.
+	for(size_t i = 0; i < height; ++i){
+		PNMPixel* line = &image->data[i * image->stride];
+		float* lineEnergies = energies->table[i];
+		size_t column = nGroove->path[i].column;
+
+		memmove(&line[column], &line[column + grooveWidth], sizeof(PNMPixel) * (width - column));
+		memmove(&lineEnergies[column], &lineEnergies[column + grooveWidth], sizeof(float) * (width - column));
+	}
+
+	image->width = width;
+	energies->width = width;
+
+	//A pixel keeps its energy unless it was next to the groove, or the groove crossed
+	//the columns between its own and the one of the pixel above or below it.
+	for(size_t i = 0; i < height; ++i){
+		size_t first = nGroove->path[i].column, last = first;
+
+		for(size_t n = (i > 0 ? i - 1 : i); n <= i + 1 && n < height; ++n){
+			first = nGroove->path[n].column < first ? nGroove->path[n].column : first;
+			last = nGroove->path[n].column > last ? nGroove->path[n].column : last;
+		}
+
+		first = first > 0 ? first - 1 : 0;
+		last = last + 1 < width ? last + 1 : width;
+
+		for(size_t j = first; j < last; ++j)
+			energies->table[i][j] = pixel_energy(image, i, j);
+
+		nbUpdated += last - first;
+	}//End for()
+
+	return nbUpdated;
+}//End remove_wide_groove()
+
+static int reduce_image_wide(PNMView* image, size_t k, size_t grooveWidth, const SlimmingOptions* options,
+                             SlimmingStats* stats){
+	double phaseStart = getTimeSeconds();
+
+	CostTable* energies = compute_energy_table(image, options->nbThreads, options->context);
+	end_parallel_phase(options);
+	CostTable* nCostTable = create_cost_table(image->width, image->height, options->context);
+	if(!energies || !nCostTable){
+		destroy_cost_table(energies);
+		destroy_cost_table(nCostTable);
+		return -1;
+	}
+
+	if(stats)
+		stats->phaseSeconds[SLIMMING_PHASE_ENERGY] += getTimeSeconds() - phaseStart;
+
+	for(size_t nbRemoved = 0; nbRemoved < k;){
+
+		//The last groove only removes the columns left. A groove then has at least 2 positions.
+		size_t width = k - nbRemoved < grooveWidth ? k - nbRemoved : grooveWidth;
+
+		phaseStart = getTimeSeconds();
+
+		compute_wide_costs(energies, nCostTable, width);
+
+		double costTime = getTimeSeconds();
+
+		Groove* optimalGroove = find_optimal_groove(nCostTable);
+		if(!optimalGroove){
+			destroy_cost_table(energies);
 			destroy_cost_table(nCostTable);
-			freePNM(reducedImage);
-			return NULL;
+			return -1;
 		}
 
-		nCostTable = update_cost_table(reducedImage, nCostTable, optimalGroove);
-		if(!nCostTable){
-			destroy_groove(optimalGroove);
-			freePNM(reducedImage);
-			return NULL;
+		double searchTime = getTimeSeconds();
+
+		size_t nbUpdated = remove_wide_groove(image, energies, optimalGroove, width);
+
+		if(stats){
+			stats->phaseSeconds[nbRemoved == 0 ? SLIMMING_PHASE_DP_BUILD : SLIMMING_PHASE_UPDATE] += costTime - phaseStart;
+			stats->phaseSeconds[SLIMMING_PHASE_BACKTRACK] += searchTime - costTime;
+			stats->phaseSeconds[SLIMMING_PHASE_REMOVAL] += getTimeSeconds() - searchTime;
+			stats->nbUpdatedCells += nbUpdated;
+			stats->nbSearchedCells += nCostTable->width * nCostTable->height;
+			stats->nbGrooves++;
+			stats->removedEnergy += optimalGroove->cost;
 		}
 
 		destroy_groove(optimalGroove);
-		optimalGroove = NULL;
+		nbRemoved += width;
+	}//End for()
 
-	}//Fin for()
+	destroy_cost_table(energies);
+	destroy_cost_table(nCostTable);
 
-	if(optimalGroove)
-		destroy_groove(optimalGroove);
-	if(nCostTable)
-		destroy_cost_table(nCostTable);
+	return 0;
+}//End reduce_image_wide()
 
-    return reducedImage;
-}//End reduceImageWidth()
+static void end_parallel_phase(const SlimmingOptions* options){
+
+	if(options->parallelDone)
+		options->parallelDone(options->parallelContext);
+
+	return;
+}//End end_parallel_phase()
+
+static ObjectMask* create_object_mask(const PNMImage* mask){
+	size_t height = mask->height;
+
+	ObjectMask* object = calloc(1, sizeof(ObjectMask));
+	if(!object)
+		return NULL;
+
+	object->storage = createPNM(mask->width, height);
+	object->maskFirst = malloc(sizeof(long) * height);
+	object->maskLast = malloc(sizeof(long) * height);
+	object->first = malloc(sizeof(long) * height);
+	object->last = malloc(sizeof(long) * height);
+	if(!object->storage || !object->maskFirst || !object->maskLast || !object->first || !object->last ||
+	   copy_pnm_image(mask, object->storage) < 0){
+		destroy_object_mask(object);
+		return NULL;
+	}
+
+	object->mask = getPNMView(object->storage);
+
+	for(size_t i = 0; i < height; ++i){
+		object->maskFirst[i] = (long)mask->width;
+		object->maskLast[i] = -1;
+
+		for(size_t j = 0; j < mask->width; ++j){
+			if(is_masked(object, i, j)){
+				if(object->maskLast[i] < 0)
+					object->maskFirst[i] = (long)j;
+				object->maskLast[i] = (long)j;
+				object->nbMasked++;
+			}
+		}
+	}
+
+	return object;
+}//End create_object_mask()
+
+static void destroy_object_mask(ObjectMask* object){
+
+	if(object){
+		freePNM(object->storage);
+		free(object->maskFirst);
+		free(object->maskLast);
+		free(object->first);
+		free(object->last);
+		destroy_cost_table(object->costs);
+		destroy_cost_table(object->counts);
+		free(object);
+	}
+
+	return;
+}//End destroy_object_mask()
+
+static inline bool is_masked(const ObjectMask* object, size_t i, size_t j){
+	const PNMPixel* pixel = &object->mask.data[i * object->mask.stride + j];
+
+	return (pixel->red | pixel->green | pixel->blue) != 0;
+}//End is_masked()
+
+static int compute_mask_band(ObjectMask* object, bool crossEveryLine){
+	long height = (long)object->mask.height;
+	long width = (long)object->mask.width;
+
+	/*
+	 A groove moves by at most one column per line. Crossing every line, the band starts as the
+	 masked columns of the lines with masked pixels (and as everything elsewhere), and is narrowed
+	 to one more column per line than its neighbours. Crossing any line, it starts as the masked
+	 columns only, and is widened by one column per line away from them. Either way, the bounds
+	 are propagated going down, then going up.
+	*/
+	for(long i = 0; i < height; ++i){
+		bool empty = object->maskFirst[i] > object->maskLast[i];
+
+		if(crossEveryLine){
+			object->first[i] = empty ? LONG_MIN / 2 : object->maskFirst[i];
+			object->last[i] = empty ? LONG_MAX / 2 : object->maskLast[i];
+
+			if(i > 0 && object->first[i - 1] - 1 > object->first[i])
+				object->first[i] = object->first[i - 1] - 1;
+			if(i > 0 && object->last[i - 1] + 1 < object->last[i])
+				object->last[i] = object->last[i - 1] + 1;
+		}else{
+			object->first[i] = empty ? LONG_MAX / 2 : object->maskFirst[i];
+			object->last[i] = empty ? LONG_MIN / 2 : object->maskLast[i];
+
+			if(i > 0 && object->first[i - 1] - 1 < object->first[i])
+				object->first[i] = object->first[i - 1] - 1;
+			if(i > 0 && object->last[i - 1] + 1 > object->last[i])
+				object->last[i] = object->last[i - 1] + 1;
+		}
+	}
+
+	for(long i = height - 2; i >= 0; --i){
+		long first = object->first[i + 1] - 1, last = object->last[i + 1] + 1;
+
+		if(crossEveryLine ? first > object->first[i] : first < object->first[i])
+			object->first[i] = first;
+		if(crossEveryLine ? last < object->last[i] : last > object->last[i])
+			object->last[i] = last;
+	}
+
+	size_t bandWidth = 0;
+
+	for(long i = 0; i < height; ++i){
+		if(object->first[i] < 0)
+			object->first[i] = 0;
+		if(object->last[i] > width - 1)
+			object->last[i] = width - 1;
+
+		//No groove crosses every line within its masked columns.
+		if(object->first[i] > object->last[i])
+			return 1;
+
+		if((size_t)(object->last[i] - object->first[i] + 1) > bandWidth)
+			bandWidth = (size_t)(object->last[i] - object->first[i] + 1);
+	}
+
+	//The tables are only reallocated if the band gets wider than they are.
+	if(!object->costs || object->costs->width < bandWidth){
+		destroy_cost_table(object->costs);
+		destroy_cost_table(object->counts);
+
+		object->costs = create_cost_table(bandWidth, (size_t)height, NULL);
+		object->counts = create_cost_table(bandWidth, (size_t)height, NULL);
+		if(!object->costs || !object->counts)
+			return -1;
+	}
+
+	return 0;
+}//End compute_mask_band()
+
+static int compute_band_costs(const PNMView* image, ObjectMask* object){
+	float** costs = object->costs->table;
+	float** counts = object->counts->table;
+
+	for(size_t i = 0; i < image->height; ++i){
+		long first = object->first[i];
+
+		for(long j = first; j <= object->last[i]; ++j){
+			float energy = pixel_energy(image, i, (size_t)j);
+			if(energy < 0)
+				return -1;
+
+			float count = is_masked(object, i, (size_t)j) ? 1 : 0;
+
+			if(i == 0){
+				costs[i][j - first] = energy;
+				counts[i][j - first] = count;
+				continue;
+			}
+
+			//The best groove reaching a neighbour above, in the band.
+			long previousFirst = object->first[i - 1];
+			float bestCost = FLT_MAX, bestCount = -1;
+
+			for(long p = j - 1; p <= j + 1; ++p){
+				if(p < previousFirst || p > object->last[i - 1] || counts[i - 1][p - previousFirst] < 0)
+					continue;
+
+				float previousCost = costs[i - 1][p - previousFirst];
+				float previousCount = counts[i - 1][p - previousFirst];
+
+				if(previousCount > bestCount || (previousCount == bestCount && previousCost < bestCost)){
+					bestCost = previousCost;
+					bestCount = previousCount;
+				}
+			}
+
+			costs[i][j - first] = bestCount < 0 ? FLT_MAX : bestCost + energy;
+			counts[i][j - first] = bestCount < 0 ? -1 : bestCount + count;
+		}
+	}
+
+	return 0;
+}//End compute_band_costs()
+
+static Groove* find_band_groove(const ObjectMask* object){
+	size_t height = object->mask.height;
+	float** costs = object->costs->table;
+	float** counts = object->counts->table;
+
+	Groove* nGroove = malloc(sizeof(Groove));
+	if(!nGroove)
+		return NULL;
+
+	nGroove->path = malloc(sizeof(PixelCoordinates) * height);
+	if(!nGroove->path){
+		free(nGroove);
+		return NULL;
+	}
+
+	//The best cell of the last line, then the best neighbour above each cell.
+	long column = -1;
+
+	for(size_t i = height; i-- > 0;){
+		long first = object->first[i];
+		long from = i + 1 == height ? first : column - 1;
+		long to = i + 1 == height ? object->last[i] : column + 1;
+
+		column = -1;
+
+		for(long j = from < first ? first : from; j <= to && j <= object->last[i]; ++j){
+			float count = counts[i][j - first];
+
+			if(count >= 0 && (column < 0 || count > counts[i][column - first] ||
+			   (count == counts[i][column - first] && costs[i][j - first] < costs[i][column - first])))
+				column = j;
+		}
+
+		nGroove->path[i].line = i;
+		nGroove->path[i].column = (size_t)column;
+	}
+
+	nGroove->cost = costs[height - 1][nGroove->path[height - 1].column - object->first[height - 1]];
+
+	return nGroove;
+}//End find_band_groove()
+
+static void remove_mask_groove(ObjectMask* object, const Groove* nGroove){
+	size_t height = object->mask.height;
+
+	for(size_t i = 0; i < height; ++i){
+		if(is_masked(object, i, nGroove->path[i].column))
+			object->nbMasked--;
+	}
+
+	remove_groove_lines(&object->mask, nGroove);
+
+	//The masked pixels of a line stay in its previous masked columns, shifted by at most one.
+	for(size_t i = 0; i < height; ++i){
+		long from = object->maskFirst[i] > 0 ? object->maskFirst[i] - 1 : 0;
+		long to = object->maskLast[i] < (long)object->mask.width ? object->maskLast[i] : (long)object->mask.width - 1;
+
+		object->maskFirst[i] = (long)object->mask.width;
+		object->maskLast[i] = -1;
+
+		for(long j = from; j <= to; ++j){
+			if(is_masked(object, i, (size_t)j)){
+				if(object->maskLast[i] < 0)
+					object->maskFirst[i] = j;
+				object->maskLast[i] = j;
+			}
+		}
+	}
+
+	return;
+}//End remove_mask_groove()
+
+static void reset_stats(SlimmingStats* stats){
+	if(!stats)
+		return;
+
+	for(size_t phase = 0; phase < NB_SLIMMING_PHASES; ++phase)
+		stats->phaseSeconds[phase] = 0;
+	stats->totalSeconds = 0;
+	stats->nbGrooves = 0;
+	stats->nbUpdatedCells = 0;
+	stats->nbSearchedCells = 0;
+	stats->nbBulkGrooves = 0;
+	stats->nbRunGrooves = 0;
+	stats->removedEnergy = 0;
+	stats->peakResidentBytes = 0;
+	stats->finalResidentBytes = 0;
+	stats->releasedBytes = 0;
+
+	return;
+}//End reset_stats()
+
+static int reduce_view(PNMView* view, size_t k, const PNMImage* image, const SlimmingOptions* options, bool owned){
+	SlimmingStats* stats = options->stats;
+	bool release = owned && options->releaseMemory;
+	size_t capacity = view->stride * view->height;
+	double phaseStart;
+
+	//Wide grooves are searched over the energies, whatever the engine.
+	if(options->grooveWidth > 1)
+		return reduce_image_wide(view, k, options->grooveWidth, options, stats);
+
+	//The first grooves of the astar and runs engines going down uniform bands are removed at once.
+	if(options->engine != SLIMMING_ENGINE_EXACT){
+		phaseStart = getTimeSeconds();
+
+		size_t nbBulkGrooves;
+		if(remove_uniform_columns(view, k, &nbBulkGrooves) < 0){
+			end_parallel_phase(options);
+			return -1;
+		}
+
+		if(stats){
+			stats->phaseSeconds[SLIMMING_PHASE_REMOVAL] += getTimeSeconds() - phaseStart;
+			stats->nbGrooves += nbBulkGrooves;
+			stats->nbBulkGrooves += nbBulkGrooves;
+		}
+
+		k -= nbBulkGrooves;
+		if(k == 0){
+			end_parallel_phase(options);
+			return 0;
+		}
+	}
+
+	//The run-length engine finds the grooves of the astar engine over runs of identical pixels.
+	//The astar engine hands it the images made of long runs.
+	if(options->engine != SLIMMING_ENGINE_EXACT && view->height >= 2 &&
+	   (options->engine == SLIMMING_ENGINE_RUNS || count_runs(view) * MIN_PIXELS_PER_RUN <= view->width * view->height)){
+		end_parallel_phase(options);
+		return reduce_image_runs(view, k, stats);
+	}
+
+	//The astar engine computes the cost table anew for each groove, over the energies kept up to date.
+	if(options->engine != SLIMMING_ENGINE_EXACT)
+		return reduce_image_wide(view, k, 1, options, stats);
+
+	//Compute the the CostTable. Dynamic programming - memoization.
+	CostTable* nCostTable = image ? compute_cost_table_while_loading(image, view, options, stats) :
+	                                compute_cost_table(view, options->nbThreads, options->context, stats);
+	end_parallel_phase(options);
+	if(!nCostTable)
+		return -1;
+
+	if(release)
+		sample_resident_memory(stats);
+
+	for(size_t number = 0; number < k; ++number){
+
+		//Once the lines have lost enough pixels, the memory they no longer use is given back.
+		size_t nbUnused = (view->stride - view->width) * view->height;
+		if(release && (view->stride - view->width) * RELEASE_FRACTION >= view->stride &&
+		   nbUnused * (sizeof(PNMPixel) + sizeof(float)) >= RELEASE_MIN_BYTES){
+			phaseStart = getTimeSeconds();
+
+			release_tail_memory(view, nCostTable, capacity, stats);
+
+			if(stats)
+				stats->phaseSeconds[SLIMMING_PHASE_REMOVAL] += getTimeSeconds() - phaseStart;
+		}
+
+		phaseStart = getTimeSeconds();
+
+		Groove* optimalGroove = find_optimal_groove(nCostTable);
+
+		if(stats)
+			stats->phaseSeconds[SLIMMING_PHASE_BACKTRACK] += getTimeSeconds() - phaseStart;
+
+		if(!optimalGroove){
+			destroy_cost_table(nCostTable);
+			return -1;
+		}
+
+		phaseStart = getTimeSeconds();
+
+		int resultRemove = remove_groove_image(view, optimalGroove);
+
+		if(stats)
+			stats->phaseSeconds[SLIMMING_PHASE_REMOVAL] += getTimeSeconds() - phaseStart;
+
+		if(resultRemove < 0){
+			destroy_groove(optimalGroove);
+			destroy_cost_table(nCostTable);
+			return -1;
+		}
+
+		phaseStart = getTimeSeconds();
+
+		nCostTable = update_cost_table(view, nCostTable, optimalGroove, stats);
+
+		if(stats){
+			stats->phaseSeconds[SLIMMING_PHASE_UPDATE] += getTimeSeconds() - phaseStart;
+			stats->nbGrooves++;
+			stats->removedEnergy += optimalGroove->cost;
+		}
+
+		destroy_groove(optimalGroove);
+
+		if(!nCostTable)
+			return -1;
+
+	}//End for()
+
+	destroy_cost_table(nCostTable);
+
+	return 0;
+}//End reduce_view()
+
+static void pack_view_lines(PNMView* view){
+
+	//A line never moves past the next one, which is further in the buffer.
+	for(size_t i = 1; i < view->height && view->stride != view->width; ++i)
+		memmove(&view->data[i * view->width], &view->data[i * view->stride], sizeof(PNMPixel) * view->width);
+
+	view->stride = view->width;
+
+	return;
+}//End pack_view_lines()
+
+static size_t release_pages(void* buffer, size_t from, size_t to, size_t size){
+	uintptr_t pageSize = (uintptr_t)sysconf(_SC_PAGESIZE);
+	uintptr_t start = ((uintptr_t)buffer + from + pageSize - 1) & ~(pageSize - 1);
+	uintptr_t end = ((uintptr_t)buffer + to + pageSize - 1) & ~(pageSize - 1);
+	uintptr_t last = ((uintptr_t)buffer + size) & ~(pageSize - 1);
+
+	//The last page of the buffer may hold other data.
+	if(end > last)
+		end = last;
+
+	if(start >= end || madvise((void*)start, end - start, MADV_DONTNEED) != 0)
+		return 0;
+
+	return end - start;
+}//End release_pages()
+
+static void release_tail_memory(PNMView* view, CostTable* nCostTable, size_t capacity, SlimmingStats* stats){
+	size_t width = view->width, height = view->height;
+	size_t used = view->stride * height; //The cells in use since the last release.
+	float* costs = nCostTable->table[0];
+
+	//The peak is reached just before the release.
+	sample_resident_memory(stats);
+
+	pack_view_lines(view);
+
+	//A line never moves past the next one, as for the view.
+	for(size_t i = 1; i < height; ++i){
+		memmove(&costs[i * width], nCostTable->table[i], sizeof(float) * width);
+		nCostTable->table[i] = &costs[i * width];
+	}
+
+	size_t released = release_pages(view->data, sizeof(PNMPixel) * width * height, sizeof(PNMPixel) * used,
+	                                 sizeof(PNMPixel) * capacity) +
+	                  release_pages(costs, sizeof(float) * width * height, sizeof(float) * used, sizeof(float) * capacity);
+
+	if(stats)
+		stats->releasedBytes += released;
+
+	return;
+}//End release_tail_memory()
+
+static size_t sample_resident_memory(SlimmingStats* stats){
+	if(!stats)
+		return 0;
+
+	size_t resident = getResidentBytes();
+	if(resident > stats->peakResidentBytes)
+		stats->peakResidentBytes = resident;
+
+	return resident;
+}//End sample_resident_memory()
+
+static AreaWeights* create_area_weights(size_t from, size_t to){
+	AreaWeights* areaWeights = malloc(sizeof(AreaWeights));
+	if(!areaWeights)
+		return NULL;
+
+	//An output pixel covers at most one source pixel more than the ones it starts in, in total.
+	areaWeights->first = malloc(sizeof(size_t) * to);
+	areaWeights->count = malloc(sizeof(size_t) * to);
+	areaWeights->offset = malloc(sizeof(size_t) * to);
+	areaWeights->weights = malloc(sizeof(float) * (from + to));
+	if(!areaWeights->first || !areaWeights->count || !areaWeights->offset || !areaWeights->weights){
+		destroy_area_weights(areaWeights);
+		return NULL;
+	}
+
+	size_t nbWeights = 0;
+
+	for(size_t x = 0; x < to; ++x){
+		//The output pixel x covers [start, end), the source pixel j covers [j * to, (j + 1) * to).
+		size_t start = x * from, end = (x + 1) * from;
+
+		areaWeights->first[x] = start / to;
+		areaWeights->offset[x] = nbWeights;
+		areaWeights->count[x] = 0;
+
+		for(size_t j = start / to; j * to < end; ++j){
+			size_t left = j * to > start ? j * to : start;
+			size_t right = (j + 1) * to < end ? (j + 1) * to : end;
+
+			areaWeights->weights[nbWeights++] = (float)(right - left) / (float)from;
+			++areaWeights->count[x];
+		}
+	}
+
+	return areaWeights;
+}//End create_area_weights()
+
+static void destroy_area_weights(AreaWeights* areaWeights){
+
+	if(areaWeights){
+		free(areaWeights->first);
+		free(areaWeights->count);
+		free(areaWeights->offset);
+		free(areaWeights->weights);
+		free(areaWeights);
+	}
+
+	return;
+}//End destroy_area_weights()
+
+static int resample_view(const PNMView* view, PNMImage* output){
+	size_t nbValues = 3 * output->width;
+
+	AreaWeights* columns = create_area_weights(view->width, output->width);
+	AreaWeights* lines = create_area_weights(view->height, output->height);
+	float* sourceLine = malloc(sizeof(float) * nbValues);
+	float* outputLine = malloc(sizeof(float) * nbValues);
+
+	if(!columns || !lines || !sourceLine || !outputLine){
+		destroy_area_weights(columns);
+		destroy_area_weights(lines);
+		free(sourceLine);
+		free(outputLine);
+		return -1;
+	}
+
+	for(size_t y = 0; y < output->height; ++y){
+
+		for(size_t v = 0; v < nbValues; ++v)
+			outputLine[v] = 0;
+
+		for(size_t n = 0; n < lines->count[y]; ++n){
+			const PNMPixel* line = &view->data[(lines->first[y] + n) * view->stride];
+			float lineWeight = lines->weights[lines->offset[y] + n];
+
+			//Resampling of the source line along the width (a source line covered by two output
+			//lines is resampled twice, which costs less than keeping it).
+			for(size_t x = 0; x < output->width; ++x){
+				const PNMPixel* pixels = &line[columns->first[x]];
+				const float* weights = &columns->weights[columns->offset[x]];
+				float red = 0, green = 0, blue = 0;
+
+				for(size_t m = 0; m < columns->count[x]; ++m){
+					red += weights[m] * pixels[m].red;
+					green += weights[m] * pixels[m].green;
+					blue += weights[m] * pixels[m].blue;
+				}
+
+				sourceLine[3 * x] = red;
+				sourceLine[3 * x + 1] = green;
+				sourceLine[3 * x + 2] = blue;
+			}
+
+			for(size_t v = 0; v < nbValues; ++v)
+				outputLine[v] += lineWeight * sourceLine[v];
+		}
+
+		PNMPixel* pixels = &output->data[y * output->width];
+
+		//The weights summing to 1 up to the rounding errors, the averages are kept under 255.
+		for(size_t x = 0; x < output->width; ++x){
+			pixels[x].red = (unsigned char)fminf(outputLine[3 * x] + 0.5f, 255.0f);
+			pixels[x].green = (unsigned char)fminf(outputLine[3 * x + 1] + 0.5f, 255.0f);
+			pixels[x].blue = (unsigned char)fminf(outputLine[3 * x + 2] + 0.5f, 255.0f);
+		}
+	}
+
+	destroy_area_weights(columns);
+	destroy_area_weights(lines);
+	free(sourceLine);
+	free(outputLine);
+
+	return 0;
+}//End resample_view()
+
+void initSlimmingOptions(SlimmingOptions* options){
+	if(!options)
+		return;
+
+	options->engine = SLIMMING_ENGINE_EXACT;
+	options->nbThreads = 1;
+	options->grooveWidth = 1;
+	options->releaseMemory = false;
+	options->outputWidth = 0;
+	options->outputHeight = 0;
+	options->stats = NULL;
+	options->waitLines = NULL;
+	options->source = NULL;
+	options->parallelDone = NULL;
+	options->parallelContext = NULL;
+	options->context = NULL;
+}//End initSlimmingOptions()
+
+SlimmingContext* createSlimmingContext(void){
+	return calloc(1, sizeof(SlimmingContext));
+}//End createSlimmingContext()
+
+void destroySlimmingContext(SlimmingContext* context){
+
+	if(context){
+		for(size_t t = 0; t < NB_CONTEXT_TABLES; ++t){
+			free(context->cells[t]);
+			free(context->tables[t].table);
+		}
+
+		free(context);
+	}
+
+	return;
+}//End destroySlimmingContext()
+
+const char* getSlimmingPhaseName(SlimmingPhase phase){
+	return PHASE_NAMES[phase];
+}//End getSlimmingPhaseName()
+
+const char* getSlimmingEngineName(SlimmingEngine engine){
+	return ENGINE_NAMES[engine];
+}//End getSlimmingEngineName()
+
+double estimateReductionTime(size_t width, size_t height, size_t k, SlimmingEngine engine){
+	//Computing the initial cost table costs about as much as removing a groove.
+	return ((double)width * (double)height * (double)(k + 1)) / ENGINE_THROUGHPUT[engine];
+}//End estimateReductionTime()
+
+PNMImage* reduceImageWidth(const PNMImage* image, size_t k){
+	return reduceImageWidthWithOptions(image, k, NULL);
+}//End reduceImageWidth()
+
+PNMImage* reduceImageWidthWithOptions(const PNMImage* image, size_t k, const SlimmingOptions* options){
+
+	SlimmingOptions defaultOptions;
+	if(!options){
+		initSlimmingOptions(&defaultOptions);
+		options = &defaultOptions;
+	}
+
+	if(!image || k >= image->width)
+		return NULL;
+
+	SlimmingStats* stats = options->stats;
+	double startTime = getTimeSeconds();
+
+	reset_stats(stats);
+
+	//Create the PNMImage which will be containing the image with a width of image->width - 'k'.
+	PNMImage* reducedImage = createPNM(image->width, image->height);
+	if(!reducedImage)
+		return NULL;
+
+	//The exact engine builds its cost table while the lines of the image arrive, copying them.
+	bool loading = options->waitLines != NULL;
+
+	if(loading && (options->engine != SLIMMING_ENGINE_EXACT || options->grooveWidth > 1)){
+		if(options->waitLines(options->source, image->height) < image->height){
+			freePNM(reducedImage);
+			return NULL;
+		}
+		loading = false;
+	}
+
+	//Copy 'image' into 'reducedImage'.
+	int resultCopy = loading ? 0 : copy_pnm_image(image, reducedImage);
+	if(resultCopy < 0){
+		freePNM(reducedImage);
+		return NULL;
+	}
+
+	//The grooves are removed within the lines of 'reducedImage', which are then moved next to each other.
+	PNMView view = getPNMView(reducedImage);
+
+	if(reduce_view(&view, k, loading ? image : NULL, options, true) < 0){
+		freePNM(reducedImage);
+		return NULL;
+	}
+
+	double phaseStart = getTimeSeconds();
+
+	size_t outputWidth = options->outputWidth > 0 ? options->outputWidth : view.width;
+	size_t outputHeight = options->outputHeight > 0 ? options->outputHeight : view.height;
+	bool resample = outputWidth != view.width || outputHeight != view.height;
+
+	//The reduced image is resampled straight from the lines of the view, without packing them first.
+	if(resample){
+		PNMImage* resampledImage = createPNM(outputWidth, outputHeight);
+
+		if(!resampledImage || resample_view(&view, resampledImage) < 0){
+			freePNM(resampledImage);
+			freePNM(reducedImage);
+			return NULL;
+		}
+
+		freePNM(reducedImage);
+		reducedImage = resampledImage;
+	}else{
+		pack_view_lines(&view);
+		reducedImage->width = view.width;
+	}
+
+	//The pixels after the last line are given back.
+	if(options->releaseMemory && !resample){
+		PNMPixel* data = realloc(reducedImage->data, sizeof(PNMPixel) * view.width * view.height);
+		if(data)
+			reducedImage->data = data;
+	}
+
+	if(stats){
+		stats->phaseSeconds[SLIMMING_PHASE_REMOVAL] += getTimeSeconds() - phaseStart;
+		stats->totalSeconds = getTimeSeconds() - startTime;
+
+		if(options->releaseMemory)
+			stats->finalResidentBytes = sample_resident_memory(stats);
+	}
+
+    return reducedImage;
+}//End reduceImageWidthWithOptions()
+
+int reduceViewWidth(PNMView* view, size_t k, const SlimmingOptions* options){
+
+	SlimmingOptions defaultOptions;
+	if(!options){
+		initSlimmingOptions(&defaultOptions);
+		options = &defaultOptions;
+	}
+
+	if(!view || !view->data || k >= view->width || view->stride < view->width)
+		return -1;
+
+	double startTime = getTimeSeconds();
+
+	reset_stats(options->stats);
+
+	//The view is reduced in place, once all its lines are there.
+	if(options->waitLines && options->waitLines(options->source, view->height) < view->height)
+		return -2;
+
+	if(reduce_view(view, k, NULL, options, false) < 0)
+		return -2;
+
+	if(options->stats)
+		options->stats->totalSeconds = getTimeSeconds() - startTime;
+
+	return 0;
+}//End reduceViewWidth()
+
+PNMImage* removeObject(const PNMImage* image, const PNMImage* mask, const SlimmingOptions* options,
+                       size_t* nbRemoved){
+	if(!image || !mask || mask->width != image->width || mask->height != image->height || image->height < 2)
+		return NULL;
+
+	SlimmingStats* stats = options ? options->stats : NULL;
+	double startTime = getTimeSeconds();
+	double phaseStart;
+
+	reset_stats(stats);
+
+	PNMImage* reducedImage = createPNM(image->width, image->height);
+	ObjectMask* object = create_object_mask(mask);
+	if(!reducedImage || !object || copy_pnm_image(image, reducedImage) < 0){
+		freePNM(reducedImage);
+		destroy_object_mask(object);
+		return NULL;
+	}
+
+	PNMView view = getPNMView(reducedImage);
+	size_t number = 0;
+
+	//Each groove crosses the mask, so that every masked pixel is eventually removed.
+	while(object->nbMasked > 0){
+
+		//The object spans the whole width of the image.
+		if(view.width < 2){
+			freePNM(reducedImage);
+			destroy_object_mask(object);
+			return NULL;
+		}
+
+		phaseStart = getTimeSeconds();
+
+		/*
+		 The groove is first searched among the ones crossing every line of the object (a narrow
+		 band). If there is none, or if the best one misses every masked pixel (the masked columns
+		 of some lines have holes), it is searched among the ones crossing any masked pixel.
+		*/
+		size_t nbBandCells = 0;
+		Groove* nGroove = NULL;
+		int resultCosts = 0;
+		double searchSeconds = 0; //Time spent searching the grooves in the costs of the bands.
+
+		for(int pass = 0; pass < 2 && !nGroove && resultCosts == 0; ++pass){
+			int resultBand = compute_mask_band(object, pass == 0);
+			if(resultBand < 0)
+				resultCosts = -1;
+			if(resultBand != 0)
+				continue;
+
+			for(size_t i = 0; i < view.height; ++i)
+				nbBandCells += (size_t)(object->last[i] - object->first[i] + 1);
+
+			resultCosts = compute_band_costs(&view, object);
+			if(resultCosts < 0)
+				break;
+
+			size_t last = view.height - 1;
+			long lastFirst = object->first[last];
+			double searchStart = getTimeSeconds();
+			nGroove = find_band_groove(object);
+			searchSeconds += getTimeSeconds() - searchStart;
+
+			if(nGroove && pass == 0 &&
+			   object->counts->table[last][(long)nGroove->path[last].column - lastFirst] < 1){
+				destroy_groove(nGroove);
+				nGroove = NULL;
+			}
+			else if(!nGroove)
+				resultCosts = -1;
+		}
+
+		double searchTime = getTimeSeconds();
+
+		if(!nGroove){
+			freePNM(reducedImage);
+			destroy_object_mask(object);
+			return NULL;
+		}
+
+		remove_groove_lines(&view, nGroove);
+		remove_mask_groove(object, nGroove);
+		destroy_groove(nGroove);
+
+		if(stats){
+			stats->phaseSeconds[SLIMMING_PHASE_DP_BUILD] += searchTime - phaseStart - searchSeconds;
+			stats->phaseSeconds[SLIMMING_PHASE_BACKTRACK] += searchSeconds;
+			stats->phaseSeconds[SLIMMING_PHASE_REMOVAL] += getTimeSeconds() - searchTime;
+			stats->nbSearchedCells += nbBandCells;
+			stats->nbGrooves++;
+		}
+
+		number++;
+	}//End while()
+
+	destroy_object_mask(object);
+
+	pack_view_lines(&view);
+	reducedImage->width = view.width;
+
+	if(nbRemoved)
+		*nbRemoved = number;
+
+	if(stats)
+		stats->totalSeconds = getTimeSeconds() - startTime;
+
+	return reducedImage;
+}//End removeObject()
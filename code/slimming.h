@@ -6,8 +6,100 @@
 #define _SLIMMING_H_
 
 #include <stddef.h>
+#include <stdbool.h>
 #include "PNM.h"
 
+// Types ----------------------------------------------------------------------
+
+//Engines available to find and remove the grooves.
+typedef enum{
+    SLIMMING_ENGINE_EXACT, //Cost table incrementally updated after each groove.
+    SLIMMING_ENGINE_ASTAR, //Cost table computed anew for each groove, over pixel energies kept up to date.
+    SLIMMING_ENGINE_RUNS   //Cost table over runs of identical pixels (same grooves as astar).
+}SlimmingEngine;
+
+//Phases of a reduction.
+typedef enum{
+    SLIMMING_PHASE_ENERGY,    //Energy of every pixel of the initial image.
+    SLIMMING_PHASE_DP_BUILD,  //Cumulative costs of the initial cost table.
+    SLIMMING_PHASE_BACKTRACK, //Search of the optimal groove in the cost table.
+    SLIMMING_PHASE_REMOVAL,   //Removal of the groove from the image.
+    SLIMMING_PHASE_UPDATE,    //Incremental update of the cost table (or of the energies).
+    NB_SLIMMING_PHASES
+}SlimmingPhase;
+
+//Measures of a reduction.
+typedef struct SlimmingStats_t{
+    double phaseSeconds[NB_SLIMMING_PHASES]; //Time spent in each phase.
+    double totalSeconds; //Time spent in the whole reduction.
+    size_t nbGrooves; //Number of grooves removed.
+    size_t nbUpdatedCells; //Number of cells (segments of cells with the runs engine) recomputed by the updates.
+    size_t nbSearchedCells; //Number of cells of the cost tables computed anew for each groove (astar, wide grooves),
+                            //or of the bands of an object removal.
+    size_t nbBulkGrooves; //Number of grooves removed at once with uniform columns.
+    size_t nbRunGrooves; //Number of grooves found over runs of identical pixels.
+    double removedEnergy; //Sum of the energies of the pixels removed by the grooves found.
+    size_t peakResidentBytes; //Largest resident memory of the process seen during the reduction.
+    size_t finalResidentBytes; //Resident memory of the process at the end of the reduction.
+    size_t releasedBytes; //Memory given back to the system while the image narrowed.
+}SlimmingStats;
+
+//Buffers (energies and cost tables) kept from one reduction to the next, so that a thread
+//reducing many images allocates them once, as large as the largest image seen.
+typedef struct SlimmingContext_t SlimmingContext;
+
+//Options driving a reduction.
+typedef struct SlimmingOptions_t{
+    SlimmingEngine engine; //Engine used to find and remove the grooves.
+    size_t nbThreads; //Number of threads the reduction may use (at least 1).
+    size_t grooveWidth; //Number of adjacent columns removed by each groove (at least 1).
+    bool releaseMemory; //Whether the memory left unused as the image narrows is given back to the system.
+    size_t outputWidth, outputHeight; //Size to which the reduced image is resampled (0 keeps its size).
+    SlimmingStats* stats; //Where the measures of the reduction are stored (or NULL).
+    size_t (*waitLines)(void* source, size_t nbLines); //If the image is still loading, waits until
+                                                       //nbLines lines are loaded and gives the number of
+                                                       //loaded lines (fewer if the loading failed), or NULL.
+    void* source; //Argument given to waitLines.
+    void (*parallelDone)(void* context); //Called once the reduction no longer uses more than one thread
+                                         //(after the initial energies), or NULL.
+    void* parallelContext; //Argument given to parallelDone.
+    SlimmingContext* context; //Buffers reused from one reduction to the next (or NULL). A context
+                              //may only be used by one reduction at a time.
+}SlimmingOptions;
+
+
+// Methods --------------------------------------------------------------------
+
+/* ------------------------------------------------------------------------- *
+ * Fill a SlimmingOptions with the default options (exact engine, a single
+ * thread, grooves one column wide, no memory released, no resampling, no
+ * measures, an image already loaded, no context).
+ *
+ * PARAMETERS
+ * options      Pointer to the options to initialise
+ * ------------------------------------------------------------------------- */
+void initSlimmingOptions(SlimmingOptions* options);
+
+/* ------------------------------------------------------------------------- *
+ * Create an empty SlimmingContext. Its buffers are allocated by the first
+ * reductions which use it, and enlarged when an image needs more.
+ *
+ * The context must later be deleted by calling destroySlimmingContext().
+ *
+ * RETURN
+ * context      Pointer to the new context
+ * NULL         if an error occured
+ * ------------------------------------------------------------------------- */
+SlimmingContext* createSlimmingContext(void);
+
+/* ------------------------------------------------------------------------- *
+ * Free a SlimmingContext and its buffers.
+ *
+ * PARAMETERS
+ * context      Pointer to the context (or NULL)
+ * ------------------------------------------------------------------------- */
+void destroySlimmingContext(SlimmingContext* context);
+
 /* ------------------------------------------------------------------------- *
  * Reduce the width of a PNM image to `image->width-k`.
  *
@@ -23,4 +115,170 @@
  * ------------------------------------------------------------------------- */
 PNMImage* reduceImageWidth(const PNMImage* image, size_t k);
 
+/* ------------------------------------------------------------------------- *
+ * Reduce the width of a PNM image to `image->width-k` using the given
+ * options. The result does not depend on the number of threads.
+ *
+ * If options->waitLines is set, the lines of the image may still be
+ * arriving: the exact engine computes the energies and costs of each line
+ * as soon as the line below it is loaded (with a single thread), and the
+ * other engines wait for the whole image.
+ *
+ * Only the initial energies are computed by options->nbThreads threads.
+ * If options->parallelDone is set, it is called (at most once, by the
+ * calling thread) as soon as they are computed, so that the caller may hand
+ * the other threads over to other work.
+ *
+ * The astar engine keeps the energies of the pixels up to date, recomputing
+ * the ones next to each groove removed, and computes the cost table anew
+ * for each groove over them (as for the wide grooves below, one column
+ * wide). With the astar and runs engines, the first grooves going down
+ * uniform bands of columns are removed at once, before the engine starts.
+ *
+ * The runs engine encodes each line as runs of identical pixels, and
+ * computes the energies and costs once per segment of cells lying in the
+ * same runs, removing each groove by shortening runs: its grooves are the
+ * ones of the astar engine, which hands it the images of at least 4 pixels
+ * per run on average (flat-color graphics such as screenshots).
+ *
+ * If options->grooveWidth is larger than 1, each groove removes that many
+ * adjacent columns (the last one, the columns left), whatever the engine:
+ * the energy of a position of the groove on a line is the sum of the
+ * energies of its pixels, the positions of consecutive lines being linked
+ * as the pixels of a groove one column wide are. The cost table is then
+ * computed anew for each groove, over the energies kept up to date. Such a
+ * reduction needs about grooveWidth times fewer passes, and usually removes
+ * a little more energy.
+ *
+ * If options->releaseMemory is set, the memory the narrower image no longer
+ * needs is given back to the system during the reduction: with the exact
+ * engine, each time the width has dropped by 1/16 since the last time (and
+ * by at least 1 MiB of pixels and costs), the lines of the image and of the
+ * cost table are moved next to each other, and the pages after them are
+ * released. The pixels of the returned image are then reallocated to its
+ * size, whatever the engine. With measures, the resident memory of the
+ * process is sampled along the way (peak and final).
+ *
+ * If options->context is set, the energies and cost tables of the exact
+ * and astar engines, and of the wide grooves, are borrowed from it instead
+ * of being allocated, and kept there for the next reduction (the pages
+ * released along the way are only mapped again when used).
+ *
+ * If options->outputWidth or options->outputHeight is set, the reduced
+ * image is resampled to that size (the other one being kept) as its lines
+ * are gathered: each output pixel is the average of the area of the reduced
+ * image it covers (weighted by the part of each pixel covered), which suits
+ * downscaling, such as for thumbnails. The reduced image at its full size
+ * is then never built. The returned image has the output size.
+ *
+ * The PNM image must later be deleted by calling freePNM().
+ *
+ * PARAMETERS
+ * image        Pointer to a PNM image
+ * k            The number of pixels to be removed (along the width axis)
+ * options      Pointer to the options (NULL for the default ones)
+ *
+ * RETURN
+ * image        Pointer to a new PNM image
+ * NULL         if an error occured
+ * ------------------------------------------------------------------------- */
+PNMImage* reduceImageWidthWithOptions(const PNMImage* image, size_t k,
+                                      const SlimmingOptions* options);
+
+/* ------------------------------------------------------------------------- *
+ * Reduce the width of the pixels of a view to `view->width-k`, in place:
+ * the lines keep their stride, and the last k pixels of each one are left
+ * undefined. The view may be a rectangle of a larger image or frame, which
+ * is then reduced without being copied; its pixels outside the view are not
+ * changed. The result is the one reduceImageWidthWithOptions() gives for an
+ * image holding the pixels of the view.
+ *
+ * If options->waitLines is set, the reduction starts once every line of
+ * the view is loaded. The memory of the view is never released, and the
+ * view is not resampled to the output size of the options.
+ *
+ * PARAMETERS
+ * view         Pointer to the view, whose width is decreased by k
+ * k            The number of pixels to be removed (along the width axis)
+ * options      Pointer to the options (NULL for the default ones)
+ *
+ * RETURN
+ * 0            In case of success
+ * -1           if k is not smaller than the width of the view, or if the
+ *              stride of the view is smaller than its width
+ * -2           if an error occured (the pixels of the view are undefined)
+ * ------------------------------------------------------------------------- */
+int reduceViewWidth(PNMView* view, size_t k, const SlimmingOptions* options);
+
+/* ------------------------------------------------------------------------- *
+ * Remove the object covered by a mask from an image: grooves are removed
+ * one by one, each one crossing the mask (through as many masked pixels as
+ * possible, then with the smallest cost), until no masked pixel is left.
+ *
+ * A groove moves by at most one column per line, so the energies and costs
+ * are only computed in the band of the cells such a groove may go through.
+ * The grooves crossing every line of the object within its masked columns
+ * are searched first: the band is then the object, widened by one column
+ * per line above and below it, and its size does not depend on the width
+ * of the image. Otherwise, the band holds the grooves crossing any masked
+ * pixel.
+ *
+ * The engine, number of threads and width of grooves of the options are not
+ * used.
+ * The PNM image must later be deleted by calling freePNM().
+ *
+ * PARAMETERS
+ * image        Pointer to a PNM image (at least 2 lines high)
+ * mask         Pointer to the mask, as large as the image, in which the
+ *              pixels of the object are not black
+ * options      Pointer to the options (NULL for the default ones)
+ * nbRemoved    Where to store the number of grooves removed (or NULL)
+ *
+ * RETURN
+ * image        Pointer to a new PNM image
+ * NULL         if an error occured, or if the object spans the whole width
+ *              of the image
+ * ------------------------------------------------------------------------- */
+PNMImage* removeObject(const PNMImage* image, const PNMImage* mask,
+                       const SlimmingOptions* options, size_t* nbRemoved);
+
+/* ------------------------------------------------------------------------- *
+ * Give the name of a phase, as used in the reports.
+ *
+ * PARAMETERS
+ * phase        The phase
+ *
+ * RETURN
+ * name         The name of the phase
+ * ------------------------------------------------------------------------- */
+const char* getSlimmingPhaseName(SlimmingPhase phase);
+
+/* ------------------------------------------------------------------------- *
+ * Give the name of an engine, as used in the options and records.
+ *
+ * PARAMETERS
+ * engine       The engine
+ *
+ * RETURN
+ * name         The name of the engine ("exact", "astar" or "runs")
+ * ------------------------------------------------------------------------- */
+const char* getSlimmingEngineName(SlimmingEngine engine);
+
+/* ------------------------------------------------------------------------- *
+ * Estimate the time needed to reduce the width of a `width` x `height`
+ * image by k pixels. The estimate is proportional to width * height * k,
+ * weighted by the nominal throughput of the engine.
+ *
+ * PARAMETERS
+ * width        Width of the image (in pixels)
+ * height       Height of the image (in pixels)
+ * k            The number of pixels to be removed (along the width axis)
+ * engine       The engine performing the reduction
+ *
+ * RETURN
+ * time         The expected duration of the reduction (in seconds)
+ * ------------------------------------------------------------------------- */
+double estimateReductionTime(size_t width, size_t height, size_t k,
+                             SlimmingEngine engine);
+
 #endif // _SLIMMING_H_
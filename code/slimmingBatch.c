@@ -0,0 +1,633 @@
+/* ------------------------------------------------------------------------- *
+ * Implementation of the batch slimming interface.
+ *
+ * Every step below reproduces, lane by lane, the corresponding step of
+ * slimming.c (including the cone-shaped update of the cost table), so that
+ * the results do not depend on the way the images are reduced.
+ * ------------------------------------------------------------------------- */
+#include <stdlib.h>
+#include <float.h>
+#include <math.h>
+#include <stdbool.h>
+
+#include "slimmingBatch.h"
+#include "timing.h"
+
+#define LANES SLIMMING_BATCH_LANES
+
+/* ------------------------------------------------------------------------- *
+ *
+ * STRUCTURES
+ *
+ * ------------------------------------------------------------------------- */
+
+//Structure representing up to LANES images reduced in lockstep.
+//The value of pixel (i, j) of lane l is at position (i * stride + j) * LANES + l.
+typedef struct LaneBatch_t{
+	size_t height; //Height of the images.
+	size_t stride; //Initial width of the images, used as the distance between two lines.
+	size_t width; //Current width of the images.
+	size_t nbLanes; //Number of lanes holding an image (the others repeat the first image).
+	unsigned char *red, *green, *blue; //Color channels of the images.
+	float *table; //Cost table of the images.
+	size_t *path; //Column of the groove of lane l on line i at position i * LANES + l.
+}LaneBatch;
+
+/* ------------------------------------------------------------------------- *
+ *
+ * PROTOTYPES OF STATIC FUNCTIONS
+ *
+ * ------------------------------------------------------------------------- */
+
+/* ------------------------------------------------------------------------- *
+ * Interleave up to LANES images of the same size in a LaneBatch.
+ *
+ * PARAMETERS
+ * images       the images
+ * nbImages     the number of images (between 1 and LANES)
+ *
+ * NOTE
+ * The returned pointer should be freed using destroy_lane_batch() after usage.
+ *
+ * RETURN
+ * batch, pointer to the new LaneBatch.
+ * NULL in case of error.
+ * ------------------------------------------------------------------------- */
+static LaneBatch* create_lane_batch(const PNMImage* const* images, size_t nbImages);
+
+/* ------------------------------------------------------------------------- *
+ * Free the memory of a LaneBatch.
+ *
+ * PARAMETERS
+ * batch        the LaneBatch to free
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void destroy_lane_batch(LaneBatch* batch);
+
+/* ------------------------------------------------------------------------- *
+ * Give the position of the pixel (i, j) of the first lane.
+ * ------------------------------------------------------------------------- */
+static inline size_t cell(const LaneBatch* batch, size_t i, size_t j);
+
+/* ------------------------------------------------------------------------- *
+ * Calculate the energy of the pixel (i, j) of a lane.
+ *
+ * PARAMETERS
+ * batch        the LaneBatch
+ * i            the line index of the pixel
+ * j            the column index of the pixel
+ * lane         the lane
+ *
+ * RETURN
+ * the pixel energy of the pixel (i, j) of the lane.
+ * ------------------------------------------------------------------------- */
+static float lane_energy(const LaneBatch* batch, size_t i, size_t j, size_t lane);
+
+/* ------------------------------------------------------------------------- *
+ * Calculate the energy of the pixel (i, j) of every lane.
+ *
+ * PARAMETERS
+ * batch        the LaneBatch
+ * i            the line index of the pixel
+ * j            the column index of the pixel
+ * energies     array of LANES floats receiving the energies
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void lane_energies(const LaneBatch* batch, size_t i, size_t j, float* energies);
+
+/* ------------------------------------------------------------------------- *
+ * Compute the cost of pixel (i, j) of every lane from its energies and the
+ * costs of line i - 1.
+ *
+ * PARAMETERS
+ * batch        the LaneBatch
+ * i            the line index of the pixel (at least 1)
+ * j            the column index of the pixel
+ * energies     the energies of the pixel
+ * costs        array of LANES floats receiving the costs
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void lane_costs(const LaneBatch* batch, size_t i, size_t j, const float* energies, float* costs);
+
+/* ------------------------------------------------------------------------- *
+ * Compute the whole cost table of every lane.
+ *
+ * PARAMETERS
+ * batch        the LaneBatch
+ * stats        the measures, whose energy and DP build times are increased (or NULL)
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void compute_lane_costs(LaneBatch* batch, SlimmingStats* stats);
+
+/* ------------------------------------------------------------------------- *
+ * Find the groove with the smallest cost of every lane, and store it in the
+ * path of the LaneBatch.
+ *
+ * PARAMETERS
+ * batch        the LaneBatch
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void find_lane_grooves(LaneBatch* batch);
+
+/* ------------------------------------------------------------------------- *
+ * Remove the groove of every lane from the images and from the cost table.
+ * Each line of each lane gathers the values at the right of its groove.
+ *
+ * PARAMETERS
+ * batch        the LaneBatch
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void remove_lane_grooves(LaneBatch* batch);
+
+/* ------------------------------------------------------------------------- *
+ * Update the cost table of every lane after removing the grooves. The cells
+ * of the union of the cones of the lanes are computed for every lane, and
+ * kept in the lanes whose cone contains them.
+ *
+ * PARAMETERS
+ * batch        the LaneBatch
+ * stats        the measures, whose number of updated cells is increased (or NULL)
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void update_lane_costs(LaneBatch* batch, SlimmingStats* stats);
+
+/* ------------------------------------------------------------------------- *
+ * Copy the image of a lane into a new PNM image.
+ *
+ * PARAMETERS
+ * batch        the LaneBatch
+ * lane         the lane
+ *
+ * RETURN
+ * image, pointer to the new PNM image.
+ * NULL in case of error.
+ * ------------------------------------------------------------------------- */
+static PNMImage* extract_lane_image(const LaneBatch* batch, size_t lane);
+
+/* ------------------------------------------------------------------------- *
+ *
+ * IMPLEMENTATION
+ *
+ * ------------------------------------------------------------------------- */
+
+static LaneBatch* create_lane_batch(const PNMImage* const* images, size_t nbImages){
+	LaneBatch* batch = malloc(sizeof(LaneBatch));
+	if(!batch)
+		return NULL;
+
+	batch->height = images[0]->height;
+	batch->stride = images[0]->width;
+	batch->width = images[0]->width;
+	batch->nbLanes = nbImages;
+
+	size_t size = batch->height * batch->stride * LANES;
+	batch->red = malloc(size);
+	batch->green = malloc(size);
+	batch->blue = malloc(size);
+	batch->table = malloc(sizeof(float) * size);
+	batch->path = malloc(sizeof(size_t) * batch->height * LANES);
+
+	if(!batch->red || !batch->green || !batch->blue || !batch->table || !batch->path){
+		destroy_lane_batch(batch);
+		return NULL;
+	}
+
+	//The unused lanes repeat the first image, so that every lane holds valid values.
+	for(size_t lane = 0; lane < LANES; ++lane){
+		const PNMImage* image = images[lane < nbImages ? lane : 0];
+
+		for(size_t p = 0; p < batch->height * batch->stride; ++p){
+			batch->red[p * LANES + lane] = image->data[p].red;
+			batch->green[p * LANES + lane] = image->data[p].green;
+			batch->blue[p * LANES + lane] = image->data[p].blue;
+		}
+	}
+
+	return batch;
+}//End create_lane_batch()
+
+static void destroy_lane_batch(LaneBatch* batch){
+
+	if(batch){
+		free(batch->red);
+		free(batch->green);
+		free(batch->blue);
+		free(batch->table);
+		free(batch->path);
+		free(batch);
+	}
+
+	return;
+}//End destroy_lane_batch()
+
+static inline size_t cell(const LaneBatch* batch, size_t i, size_t j){
+	return (i * batch->stride + j) * LANES;
+}//End cell()
+
+static float lane_energy(const LaneBatch* batch, size_t i, size_t j, size_t lane){
+	//On the edges, the pixel itself replaces its missing neighbour.
+	size_t up = cell(batch, i > 0 ? i - 1 : i, j) + lane;
+	size_t down = cell(batch, i < batch->height - 1 ? i + 1 : i, j) + lane;
+	size_t left = cell(batch, i, j > 0 ? j - 1 : j) + lane;
+	size_t right = cell(batch, i, j < batch->width - 1 ? j + 1 : j) + lane;
+
+	return (fabsf((float)batch->red[up] - batch->red[down]) / 2 +
+	        fabsf((float)batch->red[left] - batch->red[right]) / 2) +
+	       (fabsf((float)batch->green[up] - batch->green[down]) / 2 +
+	        fabsf((float)batch->green[left] - batch->green[right]) / 2) +
+	       (fabsf((float)batch->blue[up] - batch->blue[down]) / 2 +
+	        fabsf((float)batch->blue[left] - batch->blue[right]) / 2);
+}//End lane_energy()
+
+static void lane_energies(const LaneBatch* batch, size_t i, size_t j, float* energies){
+	size_t up = cell(batch, i > 0 ? i - 1 : i, j);
+	size_t down = cell(batch, i < batch->height - 1 ? i + 1 : i, j);
+	size_t left = cell(batch, i, j > 0 ? j - 1 : j);
+	size_t right = cell(batch, i, j < batch->width - 1 ? j + 1 : j);
+
+	const unsigned char *red = batch->red, *green = batch->green, *blue = batch->blue;
+
+	for(size_t lane = 0; lane < LANES; ++lane){
+		energies[lane] = (fabsf((float)red[up + lane] - red[down + lane]) / 2 +
+		                  fabsf((float)red[left + lane] - red[right + lane]) / 2) +
+		                 (fabsf((float)green[up + lane] - green[down + lane]) / 2 +
+		                  fabsf((float)green[left + lane] - green[right + lane]) / 2) +
+		                 (fabsf((float)blue[up + lane] - blue[down + lane]) / 2 +
+		                  fabsf((float)blue[left + lane] - blue[right + lane]) / 2);
+	}
+
+	return;
+}//End lane_energies()
+
+static void lane_costs(const LaneBatch* batch, size_t i, size_t j, const float* energies, float* costs){
+	const float* above = &batch->table[cell(batch, i - 1, j)];
+
+	//On the left and right edges of the image, only 2 possible values.
+	if(j == 0){
+		for(size_t lane = 0; lane < LANES; ++lane){
+			float middle = above[lane], right = above[LANES + lane];
+			costs[lane] = energies[lane] + (middle < right ? middle : right);
+		}
+	}else if(j == batch->width - 1){
+		for(size_t lane = 0; lane < LANES; ++lane){
+			float middle = above[lane], left = above[lane - LANES];
+			costs[lane] = energies[lane] + (middle < left ? middle : left);
+		}
+	}else{
+		for(size_t lane = 0; lane < LANES; ++lane){
+			float left = above[lane - LANES], middle = above[lane], right = above[LANES + lane];
+			float best = middle < right ? middle : right;
+			costs[lane] = energies[lane] + (left < best ? left : best);
+		}
+	}
+
+	return;
+}//End lane_costs()
+
+static void compute_lane_costs(LaneBatch* batch, SlimmingStats* stats){
+	double startTime = getTimeSeconds();
+
+	for(size_t i = 0; i < batch->height; ++i){
+		for(size_t j = 0; j < batch->width; ++j)
+			lane_energies(batch, i, j, &batch->table[cell(batch, i, j)]);
+	}
+
+	double energyTime = getTimeSeconds();
+
+	//The first line only contains the energies. Each cost only depends on the line above.
+	for(size_t i = 1; i < batch->height; ++i){
+		for(size_t j = 0; j < batch->width; ++j){
+			float* costs = &batch->table[cell(batch, i, j)];
+			lane_costs(batch, i, j, costs, costs);
+		}
+	}
+
+	if(stats){
+		stats->phaseSeconds[SLIMMING_PHASE_ENERGY] += energyTime - startTime;
+		stats->phaseSeconds[SLIMMING_PHASE_DP_BUILD] += getTimeSeconds() - energyTime;
+	}
+
+	return;
+}//End compute_lane_costs()
+
+static void find_lane_grooves(LaneBatch* batch){
+	const size_t last = batch->height - 1;
+	const float* table = batch->table;
+	size_t* path = batch->path;
+
+	//Minimum cost of the last line of each lane, the first one in case of tie.
+	float minLastLine[LANES];
+	for(size_t lane = 0; lane < LANES; ++lane){
+		minLastLine[lane] = FLT_MAX;
+		path[last * LANES + lane] = 0;
+	}
+
+	for(size_t j = 0; j < batch->width; ++j){
+		const float* costs = &table[cell(batch, last, j)];
+
+		for(size_t lane = 0; lane < LANES; ++lane){
+			if(costs[lane] < minLastLine[lane]){
+				minLastLine[lane] = costs[lane];
+				path[last * LANES + lane] = j;
+			}
+		}
+	}
+
+	//Bottom-up, each lane reads the neighbours of its own groove (same rule as find_optimal_pixel()).
+	for(size_t i = last; i > 0; --i){
+		for(size_t lane = 0; lane < LANES; ++lane){
+			size_t column = path[i * LANES + lane];
+			const float* above = &table[cell(batch, i - 1, column) + lane];
+
+			if(column == 0)
+				column = above[0] < above[LANES] ? column : column + 1;
+			else if(column == batch->width - 1)
+				column = above[0] < above[-LANES] ? column : column - 1;
+			else if(above[-LANES] < above[0] && above[-LANES] < above[LANES])
+				column--;
+			else if(!(above[0] < above[LANES]))
+				column++;
+
+			path[(i - 1) * LANES + lane] = column;
+		}
+	}
+
+	return;
+}//End find_lane_grooves()
+
+static void remove_lane_grooves(LaneBatch* batch){
+	const size_t width = batch->width;
+	const size_t window = (width - 1) * batch->height;
+
+	/*
+	 As remove_groove_image() only shifts the first (width - 1) * height pixels of the
+	 image, the pixels of the grooves beyond them are not removed, and the last positions
+	 of the image are filled with the pixel at position window - 1. This is reproduced
+	 so that the results match the ones of reduceImageWidth().
+	*/
+	size_t tail = cell(batch, (window - 1) / width, (window - 1) % width);
+	unsigned char tailRed[LANES], tailGreen[LANES], tailBlue[LANES];
+	size_t nbRemoved[LANES];
+
+	for(size_t lane = 0; lane < LANES; ++lane){
+		tailRed[lane] = batch->red[tail + lane];
+		tailGreen[lane] = batch->green[tail + lane];
+		tailBlue[lane] = batch->blue[tail + lane];
+		nbRemoved[lane] = 0;
+
+		for(size_t i = 0; i < batch->height; ++i){
+			if(i * width + batch->path[i * LANES + lane] < window)
+				nbRemoved[lane]++;
+		}
+	}
+
+	for(size_t i = 0; i < batch->height; ++i){
+		const size_t* columns = &batch->path[i * LANES];
+
+		//Nothing changes on the left of the leftmost groove of the line.
+		size_t first = columns[0];
+		for(size_t lane = 1; lane < LANES; ++lane){
+			if(columns[lane] < first)
+				first = columns[lane];
+		}
+
+		for(size_t j = first; j + 1 < width; ++j){
+			size_t position = cell(batch, i, j);
+
+			//Lanes whose groove is at the left of j take the value of column j + 1.
+			for(size_t lane = 0; lane < LANES; ++lane){
+				size_t source = j >= columns[lane] ? position + LANES + lane : position + lane;
+
+				batch->red[position + lane] = batch->red[source];
+				batch->green[position + lane] = batch->green[source];
+				batch->blue[position + lane] = batch->blue[source];
+				batch->table[position + lane] = batch->table[source];
+			}
+		}
+	}
+
+	--batch->width;
+
+	for(size_t lane = 0; lane < LANES; ++lane){
+		for(size_t p = window - nbRemoved[lane]; p < window; ++p){
+			size_t position = cell(batch, p / batch->width, p % batch->width) + lane;
+
+			batch->red[position] = tailRed[lane];
+			batch->green[position] = tailGreen[lane];
+			batch->blue[position] = tailBlue[lane];
+		}
+	}
+
+	return;
+}//End remove_lane_grooves()
+
+static void update_lane_costs(LaneBatch* batch, SlimmingStats* stats){
+
+	//With a width of 1, no other groove can be removed.
+	if(batch->width == 1)
+		return;
+
+	const size_t* firstColumns = batch->path;
+	float* table = batch->table;
+
+	//First line: the neighbours of the removed pixel.
+	for(size_t lane = 0; lane < LANES; ++lane){
+		size_t column = firstColumns[lane];
+
+		if(column == 0)
+			table[cell(batch, 0, 0) + lane] = lane_energy(batch, 0, 0, lane);
+		else if(column < batch->width){
+			table[cell(batch, 0, column - 1) + lane] = lane_energy(batch, 0, column - 1, lane);
+			table[cell(batch, 0, column) + lane] = lane_energy(batch, 0, column, lane);
+			if(column + 1 < batch->width)
+				table[cell(batch, 0, column + 1) + lane] = lane_energy(batch, 0, column + 1, lane);
+		}
+	}
+
+	size_t minFirst = firstColumns[0], maxFirst = firstColumns[0];
+	for(size_t lane = 1; lane < LANES; ++lane){
+		if(firstColumns[lane] < minFirst)
+			minFirst = firstColumns[lane];
+		if(firstColumns[lane] > maxFirst)
+			maxFirst = firstColumns[lane];
+	}
+
+	float energies[LANES], costs[LANES];
+	size_t nbUpdatedCells = 0;
+
+	//Line i of the cone of a lane covers the columns [first - i, first + i].
+	for(size_t i = 1; i < batch->height; ++i){
+		size_t begin = minFirst > i ? minFirst - i : 0;
+		size_t end = maxFirst + i < batch->width - 1 ? maxFirst + i : batch->width - 1;
+
+		for(size_t lane = 0; lane < batch->nbLanes; ++lane){
+			size_t laneBegin = firstColumns[lane] > i ? firstColumns[lane] - i : 0;
+			size_t laneEnd = firstColumns[lane] + i < batch->width - 1 ? firstColumns[lane] + i : batch->width - 1;
+			if(laneBegin <= laneEnd)
+				nbUpdatedCells += laneEnd - laneBegin + 1;
+		}
+
+		for(size_t j = begin; j <= end; ++j){
+			float* cells = &table[cell(batch, i, j)];
+
+			lane_energies(batch, i, j, energies);
+			lane_costs(batch, i, j, energies, costs);
+
+			for(size_t lane = 0; lane < LANES; ++lane){
+				bool inCone = j + i >= firstColumns[lane] && j <= firstColumns[lane] + i;
+				cells[lane] = inCone ? costs[lane] : cells[lane];
+			}
+		}
+	}
+
+	if(stats)
+		stats->nbUpdatedCells += nbUpdatedCells;
+
+	return;
+}//End update_lane_costs()
+
+static PNMImage* extract_lane_image(const LaneBatch* batch, size_t lane){
+	PNMImage* image = createPNM(batch->width, batch->height);
+	if(!image)
+		return NULL;
+
+	for(size_t i = 0; i < batch->height; ++i){
+		for(size_t j = 0; j < batch->width; ++j){
+			size_t position = cell(batch, i, j) + lane;
+			PNMPixel* pixel = &image->data[i * batch->width + j];
+
+			pixel->red = batch->red[position];
+			pixel->green = batch->green[position];
+			pixel->blue = batch->blue[position];
+		}
+	}
+
+	return image;
+}//End extract_lane_image()
+
+int reduceImagesWidth(const PNMImage* const* images, size_t nbImages, size_t k,
+                      PNMImage** reducedImages, const SlimmingOptions* options){
+
+	SlimmingOptions defaultOptions;
+	if(!options){
+		initSlimmingOptions(&defaultOptions);
+		options = &defaultOptions;
+	}
+
+	if(!images || !reducedImages)
+		return -1;
+
+	for(size_t n = 0; n < nbImages; ++n){
+		if(!images[n] || !images[n]->data || images[n]->width != images[0]->width ||
+		   images[n]->height != images[0]->height || k >= images[n]->width)
+			return -1;
+
+		reducedImages[n] = NULL;
+	}
+
+	if(nbImages == 0)
+		return 0;
+
+	SlimmingStats* stats = options->stats;
+	double startTime = getTimeSeconds();
+	double phaseStart;
+
+	if(stats){
+		for(size_t phase = 0; phase < NB_SLIMMING_PHASES; ++phase)
+			stats->phaseSeconds[phase] = 0;
+		stats->totalSeconds = 0;
+		stats->nbGrooves = 0;
+		stats->nbUpdatedCells = 0;
+		stats->nbSearchedCells = 0;
+		stats->nbBulkGrooves = 0;
+		stats->nbRunGrooves = 0;
+		stats->removedEnergy = 0;
+		stats->peakResidentBytes = 0;
+		stats->finalResidentBytes = 0;
+		stats->releasedBytes = 0;
+	}
+
+	//Without a groove to remove, with a single line, with wide grooves, or with an output size, the images
+	//are reduced one by one.
+	bool lockstep = k > 0 && images[0]->height > 1 && options->grooveWidth <= 1 &&
+	                options->outputWidth == 0 && options->outputHeight == 0;
+	bool failed = false;
+
+	for(size_t first = 0; first < nbImages && !failed; first += LANES){
+		size_t nbLanes = nbImages - first < LANES ? nbImages - first : LANES;
+
+		if(!lockstep){
+			SlimmingOptions singleOptions = *options;
+			singleOptions.stats = NULL;
+			singleOptions.waitLines = NULL;
+
+			for(size_t lane = 0; lane < nbLanes && !failed; ++lane){
+				reducedImages[first + lane] = reduceImageWidthWithOptions(images[first + lane], k, &singleOptions);
+				failed = !reducedImages[first + lane];
+			}
+			continue;
+		}
+
+		LaneBatch* batch = create_lane_batch(&images[first], nbLanes);
+		if(!batch){
+			failed = true;
+			break;
+		}
+
+		compute_lane_costs(batch, stats);
+
+		for(size_t number = 0; number < k; ++number){
+
+			phaseStart = getTimeSeconds();
+			find_lane_grooves(batch);
+
+			double backtrackTime = getTimeSeconds();
+			remove_lane_grooves(batch);
+
+			double removalTime = getTimeSeconds();
+			update_lane_costs(batch, stats);
+
+			if(stats){
+				stats->phaseSeconds[SLIMMING_PHASE_BACKTRACK] += backtrackTime - phaseStart;
+				stats->phaseSeconds[SLIMMING_PHASE_REMOVAL] += removalTime - backtrackTime;
+				stats->phaseSeconds[SLIMMING_PHASE_UPDATE] += getTimeSeconds() - removalTime;
+				stats->nbGrooves += nbLanes;
+			}
+		}
+
+		for(size_t lane = 0; lane < nbLanes && !failed; ++lane){
+			reducedImages[first + lane] = extract_lane_image(batch, lane);
+			failed = !reducedImages[first + lane];
+		}
+
+		destroy_lane_batch(batch);
+	}
+
+	if(failed){
+		for(size_t n = 0; n < nbImages; ++n){
+			freePNM(reducedImages[n]);
+			reducedImages[n] = NULL;
+		}
+
+		return -2;
+	}
+
+	if(stats)
+		stats->totalSeconds = getTimeSeconds() - startTime;
+
+	return 0;
+}//End reduceImagesWidth()
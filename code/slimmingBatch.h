@@ -0,0 +1,52 @@
+/* ------------------------------------------------------------------------- *
+ * Interface for slimming many images of the same size at once.
+ *
+ * The images are interleaved, SLIMMING_BATCH_LANES at a time, in a layout
+ * where the values of a pixel in every image are consecutive (one image per
+ * vector lane). The energies, the cost table, the grooves and their removal
+ * are then computed for all the images in lockstep. Each reduced image is
+ * identical to the one given by reduceImageWidth().
+ * ------------------------------------------------------------------------- */
+
+#ifndef _SLIMMING_BATCH_H_
+#define _SLIMMING_BATCH_H_
+
+#include <stddef.h>
+
+#include "slimming.h"
+#include "PNM.h"
+
+//Number of images reduced in lockstep.
+#define SLIMMING_BATCH_LANES 8
+
+// Methods --------------------------------------------------------------------
+
+/* ------------------------------------------------------------------------- *
+ * Reduce the width of several PNM images of the same size by k pixels.
+ *
+ * Each reduced image must later be deleted by calling freePNM().
+ *
+ * PARAMETERS
+ * images         Array of nbImages pointers to PNM images, all of the same
+ *                size
+ * nbImages       The number of images
+ * k              The number of pixels to be removed (along the width axis)
+ * reducedImages  Array of nbImages pointers, receiving the reduced images
+ *                (all NULL if an error occured)
+ * options        Pointer to the options (NULL for the default ones); the
+ *                number of threads and waitLines are not used (the images
+ *                are loaded) and the measures are the ones of the whole
+ *                batch (without the removed energy); with grooves wider
+ *                than 1 column, or an output size, the images are reduced
+ *                one by one
+ *
+ * RETURN
+ * 0            In case of success
+ * -1           if the images do not have the same size, or if k is not
+ *              smaller than their width
+ * -2           if an allocation failed
+ * ------------------------------------------------------------------------- */
+int reduceImagesWidth(const PNMImage* const* images, size_t nbImages, size_t k,
+                      PNMImage** reducedImages, const SlimmingOptions* options);
+
+#endif // _SLIMMING_BATCH_H_
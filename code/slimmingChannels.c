@@ -0,0 +1,398 @@
+/* ------------------------------------------------------------------------- *
+ * Implementation of the multichannel slimming interface.
+ * ------------------------------------------------------------------------- */
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+
+#include "slimmingChannels.h"
+#include "timing.h"
+
+/* ------------------------------------------------------------------------- *
+ *
+ * STRUCTURES
+ *
+ * ------------------------------------------------------------------------- */
+
+//Structure representing an image being reduced. Its lines keep the initial width as stride.
+typedef struct ChannelImage_t{
+	size_t width, height; //Current width and height of the image.
+	size_t depth; //Number of channels of each pixel.
+	size_t stride; //Initial width of the image.
+	unsigned char *pixels; //Channels of the pixels (pixel (i, j) at position (i * stride + j) * depth).
+	float *energies; //Energy of each pixel (pixel (i, j) at position i * stride + j).
+	float *costs; //Cost of the best groove from the first line to each pixel (same positions).
+	unsigned short *differences; //Differences of each channel of a line (stride * depth).
+	size_t *path; //Column of the current groove on each line.
+}ChannelImage;
+
+/* ------------------------------------------------------------------------- *
+ *
+ * PROTOTYPES OF STATIC FUNCTIONS
+ *
+ * ------------------------------------------------------------------------- */
+
+/* ------------------------------------------------------------------------- *
+ * Create the ChannelImage of a PAM image.
+ *
+ * PARAMETERS
+ * image        the PAM image
+ *
+ * NOTE
+ * The returned pointer should be freed using destroy_channel_image() after
+ * usage.
+ *
+ * RETURN
+ * channelImage, pointer to the new ChannelImage (its energies not computed).
+ * NULL in case of error.
+ * ------------------------------------------------------------------------- */
+static ChannelImage* create_channel_image(const PAMImage* image);
+
+/* ------------------------------------------------------------------------- *
+ * Free the memory of a ChannelImage.
+ *
+ * PARAMETERS
+ * channelImage the ChannelImage we want to free
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void destroy_channel_image(ChannelImage* channelImage);
+
+/* ------------------------------------------------------------------------- *
+ * Compute the energies of the pixels [first, last) of a line. The absolute
+ * differences of the neighbours of each channel are computed over the line
+ * as a flat array of bytes, then summed per pixel. A missing neighbour (on
+ * an edge) is replaced by the pixel itself.
+ *
+ * PARAMETERS
+ * channelImage the ChannelImage
+ * i            the line index
+ * first, last  the columns of the pixels (first < last <= width)
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void compute_line_energies(ChannelImage* channelImage, size_t i, size_t first, size_t last);
+
+/* ------------------------------------------------------------------------- *
+ * Compute the cost of each pixel from the energies, as compute_cost_line()
+ * of slimming.c does.
+ *
+ * PARAMETERS
+ * channelImage the ChannelImage, at least 2 pixels wide
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void compute_costs(ChannelImage* channelImage);
+
+/* ------------------------------------------------------------------------- *
+ * Find the groove with the smallest cost, breaking the ties as
+ * find_optimal_groove() of slimming.c does, and store it in the path.
+ *
+ * PARAMETERS
+ * channelImage the ChannelImage, whose costs are computed
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void find_groove(ChannelImage* channelImage);
+
+/* ------------------------------------------------------------------------- *
+ * Remove the groove of the path: the pixels (depth bytes each) and the
+ * energies after it are moved within their line, then the energies of the
+ * pixels whose neighbours changed are computed again.
+ *
+ * PARAMETERS
+ * channelImage the ChannelImage, whose path holds the groove
+ *
+ * RETURN
+ * nbUpdated, the number of energies computed again.
+ * ------------------------------------------------------------------------- */
+static size_t remove_groove(ChannelImage* channelImage);
+
+/* ------------------------------------------------------------------------- *
+ *
+ * IMPLEMENTATION
+ *
+ * ------------------------------------------------------------------------- */
+
+static ChannelImage* create_channel_image(const PAMImage* image){
+	size_t width = image->width, height = image->height, depth = image->depth;
+
+	ChannelImage* channelImage = calloc(1, sizeof(ChannelImage));
+	if(!channelImage)
+		return NULL;
+
+	channelImage->width = width;
+	channelImage->height = height;
+	channelImage->depth = depth;
+	channelImage->stride = width;
+
+	channelImage->pixels = malloc(width * height * depth);
+	channelImage->energies = malloc(sizeof(float) * width * height);
+	channelImage->costs = malloc(sizeof(float) * width * height);
+	channelImage->differences = malloc(sizeof(unsigned short) * width * depth);
+	channelImage->path = malloc(sizeof(size_t) * height);
+	if(!channelImage->pixels || !channelImage->energies || !channelImage->costs || !channelImage->differences ||
+	   !channelImage->path){
+		destroy_channel_image(channelImage);
+		return NULL;
+	}
+
+	memcpy(channelImage->pixels, image->data, width * height * depth);
+
+	return channelImage;
+}//End create_channel_image()
+
+static void destroy_channel_image(ChannelImage* channelImage){
+
+	if(channelImage){
+		free(channelImage->pixels);
+		free(channelImage->energies);
+		free(channelImage->costs);
+		free(channelImage->differences);
+		free(channelImage->path);
+		free(channelImage);
+	}
+
+	return;
+}//End destroy_channel_image()
+
+static void compute_line_energies(ChannelImage* channelImage, size_t i, size_t first, size_t last){
+	size_t width = channelImage->width, depth = channelImage->depth;
+	size_t lineSize = channelImage->stride * depth;
+
+	const unsigned char* line = &channelImage->pixels[i * lineSize];
+	const unsigned char* up = i > 0 ? line - lineSize : line;
+	const unsigned char* down = i + 1 < channelImage->height ? line + lineSize : line;
+	unsigned short* differences = channelImage->differences;
+
+	//Inner pixels: every channel of every pixel in a single loop, without any branch.
+	size_t begin = (first > 0 ? first : 1) * depth;
+	size_t end = (last < width - 1 ? last : width - 1) * depth;
+
+	for(size_t b = begin; b < end; ++b)
+		differences[b] = abs(up[b] - down[b]) + abs(line[b - depth] - line[b + depth]);
+
+	//The pixels on the left and right edges are their own missing neighbour.
+	if(first == 0){
+		size_t right = width > 1 ? depth : 0;
+
+		for(size_t c = 0; c < depth; ++c)
+			differences[c] = abs(up[c] - down[c]) + abs(line[c] - line[right + c]);
+	}
+
+	if(last == width && width > 1){
+		size_t b = (width - 1) * depth;
+
+		for(size_t c = 0; c < depth; ++c)
+			differences[b + c] = abs(up[b + c] - down[b + c]) + abs(line[b - depth + c] - line[b + c]);
+	}
+
+	//Each difference is twice the one of the energy: the sums stay exact.
+	float* energies = &channelImage->energies[i * channelImage->stride];
+
+	for(size_t j = first; j < last; ++j){
+		unsigned sum = 0;
+
+		for(size_t c = 0; c < depth; ++c)
+			sum += differences[j * depth + c];
+
+		energies[j] = (float)sum / 2;
+	}
+
+	return;
+}//End compute_line_energies()
+
+static void compute_costs(ChannelImage* channelImage){
+	size_t width = channelImage->width, stride = channelImage->stride;
+
+	memcpy(channelImage->costs, channelImage->energies, sizeof(float) * width);
+
+	for(size_t i = 1; i < channelImage->height; ++i){
+		const float* energies = &channelImage->energies[i * stride];
+		const float* previous = &channelImage->costs[(i - 1) * stride];
+		float* costs = &channelImage->costs[i * stride];
+
+		costs[0] = energies[0] + (previous[0] < previous[1] ? previous[0] : previous[1]);
+
+		for(size_t j = 1; j < width - 1; ++j){
+			float minimum = previous[j - 1] < previous[j] ? previous[j - 1] : previous[j];
+
+			costs[j] = energies[j] + (previous[j + 1] < minimum ? previous[j + 1] : minimum);
+		}
+
+		costs[width - 1] = energies[width - 1] +
+		                   (previous[width - 1] < previous[width - 2] ? previous[width - 1] : previous[width - 2]);
+	}//End for()
+
+	return;
+}//End compute_costs()
+
+static void find_groove(ChannelImage* channelImage){
+	size_t width = channelImage->width, height = channelImage->height, stride = channelImage->stride;
+
+	//The leftmost pixel with the smallest cost on the last line.
+	const float* costs = &channelImage->costs[(height - 1) * stride];
+	float minLastLine = FLT_MAX;
+	size_t column = 0;
+
+	for(size_t j = 0; j < width; ++j){
+		if(costs[j] < minLastLine){
+			minLastLine = costs[j];
+			column = j;
+		}
+	}
+
+	channelImage->path[height - 1] = column;
+
+	//Bottom-up, each neighbour on the line above is chosen as find_optimal_pixel() does.
+	for(size_t i = height - 1; i > 0; --i){
+		costs = &channelImage->costs[(i - 1) * stride];
+
+		if(column == 0){
+			if(!(costs[0] < costs[1]))
+				column = 1;
+		}
+		else if(column == width - 1){
+			if(!(costs[column] < costs[column - 1]))
+				column--;
+		}
+		else{
+			if(costs[column - 1] < costs[column] && costs[column - 1] < costs[column + 1])
+				column--;
+			else if(!(costs[column] < costs[column + 1]))
+				column++;
+		}
+
+		channelImage->path[i - 1] = column;
+	}//End for()
+
+	return;
+}//End find_groove()
+
+static size_t remove_groove(ChannelImage* channelImage){
+	size_t height = channelImage->height, depth = channelImage->depth, stride = channelImage->stride;
+	size_t width = channelImage->width - 1;
+	const size_t* path = channelImage->path;
+	size_t nbUpdated = 0;
+
+	//The pixels after the groove move by one pixel, within their line.
+	for(size_t i = 0; i < height; ++i){
+		size_t column = path[i];
+		unsigned char* pixel = &channelImage->pixels[(i * stride + column) * depth];
+		float* energy = &channelImage->energies[i * stride + column];
+
+		memmove(pixel, pixel + depth, (width - column) * depth);
+		memmove(energy, energy + 1, sizeof(float) * (width - column));
+	}
+
+	channelImage->width = width;
+
+	//A pixel keeps its energy unless it was next to the groove, or the groove
+	//crossed the columns between its own and the one of the pixel above or below.
+	for(size_t i = 0; i < height; ++i){
+		size_t first = path[i], last = path[i];
+
+		if(i > 0){
+			first = path[i - 1] < first ? path[i - 1] : first;
+			last = path[i - 1] > last ? path[i - 1] : last;
+		}
+
+		if(i + 1 < height){
+			first = path[i + 1] < first ? path[i + 1] : first;
+			last = path[i + 1] > last ? path[i + 1] : last;
+		}
+
+		first = first > 0 ? first - 1 : 0;
+		last = last + 1 < width ? last + 1 : width;
+
+		compute_line_energies(channelImage, i, first, last);
+		nbUpdated += last - first;
+	}//End for()
+
+	return nbUpdated;
+}//End remove_groove()
+
+PAMImage* reducePAMWidth(const PAMImage* image, size_t k, SlimmingStats* stats){
+	if(!image || !image->data || k >= image->width)
+		return NULL;
+
+	double startTime = getTimeSeconds();
+	double phaseStart = startTime;
+
+	if(stats){
+		for(size_t phase = 0; phase < NB_SLIMMING_PHASES; ++phase)
+			stats->phaseSeconds[phase] = 0;
+		stats->totalSeconds = 0;
+		stats->nbGrooves = 0;
+		stats->nbUpdatedCells = 0;
+		stats->nbSearchedCells = 0;
+		stats->nbBulkGrooves = 0;
+		stats->nbRunGrooves = 0;
+		stats->removedEnergy = 0;
+		stats->peakResidentBytes = 0;
+		stats->finalResidentBytes = 0;
+		stats->releasedBytes = 0;
+	}
+
+	ChannelImage* channelImage = create_channel_image(image);
+	PAMImage* reducedImage = createPAM(image->width - k, image->height, image->depth);
+	if(!channelImage || !reducedImage){
+		destroy_channel_image(channelImage);
+		freePAM(reducedImage);
+		return NULL;
+	}
+
+	for(size_t i = 0; i < image->height; ++i)
+		compute_line_energies(channelImage, i, 0, image->width);
+
+	if(stats)
+		stats->phaseSeconds[SLIMMING_PHASE_ENERGY] += getTimeSeconds() - phaseStart;
+
+	for(size_t number = 0; number < k; ++number){
+
+		phaseStart = getTimeSeconds();
+
+		compute_costs(channelImage);
+
+		double costTime = getTimeSeconds();
+
+		find_groove(channelImage);
+
+		double searchTime = getTimeSeconds();
+
+		//The cost of the groove is the one of its pixel on the last line.
+		if(stats)
+			stats->removedEnergy += channelImage->costs[(image->height - 1) * channelImage->stride +
+			                                            channelImage->path[image->height - 1]];
+
+		size_t nbUpdated = remove_groove(channelImage);
+
+		if(stats){
+			stats->phaseSeconds[number == 0 ? SLIMMING_PHASE_DP_BUILD : SLIMMING_PHASE_UPDATE] += costTime - phaseStart;
+			stats->phaseSeconds[SLIMMING_PHASE_BACKTRACK] += searchTime - costTime;
+			stats->phaseSeconds[SLIMMING_PHASE_REMOVAL] += getTimeSeconds() - searchTime;
+			stats->nbUpdatedCells += nbUpdated;
+			stats->nbGrooves++;
+		}
+	}//End for()
+
+	phaseStart = getTimeSeconds();
+
+	size_t lineSize = reducedImage->width * image->depth;
+
+	for(size_t i = 0; i < image->height; ++i)
+		memcpy(&reducedImage->data[i * lineSize], &channelImage->pixels[i * image->width * image->depth], lineSize);
+
+	destroy_channel_image(channelImage);
+
+	if(stats){
+		stats->phaseSeconds[SLIMMING_PHASE_REMOVAL] += getTimeSeconds() - phaseStart;
+		stats->totalSeconds = getTimeSeconds() - startTime;
+	}
+
+	return reducedImage;
+}//End reducePAMWidth()
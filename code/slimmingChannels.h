@@ -0,0 +1,46 @@
+/* ------------------------------------------------------------------------- *
+ * Interface for slimming images of any number of channels, such as the
+ * multispectral captures loaded from PAM files.
+ *
+ * The energy of a pixel is the sum, over its channels, of half the absolute
+ * differences between its neighbours above and below it, and on its left
+ * and on its right, as for a PNM image. The channels of a line are handled
+ * as one flat array of bytes, the horizontal neighbours of a byte being
+ * `depth` bytes away: a single loop, which the compiler vectorises, computes
+ * the differences of every channel, which are then summed per pixel.
+ *
+ * The grooves are the ones of the astar engine of slimming.h (the optimal
+ * groove of the cost table computed anew after each removal): an image of
+ * 3 channels is reduced as the PNM image of the same pixels. After each
+ * removal, only the energies of the pixels next to the groove are computed
+ * again.
+ * ------------------------------------------------------------------------- */
+
+#ifndef _SLIMMING_CHANNELS_H_
+#define _SLIMMING_CHANNELS_H_
+
+#include <stddef.h>
+
+#include "PAM.h"
+#include "slimming.h"
+
+// Methods --------------------------------------------------------------------
+
+/* ------------------------------------------------------------------------- *
+ * Reduce the width of a PAM image to `image->width-k`.
+ *
+ * The PAM image must later be deleted by calling freePAM().
+ *
+ * PARAMETERS
+ * image        Pointer to a PAM image
+ * k            The number of pixels to be removed (along the width axis)
+ * stats        Where to store the measures of the reduction (or NULL)
+ *
+ * RETURN
+ * image        Pointer to a new PAM image
+ * NULL         if k is not smaller than the width of the image, or if an
+ *              error occured
+ * ------------------------------------------------------------------------- */
+PAMImage* reducePAMWidth(const PAMImage* image, size_t k, SlimmingStats* stats);
+
+#endif // _SLIMMING_CHANNELS_H_
@@ -0,0 +1,358 @@
+/* ------------------------------------------------------------------------- *
+ * Implementation of the stream slimming interface.
+ * ------------------------------------------------------------------------- */
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+#include <limits.h>
+
+#include "slimmingStream.h"
+
+/* ------------------------------------------------------------------------- *
+ *
+ * STRUCTURES
+ *
+ * ------------------------------------------------------------------------- */
+
+//Structure representing a stream of lines, of which the last delay + 2 are kept.
+//The lines are never moved: each line of the window lists the columns of the grooves found so far.
+struct SlimmingStream_t{
+	size_t width; //Width of the lines received.
+	size_t k; //Number of pixels removed from each line.
+	size_t delay; //Number of lines received after a line before it is committed.
+	size_t nbKept; //Number of lines of the ring (delay + 2: the pending lines and the last committed one).
+	size_t nbReceived; //Number of lines received.
+	size_t nbCommitted; //Number of lines committed.
+	PNMPixel *lines; //Ring of the last lines received (line n at position (n % nbKept) * width).
+	size_t *removed; //Columns (of the line as received) of the grooves found so far on each line of the window, in increasing order (line i at position i * k).
+	size_t *origins; //Column, as received, of each column of the reduced lines needed by the current search (line i at position i * width).
+	float *costs; //Cost of the best groove from the first pending line to each cell (pending line p at position p * width).
+	long *first, *last; //The cost table covers the columns [first[p], last[p]] of pending line p.
+	size_t *path; //Column of the current groove on each pending line.
+	long *columns; //Column of each groove on the last committed line (reduced by the previous grooves).
+};
+
+/* ------------------------------------------------------------------------- *
+ *
+ * PROTOTYPES OF STATIC FUNCTIONS
+ *
+ * ------------------------------------------------------------------------- */
+
+/* ------------------------------------------------------------------------- *
+ * Calculate the energy of a pixel from its neighbours. A missing neighbour
+ * (on an edge) is replaced by the pixel itself.
+ *
+ * PARAMETERS
+ * up, down     the neighbours of the pixel above and below it
+ * left, right  the neighbours of the pixel on its left and on its right
+ *
+ * RETURN
+ * the energy of the pixel.
+ * ------------------------------------------------------------------------- */
+static inline float pixel_energy(const PNMPixel* up, const PNMPixel* down, const PNMPixel* left, const PNMPixel* right);
+
+/* ------------------------------------------------------------------------- *
+ * Give the columns, as received, of the columns [from, to] of a line of the
+ * window reduced by the grooves found so far.
+ *
+ * PARAMETERS
+ * stream       the stream
+ * i            the line index in the window
+ * from, to     the columns of the reduced line
+ * nbGrooves    the number of grooves found so far
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void map_columns(SlimmingStream* stream, size_t i, long from, long to, size_t nbGrooves);
+
+/* ------------------------------------------------------------------------- *
+ * Find the next groove over the pending lines, starting next to its column
+ * on the last committed line (anywhere on the first line of the stream),
+ * and store it in stream->path. Only the cells of the cone of the columns
+ * the groove can reach are computed.
+ *
+ * PARAMETERS
+ * stream       the stream
+ * top          the index of the first pending line in the window (0 or 1)
+ * height       the number of lines in the window
+ * width        the current width of the lines
+ * groove       the index of the groove
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void find_stream_groove(SlimmingStream* stream, size_t top, size_t height, size_t width, size_t groove);
+
+/* ------------------------------------------------------------------------- *
+ * Commit the oldest pending line: find its k grooves over the pending lines
+ * received, and write it without their pixels.
+ *
+ * PARAMETERS
+ * stream       the stream, with at least one pending line
+ * output       array of at least width - k pixels, receiving the line
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void commit_line(SlimmingStream* stream, PNMPixel* output);
+
+/* ------------------------------------------------------------------------- *
+ *
+ * IMPLEMENTATION
+ *
+ * ------------------------------------------------------------------------- */
+
+static inline float pixel_energy(const PNMPixel* up, const PNMPixel* down, const PNMPixel* left, const PNMPixel* right){
+	return (fabsf((float)up->red - (float)down->red) + fabsf((float)left->red - (float)right->red) +
+	        fabsf((float)up->green - (float)down->green) + fabsf((float)left->green - (float)right->green) +
+	        fabsf((float)up->blue - (float)down->blue) + fabsf((float)left->blue - (float)right->blue)) / 2;
+}//End pixel_energy()
+
+static void map_columns(SlimmingStream* stream, size_t i, long from, long to, size_t nbGrooves){
+	const size_t* removed = &stream->removed[i * stream->k];
+	size_t* origins = &stream->origins[i * stream->width];
+
+	//The number of grooves at the left of the first column, removed[g] - g being nondecreasing.
+	size_t low = 0, high = nbGrooves;
+
+	while(low < high){
+		size_t middle = (low + high) / 2;
+
+		if(removed[middle] - middle <= (size_t)from)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	size_t next = low;
+	size_t origin = (size_t)from + low;
+
+	//Each column of a groove at the left of (or at) a column shifts it right by one.
+	for(long j = from; j <= to; ++j, ++origin){
+		while(next < nbGrooves && removed[next] <= origin){
+			++origin;
+			++next;
+		}
+
+		origins[j] = origin;
+	}
+
+	return;
+}//End map_columns()
+
+static void find_stream_groove(SlimmingStream* stream, size_t top, size_t height, size_t width, size_t groove){
+	size_t stride = stream->width;
+	size_t nbPending = height - top;
+	size_t line = stream->nbCommitted - top;
+	float* costs = stream->costs;
+	long* first = stream->first;
+	long* last = stream->last;
+
+	//On the first pending line, the groove is next to its previous column, then moves by one column per line.
+	for(size_t p = 0; p < nbPending; ++p){
+		first[p] = p > 0 ? first[p - 1] - 1 : (top > 0 ? stream->columns[groove] - 1 : 0);
+		last[p] = p > 0 ? last[p - 1] + 1 : (top > 0 ? stream->columns[groove] + 1 : (long)width - 1);
+
+		if(first[p] < 0)
+			first[p] = 0;
+		if(last[p] > (long)width - 1)
+			last[p] = (long)width - 1;
+	}
+
+	//The energies of a pending line need its neighbours, and the columns above and below it.
+	for(size_t i = 0; i < height; ++i){
+		long from = LONG_MAX, to = LONG_MIN;
+
+		for(size_t p = (i > top ? i - top - 1 : 0); p < nbPending && p + top <= i + 1; ++p){
+			long margin = p + top == i ? 1 : 0;
+
+			from = first[p] - margin < from ? first[p] - margin : from;
+			to = last[p] + margin > to ? last[p] + margin : to;
+		}
+
+		map_columns(stream, i, from < 0 ? 0 : from, to > (long)width - 1 ? (long)width - 1 : to, groove);
+	}
+
+	for(size_t p = 0; p < nbPending; ++p){
+		size_t i = top + p;
+		const PNMPixel* pixels = &stream->lines[((line + i) % stream->nbKept) * stride];
+		const PNMPixel* above = &stream->lines[((line + (i > 0 ? i - 1 : i)) % stream->nbKept) * stride];
+		const PNMPixel* below = &stream->lines[((line + (i + 1 < height ? i + 1 : i)) % stream->nbKept) * stride];
+		const size_t* origins = &stream->origins[i * stride];
+		const size_t* originsAbove = &stream->origins[(i > 0 ? i - 1 : i) * stride];
+		const size_t* originsBelow = &stream->origins[(i + 1 < height ? i + 1 : i) * stride];
+
+		for(long j = first[p]; j <= last[p]; ++j){
+			float cost = pixel_energy(&above[originsAbove[j]], &below[originsBelow[j]],
+			                          &pixels[origins[j > 0 ? j - 1 : j]], &pixels[origins[j + 1 < (long)width ? j + 1 : j]]);
+
+			if(p > 0){
+				float best = FLT_MAX;
+
+				for(long q = j - 1; q <= j + 1; ++q){
+					if(q >= first[p - 1] && q <= last[p - 1] && costs[(p - 1) * stride + q] < best)
+						best = costs[(p - 1) * stride + q];
+				}
+
+				cost += best;
+			}
+
+			costs[p * stride + j] = cost;
+		}
+	}
+
+	//The cheapest cell of the last line (the leftmost one), then the cheapest neighbour above each cell.
+	long column = first[nbPending - 1];
+
+	for(long j = column + 1; j <= last[nbPending - 1]; ++j){
+		if(costs[(nbPending - 1) * stride + j] < costs[(nbPending - 1) * stride + column])
+			column = j;
+	}
+
+	stream->path[nbPending - 1] = (size_t)column;
+
+	for(size_t p = nbPending - 1; p-- > 0;){
+		long below = column;
+		column = -1;
+
+		for(long q = below - 1; q <= below + 1; ++q){
+			if(q >= first[p] && q <= last[p] && (column < 0 || costs[p * stride + q] < costs[p * stride + column]))
+				column = q;
+		}
+
+		stream->path[p] = (size_t)column;
+	}
+
+	return;
+}//End find_stream_groove()
+
+static void commit_line(SlimmingStream* stream, PNMPixel* output){
+	size_t line = stream->nbCommitted;
+	size_t top = line > 0 ? 1 : 0;
+	size_t height = top + (stream->nbReceived - line);
+	size_t width = stream->width;
+
+	//Each groove is searched over the lines reduced by the previous ones, then added to their grooves.
+	for(size_t groove = 0; groove < stream->k; ++groove){
+		find_stream_groove(stream, top, height, width, groove);
+
+		for(size_t i = 0; i < height; ++i){
+			size_t* removed = &stream->removed[i * stream->k];
+			size_t column = i < top ? (size_t)stream->columns[groove] : stream->path[i - top];
+			size_t origin = stream->origins[i * stream->width + column];
+			size_t low = 0, high = groove;
+
+			while(low < high){
+				size_t middle = (low + high) / 2;
+
+				if(removed[middle] < origin)
+					low = middle + 1;
+				else
+					high = middle;
+			}
+
+			memmove(&removed[low + 1], &removed[low], sizeof(size_t) * (groove - low));
+			removed[low] = origin;
+		}
+
+		stream->columns[groove] = (long)stream->path[0];
+		--width;
+	}
+
+	//The committed line, without the columns of its grooves.
+	const PNMPixel* pixels = &stream->lines[(line % stream->nbKept) * stream->width];
+	const size_t* removed = &stream->removed[top * stream->k];
+	size_t next = 0, column = 0;
+
+	for(size_t j = 0; j < stream->width; ++j){
+		if(next < stream->k && removed[next] == j){
+			++next;
+			continue;
+		}
+
+		output[column++] = pixels[j];
+	}
+
+	stream->nbCommitted++;
+
+	return;
+}//End commit_line()
+
+SlimmingStream* createSlimmingStream(size_t width, size_t k, size_t delay){
+	if(k >= width)
+		return NULL;
+
+	SlimmingStream* stream = calloc(1, sizeof(SlimmingStream));
+	if(!stream)
+		return NULL;
+
+	stream->width = width;
+	stream->k = k;
+	stream->delay = delay;
+	stream->nbKept = delay + 2;
+
+	stream->lines = malloc(sizeof(PNMPixel) * width * stream->nbKept);
+	stream->removed = malloc(sizeof(size_t) * (k > 0 ? k : 1) * stream->nbKept);
+	stream->origins = malloc(sizeof(size_t) * width * stream->nbKept);
+	stream->costs = malloc(sizeof(float) * width * (delay + 1));
+	stream->first = malloc(sizeof(long) * (delay + 1));
+	stream->last = malloc(sizeof(long) * (delay + 1));
+	stream->path = malloc(sizeof(size_t) * (delay + 1));
+	stream->columns = malloc(sizeof(long) * (k > 0 ? k : 1));
+
+	if(!stream->lines || !stream->removed || !stream->origins || !stream->costs || !stream->first || !stream->last ||
+	   !stream->path || !stream->columns){
+		freeSlimmingStream(stream);
+		return NULL;
+	}
+
+	return stream;
+}//End createSlimmingStream()
+
+int pushStreamLine(SlimmingStream* stream, const PNMPixel* line, PNMPixel* output){
+	memcpy(&stream->lines[(stream->nbReceived % stream->nbKept) * stream->width], line,
+	       sizeof(PNMPixel) * stream->width);
+	stream->nbReceived++;
+
+	if(stream->nbReceived - stream->nbCommitted <= stream->delay)
+		return 0;
+
+	commit_line(stream, output);
+
+	return 1;
+}//End pushStreamLine()
+
+int flushStreamLine(SlimmingStream* stream, PNMPixel* output){
+	if(stream->nbCommitted == stream->nbReceived)
+		return 0;
+
+	commit_line(stream, output);
+
+	return 1;
+}//End flushStreamLine()
+
+size_t getSlimmingStreamSize(const SlimmingStream* stream){
+	return sizeof(SlimmingStream) + (sizeof(PNMPixel) + sizeof(size_t)) * stream->width * stream->nbKept +
+	       sizeof(size_t) * stream->k * stream->nbKept +
+	       (sizeof(float) * stream->width + 2 * sizeof(long) + sizeof(size_t)) * (stream->delay + 1) +
+	       sizeof(long) * stream->k;
+}//End getSlimmingStreamSize()
+
+void freeSlimmingStream(SlimmingStream* stream){
+
+	if(stream){
+		free(stream->lines);
+		free(stream->removed);
+		free(stream->origins);
+		free(stream->costs);
+		free(stream->first);
+		free(stream->last);
+		free(stream->path);
+		free(stream->columns);
+		free(stream);
+	}
+
+	return;
+}//End freeSlimmingStream()
@@ -0,0 +1,101 @@
+/* ------------------------------------------------------------------------- *
+ * Interface for slimming a stream of lines of unbounded length, such as the
+ * output of a line-scan camera.
+ *
+ * The lines arrive one at a time, and k pixels are removed from each one.
+ * The grooves are found over a sliding window of the last lines received:
+ * a line is committed (its k pixels removed for good) once `delay` more
+ * lines have arrived, so that each line is emitted with a bounded delay and
+ * only O(width * delay) memory is used.
+ *
+ * For each committed line, the k grooves are searched one after the other,
+ * as reduceImageWidth() does, over the pending lines reduced by the previous
+ * grooves. Each groove starts next to its column on the previous committed
+ * line, so that the grooves stay continuous from one line to the next; the
+ * cost table then only covers the cone of the columns such a groove can
+ * reach. The rest of each groove is only a guess, revised with the next
+ * lines.
+ * ------------------------------------------------------------------------- */
+
+#ifndef _SLIMMING_STREAM_H_
+#define _SLIMMING_STREAM_H_
+
+#include <stddef.h>
+
+#include "PNM.h"
+
+// Types ----------------------------------------------------------------------
+
+typedef struct SlimmingStream_t SlimmingStream;
+
+
+// Methods --------------------------------------------------------------------
+
+/* ------------------------------------------------------------------------- *
+ * Create a stream of lines to slim.
+ * The stream must later be deleted by calling freeSlimmingStream().
+ *
+ * PARAMETERS
+ * width        Width of the lines (in pixels)
+ * k            The number of pixels to be removed from each line
+ * delay        The number of lines received after a line before it is
+ *              committed (0 to commit each line as soon as it arrives)
+ *
+ * RETURN
+ * stream       Pointer to the new stream
+ * NULL         if k is not smaller than the width, or if an allocation
+ *              failed
+ * ------------------------------------------------------------------------- */
+SlimmingStream* createSlimmingStream(size_t width, size_t k, size_t delay);
+
+/* ------------------------------------------------------------------------- *
+ * Give a line to a stream, and commit the line received `delay` lines
+ * before it, if any.
+ *
+ * PARAMETERS
+ * stream       Pointer to the stream
+ * line         The `width` pixels of the line
+ * output       Array of at least `width - k` pixels, receiving the committed
+ *              line
+ *
+ * RETURN
+ * 1            if a line was committed into output
+ * 0            if no line was committed (fewer than delay + 1 lines received)
+ * ------------------------------------------------------------------------- */
+int pushStreamLine(SlimmingStream* stream, const PNMPixel* line, PNMPixel* output);
+
+/* ------------------------------------------------------------------------- *
+ * Commit the oldest line not committed yet, at the end of a stream (the
+ * window then only holds the lines left).
+ *
+ * PARAMETERS
+ * stream       Pointer to the stream
+ * output       Array of at least `width - k` pixels, receiving the committed
+ *              line
+ *
+ * RETURN
+ * 1            if a line was committed into output
+ * 0            if every line received was already committed
+ * ------------------------------------------------------------------------- */
+int flushStreamLine(SlimmingStream* stream, PNMPixel* output);
+
+/* ------------------------------------------------------------------------- *
+ * Give the memory used by a stream.
+ *
+ * PARAMETERS
+ * stream       Pointer to the stream
+ *
+ * RETURN
+ * size         The size of the buffers of the stream (in bytes)
+ * ------------------------------------------------------------------------- */
+size_t getSlimmingStreamSize(const SlimmingStream* stream);
+
+/* ------------------------------------------------------------------------- *
+ * Free a stream.
+ *
+ * PARAMETERS
+ * stream       Pointer to the stream
+ * ------------------------------------------------------------------------- */
+void freeSlimmingStream(SlimmingStream* stream);
+
+#endif // _SLIMMING_STREAM_H_
@@ -0,0 +1,35 @@
+/* ------------------------------------------------------------------------- *
+ * Implementation of the timing interface.
+ * ------------------------------------------------------------------------- */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "timing.h"
+
+double getTimeSeconds(void){
+	struct timespec now;
+
+	if(clock_gettime(CLOCK_MONOTONIC, &now) != 0)
+		return 0.0;
+
+	return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}//End getTimeSeconds()
+
+size_t getResidentBytes(void){
+	FILE* fp = fopen("/proc/self/statm", "r");
+	if(!fp)
+		return 0;
+
+	size_t size, resident;
+	int nbRead = fscanf(fp, "%zu %zu", &size, &resident);
+	fclose(fp);
+
+	long pageSize = sysconf(_SC_PAGESIZE);
+	if(nbRead != 2 || pageSize <= 0)
+		return 0;
+
+	return resident * (size_t)pageSize;
+}//End getResidentBytes()
@@ -0,0 +1,31 @@
+/* ------------------------------------------------------------------------- *
+ * Interface for measuring elapsed time and memory use.
+ * ------------------------------------------------------------------------- */
+
+#ifndef _TIMING_H_
+#define _TIMING_H_
+
+#include <stddef.h>
+
+/* ------------------------------------------------------------------------- *
+ * Give the current time of a monotonic clock.
+ *
+ * NOTE
+ * Only differences between two values returned by this function are
+ * meaningful.
+ *
+ * RETURN
+ * time         The current time (in seconds)
+ * ------------------------------------------------------------------------- */
+double getTimeSeconds(void);
+
+/* ------------------------------------------------------------------------- *
+ * Give the resident memory of the process (its pages held in RAM), as
+ * given by /proc/self/statm.
+ *
+ * RETURN
+ * bytes        The resident memory (in bytes), 0 if it cannot be read
+ * ------------------------------------------------------------------------- */
+size_t getResidentBytes(void);
+
+#endif // _TIMING_H_
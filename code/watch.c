@@ -0,0 +1,288 @@
+/* ------------------------------------------------------------------------- *
+ * Implementation of the spool directory interface.
+ * ------------------------------------------------------------------------- */
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+
+#include "watch.h"
+#include "timing.h"
+
+//Size of the buffer receiving the inotify events.
+#define EVENTS_BUFFER_SIZE 65536
+
+//Time between two checks of the stop signal and of the counters (in milliseconds).
+#define POLL_TIMEOUT 1000
+
+//Set by the handler of SIGINT and SIGTERM.
+static volatile sig_atomic_t stopRequested = 0;
+
+/* ------------------------------------------------------------------------- *
+ *
+ * PROTOTYPES OF STATIC FUNCTIONS
+ *
+ * ------------------------------------------------------------------------- */
+
+/* ------------------------------------------------------------------------- *
+ * Handler of SIGINT and SIGTERM: ask the watch to stop.
+ *
+ * PARAMETERS
+ * signalNumber     the received signal
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void request_stop(int signalNumber);
+
+/* ------------------------------------------------------------------------- *
+ * Build the path of a file of a directory.
+ *
+ * PARAMETERS
+ * directory    the path to the directory
+ * name         the name of the file
+ *
+ * NOTE
+ * The returned pointer should be freed after usage.
+ *
+ * RETURN
+ * path, the path to the file.
+ * NULL, not enough memory.
+ * ------------------------------------------------------------------------- */
+static char* join_path(const char* directory, const char* name);
+
+/* ------------------------------------------------------------------------- *
+ * Queue the image of the spool directory with the given name, unless it is
+ * hidden.
+ *
+ * PARAMETERS
+ * scheduler    the scheduler
+ * spoolDir     the path to the spool directory
+ * outputDir    the path to the output directory
+ * name         the name of the image
+ * k            the number of pixels to be removed
+ * engine       the engine performing the reduction
+ * onlyNew      if true, the image is not queued if its output exists
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void queue_image(Scheduler* scheduler, const char* spoolDir, const char* outputDir,
+                        const char* name, size_t k, SlimmingEngine engine, bool onlyNew);
+
+/* ------------------------------------------------------------------------- *
+ * Queue the images of the spool directory whose output does not exist.
+ *
+ * PARAMETERS
+ * scheduler    the scheduler
+ * spoolDir     the path to the spool directory
+ * outputDir    the path to the output directory
+ * k            the number of pixels to be removed
+ * engine       the engine performing the reductions
+ *
+ * RETURN
+ * 0, the directory was read.
+ * -1, the directory could not be opened.
+ * ------------------------------------------------------------------------- */
+static int queue_existing_images(Scheduler* scheduler, const char* spoolDir, const char* outputDir,
+                                 size_t k, SlimmingEngine engine);
+
+/* ------------------------------------------------------------------------- *
+ * Write the counters of the scheduler on the standard error, the throughput
+ * being the one since the previous write.
+ *
+ * PARAMETERS
+ * counters     the current counters
+ * previous     the counters at the previous write
+ *
+ * RETURN
+ * /
+ * ------------------------------------------------------------------------- */
+static void print_counters(const SchedulerCounters* counters, const SchedulerCounters* previous);
+
+/* ------------------------------------------------------------------------- *
+ * Tell whether two paths name the same directory (through links, relative
+ * paths or trailing slashes), comparing their devices and inodes.
+ *
+ * PARAMETERS
+ * first, second    the paths
+ *
+ * RETURN
+ * true if they name the same directory, or if either cannot be examined.
+ * ------------------------------------------------------------------------- */
+static bool same_directory(const char* first, const char* second);
+
+/* ------------------------------------------------------------------------- *
+ *
+ * IMPLEMENTATION
+ *
+ * ------------------------------------------------------------------------- */
+
+static void request_stop(int signalNumber){
+	(void)signalNumber;
+	stopRequested = 1;
+
+	return;
+}//End request_stop()
+
+static char* join_path(const char* directory, const char* name){
+	char* path = malloc(strlen(directory) + strlen(name) + 2);
+	if(!path)
+		return NULL;
+
+	sprintf(path, "%s/%s", directory, name);
+
+	return path;
+}//End join_path()
+
+static void queue_image(Scheduler* scheduler, const char* spoolDir, const char* outputDir,
+                        const char* name, size_t k, SlimmingEngine engine, bool onlyNew){
+	if(name[0] == '.')
+		return;
+
+	char* input = join_path(spoolDir, name);
+	char* output = join_path(outputDir, name);
+
+	if(!input || !output)
+		fprintf(stderr, "watch: cannot queue '%s' (error %d)\n", name, -3);
+	else if(!onlyNew || access(output, F_OK) != 0){
+		int resultSubmit = submitJob(scheduler, input, output, k, engine);
+		if(resultSubmit < 0)
+			fprintf(stderr, "watch: cannot queue '%s' (error %d)\n", input, resultSubmit);
+	}
+
+	free(input);
+	free(output);
+
+	return;
+}//End queue_image()
+
+static int queue_existing_images(Scheduler* scheduler, const char* spoolDir, const char* outputDir,
+                                 size_t k, SlimmingEngine engine){
+	DIR* directory = opendir(spoolDir);
+	if(!directory)
+		return -1;
+
+	struct dirent* entry;
+	while((entry = readdir(directory)) != NULL){
+		if(entry->d_type == DT_REG || entry->d_type == DT_UNKNOWN)
+			queue_image(scheduler, spoolDir, outputDir, entry->d_name, k, engine, true);
+	}
+
+	closedir(directory);
+
+	return 0;
+}//End queue_existing_images()
+
+static void print_counters(const SchedulerCounters* counters, const SchedulerCounters* previous){
+	double seconds = counters->seconds - previous->seconds;
+
+	fprintf(stderr, "watch: %zu queued, %zu running, %zu done, %zu failed, %.1f images/s\n",
+	        counters->nbQueued, counters->nbRunning, counters->nbDone, counters->nbFailed,
+	        seconds > 0 ? (double)(counters->nbDone - previous->nbDone) / seconds : 0.0);
+
+	return;
+}//End print_counters()
+
+static bool same_directory(const char* first, const char* second){
+	struct stat firstStat, secondStat;
+
+	if(stat(first, &firstStat) < 0 || stat(second, &secondStat) < 0)
+		return true;
+
+	return firstStat.st_dev == secondStat.st_dev && firstStat.st_ino == secondStat.st_ino;
+}//End same_directory()
+
+int watchDirectory(Scheduler* scheduler, const char* spoolDir, const char* outputDir,
+                   size_t k, SlimmingEngine engine, double statusInterval,
+                   const char* metricsFile){
+	//The outputs written into the watched directory would be queued again as inputs.
+	if(!scheduler || !spoolDir || !outputDir || same_directory(spoolDir, outputDir))
+		return -1;
+
+	int fd = inotify_init1(IN_CLOEXEC);
+	if(fd < 0)
+		return -1;
+
+	//The files closed after being written, or moved into the directory, are complete.
+	if(inotify_add_watch(fd, spoolDir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0){
+		close(fd);
+		return -1;
+	}
+
+	//The handlers interrupt poll() without restarting it.
+	struct sigaction action, previousInterrupt, previousTerminate;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = request_stop;
+	sigemptyset(&action.sa_mask);
+
+	stopRequested = 0;
+	sigaction(SIGINT, &action, &previousInterrupt);
+	sigaction(SIGTERM, &action, &previousTerminate);
+
+	//Watching first, a file arriving during the scan cannot be missed.
+	if(queue_existing_images(scheduler, spoolDir, outputDir, k, engine) < 0){
+		sigaction(SIGINT, &previousInterrupt, NULL);
+		sigaction(SIGTERM, &previousTerminate, NULL);
+		close(fd);
+		return -1;
+	}
+
+	union{
+		struct inotify_event event;
+		char bytes[EVENTS_BUFFER_SIZE];
+	}buffer;
+
+	SchedulerCounters counters, previous;
+	getSchedulerCounters(scheduler, &previous);
+	double lastStatus = getTimeSeconds();
+
+	while(!stopRequested){
+		struct pollfd events = {fd, POLLIN, 0};
+
+		if(poll(&events, 1, POLL_TIMEOUT) > 0 && (events.revents & POLLIN)){
+			ssize_t size = read(fd, buffer.bytes, sizeof(buffer.bytes));
+
+			for(ssize_t position = 0; position < size;){
+				const struct inotify_event* event = (const struct inotify_event*)&buffer.bytes[position];
+
+				//Events were lost: the directory is scanned again.
+				if(event->mask & IN_Q_OVERFLOW)
+					queue_existing_images(scheduler, spoolDir, outputDir, k, engine);
+				else if(event->len > 0 && !(event->mask & IN_ISDIR))
+					queue_image(scheduler, spoolDir, outputDir, event->name, k, engine, false);
+
+				position += sizeof(struct inotify_event) + event->len;
+			}
+		}
+
+		if(getTimeSeconds() - lastStatus >= statusInterval){
+			getSchedulerCounters(scheduler, &counters);
+
+			if(counters.nbDone != previous.nbDone || counters.nbQueued != previous.nbQueued ||
+			   counters.nbRunning != previous.nbRunning)
+				print_counters(&counters, &previous);
+
+			if(metricsFile && exportSchedulerMetrics(scheduler, metricsFile) < 0)
+				fprintf(stderr, "watch: cannot write metrics '%s'\n", metricsFile);
+
+			previous = counters;
+			lastStatus = getTimeSeconds();
+		}
+	}//End while()
+
+	sigaction(SIGINT, &previousInterrupt, NULL);
+	sigaction(SIGTERM, &previousTerminate, NULL);
+	close(fd);
+
+	return 0;
+}//End watchDirectory()
@@ -0,0 +1,51 @@
+/* ------------------------------------------------------------------------- *
+ * Interface for slimming the images dropped into a spool directory.
+ *
+ * The directory is watched with inotify: each file closed after being
+ * written, or moved into the directory, is queued in a scheduler, whose
+ * workers persist from one image to the next. Hidden files (whose name
+ * starts with '.') are ignored, so that a file being copied under a hidden
+ * name then renamed is only queued once complete.
+ * ------------------------------------------------------------------------- */
+
+#ifndef _WATCH_H_
+#define _WATCH_H_
+
+#include <stddef.h>
+
+#include "slimming.h"
+#include "scheduler.h"
+
+// Methods --------------------------------------------------------------------
+
+/* ------------------------------------------------------------------------- *
+ * Queue the images of a spool directory in a scheduler, as they arrive,
+ * until SIGINT or SIGTERM is received. The images already in the directory
+ * whose output does not exist yet are queued first.
+ *
+ * The output of `spoolDir/name` is `outputDir/name`; the two must be
+ * different directories, whatever the paths naming them. The counters of
+ * the scheduler (backlog, running, done and failed jobs, and throughput)
+ * are written on the standard error every `statusInterval` seconds if they
+ * changed. If `metricsFile` is given, it is replaced by the metrics of the
+ * scheduler (see exportSchedulerMetrics()) at the same pace.
+ *
+ * PARAMETERS
+ * scheduler        Pointer to the scheduler running the jobs
+ * spoolDir         Path to the watched directory
+ * outputDir        Path to the directory receiving the outputs
+ * k                The number of pixels to be removed from each image
+ * engine           The engine performing the reductions
+ * statusInterval   Time between two writes of the counters (in seconds)
+ * metricsFile      Path to the metrics file (NULL for no metrics)
+ *
+ * RETURN
+ * 0            Once a stop signal was received
+ * -1           if the directory could not be watched, or if the output
+ *              directory is the watched one
+ * ------------------------------------------------------------------------- */
+int watchDirectory(Scheduler* scheduler, const char* spoolDir, const char* outputDir,
+                   size_t k, SlimmingEngine engine, double statusInterval,
+                   const char* metricsFile);
+
+#endif // _WATCH_H_